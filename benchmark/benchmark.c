@@ -13,7 +13,18 @@
 #include <logger.h>
 #include <tftp.h>
 
+/*
+ * Usage: benchmark [-o RESULT_FILE] [-f FEC_GROUP_SIZE] [-- SERVER_OPTION...]
+ * Options after -- are passed to every server started, e.g. "-o no_fast_retransmit.csv -- --fast-retransmit-threshold 0"
+ *  runs the loss grid with fast retransmission disabled and "-o reno.csv -- --congestion-control reno" with the
+ *  congestion controlled window.
+ * With -f the client asks for a FEC packet every FEC_GROUP_SIZE blocks, e.g. "-o fec8.csv -f 8 -- --fec-min-group-size 1"
+ *  runs the loss grid with a 12.5% overhead.
+ */
+
 const char *result_filepath = "benchmark_results.csv";
+char **server_extra_args = nullptr;
+int server_extra_args_count = 0;
 constexpr int iterations = 10;
 constexpr uint8_t retries = 255;
 const char *host = "::";
@@ -21,6 +32,7 @@ int current_port = 6969;
 char port_str[8] = "6969";
 uint8_t timeout_val = 1;
 uint16_t block_size_val = 1450;
+uint8_t fec_group_size_val = 0;
 
 const char *files[] = {"1MB", "10MB", "100MB"};
 constexpr int num_files = sizeof(files) / sizeof(files[0]);
@@ -47,7 +59,23 @@ static void advance_configuration(int *file_idx,
                                   int *window_size_idx,
                                   int *completed_iterations);
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[static argc + 1]) {
+int main(int argc, char *argv[static argc + 1]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "o:f:")) != -1) {
+        switch (opt) {
+            case 'o':
+                result_filepath = optarg;
+                break;
+            case 'f':
+                fec_group_size_val = (uint8_t) strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-o RESULT_FILE] [-f FEC_GROUP_SIZE] [-- SERVER_OPTION...]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    server_extra_args = &argv[optind];
+    server_extra_args_count = argc - optind;
     pid_t server_pid = -1;
     struct logger logger;
     if (!logger_init(&logger, logger_default_config)) {
@@ -133,6 +161,7 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[static argc + 1]
                                                              .timeout_s = &timeout_val,
                                                              .block_size = &block_size_val,
                                                              .window_size = &current_window_size,
+                                                             .fec_group_size = fec_group_size_val == 0 ? nullptr : &fec_group_size_val,
                                                              .use_adaptive_timeout = timeout_mode,
                                                          },
                                                          tmp);
@@ -348,15 +377,22 @@ static pid_t start_server(double loss_rate) {
         // Child process
         char loss_rate_str[8];
         snprintf(loss_rate_str, sizeof(loss_rate_str), "%.3f", loss_rate);
-        execl("./server", "server",
-              "--enable-adaptive-timeout",
-              "-l", loss_rate_str,
-              "-r", "255",
-              "-v", "warn",
-              "-p", port_str,
-              nullptr);
+        const char *fixed_args[] = {
+            "server",
+            "--enable-adaptive-timeout",
+            "-l", loss_rate_str,
+            "-r", "255",
+            "-v", "warn",
+            "-p", port_str,
+        };
+        constexpr int fixed_args_count = sizeof(fixed_args) / sizeof(fixed_args[0]);
+        const char *args[fixed_args_count + server_extra_args_count + 1];
+        memcpy(args, fixed_args, sizeof(fixed_args));
+        memcpy(&args[fixed_args_count], server_extra_args, server_extra_args_count * sizeof(*args));
+        args[fixed_args_count + server_extra_args_count] = nullptr;
+        execv("./server", (char *const *) args);
         // If execl returns, an error occurred
-        perror("execl");
+        perror("execv");
         exit(EXIT_FAILURE);
     }
     
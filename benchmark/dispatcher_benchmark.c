@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <logger.h>
+
+#include "dispatcher.h"
+
+/*
+ * Average time for a worker to submit a request and receive its completion, with an idle ring and with thousands of
+ *  sessions waiting on a pending timeout. The two latencies are expected to stay close.
+ */
+
+constexpr size_t sessions = 10'000;
+constexpr size_t samples = 100'000;
+
+static double round_trip_latency(struct dispatcher dispatcher[static 1]);
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[static argc + 1]) {
+    struct logger logger;
+    if (!logger_init(&logger, logger_default_config)) {
+        return EXIT_FAILURE;
+    }
+    struct dispatcher dispatcher;
+    struct dispatcher_event_timeout *timeouts = calloc(sessions, sizeof *timeouts);
+    if (timeouts == nullptr || !dispatcher_init(&dispatcher, sessions * 3, &logger)) {
+        fprintf(stderr, "Could not initialize the dispatcher.\n");
+        return EXIT_FAILURE;
+    }
+    const double idle_latency = round_trip_latency(&dispatcher);
+    for (size_t i = 0; i < sessions; i++) {
+        timeouts[i].timeout.tv_sec = 60;
+        if (!dispatcher_submit_timeout(&dispatcher, &timeouts[i])) {
+            fprintf(stderr, "Could not submit the timeout of session %zu.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    const double loaded_latency = round_trip_latency(&dispatcher);
+    if (idle_latency < 0 || loaded_latency < 0) {
+        return EXIT_FAILURE;
+    }
+    printf("sessions,idle_latency_us,loaded_latency_us\n");
+    printf("%zu,%.3f,%.3f\n", sessions, idle_latency * 1e6, loaded_latency * 1e6);
+    dispatcher_destroy(&dispatcher);
+    free(timeouts);
+    logger_destroy(&logger);
+    return EXIT_SUCCESS;
+}
+
+// Returns a negative value if a request fails.
+static double round_trip_latency(struct dispatcher dispatcher[static 1]) {
+    struct dispatcher_event event;
+    struct dispatcher_event *completed;
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < samples; i++) {
+        if (!dispatcher_submit(dispatcher, &event) || !dispatcher_wait_event(dispatcher, &completed)
+            || completed != &event || !completed->is_success) {
+            fprintf(stderr, "Round trip %zu failed.\n", i);
+            return -1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9) / (double) samples;
+}
@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# Runs the benchmark over a loopback impaired with netem: a bottleneck rate with a short queue and a propagation delay,
+# so that windows sent back to back overflow the queue while paced windows fit it.
+# Must be run as root from the benchmark build directory.
+#
+# Usage: netem.sh [RATE [DELAY [QUEUE_PACKETS]]]
+#
+# Each configuration writes its durations to netem_<configuration>.csv, goodput is the file size over the duration.
+# The packets sent and dropped by the bottleneck are appended to netem_drops.txt, their ratio is the loss rate caused
+# by the bursts, on top of the loss rate simulated by the server.
+#
+
+RATE=${1:-100mbit}
+DELAY=${2:-5ms}
+QUEUE_PACKETS=${3:-32}
+
+set -e
+trap 'tc qdisc del dev lo root 2>/dev/null' EXIT
+
+run() {
+    configuration=$1
+    shift
+    tc qdisc replace dev lo root netem delay "$DELAY" rate "$RATE" limit "$QUEUE_PACKETS"
+    ./benchmark -o "netem_$configuration.csv" -- "$@"
+    echo "$configuration: $(tc -s qdisc show dev lo | grep -o 'Sent .*')" >> netem_drops.txt
+}
+
+echo "rate $RATE, delay $DELAY, queue $QUEUE_PACKETS packets" >> netem_drops.txt
+run burst
+run paced --pacing
+run reno_paced --pacing --congestion-control reno
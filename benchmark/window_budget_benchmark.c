@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+
+#include <buracchi/tftp/client.h>
+#include <logger.h>
+#include <tftp.h>
+
+/*
+ * Many clients request the largest blksize and windowsize at once, for each window memory budget the aggregate
+ *  throughput and the peak resident memory of the server are recorded.
+ */
+
+const char *result_filepath = "window_budget_results.csv";
+constexpr int clients = 1000;
+constexpr uint8_t retries = 255;
+const char *host = "::";
+const char *filename = "10MB";
+int current_port = 7069;
+char port_str[8] = "7069";
+uint8_t timeout_val = 1;
+uint16_t block_size_val = 65464;
+uint16_t window_size_val = 65535;
+
+constexpr int window_memory_budgets_mib[] = {64, 256, 1024};
+constexpr int num_window_memory_budgets = sizeof(window_memory_budgets_mib) / sizeof(window_memory_budgets_mib[0]);
+
+struct client_result {
+    bool is_success;
+    size_t bytes;
+};
+
+struct rss_sampler {
+    pid_t pid;
+    atomic_bool stop;
+    long peak_kib;
+};
+
+static pid_t start_server(int window_memory_mib);
+
+static void stop_server(pid_t server_pid);
+
+static int client_run(void *arg);
+
+static int sampler_run(void *arg);
+
+static long read_rss_kib(pid_t pid);
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[static argc + 1]) {
+    FILE *result_file = fopen(result_filepath, "w");
+    if (result_file == nullptr) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(result_file, "sep=,\nWindow Memory MiB,Clients,Completed,Transfer Duration,Aggregate Throughput MiB/s,Peak RSS MiB\n");
+
+    puts("Starting Benchmarks.\n");
+
+    static thrd_t threads[clients];
+    static struct client_result results[clients];
+    for (int b = 0; b < num_window_memory_budgets; b++) {
+        const int window_memory_mib = window_memory_budgets_mib[b];
+        pid_t server_pid = start_server(window_memory_mib);
+        struct rss_sampler sampler = {.pid = server_pid};
+        thrd_t sampler_thread;
+        if (thrd_create(&sampler_thread, sampler_run, &sampler) != thrd_success) {
+            fprintf(stderr, "Failed to start the RSS sampler\n");
+            stop_server(server_pid);
+            exit(EXIT_FAILURE);
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int started = 0;
+        for (; started < clients; started++) {
+            results[started] = (struct client_result) {};
+            if (thrd_create(&threads[started], client_run, &results[started]) != thrd_success) {
+                fprintf(stderr, "Could only start %d clients\n", started);
+                break;
+            }
+        }
+        int completed = 0;
+        size_t total_bytes = 0;
+        for (int i = 0; i < started; i++) {
+            thrd_join(threads[i], nullptr);
+            if (results[i].is_success) {
+                completed++;
+                total_bytes += results[i].bytes;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        atomic_store(&sampler.stop, true);
+        thrd_join(sampler_thread, nullptr);
+        stop_server(server_pid);
+
+        double elapsed = ((double) end.tv_sec + (double) end.tv_nsec / 1e9)
+                         - ((double) start.tv_sec + (double) start.tv_nsec / 1e9);
+        double throughput = (double) total_bytes / (1024.0 * 1024.0) / elapsed;
+        double peak_rss = (double) sampler.peak_kib / 1024.0;
+        fprintf(result_file, "%d,%d,%d,%.3f,%.3f,%.3f\n",
+                window_memory_mib, started, completed, elapsed, throughput, peak_rss);
+        fflush(result_file);
+        printf("Window Memory: %d MiB\tClients: %d\tCompleted: %d\tDuration: %.3f\tThroughput: %.3f MiB/s\tPeak RSS: %.3f MiB\n",
+               window_memory_mib, started, completed, elapsed, throughput, peak_rss);
+
+        current_port++;
+        snprintf(port_str, sizeof(port_str), "%d", current_port);
+    }
+
+    fclose(result_file);
+    return EXIT_SUCCESS;
+}
+
+static int client_run(void *arg) {
+    struct client_result *result = arg;
+    struct logger logger;
+    if (!logger_init(&logger, logger_default_config)) {
+        return 0;
+    }
+    logger.config.default_level = LOGGER_LOG_LEVEL_OFF;
+    FILE *dest = fopen("/dev/null", "w");
+    if (dest == nullptr) {
+        logger_destroy(&logger);
+        return 0;
+    }
+    auto response = tftp_client_read(&logger,
+                                     retries,
+                                     host,
+                                     port_str,
+                                     filename,
+                                     TFTP_MODE_OCTET,
+                                     &(struct tftp_client_options) {
+                                         .timeout_s = &timeout_val,
+                                         .block_size = &block_size_val,
+                                         .window_size = &window_size_val,
+                                     },
+                                     dest);
+    result->is_success = response.is_success;
+    if (response.is_success) {
+        result->bytes = response.value.file_bytes_transferred;
+    }
+    fclose(dest);
+    logger_destroy(&logger);
+    return 0;
+}
+
+static int sampler_run(void *arg) {
+    struct rss_sampler *sampler = arg;
+    while (!atomic_load(&sampler->stop)) {
+        long rss_kib = read_rss_kib(sampler->pid);
+        if (rss_kib > sampler->peak_kib) {
+            sampler->peak_kib = rss_kib;
+        }
+        usleep(50'000);
+    }
+    return 0;
+}
+
+static long read_rss_kib(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *status = fopen(path, "r");
+    if (status == nullptr) {
+        return 0;
+    }
+    long rss_kib = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), status) != nullptr) {
+        if (sscanf(line, "VmRSS: %ld kB", &rss_kib) == 1) {
+            break;
+        }
+    }
+    fclose(status);
+    return rss_kib;
+}
+
+static pid_t start_server(int window_memory_mib) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pid == 0) {
+        char window_memory_str[16];
+        snprintf(window_memory_str, sizeof(window_memory_str), "%d", window_memory_mib);
+        execl("./server", "server",
+              "-w", "4",
+              "-m", "512",
+              "-r", "255",
+              "-v", "warn",
+              "-p", port_str,
+              "--window-memory", window_memory_str,
+              nullptr);
+        perror("execl");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Started server process with PID %d on port %s and window memory %d MiB\n", pid, port_str, window_memory_mib);
+    sleep(2); // Wait a few seconds for server to initialize
+    return pid;
+}
+
+static void stop_server(pid_t server_pid) {
+    printf("Sending SIGINT to server process %d\n", server_pid);
+    kill(server_pid, SIGINT);
+
+    time_t start_time = time(nullptr);
+
+    while (waitpid(server_pid, nullptr, WNOHANG) == 0) {
+        if (time(nullptr) - start_time >= 10) {
+            printf("Server process did not terminate after 10 seconds. Sending SIGKILL.\n");
+            kill(server_pid, SIGKILL);
+            continue;
+        }
+        usleep(100'000);
+    }
+
+    printf("Server process terminated\n");
+    sleep(2);
+}
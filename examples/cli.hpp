@@ -86,6 +86,7 @@ namespace TFTP {
                         type_name = std::regex_replace(type_name, std::regex(R"(\S*:?INT)"), "Integer number");
                         type_name = std::regex_replace(type_name, std::regex(R"(\S*:?FLOAT)"), "Decimal number");
                         type_name = std::regex_replace(type_name, std::regex(R"(\[(-?[0-9.]+) - (-?[0-9.]+)\])"), "range [$1, $2]");
+                        type_name = std::regex_replace(type_name, std::regex(R"(ENUM:value in \{([a-zA-Z0-9_]+)->[0-9]+, ?([a-zA-Z0-9_]+)->[0-9]+, ?([a-zA-Z0-9_]+)->[0-9]+\}.*)"), "Enum value in: {$1, $2, $3}");
                         type_name = std::regex_replace(type_name, std::regex(R"(ENUM:value in \{([a-zA-Z0-9_]+)->[0-9]+, ?([a-zA-Z0-9_]+)->[0-9]+\}.*)"), "Enum value in: {$1, $2}");
                         footer += std::format("  {}{}{}\n", option->get_option_text(), padding, type_name);
                     }
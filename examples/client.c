@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <time.h>
 
 #include <buracchi/tftp/client.h>
@@ -22,7 +24,36 @@ static struct tftp_client_response get(struct logger logger[static 1],
                                        const char filename[static 1],
                                        enum tftp_mode mode,
                                        struct tftp_client_options *options,
-                                       const char *output_path);
+                                       const char *output_path,
+                                       uint8_t segments,
+                                       bool resume,
+                                       bool if_changed);
+
+static struct tftp_client_response resume_get(struct logger logger[static 1],
+                                              uint8_t retries,
+                                              const char host[static 1],
+                                              const char port[static 1],
+                                              const char filename[static 1],
+                                              struct tftp_client_options options[static 1],
+                                              const char output_path[static 1]);
+
+static struct tftp_client_response get_if_changed(struct logger logger[static 1],
+                                                  uint8_t retries,
+                                                  const char host[static 1],
+                                                  const char port[static 1],
+                                                  const char filename[static 1],
+                                                  enum tftp_mode mode,
+                                                  struct tftp_client_options options[static 1],
+                                                  const char output_path[static 1]);
+
+static struct tftp_client_response mget(struct logger logger[static 1],
+                                        uint8_t retries,
+                                        const char host[static 1],
+                                        const char port[static 1],
+                                        size_t count,
+                                        const char *const filenames[static count],
+                                        enum tftp_mode mode,
+                                        struct tftp_client_options *options);
 
 static struct tftp_client_response put(struct logger logger[static 1],
                                        uint8_t retries,
@@ -49,11 +80,16 @@ int main(int argc, char *argv[static argc + 1]) {
     logger.config.default_level = args.verbose_level;
     auto options = (struct tftp_client_options) {
         .timeout_s = args.options.timeout_s,
+        .timeout_us = args.options.timeout_us,
         .block_size = args.options.block_size,
         .window_size = args.options.window_size,
+        .fec_group_size = args.options.fec_group_size,
         .use_tsize = args.options.use_tsize,
+        .use_sack = args.options.use_sack,
+        .use_compression = args.options.use_compression,
         .use_adaptive_timeout = args.options.adaptive_timeout,
         .is_read_type_list = args.command == CLIENT_COMMAND_LIST,
+        .is_read_type_list_detailed = args.command == CLIENT_COMMAND_LIST && args.options.detailed_listing,
     };
     struct tftp_client_response response = {};
     bool is_retry = false;
@@ -82,7 +118,20 @@ int main(int argc, char *argv[static argc + 1]) {
                                args.command_args.get.filename,
                                args.command_args.get.mode,
                                options_ptr,
-                               args.command_args.get.output);
+                               args.command_args.get.output,
+                               args.command_args.get.segments,
+                               args.command_args.get.resume,
+                               args.command_args.get.if_changed);
+                break;
+            case CLIENT_COMMAND_MGET:
+                response = mget(&logger,
+                                args.retries,
+                                args.host,
+                                args.port,
+                                args.command_args.mget.count,
+                                args.command_args.mget.filenames,
+                                args.command_args.mget.mode,
+                                options_ptr);
                 break;
             case CLIENT_COMMAND_PUT:
                 response = put(&logger,
@@ -119,11 +168,28 @@ static struct tftp_client_response get(struct logger logger[static 1],
                                        const char filename[static 1],
                                        enum tftp_mode mode,
                                        struct tftp_client_options *options,
-                                       const char *output_path) {
+                                       const char *output_path,
+                                       uint8_t segments,
+                                       bool resume,
+                                       bool if_changed) {
     FILE *output;
     if (output_path == nullptr) {
         output_path = filename;
     }
+    if ((resume || segments > 1) && (options == nullptr || mode != TFTP_MODE_OCTET)) {
+        logger_log_error(logger, "Ranged downloads require octet mode and the offset and length options.");
+        goto fail;
+    }
+    if (if_changed && (resume || segments > 1)) {
+        logger_log_error(logger, "Only whole file downloads can be skipped when the output file is unchanged.");
+        goto fail;
+    }
+    if (resume) {
+        return resume_get(logger, retries, host, port, filename, options, output_path);
+    }
+    if (if_changed && options != nullptr) {
+        return get_if_changed(logger, retries, host, port, filename, mode, options, output_path);
+    }
     const int fd = open(output_path, O_CREAT | O_WRONLY | O_EXCL, S_IRUSR | S_IWUSR);
     const bool output_file_already_exist = (fd == -1 && errno == EEXIST);
     if (fd == -1 && !output_file_already_exist) {
@@ -146,7 +212,9 @@ static struct tftp_client_response get(struct logger logger[static 1],
         fclose(output);
         goto fail;
     }
-    auto response = tftp_client_read(logger, retries, host, port, filename, mode, options, tmp);
+    auto response = segments > 1
+                    ? tftp_client_read_parallel(logger, retries, host, port, filename, options, segments, tmp)
+                    : tftp_client_read(logger, retries, host, port, filename, mode, options, tmp);
     if (!response.is_success) {
         goto fail2;
     }
@@ -179,6 +247,139 @@ fail:
     };
 }
 
+// Blocks are written in place after the bytes already in the output file, which is kept on failure.
+static struct tftp_client_response resume_get(struct logger logger[static 1],
+                                              uint8_t retries,
+                                              const char host[static 1],
+                                              const char port[static 1],
+                                              const char filename[static 1],
+                                              struct tftp_client_options options[static 1],
+                                              const char output_path[static 1]) {
+    const int fd = open(output_path, O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
+    struct stat output_stat;
+    if (fd == -1 || fstat(fd, &output_stat) == -1) {
+        logger_log_error(logger, "Could not open file %s for writing. %s", output_path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return (struct tftp_client_response) {
+            .is_success = false,
+            .error.server_may_not_support_options = false,
+        };
+    }
+    FILE *output = fdopen(fd, "wb");
+    if (output == nullptr) {
+        logger_log_error(logger, "Could not open file %s for writing. %s", output_path, strerror(errno));
+        close(fd);
+        return (struct tftp_client_response) {
+            .is_success = false,
+            .error.server_may_not_support_options = false,
+        };
+    }
+    size_t offset = output_stat.st_size;
+    logger_log_info(logger, "Resuming download of %s from byte %zu.", filename, offset);
+    options->offset = &offset;
+    auto response = tftp_client_read(logger, retries, host, port, filename, TFTP_MODE_OCTET, options, output);
+    options->offset = nullptr;
+    if (fclose(output) == EOF) {
+        logger_log_warn(logger, "Failed to close the output file. %s", strerror(errno));
+    }
+    return response;
+}
+
+// The output file is rewritten only after the whole file is received, it is left untouched when unchanged.
+static struct tftp_client_response get_if_changed(struct logger logger[static 1],
+                                                  uint8_t retries,
+                                                  const char host[static 1],
+                                                  const char port[static 1],
+                                                  const char filename[static 1],
+                                                  enum tftp_mode mode,
+                                                  struct tftp_client_options options[static 1],
+                                                  const char output_path[static 1]) {
+    FILE *local_copy = fopen(output_path, "rb");
+    if (local_copy == nullptr) {
+        if (errno != ENOENT) {
+            logger_log_warn(logger, "Could not open file %s for reading. %s", output_path, strerror(errno));
+        }
+        return get(logger, retries, host, port, filename, mode, options, output_path, 1, false, false);
+    }
+    FILE *tmp = tmpfile();
+    if (tmp == nullptr) {
+        logger_log_error(logger, "Could not create temporary file. %s", strerror(errno));
+        fclose(local_copy);
+        return (struct tftp_client_response) {
+            .is_success = false,
+            .error.server_may_not_support_options = false,
+        };
+    }
+    options->local_copy = local_copy;
+    auto response = tftp_client_read(logger, retries, host, port, filename, mode, options, tmp);
+    options->local_copy = nullptr;
+    fclose(local_copy);
+    if (response.is_success && response.value.is_unchanged) {
+        logger_log_info(logger, "%s is up to date.", output_path);
+    }
+    else if (response.is_success) {
+        FILE *output = fopen(output_path, "wb");
+        if (output == nullptr) {
+            logger_log_error(logger, "Could not open file %s for writing. %s", output_path, strerror(errno));
+            response.is_success = false;
+            response.error.server_may_not_support_options = false;
+        }
+        else {
+            if (!copy_file_contents(output, tmp, logger)) {
+                logger_log_error(logger, "Failed to copy the temporary file contents into the output file.");
+                response.is_success = false;
+                response.error.server_may_not_support_options = false;
+            }
+            if (fclose(output) == EOF) {
+                logger_log_warn(logger, "Failed to close the output file. %s", strerror(errno));
+            }
+        }
+    }
+    if (fclose(tmp) == EOF) {
+        logger_log_warn(logger, "Failed to close the temporary file. %s", strerror(errno));
+    }
+    return response;
+}
+
+static struct tftp_client_response mget(struct logger logger[static 1],
+                                        uint8_t retries,
+                                        const char host[static 1],
+                                        const char port[static 1],
+                                        size_t count,
+                                        const char *const filenames[static count],
+                                        enum tftp_mode mode,
+                                        struct tftp_client_options *options) {
+    struct tftp_client_response response = {
+        .is_success = false,
+        .error.server_may_not_support_options = false,
+    };
+    FILE **outputs = calloc(count, sizeof *outputs);
+    if (outputs == nullptr) {
+        logger_log_error(logger, "Could not allocate the output files. %s", strerror(errno));
+        return response;
+    }
+    size_t opened = 0;
+    for (; opened < count; opened++) {
+        outputs[opened] = fopen(filenames[opened], "wb");
+        if (outputs[opened] == nullptr) {
+            logger_log_error(logger, "Could not open file %s for writing. %s", filenames[opened], strerror(errno));
+            break;
+        }
+    }
+    if (opened == count) {
+        response = tftp_client_read_files(logger, retries, host, port, count, filenames, mode, options, outputs);
+    }
+    for (size_t i = 0; i < opened; i++) {
+        if (fclose(outputs[i]) == EOF) {
+            logger_log_warn(logger, "Failed to close the output file. %s", strerror(errno));
+        }
+    }
+    free(outputs);
+    return response;
+}
+
 static struct tftp_client_response put(struct logger logger[static 1],
                                        uint8_t retries,
                                        const char host[static 1],
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <map>
 #include <print>
+#include <vector>
 
 #include <CLI/CLI.hpp>
 
@@ -32,6 +33,9 @@ namespace TFTP::Client {
             add_option("-t,--timeout", timeout_val, "Timeout in seconds for response")
                 ->check(CLI::Range(1, 255))
                 ->option_text("SECONDS");
+            add_option("-u,--utimeout", utimeout_val, "Timeout in microseconds for response, overrides --timeout")
+                ->check(CLI::Range(1000, 255000000))
+                ->option_text("MICROSECONDS");
             add_option("-b,--block-size", block_size_val, "Size of the data block for file transfer")
                 ->check(CLI::Range(8, 65464))
                 ->option_text("BLOCK_SIZE");
@@ -40,6 +44,11 @@ namespace TFTP::Client {
                 ->option_text("WINDOW_SIZE");
             add_flag("-a,--adaptive-timeout", args->options.adaptive_timeout, "Enable adaptive timeout based on network delays");
             add_flag("--use-tsize", args->options.use_tsize, "Request file size from the server");
+            add_option("-f,--fec", fec_group_size_val, "Request a FEC packet after each group of GROUP_SIZE blocks, lost blocks are rebuilt without waiting for a retransmission")
+                ->check(CLI::Range(1, 255))
+                ->option_text("GROUP_SIZE");
+            add_flag("--sack", args->options.use_sack, "Request selective acknowledgements, out of order blocks of a window are kept and only the missing ones are resent");
+            add_flag("-z,--compress", args->options.use_compression, "Request downloaded files compressed, they are decompressed as they are received");
             add_option("-l,--loss-probability", args->loss_probability, "Simulated packet loss probability")
                 ->default_val("0.0")
                 ->check(CLI::Range(0.0, 1.0))
@@ -54,8 +63,10 @@ namespace TFTP::Client {
                 args->host = strdup(host.c_str());
                 args->port = strdup(port.c_str());
                 args->options.timeout_s = (timeout_val == 0) ? nullptr : new uint8_t(timeout_val);
+                args->options.timeout_us = (utimeout_val == 0) ? nullptr : new uint32_t(utimeout_val);
                 args->options.block_size = (block_size_val == 0) ? nullptr : new uint16_t(block_size_val);
                 args->options.window_size = (window_size_val == 0) ? nullptr : new uint16_t(window_size_val);
+                args->options.fec_group_size = (fec_group_size_val == 0) ? nullptr : new uint8_t(fec_group_size_val);
             });
             
             require_subcommand();
@@ -69,6 +80,7 @@ namespace TFTP::Client {
                 ->transform(CLI::CheckedTransformer(tftp_mode_map, CLI::ignore_case))
                 ->option_text("MODE")
                 ->default_val("octet");
+            list_cmd->add_flag("-l,--long", args->options.detailed_listing, "Show size and modification time of each file");
             list_cmd->callback([this, args]() {
                 args->command = CLIENT_COMMAND_LIST;
                 args->command_args.list.directory = strdup(filename.c_str());
@@ -86,12 +98,36 @@ namespace TFTP::Client {
                 ->default_val("octet");
             get_cmd->add_option("-o,--output", output, "Output file name")
                 ->option_text("OUTPUT_FILE");
+            get_cmd->add_option("-s,--segments", args->command_args.get.segments, "Split the file in SEGMENTS ranges downloaded concurrently by separate sessions")
+                ->default_val("1")
+                ->check(CLI::Range(1, 64))
+                ->option_text("SEGMENTS");
+            get_cmd->add_flag("-c,--continue", args->command_args.get.resume, "Resume an interrupted download from the end of the output file");
+            get_cmd->add_flag("--if-changed", args->command_args.get.if_changed, "Download the file only if the server content differs from the output file, using the digest option");
             get_cmd->callback([this, args]() {
                 args->command = CLIENT_COMMAND_GET;
                 args->command_args.get.filename = strdup(filename.c_str());
                 args->command_args.get.output = output.empty() ? nullptr : strdup(output.c_str());
             });
             
+            auto *mget_cmd = add_subcommand("mget", "Download several files from the server on a single session");
+            mget_cmd->fallthrough(true);
+            mget_cmd->add_option("filenames", filenames, "Files to download, each one is saved with its name")
+                ->option_text("FILENAME...")
+                ->required();
+            mget_cmd->add_option("-m,--mode", args->command_args.mget.mode, "Transfer mode")
+                ->transform(CLI::CheckedTransformer(tftp_mode_map, CLI::ignore_case))
+                ->option_text("MODE")
+                ->default_val("octet");
+            mget_cmd->callback([this, args]() {
+                args->command = CLIENT_COMMAND_MGET;
+                args->command_args.mget.count = filenames.size();
+                args->command_args.mget.filenames = new const char *[filenames.size()];
+                for (size_t i = 0; i < filenames.size(); i++) {
+                    args->command_args.mget.filenames[i] = strdup(filenames[i].c_str());
+                }
+            });
+            
             auto *put_cmd = add_subcommand("put", "Upload a file to the server");
             put_cmd->fallthrough(true);
             put_cmd->add_option("filename", filename, "File to upload")
@@ -114,10 +150,13 @@ namespace TFTP::Client {
         std::string host;
         std::string port;
         std::string filename;
+        std::vector<std::string> filenames;
         std::string output;
         int timeout_val = 0;
+        uint32_t utimeout_val = 0;
         int block_size_val = 0;
         int window_size_val = 0;
+        int fec_group_size_val = 0;
     };
 }
 
@@ -147,6 +186,12 @@ void cli_args_destroy(cli_args *args) {
         free((void *) args->command_args.get.filename);
         free((void *) args->command_args.get.output);
     }
+    else if (args->command == CLIENT_COMMAND_MGET) {
+        for (size_t i = 0; i < args->command_args.mget.count; i++) {
+            free((void *) args->command_args.mget.filenames[i]);
+        }
+        delete[] args->command_args.mget.filenames;
+    }
     else if (args->command == CLIENT_COMMAND_PUT) {
         free((void *) args->command_args.put.filename);
     }
@@ -154,6 +199,8 @@ void cli_args_destroy(cli_args *args) {
         free((void *) args->command_args.list.directory);
     }
     delete args->options.timeout_s;
+    delete args->options.timeout_us;
     delete args->options.block_size;
     delete args->options.window_size;
+    delete args->options.fec_group_size;
 }
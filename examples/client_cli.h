@@ -18,6 +18,7 @@ extern "C" {
 enum command {
     CLIENT_COMMAND_LIST,
     CLIENT_COMMAND_GET,
+    CLIENT_COMMAND_MGET,
     CLIENT_COMMAND_PUT,
 };
 
@@ -26,7 +27,15 @@ union command_args {
         enum tftp_mode mode;            // transfer mode to use for the file transfer
         const char *filename;           // file to download from the server
         const char *output;             // file to save the downloaded file to
+        uint8_t segments;               // concurrent sessions each reading a range of the file, octet mode only
+        bool resume;                    // continue an interrupted download from the size of the output file
+        bool if_changed;                // skip the download when the output file has the content of the server one
     } get;
+    struct mget_args {
+        enum tftp_mode mode;            // transfer mode to use for the file transfer
+        size_t count;
+        const char **filenames;         // files to download on a single session, saved with the same names
+    } mget;
     struct put_args {
         enum tftp_mode mode;            // transfer mode to use for the file transfer
         const char *filename;           // file to upload to the server
@@ -39,10 +48,15 @@ union command_args {
 
 struct options {
     uint8_t *timeout_s;                     // duration of the timeout to use for the Go-Back N protocol, in seconds
+    uint32_t *timeout_us;                   // sub-second duration of the timeout, in microseconds, overrides timeout_s
     uint16_t *block_size;                   // size of the data block to use for the file transfer
     uint16_t *window_size;                  // size of the dispatch window to use for the Go-Back N protocol
+    uint8_t *fec_group_size;                // blocks protected by each FEC packet, the overhead is one packet per group
     bool use_tsize;                         // flag to request the file size from the server
+    bool use_sack;                          // flag to request selective acknowledgements of the blocks of a window
+    bool use_compression;                   // flag to request files compressed by the server
     bool adaptive_timeout;                  // flag to use an adaptive timeout calculated dynamically based on network delays
+    bool detailed_listing;                  // flag to request size and modification time of listed files
 };
 
 struct cli_args {
@@ -66,9 +66,31 @@ int main(int argc, char *argv[static argc + 1]) {
             .root = args.root,
             .retries = args.retries,
             .timeout_s = args.timeout_s,
+            .fast_retransmit_threshold = args.fast_retransmit_threshold,
+            .min_fec_group_size = args.fec_min_group_size,
+            .congestion_control = args.congestion_control,
             .workers = args.workers,
             .max_worker_sessions = args.max_worker_sessions,
+            .max_cached_file_descriptors = args.max_cached_file_descriptors,
+            .content_cache_max_bytes = (uint64_t) args.content_cache_size_mib << 20,
+            .content_cache_max_file_size = (uint64_t) args.content_cache_max_file_size_mib << 20,
+            .content_cache_manifest = args.content_cache_manifest,
+            .negative_cache_max_entries = args.negative_cache_size,
+            .negative_cache_ttl_ms = args.negative_cache_ttl_ms,
+            .listing_cache_max_entries = args.listing_cache_size,
+            .window_memory_max_bytes = (uint64_t) args.window_memory_mib << 20,
+            .rtt_cache_max_entries = args.rtt_cache_size,
+            .digest_cache_max_entries = args.digest_cache_size,
+            .slab_max_cached_bytes = (uint64_t) args.slab_cache_size_mib << 20,
+            .is_slab_huge_pages_enabled = args.enable_slab_huge_pages,
+            .socket_pool_size = args.socket_pool_size,
+            .shared_socket_port = args.shared_socket_port,
+            .shared_sockets_per_worker = args.shared_sockets_per_worker,
+            .is_content_cache_huge_pages_enabled = args.enable_content_cache_huge_pages,
+            .is_content_cache_mlock_enabled = args.enable_content_cache_mlock,
             .is_adaptive_timeout_enabled = args.enable_adaptive_timeout,
+            .is_pacing_enabled = args.enable_pacing,
+            .is_compression_enabled = args.enable_compression,
             .is_write_request_enabled = args.enable_write_requests,
             .is_list_request_enabled = args.enable_list_requests,
             .server_stats_callback = print_server_stats,
@@ -123,6 +145,8 @@ static void print_session_stats(struct tftp_session_stats stats[static 1]) {
     logger_log_info(stats->logger, "\tBlock size: %zu", stats->blksize);
     logger_log_info(stats->logger, "\tWindow size: %d", stats->window_size);
     logger_log_info(stats->logger, "\tRetransmits: %d", stats->retransmits);
+    logger_log_info(stats->logger, "\tFast retransmits: %d", stats->fast_retransmits);
+    logger_log_info(stats->logger, "\tCongestion window: %d", stats->congestion_window);
     logger_log_info(stats->logger, "\tServer port: %d", stats->server_port);
     logger_log_info(stats->logger, "\tClient port: %d", stats->peer_port);
 }
@@ -140,5 +164,12 @@ static bool print_server_stats(struct tftp_server_stats stats[static 1]) {
     }
     logger_log_info(stats->logger, "Server stats - every %d seconds", stats->interval);
     logger_log_info(stats->logger, "Number of spawned TFTP sessions in stats time frame : %lu", counters.sessions_count);
+    logger_log_info(stats->logger, "Content cache hits in stats time frame : %lu", counters.content_cache_hits);
+    logger_log_info(stats->logger, "Content cache misses in stats time frame : %lu", counters.content_cache_misses);
+    logger_log_info(stats->logger, "Requests for missing files answered from the negative cache in stats time frame : %lu", counters.negative_cache_hits);
+    logger_log_info(stats->logger, "Sessions with a window reduced by the memory budget in stats time frame : %lu", counters.window_budget_clamps);
+    logger_log_info(stats->logger, "Session buffers allocated in stats time frame : %lu (%lu recycled)", counters.slab_allocations, counters.slab_reuses);
+    logger_log_info(stats->logger, "Session buffers memory : %lu bytes in use, %lu bytes kept for reuse", counters.slab_bytes_in_use, counters.slab_bytes_cached);
+    logger_log_info(stats->logger, "Sessions that had to create their socket in stats time frame : %lu", counters.socket_pool_misses);
     return true;
 }
@@ -23,6 +23,12 @@ For more details, refer to RFC1350.
 
 namespace TFTP::Server {
     
+    static const std::map<std::string, enum tftp_congestion_control> congestion_control_map{
+        {"none",  TFTP_CONGESTION_CONTROL_NONE},
+        {"reno",  TFTP_CONGESTION_CONTROL_RENO},
+        {"vegas", TFTP_CONGESTION_CONTROL_VEGAS},
+    };
+    
     class CLIParser final : public TFTP::CLIParser {
     public:
         explicit CLIParser(const std::shared_ptr<cli_args>& args) : TFTP::CLIParser("TFTP Server") {
@@ -32,6 +38,7 @@ namespace TFTP::Server {
             
             const std::string BasicOptionsStr = "Basic Options";
             const std::string NetworkSettingsStr = "Network Settings";
+            const std::string PerformanceTuningStr = "Performance Tuning";
             const std::string DebuggingAndSimulationStr = "Debugging and Simulation";
             
             get_option("--help")->group(BasicOptionsStr);
@@ -83,6 +90,102 @@ namespace TFTP::Server {
                 ->default_val("2")
                 ->check(CLI::Range(1, 255))
                 ->option_text("SECONDS");
+            add_option("--fast-retransmit-threshold", args->fast_retransmit_threshold, "Duplicate ACKs after which the window is resent without waiting for the timeout, 0 to disable")
+                ->group(NetworkSettingsStr)
+                ->default_val("3")
+                ->check(CLI::Range(0, 255))
+                ->option_text("ACKS");
+            add_option("--fec-min-group-size", args->fec_min_group_size, "Smallest group of DATA packets a client can ask to protect with a FEC packet, bounding the overhead to one packet per group, 0 to disable")
+                ->group(NetworkSettingsStr)
+                ->default_val("4")
+                ->check(CLI::Range(0, 255))
+                ->option_text("BLOCKS");
+            add_option("--congestion-control", args->congestion_control, "Algorithm adapting the DATA packets in flight, up to the negotiated window size, to the network conditions")
+                ->group(NetworkSettingsStr)
+                ->transform(CLI::CheckedTransformer(congestion_control_map, CLI::ignore_case))
+                ->default_val("none")
+                ->option_text("ALGORITHM");
+            add_flag("--pacing", args->enable_pacing, "Spread the DATA packets of each window over the round trip time instead of sending them back to back")
+                ->group(NetworkSettingsStr);
+            add_flag("--compression", args->enable_compression, "Send files held in the content cache compressed to clients negotiating the compress option, each file is compressed once")
+                ->group(NetworkSettingsStr);
+            
+            // Performance Tuning Group
+            add_option("--fd-cache-size", args->max_cached_file_descriptors, "Maximum number of open files shared between sessions, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("256")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("FILES");
+            add_option("--content-cache-size", args->content_cache_size_mib, "Memory budget for files served from memory, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("128")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("MiB");
+            add_option("--content-cache-max-file-size", args->content_cache_max_file_size_mib, "Size of the largest file served from memory")
+                ->group(PerformanceTuningStr)
+                ->default_val("32")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("MiB");
+            add_option("--content-cache-preload", content_cache_manifest, "File listing paths, relative to the root directory, to load in memory on startup")
+                ->group(PerformanceTuningStr)
+                ->check(CLI::ExistingFile)
+                ->option_text("FILE");
+            add_flag("--content-cache-huge-pages", args->enable_content_cache_huge_pages, "Back files served from memory with huge pages")
+                ->group(PerformanceTuningStr);
+            add_flag("--content-cache-mlock", args->enable_content_cache_mlock, "Lock files served from memory in RAM")
+                ->group(PerformanceTuningStr);
+            add_option("--negative-cache-size", args->negative_cache_size, "Maximum number of missing files remembered to answer repeated requests quickly, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("1024")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("FILES");
+            add_option("--negative-cache-ttl", args->negative_cache_ttl_ms, "How long a missing file is remembered")
+                ->group(PerformanceTuningStr)
+                ->default_val("5000")
+                ->check(CLI::Range(1, 3600000))
+                ->option_text("MILLISECONDS");
+            add_option("--listing-cache-size", args->listing_cache_size, "Maximum number of directory listings shared between list requests, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("64")
+                ->check(CLI::Range(0, 65536))
+                ->option_text("DIRECTORIES");
+            add_option("--window-memory", args->window_memory_mib, "Memory budget shared by the DATA windows of all sessions, larger blksize and windowsize requests are reduced to fit, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("1024")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("MiB");
+            add_option("--rtt-cache-size", args->rtt_cache_size, "Maximum number of peers whose round trip time seeds the adaptive timeout of their next sessions, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("4096")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("PEERS");
+            add_option("--digest-cache-size", args->digest_cache_size, "Maximum number of file versions whose content digest is remembered for the digest option, 0 to disable the option")
+                ->group(PerformanceTuningStr)
+                ->default_val("4096")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("FILES");
+            add_option("--slab-cache-size", args->slab_cache_size_mib, "Memory budget of each worker for freed session buffers kept for reuse, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("16")
+                ->check(CLI::Range(0, 1048576))
+                ->option_text("MiB");
+            add_flag("--slab-huge-pages", args->enable_slab_huge_pages, "Back session buffers of 2 MiB or more with huge pages")
+                ->group(PerformanceTuningStr);
+            add_option("--socket-pool-size", args->socket_pool_size, "Number of pre-bound session sockets each worker keeps ready for each address family, 0 to disable")
+                ->group(PerformanceTuningStr)
+                ->default_val("64")
+                ->check(CLI::Range(0, 65535))
+                ->option_text("SOCKETS");
+            add_option("--shared-socket-port", args->shared_socket_port, "First port of the sockets each worker shares between its sessions, sessions get a socket each if 0")
+                ->group(PerformanceTuningStr)
+                ->default_val("0")
+                ->check(CLI::Range(0, 65535))
+                ->option_text("PORT");
+            add_option("--shared-sockets", args->shared_sockets_per_worker, "Number of shared sockets of each worker, on consecutive ports")
+                ->group(PerformanceTuningStr)
+                ->default_val("4")
+                ->check(CLI::Range(1, 1024))
+                ->option_text("SOCKETS");
             
             // Debugging and Simulation Group
             add_option("-l,--loss-probability", args->loss_probability, "Simulated packet loss probability")
@@ -110,6 +213,7 @@ namespace TFTP::Server {
                     root = root_path.string();
                 }
                 args->root = strdup(root.c_str());
+                args->content_cache_manifest = count("--content-cache-preload") ? strdup(content_cache_manifest.c_str()) : nullptr;
             });
             
             format();
@@ -119,6 +223,7 @@ namespace TFTP::Server {
         std::string host;
         std::string port;
         std::string root;
+        std::string content_cache_manifest;
     };
 }
 
@@ -145,4 +250,5 @@ void cli_args_destroy(struct cli_args *args) {
     free((void *) args->host);
     free((void *) args->port);
     free((void *) args->root);
+    free((void *) args->content_cache_manifest);
 }
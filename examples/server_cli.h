@@ -12,6 +12,7 @@ extern "C" {
 #endif
 
 #include <logger.h>
+#include <buracchi/tftp/server_congestion_control.h>
 
 struct cli_args {
     const char *host;                       // host to listen on
@@ -19,14 +20,36 @@ struct cli_args {
     const char *root;                       // file root directory
     uint16_t workers;                       // number of worker threads to use
     uint16_t max_worker_sessions;           // maximum number of sessions a worker can handle
+    uint32_t max_cached_file_descriptors;   // maximum number of read-only file descriptors shared between sessions
+    uint32_t content_cache_size_mib;        // memory budget in MiB for files served from memory
+    uint32_t content_cache_max_file_size_mib; // size in MiB of the largest file served from memory
+    const char *content_cache_manifest;     // list of files to load in memory on startup
+    uint32_t negative_cache_size;           // maximum number of missing files remembered
+    uint32_t negative_cache_ttl_ms;         // how long a missing file is remembered
+    uint32_t listing_cache_size;            // maximum number of rendered directory listings kept in memory
+    uint32_t window_memory_mib;             // memory budget in MiB for the DATA windows of all sessions
+    uint32_t rtt_cache_size;                // maximum number of peers whose round trip time is remembered
+    uint32_t digest_cache_size;             // maximum number of file versions whose digest is remembered
+    uint32_t slab_cache_size_mib;           // memory budget in MiB per worker for freed session buffers kept for reuse
+    uint16_t socket_pool_size;              // idle pre-bound session sockets kept by each worker per address family
+    uint16_t shared_socket_port;            // first port of the sockets shared by the sessions of each worker, 0 disables
+    uint16_t shared_sockets_per_worker;     // shared sockets bound by each worker
     uint8_t retries;                        // number of retries to attempt before giving up
     uint8_t timeout_s;                      // duration of the timeout in seconds
+    uint8_t fast_retransmit_threshold;      // duplicate ACKs that trigger a retransmission before the timeout
+    uint8_t fec_min_group_size;             // smallest group of blocks protected by a FEC packet, 0 disables FEC
+    enum tftp_congestion_control congestion_control; // algorithm bounding the DATA packets in flight
     double loss_probability;                // probability of packet loss to simulate
     enum logger_log_level verbose_level;    // verbose level to output additional information
     bool enable_write_requests;             // flag to enable write requests
     bool enable_list_requests;              // flag to enable list requests
     bool enable_adaptive_timeout;           // flag to enable adaptive timeout requests calculated dynamically based on network delays
+    bool enable_pacing;                     // flag to spread the DATA packets of a window over the round trip time
+    bool enable_compression;                // flag to serve compressed cached files to clients asking for it
     bool disable_fixed_seed;                // flag to disable fixed random seed
+    bool enable_content_cache_huge_pages;   // flag to back cached files with huge pages
+    bool enable_content_cache_mlock;        // flag to lock cached files in memory
+    bool enable_slab_huge_pages;            // flag to back large session buffers with huge pages
 };
 
 bool cli_args_parse(struct cli_args* args, int argc, const char *argv[]);
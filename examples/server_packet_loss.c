@@ -9,12 +9,15 @@
 #include <string.h>
 
 #include "dispatcher.h"
+#include "session.h"
 
 struct recv_data {
     struct dispatcher *dispatcher;
     struct dispatcher_event *event;
     int fd;
-    struct msghdr *msghdr;
+    struct msghdr *msghdr;      // nullptr for plain receives
+    void *buffer;
+    size_t n_bytes;
     unsigned flags;
     struct dispatcher_event discard_event;
 };
@@ -89,6 +92,45 @@ bool __wrap_dispatcher_submit_recvmsg(struct dispatcher dispatcher[static 1],
 }
 
 
+bool __real_dispatcher_submit_recv(struct dispatcher dispatcher[static 1],
+                                   struct dispatcher_event event[static 1],
+                                   int fd,
+                                   void *buffer,
+                                   size_t n_bytes,
+                                   int flags);
+
+bool __wrap_dispatcher_submit_recv(struct dispatcher dispatcher[static 1],
+                                   struct dispatcher_event event[static 1],
+                                   int fd,
+                                   void *buffer,
+                                   size_t n_bytes,
+                                   int flags) {
+    if ((rand() / (double) RAND_MAX) < packet_loss_probability) {
+        struct recv_data *data = malloc(sizeof *data);
+        *data = (struct recv_data) {
+            .dispatcher = dispatcher,
+            .event = event,
+            .fd = fd,
+            .msghdr = nullptr,
+            .buffer = buffer,
+            .n_bytes = n_bytes,
+            .flags = flags,
+            .discard_event = {
+                .id = (uint64_t) data
+            }
+        };
+        return __real_dispatcher_submit_recv(
+            &global_dispatcher,
+            &data->discard_event,
+            fd,
+            buffer,
+            n_bytes,
+            flags);
+    }
+    return __real_dispatcher_submit_recv(dispatcher, event, fd, buffer, n_bytes, flags);
+}
+
+
 ssize_t __real_recvmsg(int sockfd, struct msghdr *message, int flags);
 
 ssize_t __wrap_recvmsg(int sockfd, struct msghdr *message, int flags) {
@@ -116,6 +158,43 @@ ssize_t __wrap_sendto(int sockfd, const void *buffer, size_t len, int flags,
     return __real_sendto(sockfd, buffer, len, flags, dest_addr, addrlen);
 }
 
+
+ssize_t __real_send(int sockfd, const void *buffer, size_t len, int flags);
+
+ssize_t __wrap_send(int sockfd, const void *buffer, size_t len, int flags) {
+    if (rand() / (double) RAND_MAX < packet_loss_probability) {
+        logger_log_debug(global_logger, "Packet was not sent to simulate packet loss.");
+        return len;
+    }
+    return __real_send(sockfd, buffer, len, flags);
+}
+
+
+ssize_t __real_sendmsg(int sockfd, const struct msghdr *message, int flags);
+
+ssize_t __wrap_sendmsg(int sockfd, const struct msghdr *message, int flags) {
+    if (rand() / (double) RAND_MAX < packet_loss_probability) {
+        logger_log_debug(global_logger, "Packet was not sent to simulate packet loss.");
+        size_t len = 0;
+        for (size_t i = 0; i < message->msg_iovlen; i++) {
+            len += message->msg_iov[i].iov_len;
+        }
+        return len;
+    }
+    return __real_sendmsg(sockfd, message, flags);
+}
+
+enum tftp_session_state __real_tftp_session_handle_packet(struct tftp_session session[static 1], const void *packet, size_t packet_size);
+
+// Packets of the shared sockets are demultiplexed by the worker and handed over to the session.
+enum tftp_session_state __wrap_tftp_session_handle_packet(struct tftp_session session[static 1], const void *packet, size_t packet_size) {
+    if ((rand() / (double) RAND_MAX) < packet_loss_probability) {
+        logger_log_debug(global_logger, "Received packet was discarded to simulate packet loss.");
+        return TFTP_SESSION_STATE_IDLE;
+    }
+    return __real_tftp_session_handle_packet(session, packet, packet_size);
+}
+
 // NOLINTEND(*-reserved-identifier)
 
 _Noreturn static int packet_discard_thread(void *) {
@@ -131,12 +210,23 @@ _Noreturn static int packet_discard_thread(void *) {
         }
         logger_log_debug(global_logger, "Received packet was discarded to simulate packet loss.");
         auto const data = (struct recv_data *) (event->id);
-        __real_dispatcher_submit_recvmsg(
-            data->dispatcher,
-            data->event,
-            data->fd,
-            data->msghdr,
-            data->flags);
+        if (data->msghdr != nullptr) {
+            __real_dispatcher_submit_recvmsg(
+                data->dispatcher,
+                data->event,
+                data->fd,
+                data->msghdr,
+                data->flags);
+        }
+        else {
+            __real_dispatcher_submit_recv(
+                data->dispatcher,
+                data->event,
+                data->fd,
+                data->buffer,
+                data->n_bytes,
+                (int) data->flags);
+        }
         free(data);
     }
 }
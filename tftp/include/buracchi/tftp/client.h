@@ -9,11 +9,20 @@
 
 struct tftp_client_options {
     uint8_t *timeout_s;
+    uint32_t *timeout_us;   // negotiated with the utimeout option, it takes precedence over timeout_s
     uint16_t *block_size;
     uint16_t *window_size;
+    uint8_t *fec_group_size;    // blocks protected by each FEC packet, only for read requests
+    size_t *offset;         // first byte of the file to read, blocks are written at their position in dest
+    size_t *length;         // bytes to read from the offset, the rest of the file when nullptr
     bool use_tsize;
+    bool use_sack;          // only for read requests with a window size greater than 1
+    bool use_pipeline;      // ask the server to serve further read requests on the same session, see tftp_client_read_files
+    bool use_compression;   // ask for the file compressed, only for octet reads of whole files
     bool use_adaptive_timeout;
     bool is_read_type_list;
+    bool is_read_type_list_detailed;    // list entries as "<size>\t<mtime>\t<name>" lines
+    FILE *local_copy;       // the read is aborted after the OACK if the server content has its digest, see tftp_client_stats
 };
 
 struct tftp_client_response {
@@ -28,6 +37,7 @@ struct tftp_client_response {
                 };
             } start_time;
             size_t file_bytes_transferred;
+            bool is_unchanged;      // the server content has the digest of the local copy, nothing was written to dest
         } value;
         struct tftp_client_error {
             bool server_may_not_support_options;
@@ -44,6 +54,35 @@ struct tftp_client_response tftp_client_read(struct logger logger[static 1],
                                              struct tftp_client_options *options,
                                              FILE dest[static 1]);
 
+/*
+ * Reads an octet mode file splitting it in segments read concurrently by separate sessions with the offset and length
+ *  options. The file size is queried first with the tsize option, dest must support positional writes.
+ */
+struct tftp_client_response tftp_client_read_parallel(struct logger logger[static 1],
+                                                      uint8_t retries,
+                                                      const char host[static 1],
+                                                      const char port[static 1],
+                                                      const char filename[static 1],
+                                                      struct tftp_client_options options[static 1],
+                                                      uint8_t segments,
+                                                      FILE dest[static 1]);
+
+/*
+ * Reads the files in order on a single session with the pipeline option, after each file the next one is requested from
+ *  the session TID so the server streams it with the negotiated options and the RTT estimate of the previous one.
+ * Falls back to a session for each file when the server does not acknowledge the option. On success the response holds
+ *  the bytes of all the files.
+ */
+struct tftp_client_response tftp_client_read_files(struct logger logger[static 1],
+                                                   uint8_t retries,
+                                                   const char host[static 1],
+                                                   const char port[static 1],
+                                                   size_t count,
+                                                   const char *const filenames[static count],
+                                                   enum tftp_mode mode,
+                                                   struct tftp_client_options *options,
+                                                   FILE *const dest[static count]);
+
 struct tftp_client_response tftp_client_write(struct logger logger[static 1],
                                               uint8_t retries,
                                               const char host[static 1],
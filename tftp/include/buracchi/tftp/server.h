@@ -6,6 +6,7 @@
 
 #include <logger.h>
 
+#include <buracchi/tftp/server_congestion_control.h>
 #include <buracchi/tftp/server_stats.h>
 #include <buracchi/tftp/server_session_stats.h>
 #include <buracchi/tftp/server_listener.h>
@@ -17,6 +18,14 @@ struct tftp_server {
     struct logger *logger;
     volatile sig_atomic_t should_stop; // volatile sig_atomic_t is used instead of atomic_bool for N3220 5.1.2.4/5 since it's implementation-defined whether the type is lock-free
     struct tftp_server_worker_pool *worker_pool;
+    struct file_cache *file_cache;
+    struct content_cache *content_cache;
+    struct fs_watcher *fs_watcher;
+    struct negative_cache *negative_cache;
+    struct listing_cache *listing_cache;
+    struct window_budget *window_budget;
+    struct rtt_cache *rtt_cache;
+    struct digest_cache *digest_cache;
     struct tftp_server_listener listener;
     struct tftp_server_stats stats;
     
@@ -25,9 +34,14 @@ struct tftp_server {
     const char *root;
     uint8_t retries;
     uint8_t timeout;
+    uint8_t fast_retransmit_threshold;
+    uint8_t min_fec_group_size;
+    enum tftp_congestion_control congestion_control;
 
     // Opt-in features
     bool is_adaptive_timeout_enabled;
+    bool is_pacing_enabled;
+    bool is_compression_enabled;
     bool is_write_request_enabled;
     bool is_list_request_enabled;
 };
@@ -38,9 +52,31 @@ struct tftp_server_arguments {
     const char *root;
     uint8_t retries;
     uint8_t timeout_s;
+    uint8_t fast_retransmit_threshold;      // duplicate ACKs that resend the window before the timeout, 0 disables
+    uint8_t min_fec_group_size;             // bounds the FEC overhead clients can ask for, 0 disables the fec option
+    enum tftp_congestion_control congestion_control;    // bounds the DATA packets in flight of read sessions
     uint16_t workers;
     uint16_t max_worker_sessions;
+    uint32_t max_cached_file_descriptors;   // 0 disables sharing file descriptors between sessions
+    uint64_t content_cache_max_bytes;       // 0 disables serving files from memory
+    uint64_t content_cache_max_file_size;
+    const char *content_cache_manifest;     // list of files, relative to root, to load in the content cache on startup
+    uint32_t negative_cache_max_entries;    // 0 disables remembering requested files that do not exist
+    uint32_t negative_cache_ttl_ms;
+    uint32_t listing_cache_max_entries;     // 0 disables sharing rendered directory listings between sessions
+    uint64_t window_memory_max_bytes;       // 0 disables the server-wide budget for DATA windows and receive buffers
+    uint32_t rtt_cache_max_entries;         // 0 disables seeding the adaptive timeout from previous sessions of a peer
+    uint32_t digest_cache_max_entries;      // 0 disables advertising content digests with the digest option
+    uint64_t slab_max_cached_bytes;         // per worker budget of freed session buffers kept for reuse
+    bool is_slab_huge_pages_enabled;
+    uint16_t socket_pool_size;              // per worker and address family idle pre-bound session sockets, 0 disables
+    uint16_t shared_socket_port;            // first port of the sockets each worker shares between its sessions, 0 disables
+    uint16_t shared_sockets_per_worker;
+    bool is_content_cache_huge_pages_enabled;
+    bool is_content_cache_mlock_enabled;
     bool is_adaptive_timeout_enabled;
+    bool is_pacing_enabled;                 // spreads the DATA packets of a window over the round trip time
+    bool is_compression_enabled;            // acknowledges the compress option for files served from the content cache
     bool is_write_request_enabled;
     bool is_list_request_enabled;
     bool (*server_stats_callback)(struct tftp_server_stats *);
@@ -0,0 +1,10 @@
+#ifndef TFTP_SERVER_CONGESTION_CONTROL_H
+#define TFTP_SERVER_CONGESTION_CONTROL_H
+
+enum tftp_congestion_control {
+    TFTP_CONGESTION_CONTROL_NONE,   // the whole negotiated window is kept in flight
+    TFTP_CONGESTION_CONTROL_RENO,
+    TFTP_CONGESTION_CONTROL_VEGAS,
+};
+
+#endif // TFTP_SERVER_CONGESTION_CONTROL_H
@@ -30,8 +30,10 @@ struct tftp_session_stats {
     int packets_acked;
     size_t bytes_sent;
     int retransmits;
+    int fast_retransmits;       // retransmissions triggered by duplicate ACKs, included in retransmits
     uint16_t blksize;
     uint16_t window_size;
+    uint16_t congestion_window;     // DATA packets allowed in flight when the session closed
     void (*callback)(struct tftp_session_stats *);
 };
 
@@ -9,6 +9,15 @@
 
 struct tftp_server_stats_counters {
     uint64_t sessions_count;
+    uint64_t content_cache_hits;
+    uint64_t content_cache_misses;
+    uint64_t negative_cache_hits;
+    uint64_t window_budget_clamps;  // sessions whose blksize or windowsize was reduced to fit the window memory budget
+    uint64_t slab_allocations;      // session buffers allocations
+    uint64_t slab_reuses;           // session buffers allocations served by recycling a freed buffer
+    uint64_t slab_bytes_in_use;     // session buffers memory at collection time
+    uint64_t slab_bytes_cached;     // freed session buffers memory kept for reuse at collection time
+    uint64_t socket_pool_misses;    // sessions that found no pre-bound socket and had to create one
 };
 
 struct tftp_server_stats {
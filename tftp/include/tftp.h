@@ -12,7 +12,11 @@ extern "C" {
 constexpr size_t tftp_request_packet_max_size = 512;
 constexpr size_t tftp_oack_packet_max_size = 512;
 constexpr uint16_t tftp_default_blksize = 512;
+constexpr uint16_t tftp_max_blksize = 65464;
 constexpr uint16_t tftp_default_window_size = 1;
+constexpr uint32_t tftp_min_utimeout_us = 1'000;
+constexpr uint32_t tftp_max_utimeout_us = 255'000'000;
+constexpr size_t tftp_sack_bitmap_max_size = 64;     // blocks beyond block_number + 513 are never reported
 
 enum tftp_mode {
     TFTP_MODE_OCTET,
@@ -29,6 +33,7 @@ enum tftp_opcode : uint16_t {
     TFTP_OPCODE_ACK = 0x04,
     TFTP_OPCODE_ERROR = 0x05,
     TFTP_OPCODE_OACK = 0x06,
+    TFTP_OPCODE_FEC = 0x07,     // only sent to clients negotiating the fec option
 };
 
 enum tftp_error_code : uint16_t {
@@ -59,6 +64,12 @@ struct [[gnu::packed]] tftp_packet {
             uint16_t error_code;
             uint8_t error_message[512];
         } error;
+        struct [[gnu::packed]] {
+            uint16_t block_number;
+            uint16_t blocks_count;
+            uint16_t size_parity;
+            uint8_t data[512];
+        } fec;
     };
 };
 
@@ -77,6 +88,30 @@ struct [[gnu::packed]] tftp_ack_packet {
     uint16_t block_number;
 };
 
+/*
+ * ACK of a read request transfer that negotiated the sack option: the bitmap reports the blocks received beyond the
+ *  cumulative ACK, bit i of byte j (least significant first) is set when block block_number + 2 + 8 * j + i was
+ *  received. Block block_number + 1 is the first missing one and has no bit, trailing zero bytes are omitted.
+ */
+struct [[gnu::packed]] tftp_sack_packet {
+    enum tftp_opcode opcode;
+    uint16_t block_number;
+    uint8_t bitmap[];
+};
+
+/*
+ * Repair packet following the last DATA packet of each group of blocks when the fec option is negotiated: the payload
+ *  is the XOR of the payloads of the blocks_count blocks starting from block_number, zero padded to the largest one,
+ *  size_parity the XOR of their sizes.
+ */
+struct [[gnu::packed]] tftp_fec_packet {
+    enum tftp_opcode opcode;
+    uint16_t block_number;
+    uint16_t blocks_count;
+    uint16_t size_parity;
+    uint8_t data[];
+};
+
 struct [[gnu::packed]] tftp_data_packet {
     enum tftp_opcode opcode;
     uint16_t block_number;
@@ -144,8 +179,16 @@ constexpr size_t tftp_option_formatted_string_max_size = tftp_option_string_max_
 enum tftp_option_recognized {
     TFTP_OPTION_BLKSIZE,
     TFTP_OPTION_TIMEOUT,
+    TFTP_OPTION_UTIMEOUT,   // timeout in microseconds, it takes precedence over timeout when both are acknowledged
     TFTP_OPTION_TSIZE,
     TFTP_OPTION_WINDOWSIZE,
+    TFTP_OPTION_SACK,       // selective acknowledgements of the blocks of a window, only for read requests
+    TFTP_OPTION_FEC,        // blocks in each group protected by a FEC packet, only for read requests
+    TFTP_OPTION_OFFSET,     // first byte of the file to send, only for octet read requests of seekable files, tsize still reports the whole file
+    TFTP_OPTION_LENGTH,     // bytes to send from the offset, the rest of the file when not negotiated
+    TFTP_OPTION_PIPELINE,   // further read requests on the session TID, valued with the last block of the previous file
+    TFTP_OPTION_DIGEST,     // digest algorithm in requests, algorithm and digest of the file content in the OACK
+    TFTP_OPTION_COMPRESS,   // the DATA blocks carry the file compressed with the algorithm, tsize still reports the file size
     TFTP_OPTION_READ_TYPE,
     TFTP_OPTION_TOTAL_OPTIONS
 };
@@ -153,6 +196,7 @@ enum tftp_option_recognized {
 enum tftp_read_type {
     TFTP_READ_TYPE_FILE,
     TFTP_READ_TYPE_DIRECTORY,
+    TFTP_READ_TYPE_DIRECTORY_DETAILED,
     TFTP_READ_TYPE_INVALID
 };
 
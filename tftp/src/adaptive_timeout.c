@@ -11,6 +11,8 @@ constexpr double beta = 1.0 / 4.0;
 constexpr double k = 4.0;
 constexpr double granularity = 1e-5; // 10,000 ns
 
+static void update_rto(struct adaptive_timeout at[static 1]);
+
 void adaptive_timeout_init(struct adaptive_timeout at[static 1]) {
     *at = (struct adaptive_timeout) {
         .is_first_measurement = true,
@@ -29,8 +31,11 @@ bool adaptive_timeout_stop_timer(struct adaptive_timeout at[static 1]) {
         return false;
     }
     at->is_timer_active = false;
+    adaptive_timeout_add_sample(at, timespec_to_double(now) - timespec_to_double(at->timer));
+    return true;
+}
 
-    const double r = timespec_to_double(now) - timespec_to_double(at->timer);
+void adaptive_timeout_add_sample(struct adaptive_timeout at[static 1], double r) {
     if (at->is_first_measurement) {
         at->is_first_measurement = false;
 
@@ -41,13 +46,22 @@ bool adaptive_timeout_stop_timer(struct adaptive_timeout at[static 1]) {
         at->rtt_variation = (1.0 - beta) * at->rtt_variation + beta * fabs(at->smoothed_rtt - r);
         at->smoothed_rtt = (1.0 - alpha) * at->smoothed_rtt + alpha * r;
     }
+    update_rto(at);
+}
 
-    const double rto = at->smoothed_rtt + fmax(granularity, k * at->rtt_variation);
-    at->rto = double_to_timespec(fmin(60.0, rto));
-    return true;
+void adaptive_timeout_seed(struct adaptive_timeout at[static 1], double smoothed_rtt, double rtt_variation) {
+    at->is_first_measurement = false;
+    at->smoothed_rtt = smoothed_rtt;
+    at->rtt_variation = rtt_variation;
+    update_rto(at);
 }
 
 void adaptive_timeout_backoff(struct adaptive_timeout at[static 1]) {
     double rto = fmin(1.0, 2 * timespec_to_double(at->rto));
     at->rto = double_to_timespec(rto);
 }
+
+static void update_rto(struct adaptive_timeout at[static 1]) {
+    const double rto = at->smoothed_rtt + fmax(granularity, k * at->rtt_variation);
+    at->rto = double_to_timespec(fmin(60.0, rto));
+}
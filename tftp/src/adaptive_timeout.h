@@ -25,6 +25,21 @@ static inline void adaptive_timeout_cancel_timer(struct adaptive_timeout at[stat
 
 bool adaptive_timeout_stop_timer(struct adaptive_timeout at[static 1]);
 
+// Updates the RTO with a round trip time, in seconds, measured by the caller.
+void adaptive_timeout_add_sample(struct adaptive_timeout at[static 1], double rtt);
+
+// Starts from the estimate of a previous connection to the same peer instead of the first measurement.
+void adaptive_timeout_seed(struct adaptive_timeout at[static 1], double smoothed_rtt, double rtt_variation);
+
 void adaptive_timeout_backoff(struct adaptive_timeout at[static 1]);
 
+// Returns 0 until the first measurement.
+static inline double adaptive_timeout_get_smoothed_rtt(const struct adaptive_timeout at[static 1]) {
+    return at->is_first_measurement ? 0 : at->smoothed_rtt;
+}
+
+static inline double adaptive_timeout_get_rtt_variation(const struct adaptive_timeout at[static 1]) {
+    return at->is_first_measurement ? 0 : at->rtt_variation;
+}
+
 #endif // ADAPTIVE_TIMEOUT_H
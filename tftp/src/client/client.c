@@ -1,23 +1,30 @@
 #include <buracchi/tftp/client.h>
 
 #include <errno.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 #include <unistd.h>
 
 #include <tftp.h>
 
 #include "connection.h"
+#include "local_digest.h"
 #include "stats.h"
 #include "../adaptive_timeout.h"
+#include "../compression.h"
+#include "../digest.h"
+#include "../fec.h"
 #include "../utils/inet.h"
 #include "../utils/time.h"
 
 #define UINT8_STRLEN 4
 #define UINT16_STRLEN 6
 #define SIZE_STRLEN 21
+#define UINT32_STRLEN 11
 
-constexpr uint8_t default_timeout_s = 2;
+constexpr uint32_t default_timeout_us = 2'000'000;
 
 enum request_type {
     REQUEST_GET,
@@ -40,8 +47,9 @@ struct options {
     struct tftp_option options[TFTP_OPTION_TOTAL_OPTIONS];
     char options_str[tftp_option_formatted_string_max_size];
     
-    uint8_t timeout_s;
+    uint32_t timeout_us;
     char *timeout_s_str[9];
+    char *timeout_us_str[UINT32_STRLEN];
     
     uint16_t block_size;
     char *block_size_str[UINT16_STRLEN];
@@ -54,6 +62,35 @@ struct options {
     char *tsize_str[SIZE_STRLEN];
     
     bool use_adaptive_timeout;
+    bool use_sack;
+    
+    uint8_t fec_group_size;
+    char *fec_group_size_str[UINT8_STRLEN];
+    
+    bool use_range;         // blocks are written at their position in the file
+    size_t offset;
+    char *offset_str[SIZE_STRLEN];
+    size_t length;          // SIZE_MAX for the rest of the file
+    char *length_str[SIZE_STRLEN];
+    
+    bool use_pipeline;
+    char *pipeline_str[UINT16_STRLEN];
+    
+    FILE *local_copy;       // nullptr if the digest option is not requested
+    bool has_server_digest;
+    uint64_t server_digest;
+    
+    bool use_compression;
+};
+
+// DATA packets received after a lost one, kept until the hole is filled when the sack option is negotiated.
+struct reorder_buffer {
+    uint16_t capacity;      // blocks following the next expected one that can be held, 0 without the sack option
+    uint16_t head;          // slot of the block following the next expected one
+    uint16_t block_size;
+    uint8_t *blocks;
+    uint16_t *block_sizes;
+    bool *is_received;
 };
 
 struct request {
@@ -74,13 +111,22 @@ struct request {
     union {
         struct tftp_rrq_packet rrq_packet;
         struct tftp_wrq_packet wrq_packet;
-        struct tftp_ack_packet ack_packet;
+        struct {
+            struct tftp_ack_packet ack_packet;
+            uint8_t sack_bitmap[tftp_sack_bitmap_max_size];
+        };
         // error packet are not acknowledged or retransmitted, so they don't need to be stored
     } last_packet_sent;
     size_t last_packet_sent_size;
     
     uint8_t *packet_recv_buffer;
     size_t packet_recv_buffer_size;
+    struct reorder_buffer reorder_buffer;
+    struct fec_decoder fec_decoder;
+    struct decompressor decompressor;
+    
+    bool is_pipelined;              // the file is requested on the session of the previous one
+    uint16_t last_block_received;   // pipelined files go on from the block number following it
     
     bool server_may_not_support_options;   // if errors are received this flag could be set to true
 };
@@ -90,10 +136,36 @@ enum receive_packet_error: ssize_t {
     RECEIVE_PACKET_TIMEOUT = -2,
 };
 
+// Range of the file read by one of the sessions of a parallel read.
+struct segment {
+    struct logger *logger;
+    uint8_t retries;
+    const char *host;
+    const char *port;
+    const char *filename;
+    struct tftp_client_options options;
+    size_t offset;
+    size_t length;
+    FILE *dest;
+    struct tftp_client_response response;
+};
+
 static inline bool is_in_range(uint16_t n, uint16_t begin, uint16_t end) {
     return begin <= end ? (begin <= n && n <= end) : (begin <= n || n <= end);
 }
 
+static struct tftp_client_response read_file(struct logger logger[static 1],
+                                             uint8_t retries,
+                                             const char host[static 1],
+                                             const char port[static 1],
+                                             const char filename[static 1],
+                                             enum tftp_mode mode,
+                                             struct tftp_client_options *options,
+                                             FILE dest[static 1],
+                                             size_t file_size[static 1]);
+
+static int read_segment(void *arg);
+
 static struct tftp_client_response handle_get_request(struct request request[static 1],
                                                       struct connection connection[static 1],
                                                       FILE file_buffer[static 1]);
@@ -106,6 +178,10 @@ static bool options_init(struct options result[static 1],
                          enum request_type request_type,
                          struct tftp_client_options *options);
 
+static void pipeline_options_init(struct options options[static 1], uint16_t last_block);
+
+static void release_receive_buffers(struct request request[static 1]);
+
 static bool send_read_request(struct request request[static 1]);
 
 static bool send_write_request(struct request request[static 1]);
@@ -122,6 +198,25 @@ static bool send_wrq(struct request request[static 1]);
 
 static bool send_ack(struct request request[static 1], uint16_t received_block_number);
 
+static bool write_block(struct request request[static 1], FILE file[static 1], const uint8_t data[], size_t size);
+
+static bool write_data(struct request request[static 1], FILE file[static 1], const uint8_t data[], size_t size);
+
+static bool reorder_buffer_init(struct reorder_buffer buffer[static 1], uint16_t window_size, uint16_t block_size, struct logger logger[static 1]);
+
+static void reorder_buffer_destroy(struct reorder_buffer buffer[static 1]);
+
+static void reorder_buffer_store(struct reorder_buffer buffer[static 1], uint16_t offset, const uint8_t data[], size_t size);
+
+static bool reorder_buffer_pop(struct reorder_buffer buffer[static 1], const uint8_t *data[static 1], size_t size[static 1]);
+
+static size_t reorder_buffer_get_bitmap(struct reorder_buffer buffer[static 1], uint8_t bitmap[static tftp_sack_bitmap_max_size]);
+
+static ssize_t recover_data_packet(struct request request[static 1],
+                                   uint64_t block,
+                                   uint16_t expected_sequence_number,
+                                   uint64_t blocks_delivered);
+
 static bool send_error(struct request request[static 1], enum tftp_error_code error_code, const char *error_message);
 
 static bool retransmit_last_packet_sent(struct request request[static 1]);
@@ -132,7 +227,7 @@ static bool send_rrq_packet(struct request request[static 1], const struct tftp_
 static bool send_wrq_packet(struct request request[static 1], const struct tftp_wrq_packet wrq_packet[static 1],
                             size_t wrq_packet_size);
 
-static bool send_ack_packet(struct request request[static 1], const struct tftp_ack_packet ack_packet[static 1]);
+static bool send_ack_packet(struct request request[static 1], const struct tftp_ack_packet ack_packet[static 1], size_t ack_packet_size);
 
 static bool send_error_packet(struct request request[static 1], const struct tftp_error_packet *error_packet,
                               size_t error_packet_size);
@@ -146,6 +241,11 @@ static bool handle_oack_packet(struct request request[static 1], ssize_t packet_
 
 static inline size_t tftp_packet_buffer_size(uint16_t required_block_size);
 
+static inline size_t get_expected_size(const struct options options[static 1]) {
+    const size_t remaining = options->tsize > options->offset ? options->tsize - options->offset : 0;
+    return remaining < options->length ? remaining : options->length;
+}
+
 struct tftp_client_response tftp_client_read(struct logger logger[static 1],
                                              uint8_t retries,
                                              const char host[static 1],
@@ -154,6 +254,112 @@ struct tftp_client_response tftp_client_read(struct logger logger[static 1],
                                              enum tftp_mode mode,
                                              struct tftp_client_options *options,
                                              FILE dest[static 1]) {
+    size_t file_size;
+    return read_file(logger, retries, host, port, filename, mode, options, dest, &file_size);
+}
+
+struct tftp_client_response tftp_client_read_parallel(struct logger logger[static 1],
+                                                      uint8_t retries,
+                                                      const char host[static 1],
+                                                      const char port[static 1],
+                                                      const char filename[static 1],
+                                                      struct tftp_client_options options[static 1],
+                                                      uint8_t segments,
+                                                      FILE dest[static 1]) {
+    // an empty range gives the file size without transferring any block
+    size_t file_size = 0;
+    size_t empty_range = 0;
+    struct tftp_client_options probe_options = *options;
+    probe_options.offset = &empty_range;
+    probe_options.length = &empty_range;
+    probe_options.use_tsize = true;
+    struct tftp_client_response response = read_file(logger, retries, host, port, filename, TFTP_MODE_OCTET, &probe_options, dest, &file_size);
+    if (!response.is_success) {
+        return response;
+    }
+    size_t segments_count = segments == 0 ? 1 : segments;
+    if (file_size < segments_count) {
+        segments_count = file_size == 0 ? 1 : file_size;   // without the file size a single session reads the whole file
+    }
+    const size_t segment_size = (file_size + segments_count - 1) / segments_count;
+    struct segment *segment = calloc(segments_count, sizeof *segment);
+    thrd_t *threads = calloc(segments_count, sizeof *threads);
+    if (segment == nullptr || threads == nullptr) {
+        logger_log_error(logger, "Failed to allocate memory for the segments. %s", strerror(errno));
+        free(segment);
+        free(threads);
+        return (struct tftp_client_response) {
+            .is_success = false,
+            .error.server_may_not_support_options = false,
+        };
+    }
+    logger_log_info(logger, "Reading %zu bytes in %zu segments of %zu bytes.", file_size, segments_count, segment_size);
+    size_t threads_count = 0;
+    for (size_t i = 0; i < segments_count; i++) {
+        segment[i] = (struct segment) {
+            .logger = logger,
+            .retries = retries,
+            .host = host,
+            .port = port,
+            .filename = filename,
+            .options = *options,
+            .offset = i * segment_size,
+            .length = segment_size,
+            .dest = dest,
+        };
+        segment[i].options.offset = &segment[i].offset;
+        segment[i].options.length = i == segments_count - 1 ? nullptr : &segment[i].length;   // the last one reads any data appended meanwhile
+        segment[i].options.use_tsize = false;
+        if (thrd_create(&threads[i], read_segment, &segment[i]) != thrd_success) {
+            logger_log_error(logger, "Failed to start the session of segment %zu.", i);
+            break;
+        }
+        threads_count++;
+    }
+    response.value.file_bytes_transferred = 0;
+    response.is_success = threads_count == segments_count;
+    for (size_t i = 0; i < threads_count; i++) {
+        thrd_join(threads[i], nullptr);
+        response.is_success = response.is_success && segment[i].response.is_success;
+        if (segment[i].response.is_success) {
+            response.value.file_bytes_transferred += segment[i].response.value.file_bytes_transferred;
+        }
+    }
+    free(segment);
+    free(threads);
+    if (!response.is_success) {
+        return (struct tftp_client_response) {
+            .is_success = false,
+            .error.server_may_not_support_options = false,
+        };
+    }
+    return response;
+}
+
+static int read_segment(void *arg) {
+    struct segment *segment = arg;
+    size_t file_size;
+    segment->response = read_file(segment->logger,
+                                  segment->retries,
+                                  segment->host,
+                                  segment->port,
+                                  segment->filename,
+                                  TFTP_MODE_OCTET,
+                                  &segment->options,
+                                  segment->dest,
+                                  &file_size);
+    return 0;
+}
+
+static struct tftp_client_response read_file(struct logger logger[static 1],
+                                             uint8_t retries,
+                                             const char host[static 1],
+                                             const char port[static 1],
+                                             const char filename[static 1],
+                                             enum tftp_mode mode,
+                                             struct tftp_client_options *options,
+                                             FILE dest[static 1],
+                                             size_t file_size[static 1]) {
     struct connection connection;
     if (!connection_init(&connection, host, port, logger)) {
         return (struct tftp_client_response) {
@@ -172,11 +378,13 @@ struct tftp_client_response tftp_client_read(struct logger logger[static 1],
         .packet_recv_buffer = nullptr,
     };
     request.use_options = options_init(&request.options, request.request_type, options);
-    if (!connection_set_recv_timeout(&connection, request.options.timeout_s, request.logger)) {
+    if (!connection_set_recv_timeout(&connection, request.options.timeout_us, request.logger)) {
         goto fail;
     }
     stats_init(&request.stats);
     struct tftp_client_response response = handle_get_request(&request, &connection, dest);
+    release_receive_buffers(&request);
+    *file_size = request.options.tsize;
     connection_destroy(&connection, logger);
     return response;
 fail:
@@ -187,6 +395,73 @@ fail:
     };
 }
 
+struct tftp_client_response tftp_client_read_files(struct logger logger[static 1],
+                                                   uint8_t retries,
+                                                   const char host[static 1],
+                                                   const char port[static 1],
+                                                   size_t count,
+                                                   const char *const filenames[static count],
+                                                   enum tftp_mode mode,
+                                                   struct tftp_client_options *options,
+                                                   FILE *const dest[static count]) {
+    struct tftp_client_options pipeline_options = options == nullptr ? (struct tftp_client_options) {} : *options;
+    pipeline_options.use_pipeline = options != nullptr;
+    pipeline_options.offset = nullptr;
+    pipeline_options.length = nullptr;
+    pipeline_options.local_copy = nullptr;
+    struct connection connection;
+    if (!connection_init(&connection, host, port, logger)) {
+        return (struct tftp_client_response) {
+            .is_success = false,
+            .error.server_may_not_support_options = false,
+        };
+    }
+    struct request request = {
+        .logger = logger,
+        .connection = &connection,
+        .retries = retries,
+        .request_type = REQUEST_GET,
+        .details.get.mode = mode,
+        .details.get.mode_str = tftp_mode_to_string(mode),
+        .details.get.filename = filenames[0],
+        .packet_recv_buffer = nullptr,
+    };
+    request.use_options = options_init(&request.options, request.request_type, &pipeline_options);
+    struct tftp_client_response response = {
+        .is_success = false,
+        .error.server_may_not_support_options = false,
+    };
+    size_t files_read = 0;
+    if (connection_set_recv_timeout(&connection, request.options.timeout_us, request.logger)) {
+        stats_init(&request.stats);
+        response = handle_get_request(&request, &connection, dest[0]);
+        files_read = response.is_success ? 1 : 0;
+    }
+    while (response.is_success && request.options.use_pipeline && files_read < count) {
+        pipeline_options_init(&request.options, request.last_block_received);
+        request.is_pipelined = true;
+        request.details.get.filename = filenames[files_read];
+        response = handle_get_request(&request, &connection, dest[files_read]);
+        files_read += response.is_success ? 1 : 0;
+    }
+    release_receive_buffers(&request);
+    connection_destroy(&connection, logger);
+    if (response.is_success && files_read < count && options != nullptr) {
+        logger_log_info(logger, "Server did not acknowledge the pipeline option, reading the remaining files on separate sessions.");
+    }
+    pipeline_options.use_pipeline = false;
+    for (; response.is_success && files_read < count; files_read++) {
+        const struct tftp_client_stats stats = response.value;
+        size_t file_size;
+        response = read_file(logger, retries, host, port, filenames[files_read], mode, &pipeline_options, dest[files_read], &file_size);
+        if (response.is_success) {
+            response.value.start_time = stats.start_time;
+            response.value.file_bytes_transferred += stats.file_bytes_transferred;
+        }
+    }
+    return response;
+}
+
 struct tftp_client_response tftp_client_write(struct logger logger[static 1],
                                               uint8_t retries,
                                               const char host[static 1],
@@ -212,7 +487,7 @@ struct tftp_client_response tftp_client_write(struct logger logger[static 1],
         .details.put.filename = filename,
     };
     request.use_options = options_init(&request.options, request.request_type, options);
-    if (!connection_set_recv_timeout(&connection, request.options.timeout_s, request.logger)) {
+    if (!connection_set_recv_timeout(&connection, request.options.timeout_us, request.logger)) {
         goto fail;
     }
     stats_init(&request.stats);
@@ -235,6 +510,9 @@ static bool options_init(struct options result[static 1],
     }
     const bool is_timeout_required = options->timeout_s != nullptr
                                      && *options->timeout_s != 0;
+    const bool is_utimeout_required = options->timeout_us != nullptr
+                                      && *options->timeout_us >= tftp_min_utimeout_us
+                                      && *options->timeout_us <= tftp_max_utimeout_us;
     const bool is_block_size_required = options->block_size != nullptr
                                         && *options->block_size >= 8
                                         && *options->block_size <= 65464;
@@ -243,15 +521,46 @@ static bool options_init(struct options result[static 1],
                                          && request_type != REQUEST_PUT;
     const bool is_tsize_required = options->use_tsize;
     const bool is_adaptive_timeout_required = options->use_adaptive_timeout && request_type == REQUEST_GET;
+    const bool is_sack_required = options->use_sack && is_window_size_required && *options->window_size > 1;
+    const bool is_fec_required = options->fec_group_size != nullptr
+                                 && *options->fec_group_size != 0
+                                 && request_type == REQUEST_GET;
+    const bool is_offset_required = options->offset != nullptr && request_type == REQUEST_GET;
+    const bool is_length_required = options->length != nullptr && request_type == REQUEST_GET;
+    const bool is_pipeline_required = options->use_pipeline && request_type == REQUEST_GET;
+    const bool is_digest_required = options->local_copy != nullptr
+                                    && request_type == REQUEST_GET
+                                    && !is_offset_required
+                                    && !is_length_required
+                                    && !options->is_read_type_list;
+    const bool is_compression_required = options->use_compression
+                                         && request_type == REQUEST_GET
+                                         && !is_offset_required
+                                         && !is_length_required
+                                         && !options->is_read_type_list;
     
-    result->timeout_s = is_timeout_required ? *options->timeout_s : default_timeout_s;
+    result->timeout_us = is_utimeout_required ? *options->timeout_us :
+                         is_timeout_required ? *options->timeout_s * 1'000'000U :
+                                               default_timeout_us;
     result->block_size = is_block_size_required ? *options->block_size : tftp_default_blksize;
     result->window_size = is_window_size_required ? *options->window_size : tftp_default_window_size;
     result->use_tsize = is_tsize_required;
     result->use_adaptive_timeout = options->use_adaptive_timeout;
+    result->use_sack = is_sack_required;
+    result->fec_group_size = is_fec_required ? *options->fec_group_size : 0;
+    result->use_range = is_offset_required || is_length_required;
+    result->offset = is_offset_required ? *options->offset : 0;
+    result->length = is_length_required ? *options->length : SIZE_MAX;
+    result->use_pipeline = is_pipeline_required;
+    result->local_copy = is_digest_required ? options->local_copy : nullptr;
+    result->has_server_digest = false;
+    result->use_compression = is_compression_required;
     
     if (is_timeout_required && !is_adaptive_timeout_required) {
-        sprintf((char *) result->timeout_s_str, "%hhu", result->timeout_s);
+        sprintf((char *) result->timeout_s_str, "%hhu", *options->timeout_s);
+    }
+    if (is_utimeout_required) {
+        sprintf((char *) result->timeout_us_str, "%u", result->timeout_us);
     }
     if (is_adaptive_timeout_required) {
         sprintf((char *) result->timeout_s_str, "adaptive");
@@ -262,16 +571,37 @@ static bool options_init(struct options result[static 1],
     if (is_window_size_required) {
         sprintf((char *) result->window_size_str, "%hu", result->window_size);
     }
+    if (is_fec_required) {
+        sprintf((char *) result->fec_group_size_str, "%hhu", result->fec_group_size);
+    }
+    if (is_offset_required) {
+        sprintf((char *) result->offset_str, "%zu", result->offset);
+    }
+    if (is_length_required) {
+        sprintf((char *) result->length_str, "%zu", result->length);
+    }
     // TODO: handle write request tsize option
     sprintf((char *) result->tsize_str, "0");
+    sprintf((char *) result->pipeline_str, "0");
     
     memcpy(result->options,
            &(struct tftp_option[TFTP_OPTION_TOTAL_OPTIONS]) {
                [TFTP_OPTION_BLKSIZE] = {.is_active = is_block_size_required, .value = (const char *) result->block_size_str},
                [TFTP_OPTION_TIMEOUT] = {.is_active = is_timeout_required || is_adaptive_timeout_required, .value = (const char *) result->timeout_s_str},
+               [TFTP_OPTION_UTIMEOUT] = {.is_active = is_utimeout_required && !is_adaptive_timeout_required, .value = (const char *) result->timeout_us_str},
                [TFTP_OPTION_TSIZE] = {.is_active = result->use_tsize, .value = (const char *) result->tsize_str},
                [TFTP_OPTION_WINDOWSIZE] = {.is_active = is_window_size_required, .value = (const char *) result->window_size_str},
-               [TFTP_OPTION_READ_TYPE] = {.is_active = options != nullptr && options->is_read_type_list, .value = "directory"},
+               [TFTP_OPTION_SACK] = {.is_active = is_sack_required, .value = "1"},
+               [TFTP_OPTION_FEC] = {.is_active = is_fec_required, .value = (const char *) result->fec_group_size_str},
+               [TFTP_OPTION_OFFSET] = {.is_active = is_offset_required, .value = (const char *) result->offset_str},
+               [TFTP_OPTION_LENGTH] = {.is_active = is_length_required, .value = (const char *) result->length_str},
+               [TFTP_OPTION_PIPELINE] = {.is_active = is_pipeline_required, .value = (const char *) result->pipeline_str},
+               [TFTP_OPTION_DIGEST] = {.is_active = is_digest_required, .value = digest_algorithm},
+               [TFTP_OPTION_COMPRESS] = {.is_active = is_compression_required, .value = compression_algorithm},
+               [TFTP_OPTION_READ_TYPE] = {
+                   .is_active = options != nullptr && options->is_read_type_list,
+                   .value = options != nullptr && options->is_read_type_list_detailed ? "directory-detailed" : "directory",
+               },
            },
            sizeof result->options);
     for (size_t i = 0; i < TFTP_OPTION_TOTAL_OPTIONS; i++) {
@@ -283,6 +613,27 @@ static bool options_init(struct options result[static 1],
     return false;
 }
 
+// The next file of a pipeline is requested with the last block received, the other options stay as negotiated.
+static void pipeline_options_init(struct options options[static 1], uint16_t last_block) {
+    for (size_t i = 0; i < TFTP_OPTION_TOTAL_OPTIONS; i++) {
+        options->options[i].is_active = false;
+    }
+    sprintf((char *) options->pipeline_str, "%hu", last_block);
+    options->options[TFTP_OPTION_PIPELINE] = (struct tftp_option) {
+        .is_active = true,
+        .value = (const char *) options->pipeline_str,
+    };
+    tftp_format_options(options->options, options->options_str);
+}
+
+static void release_receive_buffers(struct request request[static 1]) {
+    free(request->packet_recv_buffer);
+    request->packet_recv_buffer = nullptr;
+    reorder_buffer_destroy(&request->reorder_buffer);
+    fec_decoder_destroy(&request->fec_decoder);
+    decompressor_destroy(&request->decompressor);
+}
+
 static struct tftp_client_response handle_get_request(struct request request[static 1],
                                                       struct connection connection[static 1],
                                                       FILE file_buffer[static 1]) {
@@ -300,18 +651,22 @@ static struct tftp_client_response handle_get_request(struct request request[sta
     if (!send_read_request(request)) {
         goto fail;
     }
-    request->packet_recv_buffer_size = tftp_packet_buffer_size(request->options.block_size);
-    request->packet_recv_buffer = malloc(request->packet_recv_buffer_size);
     if (request->packet_recv_buffer == nullptr) {
-        logger_log_error(request->logger, "Failed to allocate memory for the receive buffer. %s", strerror(errno));
-        goto fail;
+        request->packet_recv_buffer_size = tftp_packet_buffer_size(request->options.block_size);
+        request->packet_recv_buffer = malloc(request->packet_recv_buffer_size);
+        if (request->packet_recv_buffer == nullptr) {
+            logger_log_error(request->logger, "Failed to allocate memory for the receive buffer. %s", strerror(errno));
+            goto fail;
+        }
     }
     if (!receive_file(request, file_buffer)) {
-        free(request->packet_recv_buffer);
         goto fail;
     }
-    free(request->packet_recv_buffer);
-    if (request->options.use_tsize && (request->stats.file_bytes_transferred != request->options.tsize)) {
+    if (request->options.use_compression && !decompressor_is_at_frame_boundary(&request->decompressor)) {
+        logger_log_error(request->logger, "Received compressed data ending in the middle of a frame.");
+        goto fail;
+    }
+    if (!request->is_pipelined && !request->stats.is_unchanged && request->options.use_tsize && (request->stats.file_bytes_transferred != get_expected_size(&request->options))) {
         logger_log_error(request->logger, "Received file size does not match the expected size.");
         goto fail;
     }
@@ -395,7 +750,7 @@ static struct tftp_client_response handle_put_request(struct request request[sta
             if (request->use_options) {
                 request->use_options = false;
                 request->options.block_size = tftp_default_blksize;
-                request->options.timeout_s = default_timeout_s;
+                request->options.timeout_us = default_timeout_us;
                 request->options.use_tsize = false;
             }
             logger_log_trace(request->logger, "Received ACK <block=%d>", block_number);
@@ -466,9 +821,13 @@ static bool send_write_request(struct request request[static 1]) {
 }
 
 static bool receive_file(struct request request[static 1], FILE file[static 1]) {
-    bool is_first_receive = true;
+    bool is_first_receive = !request->is_pipelined;
     bool transfer_complete = false;
-    uint16_t expected_sequence_number = 1;
+    uint16_t expected_sequence_number = request->last_block_received + 1;
+    uint64_t blocks_delivered = 0;
+    if (request->is_pipelined) {
+        fec_decoder_reset(&request->fec_decoder);
+    }
     while (!transfer_complete) {
         struct server_sockaddr server_addr = {
             .socklen = sizeof server_addr.sockaddr,
@@ -508,11 +867,36 @@ static bool receive_file(struct request request[static 1], FILE file[static 1])
                     send_error(request, TFTP_ERROR_INVALID_OPTIONS, nullptr);
                     return false;
                 }
+                if (request->options.has_server_digest) {
+                    uint64_t local_digest;
+                    if (local_digest_get(request->options.local_copy, &local_digest, request->logger)
+                        && local_digest == request->options.server_digest) {
+                        logger_log_info(request->logger, "Local copy of %s has the same content, skipping the transfer.", request->details.get.filename);
+                        send_error(request, TFTP_ERROR_NOT_DEFINED, "Content unchanged.");
+                        request->stats.is_unchanged = true;
+                        return true;
+                    }
+                }
+                if (request->options.use_compression && !decompressor_init(&request->decompressor, request->logger)) {
+                    send_error(request, TFTP_ERROR_NOT_DEFINED, nullptr);
+                    return false;
+                }
+                if ((request->options.use_sack || request->options.fec_group_size != 0)
+                    && !reorder_buffer_init(&request->reorder_buffer, request->options.window_size, request->options.block_size, request->logger)) {
+                    send_error(request, TFTP_ERROR_NOT_DEFINED, nullptr);
+                    return false;
+                }
+                if (request->options.fec_group_size != 0
+                    && !fec_decoder_init(&request->fec_decoder, request->options.fec_group_size, request->options.block_size, request->reorder_buffer.capacity + 1, request->logger)) {
+                    send_error(request, TFTP_ERROR_NOT_DEFINED, nullptr);
+                    return false;
+                }
                 if (!send_ack(request, 0)) {
                     return false;
                 }
                 break;
             case TFTP_OPCODE_DATA:
+recovered_data_packet:
                 if (is_first_receive) {
                     if (request->use_options) {
                         logger_log_error(request->logger, "Received DATA packet before OACK packet, discarding options.");
@@ -522,15 +906,43 @@ static bool receive_file(struct request request[static 1], FILE file[static 1])
                             request->server_may_not_support_options = true;
                             return false;
                         }
+                        if (request->options.use_range) {
+                            // the file would be received from its first byte
+                            logger_log_error(request->logger, "Server may not support the offset and length options.");
+                            send_error(request, TFTP_ERROR_INVALID_OPTIONS, nullptr);
+                            return false;
+                        }
                     }
                     request->options.window_size = tftp_default_window_size;
                     request->options.block_size = tftp_default_blksize;
-                    request->options.timeout_s = default_timeout_s;
+                    request->options.timeout_us = default_timeout_us;
                     request->options.use_adaptive_timeout = false;
                     request->options.use_tsize = false;
+                    request->options.use_sack = false;
+                    request->options.fec_group_size = 0;
+                    request->options.use_pipeline = false;
+                    request->options.use_compression = false;
                 }
                 struct tftp_data_packet *data_packet = (struct tftp_data_packet *) request->packet_recv_buffer;
                 uint16_t block_number = ntohs(data_packet->block_number);
+                size_t block_size = bytes_received - sizeof *data_packet;
+                const uint16_t block_offset = block_number - expected_sequence_number;
+                const uint64_t absolute_block_number = blocks_delivered + 1 + block_offset;
+                if (block_offset <= request->reorder_buffer.capacity) {
+                    fec_decoder_add_block(&request->fec_decoder, absolute_block_number, data_packet->data, block_size);
+                }
+                if (block_offset != 0 && request->reorder_buffer.capacity != 0) {
+                    logger_log_debug(request->logger, "Received out of order DATA packet: expected block %hu, received block %hu. Buffering it.", expected_sequence_number, block_number);
+                    reorder_buffer_store(&request->reorder_buffer, block_offset, data_packet->data, block_size);
+                    bytes_received = recover_data_packet(request, absolute_block_number, expected_sequence_number, blocks_delivered);
+                    if (bytes_received != 0) {
+                        goto recovered_data_packet;
+                    }
+                    if (!send_ack(request, expected_sequence_number - 1)) {
+                        return false;
+                    }
+                    break;
+                }
                 if (block_number != expected_sequence_number) {
                     logger_log_debug(request->logger, "Received out of order DATA packet: expected block %hu, received block %hu. Retransmitting last ACK.", expected_sequence_number, block_number);
                     if (!retransmit_last_packet_sent(request)) {
@@ -539,36 +951,67 @@ static bool receive_file(struct request request[static 1], FILE file[static 1])
                     break;  // ignore out of order DATA packets
                 }
                 expected_sequence_number++;
-                size_t block_size = bytes_received - sizeof *data_packet;
-                if (fwrite(data_packet->data, 1, block_size, file) != block_size) {
-                    logger_log_error(request->logger, "Failed to write to file. %s", strerror(errno));
-                    if (errno == ENOSPC) {
-                        send_error(request, TFTP_ERROR_DISK_FULL, nullptr);
-                    }
-                    else {
-                        send_error(request, TFTP_ERROR_NOT_DEFINED, nullptr);
-                    }
+                blocks_delivered++;
+                if (!write_block(request, file, data_packet->data, block_size)) {
                     return false;
                 }
-                request->stats.file_bytes_transferred += block_size;
                 logger_log_trace(request->logger, "Received DATA <block=%d, size=%zu bytes>", block_number, block_size);
-                if (!send_ack(request, block_number)) {
+                transfer_complete = block_size < request->options.block_size;
+                const uint8_t *buffered_block;
+                while (!transfer_complete && reorder_buffer_pop(&request->reorder_buffer, &buffered_block, &block_size)) {
+                    if (!write_block(request, file, buffered_block, block_size)) {
+                        return false;
+                    }
+                    logger_log_trace(request->logger, "Delivered buffered DATA <block=%d, size=%zu bytes>", expected_sequence_number, block_size);
+                    expected_sequence_number++;
+                    blocks_delivered++;
+                    transfer_complete = block_size < request->options.block_size;
+                }
+                if (!transfer_complete) {
+                    bytes_received = recover_data_packet(request, absolute_block_number, expected_sequence_number, blocks_delivered);
+                    if (bytes_received != 0) {
+                        goto recovered_data_packet;
+                    }
+                }
+                if (!send_ack(request, expected_sequence_number - 1)) {
                     return false;
                 }
-                if (block_size < request->options.block_size) {
-                    transfer_complete = true;
+                break;
+            case TFTP_OPCODE_FEC: {
+                if (request->fec_decoder.group_size == 0 || bytes_received < (ssize_t) sizeof(struct tftp_fec_packet)) {
+                    goto unexpected_opcode;
+                }
+                auto fec_packet = (struct tftp_fec_packet *) request->packet_recv_buffer;
+                const int16_t block_offset = (int16_t) (ntohs(fec_packet->block_number) - expected_sequence_number);
+                if (block_offset < 0 && (uint64_t) -block_offset > blocks_delivered) {
+                    break;
+                }
+                const uint64_t first_block = blocks_delivered + 1 + block_offset;
+                logger_log_trace(request->logger, "Received FEC <block=%d, blocks=%d>", ntohs(fec_packet->block_number), ntohs(fec_packet->blocks_count));
+                fec_decoder_add_fec(&request->fec_decoder,
+                                    first_block,
+                                    ntohs(fec_packet->blocks_count),
+                                    ntohs(fec_packet->size_parity),
+                                    fec_packet->data,
+                                    bytes_received - sizeof *fec_packet);
+                bytes_received = recover_data_packet(request, first_block, expected_sequence_number, blocks_delivered);
+                if (bytes_received != 0) {
+                    goto recovered_data_packet;
                 }
                 break;
+            }
             case TFTP_OPCODE_ERROR:
                 log_error_packet_received(request->logger, (struct tftp_error_packet *) request->packet_recv_buffer, bytes_received);
                 request->server_may_not_support_options = (is_first_receive && request->use_options);
                 return false;
+unexpected_opcode:
             default:
                 logger_log_error(request->logger, "Unexpected opcode %d", opcode);
                 return false;
         }
         is_first_receive = false;
     }
+    request->last_block_received = expected_sequence_number - 1;
     return true;
 }
 
@@ -595,7 +1038,7 @@ static bool send_file(struct request request[static 1], FILE file[static 1]) {
         adaptive_timeout_init(&adaptive_timeout);
         rto = timespec_to_double(adaptive_timeout.rto);
     } else {
-        rto = request->options.timeout_s;
+        rto = request->options.timeout_us / 1e6;
     }
     
     while (!transfer_completed) {
@@ -765,8 +1208,9 @@ static bool handle_oack_packet(struct request request[static 1], ssize_t packet_
     char ackd_options_str[tftp_option_formatted_string_max_size];
     bool contains_unrequested_options = false;
     uint16_t block_size = request->options.block_size;
-    uint16_t timeout = request->options.timeout_s;
+    uint32_t timeout_us = request->options.timeout_us;
     uint16_t window_size = request->options.window_size;
+    uint8_t fec_group_size = 0;
     tftp_parse_options(ackd_options, packet_size - sizeof *oack_packet, (char *) oack_packet->options_values);
     if (request->options.use_adaptive_timeout && request->request_type == REQUEST_GET) {
         request->options.use_adaptive_timeout = false;
@@ -803,7 +1247,13 @@ static bool handle_oack_packet(struct request request[static 1], ssize_t packet_
                     if (request->options.use_adaptive_timeout) {
                         break;
                     }
-                    timeout = strtoul(ackd_options[o].value, nullptr, 10);
+                    timeout_us = strtoul(ackd_options[o].value, nullptr, 10) * 1'000'000;
+                    break;
+                case TFTP_OPTION_UTIMEOUT:
+                    if (request->options.use_adaptive_timeout) {
+                        break;
+                    }
+                    timeout_us = strtoul(ackd_options[o].value, nullptr, 10);
                     break;
                 case TFTP_OPTION_TSIZE:
                     request->options.tsize = strtoul(ackd_options[o].value, nullptr, 10);
@@ -811,6 +1261,18 @@ static bool handle_oack_packet(struct request request[static 1], ssize_t packet_
                 case TFTP_OPTION_WINDOWSIZE:
                     window_size = strtoul(ackd_options[o].value, nullptr, 10);
                     break;
+                case TFTP_OPTION_FEC:
+                    fec_group_size = strtoul(ackd_options[o].value, nullptr, 10);
+                    break;
+                case TFTP_OPTION_DIGEST:
+                    // a server echoing the algorithm does not know the digest of the file
+                    request->options.has_server_digest = digest_parse(ackd_options[o].value, &request->options.server_digest);
+                    break;
+                case TFTP_OPTION_SACK:
+                case TFTP_OPTION_OFFSET:
+                case TFTP_OPTION_LENGTH:
+                case TFTP_OPTION_PIPELINE:
+                case TFTP_OPTION_COMPRESS:
                 case TFTP_OPTION_READ_TYPE:
                     break;
                 default:
@@ -818,11 +1280,21 @@ static bool handle_oack_packet(struct request request[static 1], ssize_t packet_
             }
         }
     }
+    request->options.use_sack = ackd_options[TFTP_OPTION_SACK].is_active;
+    request->options.use_pipeline = ackd_options[TFTP_OPTION_PIPELINE].is_active;
+    request->options.use_compression = ackd_options[TFTP_OPTION_COMPRESS].is_active;
+    request->options.fec_group_size = fec_group_size;
     if (contains_unrequested_options) {
         logger_log_error(request->logger, "Received OACK with unrequested options.");
         send_error(request, TFTP_ERROR_INVALID_OPTIONS, nullptr);
         return false;
     }
+    if ((request->options.options[TFTP_OPTION_OFFSET].is_active && !ackd_options[TFTP_OPTION_OFFSET].is_active)
+        || (request->options.options[TFTP_OPTION_LENGTH].is_active && !ackd_options[TFTP_OPTION_LENGTH].is_active)) {
+        logger_log_error(request->logger, "Received OACK without the offset and length options. Server may not support them for this file.");
+        send_error(request, TFTP_ERROR_INVALID_OPTIONS, nullptr);
+        return false;
+    }
     if (block_size != request->options.block_size || window_size != request->options.window_size) {
         request->options.block_size = block_size;
         request->options.window_size = window_size;
@@ -834,11 +1306,9 @@ static bool handle_oack_packet(struct request request[static 1], ssize_t packet_
         }
         request->packet_recv_buffer = new_buffer;
     }
-    if (!request->options.use_adaptive_timeout && timeout != request->options.timeout_s) {
-        request->options.timeout_s = timeout;
-        struct timeval new_timeout = {.tv_sec = request->options.timeout_s,};
-        if (setsockopt(request->connection->sockfd, SOL_SOCKET, SO_RCVTIMEO, &new_timeout, sizeof new_timeout) == -1) {
-            logger_log_error(request->logger, "Could not set listener socket options for the server. %s", strerror(errno));
+    if (!request->options.use_adaptive_timeout && timeout_us != request->options.timeout_us) {
+        request->options.timeout_us = timeout_us;
+        if (!connection_set_recv_timeout(request->connection, request->options.timeout_us, request->logger)) {
             return false;
         }
     }
@@ -934,22 +1404,163 @@ static bool send_wrq(struct request request[static 1]) {
 }
 
 static bool send_ack(struct request request[static 1], uint16_t received_block_number) {
-    struct tftp_ack_packet ack_packet;
-    ssize_t ack_packet_size = sizeof ack_packet;
-    tftp_ack_packet_init(&ack_packet, received_block_number);
-    if (!send_ack_packet(request, &ack_packet)) {
+    tftp_ack_packet_init(&request->last_packet_sent.ack_packet, received_block_number);
+    size_t ack_packet_size = sizeof request->last_packet_sent.ack_packet;
+    if (request->options.use_sack) {
+        ack_packet_size += reorder_buffer_get_bitmap(&request->reorder_buffer, request->last_packet_sent.sack_bitmap);
+    }
+    if (!send_ack_packet(request, &request->last_packet_sent.ack_packet, ack_packet_size)) {
         return false;
     }
-    request->last_packet_sent.ack_packet = ack_packet;
     request->last_packet_sent_size = ack_packet_size;
     return true;
 }
 
+// Blocks of compressed transfers are decompressed, the content is written as soon as a frame is complete.
+static bool write_block(struct request request[static 1], FILE file[static 1], const uint8_t data[], size_t size) {
+    if (!request->options.use_compression) {
+        return write_data(request, file, data, size);
+    }
+    while (size != 0) {
+        const uint8_t *chunk;
+        size_t chunk_size;
+        const ssize_t consumed = decompressor_feed(&request->decompressor, size, data, &chunk, &chunk_size);
+        if (consumed == -1) {
+            logger_log_error(request->logger, "Received ill formed compressed data.");
+            send_error(request, TFTP_ERROR_NOT_DEFINED, "Ill formed compressed data.");
+            return false;
+        }
+        if (chunk_size != 0 && !write_data(request, file, chunk, chunk_size)) {
+            return false;
+        }
+        data += consumed;
+        size -= consumed;
+    }
+    return true;
+}
+
+static bool write_data(struct request request[static 1], FILE file[static 1], const uint8_t data[], size_t size) {
+    const bool is_written = request->options.use_range
+                            ? pwrite(fileno(file), data, size, (off_t) (request->options.offset + request->stats.file_bytes_transferred)) == (ssize_t) size
+                            : fwrite(data, 1, size, file) == size;
+    if (!is_written) {
+        logger_log_error(request->logger, "Failed to write to file. %s", strerror(errno));
+        if (errno == ENOSPC) {
+            send_error(request, TFTP_ERROR_DISK_FULL, nullptr);
+        }
+        else {
+            send_error(request, TFTP_ERROR_NOT_DEFINED, nullptr);
+        }
+        return false;
+    }
+    request->stats.file_bytes_transferred += size;
+    return true;
+}
+
+/*
+ * Rebuilds the block missing in the group of block from its FEC packet. The block is written in the receive buffer as a
+ *  DATA packet, as if it was received, and the size of the packet is returned. Returns 0 if no block was rebuilt.
+ */
+static ssize_t recover_data_packet(struct request request[static 1],
+                                   uint64_t block,
+                                   uint16_t expected_sequence_number,
+                                   uint64_t blocks_delivered) {
+    uint64_t recovered_block;
+    const uint8_t *data;
+    size_t size;
+    if (!fec_decoder_recover(&request->fec_decoder, block, &recovered_block, &data, &size) || recovered_block <= blocks_delivered) {
+        return 0;
+    }
+    auto data_packet = (struct tftp_data_packet *) request->packet_recv_buffer;
+    data_packet->opcode = htons(TFTP_OPCODE_DATA);
+    data_packet->block_number = htons(expected_sequence_number + (uint16_t) (recovered_block - blocks_delivered - 1));
+    memcpy(data_packet->data, data, size);
+    logger_log_debug(request->logger, "Recovered DATA <block=%d, size=%zu bytes> from FEC packet.", ntohs(data_packet->block_number), size);
+    return (ssize_t) (sizeof *data_packet + size);
+}
+
+static bool reorder_buffer_init(struct reorder_buffer buffer[static 1], uint16_t window_size, uint16_t block_size, struct logger logger[static 1]) {
+    const uint16_t capacity = window_size - 1 < tftp_sack_bitmap_max_size * 8 ? window_size - 1 : tftp_sack_bitmap_max_size * 8;
+    if (capacity == 0) {
+        return true;    // the server shrunk the window to a single block
+    }
+    *buffer = (struct reorder_buffer) {
+        .capacity = capacity,
+        .head = 0,
+        .block_size = block_size,
+        .blocks = malloc((size_t) capacity * block_size),
+        .block_sizes = malloc(capacity * sizeof *buffer->block_sizes),
+        .is_received = calloc(capacity, sizeof *buffer->is_received),
+    };
+    if (buffer->blocks == nullptr || buffer->block_sizes == nullptr || buffer->is_received == nullptr) {
+        logger_log_error(logger, "Failed to allocate memory for the reorder buffer. %s", strerror(errno));
+        reorder_buffer_destroy(buffer);
+        return false;
+    }
+    return true;
+}
+
+static void reorder_buffer_destroy(struct reorder_buffer buffer[static 1]) {
+    free(buffer->blocks);
+    free(buffer->block_sizes);
+    free(buffer->is_received);
+    *buffer = (struct reorder_buffer) {};
+}
+
+// The offset is the distance of the block from the next expected one, blocks that do not fit are dropped.
+static void reorder_buffer_store(struct reorder_buffer buffer[static 1], uint16_t offset, const uint8_t data[], size_t size) {
+    if (offset == 0 || offset > buffer->capacity) {
+        return;
+    }
+    const size_t slot = (buffer->head + offset - 1) % buffer->capacity;
+    if (buffer->is_received[slot] || size > buffer->block_size) {
+        return;
+    }
+    memcpy(&buffer->blocks[slot * buffer->block_size], data, size);
+    buffer->block_sizes[slot] = size;
+    buffer->is_received[slot] = true;
+}
+
+// Moves past the next expected block, which is returned if it was buffered.
+static bool reorder_buffer_pop(struct reorder_buffer buffer[static 1], const uint8_t *data[static 1], size_t size[static 1]) {
+    if (buffer->capacity == 0) {
+        return false;
+    }
+    const size_t slot = buffer->head;
+    buffer->head = (buffer->head + 1) % buffer->capacity;
+    if (!buffer->is_received[slot]) {
+        return false;
+    }
+    buffer->is_received[slot] = false;
+    *data = &buffer->blocks[slot * buffer->block_size];
+    *size = buffer->block_sizes[slot];
+    return true;
+}
+
+// Returns the size of the bitmap, 0 when no block is buffered.
+static size_t reorder_buffer_get_bitmap(struct reorder_buffer buffer[static 1], uint8_t bitmap[static tftp_sack_bitmap_max_size]) {
+    size_t bitmap_size = 0;
+    for (size_t i = 0; i < buffer->capacity; i++) {
+        if (i % 8 == 0) {
+            bitmap[i / 8] = 0;
+        }
+        if (buffer->is_received[(buffer->head + i) % buffer->capacity]) {
+            bitmap[i / 8] |= 1U << (i % 8);
+            bitmap_size = i / 8 + 1;
+        }
+    }
+    return bitmap_size;
+}
+
 static bool send_error(struct request request[static 1], enum tftp_error_code error_code, const char *error_message) {
     if (error_code == TFTP_ERROR_NOT_DEFINED) {
-        logger_log_error(request->logger, "Undefined error code are still not supported.");
-        (void) error_message;
-        return false;
+        if (error_message == nullptr) {
+            logger_log_error(request->logger, "Undefined error code are still not supported without a message.");
+            return false;
+        }
+        const size_t message_size = strlen(error_message) + 1;
+        struct tftp_packet packet = tftp_encode_error(error_code, message_size, (char *) error_message);
+        return send_error_packet(request, (const struct tftp_error_packet *) &packet, offsetof(struct tftp_packet, error.error_message) + message_size);
     }
     const struct tftp_error_packet *error_packet = tftp_error_packet_info[error_code].packet;
     size_t error_packet_size = tftp_error_packet_info[error_code].size;
@@ -971,7 +1582,7 @@ static bool retransmit_last_packet_sent(struct request request[static 1]) {
             ret = send_wrq_packet(request, &request->last_packet_sent.wrq_packet, request->last_packet_sent_size);
             break;
         case TFTP_OPCODE_ACK:
-            ret = send_ack_packet(request, &request->last_packet_sent.ack_packet);
+            ret = send_ack_packet(request, &request->last_packet_sent.ack_packet, request->last_packet_sent_size);
             break;
         default:
             logger_log_error(request->logger, "Last packet sent is of an unexpected packet type %d", opcode);
@@ -1022,10 +1633,10 @@ static bool send_wrq_packet(struct request request[static 1],
     return true;
 }
 
-static bool send_ack_packet(struct request request[static 1], const struct tftp_ack_packet ack_packet[static 1]) {
+static bool send_ack_packet(struct request request[static 1], const struct tftp_ack_packet ack_packet[static 1], size_t ack_packet_size) {
     ssize_t bytes_sent = sendto(request->connection->sockfd,
                                 ack_packet,
-                                sizeof *ack_packet,
+                                ack_packet_size,
                                 0,
                                 (struct sockaddr *) &request->connection->server_addr.sockaddr,
                                 request->connection->server_addr.socklen);
@@ -1034,7 +1645,12 @@ static bool send_ack_packet(struct request request[static 1], const struct tftp_
         return false;
     }
     uint16_t received_block_number = ntohs(ack_packet->block_number);
-    logger_log_trace(request->logger, "Sent ACK <block=%d>", received_block_number);
+    if (ack_packet_size > sizeof *ack_packet) {
+        logger_log_trace(request->logger, "Sent SACK <block=%d, bitmap=%zu bytes>", received_block_number, ack_packet_size - sizeof *ack_packet);
+    }
+    else {
+        logger_log_trace(request->logger, "Sent ACK <block=%d>", received_block_number);
+    }
     return true;
 }
 
@@ -1112,6 +1728,6 @@ static inline void log_error_packet_received(struct logger logger[static 1],
 static inline size_t tftp_packet_buffer_size(uint16_t required_block_size) {
     //constexpr size_t min_buffer_size = tftp_oack_packet_max_size;
     constexpr size_t min_buffer_size = 516; // data_packet size + default_block_size since it is handled poorly
-    size_t required_buffer_size = sizeof(struct tftp_data_packet) + required_block_size;
+    size_t required_buffer_size = sizeof(struct tftp_fec_packet) + required_block_size;    // largest header
     return required_buffer_size < min_buffer_size ? min_buffer_size : required_buffer_size;
 }
@@ -75,8 +75,8 @@ fail:
     return false;
 }
 
-bool connection_set_recv_timeout(struct connection connection[static 1], uint8_t timeout_s, struct logger logger[static 1]) {
-    struct timeval timeout = {.tv_sec = timeout_s,};
+bool connection_set_recv_timeout(struct connection connection[static 1], uint32_t timeout_us, struct logger logger[static 1]) {
+    struct timeval timeout = {.tv_sec = timeout_us / 1'000'000, .tv_usec = timeout_us % 1'000'000};
     if (setsockopt(connection->sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout) == -1) {
         logger_log_error(logger, "Could not set socket timeout option. %s", strerror(errno));
         return false;
@@ -26,7 +26,7 @@ bool connection_init(struct connection connection[static 1],
                      struct logger logger[static 1]);
 
 
-bool connection_set_recv_timeout(struct connection connection[static 1], uint8_t timeout_s, struct logger logger[static 1]);
+bool connection_set_recv_timeout(struct connection connection[static 1], uint32_t timeout_us, struct logger logger[static 1]);
 
 bool connection_destroy(struct connection connection[static 1], struct logger logger[static 1]);
 
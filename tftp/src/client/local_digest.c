@@ -0,0 +1,74 @@
+#include "local_digest.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include "../digest.h"
+
+static const char digest_attribute[] = "user.tftp.xxh64";
+
+struct stored_digest {
+    uint64_t size;
+    int64_t mtime_s;
+    int64_t mtime_ns;
+    uint64_t digest;
+};
+
+static bool compute_digest(int fd, uint64_t digest[static 1]);
+
+bool local_digest_get(FILE file[static 1], uint64_t digest[static 1], struct logger logger[static 1]) {
+    const int fd = fileno(file);
+    struct stat file_stat;
+    if (fd == -1 || fstat(fd, &file_stat) == -1) {
+        logger_log_warn(logger, "Could not query the local copy of the file. %s", strerror(errno));
+        return false;
+    }
+    if (!S_ISREG(file_stat.st_mode)) {
+        return false;
+    }
+    struct stored_digest stored;
+    if (fgetxattr(fd, digest_attribute, &stored, sizeof stored) == sizeof stored
+        && stored.size == (uint64_t) file_stat.st_size
+        && stored.mtime_s == file_stat.st_mtim.tv_sec
+        && stored.mtime_ns == file_stat.st_mtim.tv_nsec) {
+        *digest = stored.digest;
+        return true;
+    }
+    if (!compute_digest(fd, digest)) {
+        logger_log_warn(logger, "Could not read the local copy of the file. %s", strerror(errno));
+        return false;
+    }
+    stored = (struct stored_digest) {
+        .size = file_stat.st_size,
+        .mtime_s = file_stat.st_mtim.tv_sec,
+        .mtime_ns = file_stat.st_mtim.tv_nsec,
+        .digest = *digest,
+    };
+    if (fsetxattr(fd, digest_attribute, &stored, sizeof stored, 0) == -1) {
+        logger_log_debug(logger, "Could not cache the digest of the local copy of the file. %s", strerror(errno));
+    }
+    return true;
+}
+
+static bool compute_digest(int fd, uint64_t digest[static 1]) {
+    struct digest_state state;
+    digest_init(&state);
+    uint8_t buffer[16384];
+    off_t offset = 0;
+    ssize_t bytes_read;
+    do {
+        do {
+            bytes_read = pread(fd, buffer, sizeof buffer, offset);
+        } while (bytes_read == -1 && errno == EINTR);
+        if (bytes_read == -1) {
+            return false;
+        }
+        digest_update(&state, buffer, bytes_read);
+        offset += bytes_read;
+    } while (bytes_read != 0);
+    *digest = digest_final(&state);
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef TFTP_CLIENT_LOCAL_DIGEST_H
+#define TFTP_CLIENT_LOCAL_DIGEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <logger.h>
+
+/*
+ * Digest of the local copy of a file, compared with the one advertised by the server to skip downloading it again.
+ * The digest is cached in an extended attribute of the file along with its size and modification time, so that a copy
+ *  is hashed again only after it changes. Copies on file systems without user extended attributes are hashed each time.
+ */
+bool local_digest_get(FILE file[static 1], uint64_t digest[static 1], struct logger logger[static 1]);
+
+#endif // TFTP_CLIENT_LOCAL_DIGEST_H
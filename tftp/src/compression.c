@@ -0,0 +1,231 @@
+#include "compression.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char compression_algorithm[] = "lz77";
+
+static constexpr size_t min_match_length = 4;
+static constexpr size_t max_distance = 65535;
+static constexpr int hash_bits = 12;
+static constexpr uint32_t no_position = UINT32_MAX;
+
+static size_t compress_chunk(const uint8_t source[], size_t size, uint8_t destination[]);
+static bool decompress_chunk(const uint8_t source[], size_t size, uint8_t destination[], size_t chunk_size);
+static size_t write_length(uint8_t destination[], size_t length);
+static bool read_length(const uint8_t source[], size_t size, size_t position[static 1], size_t length[static 1]);
+
+static inline uint32_t read_u32(const uint8_t data[static 4]) {
+    uint32_t value;
+    memcpy(&value, data, sizeof value);
+    return value;
+}
+
+static inline size_t get_chunk_bound(size_t size) {
+    // literals only with a length byte every 255 of them, plus some tokens
+    return size + size / 255 + 16;
+}
+
+size_t compression_bound(size_t size) {
+    const size_t chunks_count = (size + compression_chunk_size - 1) / compression_chunk_size;
+    return chunks_count * (compression_frame_header_size + get_chunk_bound(compression_chunk_size));
+}
+
+size_t compression_compress(const uint8_t source[], size_t size, uint8_t destination[]) {
+    size_t frames_size = 0;
+    for (size_t offset = 0; offset < size; offset += compression_chunk_size) {
+        const size_t chunk_size = size - offset < compression_chunk_size ? size - offset : compression_chunk_size;
+        uint8_t *header = &destination[frames_size];
+        uint8_t *payload = &header[compression_frame_header_size];
+        size_t payload_size = compress_chunk(&source[offset], chunk_size, payload);
+        if (payload_size >= chunk_size) {
+            memcpy(payload, &source[offset], chunk_size);
+            payload_size = chunk_size;
+        }
+        header[0] = (uint8_t) ((chunk_size - 1) >> 8);
+        header[1] = (uint8_t) (chunk_size - 1);
+        header[2] = (uint8_t) ((payload_size - 1) >> 8);
+        header[3] = (uint8_t) (payload_size - 1);
+        frames_size += compression_frame_header_size + payload_size;
+    }
+    return frames_size;
+}
+
+bool decompressor_init(struct decompressor decompressor[static 1], struct logger logger[static 1]) {
+    *decompressor = (struct decompressor) {
+        .payload = malloc(compression_chunk_size),
+        .chunk = malloc(compression_chunk_size),
+    };
+    if (decompressor->payload == nullptr || decompressor->chunk == nullptr) {
+        logger_log_error(logger, "Could not allocate memory for the decompressor. %s", strerror(errno));
+        decompressor_destroy(decompressor);
+        return false;
+    }
+    return true;
+}
+
+void decompressor_destroy(struct decompressor decompressor[static 1]) {
+    free(decompressor->payload);
+    free(decompressor->chunk);
+    decompressor->payload = nullptr;
+    decompressor->chunk = nullptr;
+}
+
+ssize_t decompressor_feed(struct decompressor decompressor[static 1],
+                          size_t size,
+                          const uint8_t data[static size],
+                          const uint8_t *chunk[static 1],
+                          size_t chunk_size[static 1]) {
+    size_t consumed = 0;
+    *chunk_size = 0;
+    if (decompressor->header_size < compression_frame_header_size) {
+        const size_t missing = compression_frame_header_size - decompressor->header_size;
+        consumed = size < missing ? size : missing;
+        memcpy(&decompressor->header[decompressor->header_size], data, consumed);
+        decompressor->header_size += consumed;
+        if (decompressor->header_size < compression_frame_header_size) {
+            return (ssize_t) consumed;
+        }
+        decompressor->chunk_size = (size_t) (decompressor->header[0] << 8 | decompressor->header[1]) + 1;
+        decompressor->payload_size = (size_t) (decompressor->header[2] << 8 | decompressor->header[3]) + 1;
+        decompressor->payload_received = 0;
+        if (decompressor->payload_size > decompressor->chunk_size) {
+            return -1;
+        }
+    }
+    const size_t missing = decompressor->payload_size - decompressor->payload_received;
+    const size_t available = size - consumed;
+    const size_t payload_bytes = available < missing ? available : missing;
+    memcpy(&decompressor->payload[decompressor->payload_received], &data[consumed], payload_bytes);
+    decompressor->payload_received += payload_bytes;
+    consumed += payload_bytes;
+    if (decompressor->payload_received < decompressor->payload_size) {
+        return (ssize_t) consumed;
+    }
+    decompressor->header_size = 0;
+    if (decompressor->payload_size == decompressor->chunk_size) {
+        *chunk = decompressor->payload;
+    }
+    else if (decompress_chunk(decompressor->payload, decompressor->payload_size, decompressor->chunk, decompressor->chunk_size)) {
+        *chunk = decompressor->chunk;
+    }
+    else {
+        return -1;
+    }
+    *chunk_size = decompressor->chunk_size;
+    return (ssize_t) consumed;
+}
+
+// Greedy parsing with a single candidate for each hash of the next 4 bytes, chunks are short enough for 16 bit distances.
+static size_t compress_chunk(const uint8_t source[], size_t size, uint8_t destination[]) {
+    uint32_t positions[1 << hash_bits];
+    for (size_t i = 0; i < sizeof positions / sizeof *positions; i++) {
+        positions[i] = no_position;
+    }
+    size_t written = 0;
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + min_match_length <= size) {
+        const uint32_t sequence = read_u32(&source[i]);
+        const uint32_t hash = (sequence * 2654435761U) >> (32 - hash_bits);
+        const uint32_t candidate = positions[hash];
+        positions[hash] = (uint32_t) i;
+        if (candidate == no_position || i - candidate > max_distance || read_u32(&source[candidate]) != sequence) {
+            i++;
+            continue;
+        }
+        size_t length = min_match_length;
+        while (i + length < size && source[candidate + length] == source[i + length]) {
+            length++;
+        }
+        const size_t literals = i - anchor;
+        uint8_t *token = &destination[written++];
+        *token = (uint8_t) ((literals < 15 ? literals : 15) << 4 | (length - min_match_length < 15 ? length - min_match_length : 15));
+        if (literals >= 15) {
+            written += write_length(&destination[written], literals - 15);
+        }
+        memcpy(&destination[written], &source[anchor], literals);
+        written += literals;
+        const size_t distance = i - candidate;
+        destination[written++] = (uint8_t) distance;
+        destination[written++] = (uint8_t) (distance >> 8);
+        if (length - min_match_length >= 15) {
+            written += write_length(&destination[written], length - min_match_length - 15);
+        }
+        i += length;
+        anchor = i;
+        if (written >= size) {
+            return written;     // stored as is
+        }
+    }
+    const size_t literals = size - anchor;
+    destination[written++] = (uint8_t) ((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) {
+        written += write_length(&destination[written], literals - 15);
+    }
+    memcpy(&destination[written], &source[anchor], literals);
+    return written + literals;
+}
+
+static bool decompress_chunk(const uint8_t source[], size_t size, uint8_t destination[], size_t chunk_size) {
+    size_t read = 0;
+    size_t written = 0;
+    while (read < size) {
+        const uint8_t token = source[read++];
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(source, size, &read, &literals)) {
+            return false;
+        }
+        if (literals > size - read || literals > chunk_size - written) {
+            return false;
+        }
+        memcpy(&destination[written], &source[read], literals);
+        read += literals;
+        written += literals;
+        if (read == size) {
+            break;
+        }
+        if (size - read < 2) {
+            return false;
+        }
+        const size_t distance = source[read] | (size_t) source[read + 1] << 8;
+        read += 2;
+        size_t length = token & 0x0f;
+        if (length == 15 && !read_length(source, size, &read, &length)) {
+            return false;
+        }
+        length += min_match_length;
+        if (distance == 0 || distance > written || length > chunk_size - written) {
+            return false;
+        }
+        // byte by byte, the match may overlap the bytes it produces
+        for (size_t i = 0; i < length; i++) {
+            destination[written + i] = destination[written - distance + i];
+        }
+        written += length;
+    }
+    return written == chunk_size;
+}
+
+static size_t write_length(uint8_t destination[], size_t length) {
+    size_t written = 0;
+    while (length >= 255) {
+        destination[written++] = 255;
+        length -= 255;
+    }
+    destination[written++] = (uint8_t) length;
+    return written;
+}
+
+static bool read_length(const uint8_t source[], size_t size, size_t position[static 1], size_t length[static 1]) {
+    uint8_t byte;
+    do {
+        if (*position >= size) {
+            return false;
+        }
+        byte = source[(*position)++];
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <logger.h>
+
+/*
+ * Built-in LZ77 compression of the files read with the compress option. The content is split in chunks compressed
+ *  independently, each framed by a header holding its size and the size of its payload, both minus 1 as 16 bit big
+ *  endian numbers. A chunk that does not shrink is stored as is, with a payload as large as the chunk.
+ * The frames are sent as the content of the file, DATA blocks do not follow the frame boundaries.
+ * A compressed payload is a sequence of tokens: a byte holding the literals count in the high nibble and the match
+ *  length minus 4 in the low one, the literals, then the 16 bit little endian distance of the match. Nibbles of 15 are
+ *  continued by bytes added to them up to the first one that is not 255, placed after the token for literals and after
+ *  the distance for matches. The last token of a payload has literals only.
+ */
+
+constexpr size_t compression_chunk_size = 65536;
+constexpr size_t compression_frame_header_size = 4;
+
+extern const char compression_algorithm[];    // value of the compress option
+
+// Largest size of the frames of size bytes of content.
+size_t compression_bound(size_t size);
+
+// Compresses size bytes in frames, destination must hold compression_bound(size) bytes. Returns the frames size.
+size_t compression_compress(const uint8_t source[], size_t size, uint8_t destination[]);
+
+struct decompressor {
+    uint8_t header[compression_frame_header_size];
+    size_t header_size;         // bytes of the header of the current frame received
+    size_t chunk_size;
+    size_t payload_size;
+    size_t payload_received;
+    uint8_t *payload;
+    uint8_t *chunk;
+};
+
+bool decompressor_init(struct decompressor decompressor[static 1], struct logger logger[static 1]);
+
+void decompressor_destroy(struct decompressor decompressor[static 1]);
+
+/*
+ * Consumes the bytes of data up to the end of the current frame, returns the bytes consumed or -1 for an ill formed
+ *  frame. When the frame is complete chunk points to its content, valid until the next call, otherwise chunk_size is 0.
+ */
+ssize_t decompressor_feed(struct decompressor decompressor[static 1],
+                          size_t size,
+                          const uint8_t data[static size],
+                          const uint8_t *chunk[static 1],
+                          size_t chunk_size[static 1]);
+
+// True if all the frames fed so far are complete.
+static inline bool decompressor_is_at_frame_boundary(const struct decompressor decompressor[static 1]) {
+    return decompressor->header_size == 0;
+}
+
+#endif // COMPRESSION_H
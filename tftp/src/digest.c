@@ -0,0 +1,133 @@
+#include "digest.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+const char digest_algorithm[] = "xxh64";
+
+static constexpr uint64_t prime_1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t prime_2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t prime_3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t prime_4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t prime_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotate_left(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+static inline uint64_t read_64(const uint8_t *p) {
+    uint64_t x;
+    memcpy(&x, p, sizeof x);
+    return x;   // little endian hosts only, like the rest of the server
+}
+
+static inline uint32_t read_32(const uint8_t *p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof x);
+    return x;
+}
+
+static inline uint64_t round_64(uint64_t accumulator, uint64_t input) {
+    accumulator += input * prime_2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * prime_1;
+}
+
+static inline uint64_t merge_round(uint64_t accumulator, uint64_t value) {
+    accumulator ^= round_64(0, value);
+    return accumulator * prime_1 + prime_4;
+}
+
+static void consume_stripes(struct digest_state state[static 1], const uint8_t *data, size_t stripes) {
+    uint64_t *a = state->accumulators;
+    for (size_t i = 0; i < stripes; i++, data += 32) {
+        a[0] = round_64(a[0], read_64(&data[0]));
+        a[1] = round_64(a[1], read_64(&data[8]));
+        a[2] = round_64(a[2], read_64(&data[16]));
+        a[3] = round_64(a[3], read_64(&data[24]));
+    }
+}
+
+void digest_init(struct digest_state state[static 1]) {
+    *state = (struct digest_state) {
+        .accumulators = {prime_1 + prime_2, prime_2, 0, -prime_1},
+    };
+}
+
+void digest_update(struct digest_state state[static 1], const void *data, size_t size) {
+    const uint8_t *p = data;
+    state->total_size += size;
+    if (state->buffer_size + size < sizeof state->buffer) {
+        memcpy(&state->buffer[state->buffer_size], p, size);
+        state->buffer_size += size;
+        return;
+    }
+    if (state->buffer_size != 0) {
+        const size_t fill = sizeof state->buffer - state->buffer_size;
+        memcpy(&state->buffer[state->buffer_size], p, fill);
+        consume_stripes(state, state->buffer, 1);
+        p += fill;
+        size -= fill;
+        state->buffer_size = 0;
+    }
+    const size_t stripes = size / sizeof state->buffer;
+    consume_stripes(state, p, stripes);
+    p += stripes * sizeof state->buffer;
+    size -= stripes * sizeof state->buffer;
+    memcpy(state->buffer, p, size);
+    state->buffer_size = size;
+}
+
+uint64_t digest_final(const struct digest_state state[static 1]) {
+    const uint64_t *a = state->accumulators;
+    uint64_t h;
+    if (state->total_size >= sizeof state->buffer) {
+        h = rotate_left(a[0], 1) + rotate_left(a[1], 7) + rotate_left(a[2], 12) + rotate_left(a[3], 18);
+        for (size_t i = 0; i < 4; i++) {
+            h = merge_round(h, a[i]);
+        }
+    }
+    else {
+        h = a[2] + prime_5;
+    }
+    h += state->total_size;
+    const uint8_t *p = state->buffer;
+    const uint8_t *end = &state->buffer[state->buffer_size];
+    for (; p + 8 <= end; p += 8) {
+        h ^= round_64(0, read_64(p));
+        h = rotate_left(h, 27) * prime_1 + prime_4;
+    }
+    if (p + 4 <= end) {
+        h ^= read_32(p) * prime_1;
+        h = rotate_left(h, 23) * prime_2 + prime_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * prime_5;
+        h = rotate_left(h, 11) * prime_1;
+    }
+    h ^= h >> 33;
+    h *= prime_2;
+    h ^= h >> 29;
+    h *= prime_3;
+    h ^= h >> 32;
+    return h;
+}
+
+void digest_format(uint64_t digest, char str[static digest_string_size]) {
+    snprintf(str, digest_string_size, "%s:%016" PRIx64, digest_algorithm, digest);
+}
+
+bool digest_parse(const char *str, uint64_t digest[static 1]) {
+    const size_t prefix_size = strlen(digest_algorithm);
+    if (strncasecmp(str, digest_algorithm, prefix_size) != 0 || str[prefix_size] != ':') {
+        return false;
+    }
+    const char *hex = &str[prefix_size + 1];
+    if (strlen(hex) != 16 || strspn(hex, "0123456789abcdefABCDEF") != 16) {
+        return false;
+    }
+    return sscanf(hex, "%" SCNx64, digest) == 1;
+}
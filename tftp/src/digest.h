@@ -0,0 +1,36 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * XXH64 content digest of the files served with the digest option. The server acknowledges the option with
+ *  "xxh64:<16 lowercase hex digits>" and a client holding a copy with the same digest may skip the transfer.
+ * XXH64 is not a cryptographic hash, it detects changes of the content, not tampering.
+ */
+
+constexpr size_t digest_string_size = sizeof "xxh64:" + 16;     // 16 hex digits and '\0'
+
+extern const char digest_algorithm[];     // value of the digest option in requests
+
+struct digest_state {
+    uint64_t accumulators[4];
+    uint64_t total_size;
+    uint8_t buffer[32];         // input not yet consumed, less than a stripe
+    size_t buffer_size;
+};
+
+void digest_init(struct digest_state state[static 1]);
+
+void digest_update(struct digest_state state[static 1], const void *data, size_t size);
+
+uint64_t digest_final(const struct digest_state state[static 1]);
+
+// Formats the value of the digest option.
+void digest_format(uint64_t digest, char str[static digest_string_size]);
+
+// Parses the value of the digest option, returns false for a different algorithm or an ill formed value.
+bool digest_parse(const char *str, uint64_t digest[static 1]);
+
+#endif // DIGEST_H
@@ -0,0 +1,144 @@
+#include "fec.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct fec_group *get_group(struct fec_decoder decoder[static 1], uint64_t block);
+static bool mark_received(struct fec_group group[static 1], size_t index);
+
+void fec_xor(uint8_t destination[restrict], const uint8_t source[restrict], size_t size) {
+    size_t i = 0;
+    // word sized steps, the compiler vectorizes the loop
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t d;
+        uint64_t s;
+        memcpy(&d, &destination[i], sizeof d);
+        memcpy(&s, &source[i], sizeof s);
+        d ^= s;
+        memcpy(&destination[i], &d, sizeof d);
+    }
+    for (; i < size; i++) {
+        destination[i] ^= source[i];
+    }
+}
+
+bool fec_decoder_init(struct fec_decoder decoder[static 1],
+                      uint16_t group_size,
+                      uint16_t block_size,
+                      uint16_t span_blocks,
+                      struct logger logger[static 1]) {
+    const size_t groups_count = (span_blocks + group_size - 1) / group_size + 1;
+    *decoder = (struct fec_decoder) {
+        .group_size = group_size,
+        .block_size = block_size,
+        .groups_count = groups_count,
+        .groups = calloc(groups_count, sizeof *decoder->groups),
+        .payloads = malloc(groups_count * block_size),
+    };
+    if (decoder->groups == nullptr || decoder->payloads == nullptr) {
+        logger_log_error(logger, "Could not allocate memory for the FEC decoder. %s", strerror(errno));
+        fec_decoder_destroy(decoder);
+        return false;
+    }
+    for (size_t i = 0; i < groups_count; i++) {
+        decoder->groups[i].payload_parity = &decoder->payloads[i * block_size];
+    }
+    return true;
+}
+
+void fec_decoder_destroy(struct fec_decoder decoder[static 1]) {
+    free(decoder->groups);
+    free(decoder->payloads);
+    *decoder = (struct fec_decoder) {};
+}
+
+void fec_decoder_reset(struct fec_decoder decoder[static 1]) {
+    for (size_t i = 0; i < decoder->groups_count; i++) {
+        decoder->groups[i].first_block = 0;
+    }
+}
+
+void fec_decoder_add_block(struct fec_decoder decoder[static 1], uint64_t block, const uint8_t data[], size_t size) {
+    struct fec_group *group = get_group(decoder, block);
+    if (group == nullptr || size > decoder->block_size || !mark_received(group, block - group->first_block)) {
+        return;
+    }
+    fec_xor(group->payload_parity, data, size);
+    group->size_parity ^= size;
+}
+
+void fec_decoder_add_fec(struct fec_decoder decoder[static 1],
+                         uint64_t first_block,
+                         uint16_t blocks_count,
+                         uint16_t size_parity,
+                         const uint8_t data[],
+                         size_t size) {
+    struct fec_group *group = get_group(decoder, first_block);
+    if (group == nullptr
+        || group->first_block != first_block
+        || blocks_count == 0
+        || blocks_count > decoder->group_size
+        || size > decoder->block_size
+        || !mark_received(group, decoder->group_size)) {
+        return;
+    }
+    group->blocks_count = blocks_count;
+    fec_xor(group->payload_parity, data, size);
+    group->size_parity ^= size_parity;
+}
+
+bool fec_decoder_recover(struct fec_decoder decoder[static 1],
+                         uint64_t block,
+                         uint64_t recovered_block[static 1],
+                         const uint8_t *data[static 1],
+                         size_t size[static 1]) {
+    struct fec_group *group = get_group(decoder, block);
+    if (group == nullptr || group->blocks_count == 0 || group->received_count != group->blocks_count) {
+        return false;   // without the FEC packet or missing more than one block
+    }
+    size_t missing = 0;
+    while (missing < group->blocks_count && (group->received[missing / 8] & (1U << (missing % 8))) != 0) {
+        missing++;
+    }
+    if (missing == group->blocks_count || group->size_parity > decoder->block_size) {
+        return false;
+    }
+    mark_received(group, missing);
+    *recovered_block = group->first_block + missing;
+    *data = group->payload_parity;
+    *size = group->size_parity;
+    return true;
+}
+
+// Returns the group of block, resetting the storage of an older group, or nullptr if the group was already dropped.
+static struct fec_group *get_group(struct fec_decoder decoder[static 1], uint64_t block) {
+    if (decoder->group_size == 0 || block == 0) {
+        return nullptr;
+    }
+    const uint64_t index = (block - 1) / decoder->group_size;
+    const uint64_t first_block = index * decoder->group_size + 1;
+    struct fec_group *group = &decoder->groups[index % decoder->groups_count];
+    if (group->first_block > first_block) {
+        return nullptr;
+    }
+    if (group->first_block < first_block) {
+        uint8_t *payload_parity = group->payload_parity;
+        memset(payload_parity, 0, decoder->block_size);
+        *group = (struct fec_group) {
+            .first_block = first_block,
+            .payload_parity = payload_parity,
+        };
+    }
+    return group;
+}
+
+static bool mark_received(struct fec_group group[static 1], size_t index) {
+    const uint8_t bit = 1U << (index % 8);
+    if ((group->received[index / 8] & bit) != 0) {
+        return false;
+    }
+    group->received[index / 8] |= bit;
+    group->received_count++;
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <logger.h>
+
+/*
+ * XOR forward error correction of the DATA packets of a read request transfer negotiating the fec option.
+ * The blocks are split in groups of group_size consecutive blocks starting from block 1, the last group ends with the
+ *  last block. The server follows the last block of each group with a FEC packet holding the XOR of the payloads,
+ *  zero padded to the largest one, and of the sizes of the blocks of the group.
+ * A client missing a single block of a group rebuilds it from the FEC packet and the other blocks instead of waiting
+ *  for its retransmission.
+ * Blocks are identified by their absolute number, counted from 1 without the wraparound of the 16 bit block numbers.
+ */
+
+constexpr uint16_t fec_max_group_size = 255;
+
+void fec_xor(uint8_t destination[restrict], const uint8_t source[restrict], size_t size);
+
+struct fec_group {
+    uint64_t first_block;       // 0 for an unused group
+    uint16_t blocks_count;      // 0 until the FEC packet is received
+    uint16_t received_count;    // blocks and FEC packet
+    uint16_t size_parity;
+    uint8_t received[(fec_max_group_size + 1 + 7) / 8];     // bit i for block first_block + i, the last for the FEC packet
+    uint8_t *payload_parity;
+};
+
+struct fec_decoder {
+    uint16_t group_size;        // 0 when the fec option is not negotiated
+    uint16_t block_size;
+    size_t groups_count;
+    struct fec_group *groups;
+    uint8_t *payloads;
+};
+
+// Blocks added to the decoder must be within span_blocks consecutive blocks, older groups are dropped.
+bool fec_decoder_init(struct fec_decoder decoder[static 1],
+                      uint16_t group_size,
+                      uint16_t block_size,
+                      uint16_t span_blocks,
+                      struct logger logger[static 1]);
+
+void fec_decoder_destroy(struct fec_decoder decoder[static 1]);
+
+// Drops all the groups, the blocks of the next transfer are counted again from 1.
+void fec_decoder_reset(struct fec_decoder decoder[static 1]);
+
+// Blocks and FEC packets received again are ignored.
+void fec_decoder_add_block(struct fec_decoder decoder[static 1], uint64_t block, const uint8_t data[], size_t size);
+
+void fec_decoder_add_fec(struct fec_decoder decoder[static 1],
+                         uint64_t first_block,
+                         uint16_t blocks_count,
+                         uint16_t size_parity,
+                         const uint8_t data[],
+                         size_t size);
+
+/*
+ * Rebuilds the only missing block of the group of block once its FEC packet and all the other blocks are received.
+ * The block is then considered received, data points to the storage of the decoder until the next call.
+ */
+bool fec_decoder_recover(struct fec_decoder decoder[static 1],
+                         uint64_t block,
+                         uint64_t recovered_block[static 1],
+                         const uint8_t *data[static 1],
+                         size_t size[static 1]);
+
+#endif // FEC_H
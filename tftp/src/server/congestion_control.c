@@ -0,0 +1,105 @@
+#include "congestion_control.h"
+
+// See RFC 5681 for Reno and Brakmo, Peterson "TCP Vegas: End to End Congestion Avoidance on a Global Internet"
+
+constexpr uint16_t initial_window = 4;
+constexpr uint16_t min_slow_start_threshold = 2;
+constexpr double vegas_alpha = 2.0;     // packets queued below which the window grows
+constexpr double vegas_beta = 4.0;      // packets queued above which the window shrinks
+constexpr double vegas_gamma = 1.0;     // packets queued above which slow start ends
+
+static inline uint16_t min(uint16_t a, uint16_t b) {
+    return a < b ? a : b;
+}
+
+static inline uint16_t max(uint16_t a, uint16_t b) {
+    return a > b ? a : b;
+}
+
+void congestion_control_init(struct congestion_control cc[static 1], enum tftp_congestion_control algorithm, uint16_t max_window) {
+    *cc = (struct congestion_control) {
+        .algorithm = algorithm,
+        .max_window = max_window,
+        .window = algorithm == TFTP_CONGESTION_CONTROL_NONE ? max_window : min(initial_window, max_window),
+        .slow_start_threshold = max_window,
+    };
+}
+
+void congestion_control_on_ack(struct congestion_control cc[static 1], uint16_t packets) {
+    if (cc->algorithm == TFTP_CONGESTION_CONTROL_NONE) {
+        return;
+    }
+    if (cc->window < cc->slow_start_threshold) {
+        cc->window = min(cc->window + packets, cc->max_window);
+        return;
+    }
+    if (cc->algorithm == TFTP_CONGESTION_CONTROL_VEGAS && cc->base_rtt != 0) {
+        return;     // driven by the round trip time samples
+    }
+    if (cc->window == cc->max_window) {
+        cc->acked = 0;
+        return;
+    }
+    cc->acked += packets;
+    while (cc->acked >= cc->window && cc->window < cc->max_window) {
+        cc->acked -= cc->window;
+        cc->window++;
+    }
+}
+
+void congestion_control_on_rtt_sample(struct congestion_control cc[static 1], double rtt, uint16_t block_number, uint16_t next_block_number) {
+    if (cc->algorithm != TFTP_CONGESTION_CONTROL_VEGAS || rtt <= 0) {
+        return;
+    }
+    if (cc->base_rtt == 0 || rtt < cc->base_rtt) {
+        cc->base_rtt = rtt;
+    }
+    if (cc->round_rtt == 0 || rtt < cc->round_rtt) {
+        cc->round_rtt = rtt;
+    }
+    if (!cc->is_round_started) {
+        cc->is_round_started = true;
+        cc->round_end = next_block_number - 1;
+        return;
+    }
+    if ((int16_t) (block_number - cc->round_end) < 0) {
+        return;
+    }
+    const double queued = cc->window * (1.0 - cc->base_rtt / cc->round_rtt);
+    cc->round_end = next_block_number - 1;
+    cc->round_rtt = 0;
+    if (cc->window < cc->slow_start_threshold) {
+        if (queued > vegas_gamma) {
+            cc->slow_start_threshold = max(cc->window, min_slow_start_threshold);
+        }
+        return;
+    }
+    if (queued < vegas_alpha && cc->window < cc->max_window) {
+        cc->window++;
+    }
+    else if (queued > vegas_beta && cc->window > 1) {
+        cc->window--;
+    }
+}
+
+void congestion_control_on_loss(struct congestion_control cc[static 1]) {
+    if (cc->algorithm == TFTP_CONGESTION_CONTROL_NONE) {
+        return;
+    }
+    cc->slow_start_threshold = max(cc->window / 2, min_slow_start_threshold);
+    cc->window = min(cc->slow_start_threshold, cc->max_window);
+    cc->acked = 0;
+    cc->is_round_started = false;
+    cc->round_rtt = 0;
+}
+
+void congestion_control_on_timeout(struct congestion_control cc[static 1]) {
+    if (cc->algorithm == TFTP_CONGESTION_CONTROL_NONE) {
+        return;
+    }
+    cc->slow_start_threshold = max(cc->window / 2, min_slow_start_threshold);
+    cc->window = 1;
+    cc->acked = 0;
+    cc->is_round_started = false;
+    cc->round_rtt = 0;
+}
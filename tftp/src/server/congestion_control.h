@@ -0,0 +1,51 @@
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+
+#include <stdint.h>
+
+#include <buracchi/tftp/server_congestion_control.h>
+
+/*
+ * Congestion window of a read session, the DATA packets it keeps in flight, never larger than the negotiated window.
+ * Reno: slow start grows the window by a packet for each ACKed packet up to the slow start threshold, then congestion
+ *  avoidance grows it by a packet for each window ACKed. A fast retransmission halves the window, a timeout restarts
+ *  slow start from a single packet.
+ * Vegas: once round trip times are sampled the window follows the packets queued along the path, estimated as
+ *  window * (1 - base_rtt / rtt) with the smallest rtt of a round trip, instead of growing until a loss. The window
+ *  moves by at most a packet per round trip, which ends when the last packet in flight at its start is ACKed. Losses
+ *  are handled as in Reno.
+ */
+
+struct congestion_control {
+    enum tftp_congestion_control algorithm;
+    uint16_t max_window;
+    uint16_t window;
+    uint16_t slow_start_threshold;
+    uint16_t acked;         // packets ACKed since the window last grew in congestion avoidance
+    double base_rtt;        // smallest round trip time sampled, 0 until the first sample
+    bool is_round_started;
+    uint16_t round_end;     // block whose ACK ends the current round trip
+    double round_rtt;       // smallest round trip time sampled in the current round trip, 0 before the first one
+};
+
+void congestion_control_init(struct congestion_control cc[static 1], enum tftp_congestion_control algorithm, uint16_t max_window);
+
+static inline uint16_t congestion_control_window(const struct congestion_control cc[static 1]) {
+    return cc->window;
+}
+
+// Called when an ACK moves the window by packets DATA packets.
+void congestion_control_on_ack(struct congestion_control cc[static 1], uint16_t packets);
+
+/*
+ * Called with the round trip time, in seconds, of a DATA packet that was not retransmitted, the block number ACKed
+ *  and the number of the next block to be sent.
+ */
+void congestion_control_on_rtt_sample(struct congestion_control cc[static 1], double rtt, uint16_t block_number, uint16_t next_block_number);
+
+// Called when duplicate ACKs trigger a fast retransmission.
+void congestion_control_on_loss(struct congestion_control cc[static 1]);
+
+void congestion_control_on_timeout(struct congestion_control cc[static 1]);
+
+#endif // CONGESTION_CONTROL_H
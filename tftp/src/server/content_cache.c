@@ -0,0 +1,283 @@
+#include "content_cache.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../compression.h"
+#include "../utils/hash.h"
+
+static constexpr size_t buckets_count = 256;
+static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+static struct content_cache_entry *entry_load(struct content_cache cache[static 1], struct file_cache_entry file[static 1]);
+static void entry_free(struct content_cache_entry *entry);
+static void *map_memory(struct content_cache cache[static 1], size_t size, size_t mapping_size[static 1]);
+static size_t max_mapping_size(struct content_cache cache[static 1], size_t size);
+static bool path_matches(const struct lru_index_node node[static 1], const void *path);
+static void node_free(struct lru_index_node node[static 1]);
+static bool index_remove(struct content_cache cache[static 1], struct lru_index_node **link);
+static void evict_idle_entries(struct content_cache cache[static 1], size_t bytes);
+
+static inline size_t entry_size(const struct content_cache_entry entry[static 1]) {
+    return entry->mapping_size + entry->compressed_size;
+}
+
+bool content_cache_init(struct content_cache cache[static 1],
+                        size_t max_bytes,
+                        size_t max_file_size,
+                        bool use_huge_pages,
+                        bool lock_memory,
+                        struct logger logger[static 1]) {
+    *cache = (struct content_cache) {
+        .logger = logger,
+        .max_bytes = max_bytes,
+        .max_file_size = max_file_size,
+        .use_huge_pages = use_huge_pages,
+        .lock_memory = lock_memory,
+    };
+    if (!lru_index_init(&cache->index, buckets_count)) {
+        logger_log_error(logger, "Could not allocate memory for the content cache index. %s", strerror(errno));
+        return false;
+    }
+    if (mtx_init(&cache->mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the content cache mutex.");
+        lru_index_destroy(&cache->index);
+        return false;
+    }
+    return true;
+}
+
+void content_cache_destroy(struct content_cache cache[static 1]) {
+    lru_index_clear(&cache->index, node_free);
+    lru_index_destroy(&cache->index);
+    mtx_destroy(&cache->mtx);
+}
+
+struct content_cache_entry *content_cache_acquire(struct content_cache cache[static 1], struct file_cache_entry file[static 1]) {
+    if (!content_cache_is_cacheable(cache, &file->stat)) {
+        return nullptr;
+    }
+    const uint64_t hash = hash_string(file->path);
+    mtx_lock(&cache->mtx);
+    struct lru_index_node **link = lru_index_find(&cache->index, hash, path_matches, file->path);
+    if (*link != nullptr) {
+        struct content_cache_entry *entry = lru_index_entry(*link, struct content_cache_entry, node);
+        if (file_cache_is_same_file(&entry->stat, &file->stat)) {
+            lru_index_acquire(&cache->index, &entry->node);
+            cache->hits++;
+            mtx_unlock(&cache->mtx);
+            return entry;
+        }
+        logger_log_debug(cache->logger, "Cached content of %s is stale.", file->path);
+        if (index_remove(cache, link)) {
+            entry_free(entry);
+        }
+    }
+    cache->misses++;
+    // the room is reserved before loading, a file that does not fit is served from its descriptor
+    const size_t reserved_bytes = max_mapping_size(cache, file->stat.st_size);
+    evict_idle_entries(cache, reserved_bytes);
+    if (cache->bytes + reserved_bytes > cache->max_bytes) {
+        mtx_unlock(&cache->mtx);
+        return nullptr;
+    }
+    cache->bytes += reserved_bytes;
+    mtx_unlock(&cache->mtx);
+    // loading may take a while, do not hold the lock meanwhile
+    struct content_cache_entry *entry = entry_load(cache, file);
+    mtx_lock(&cache->mtx);
+    cache->bytes -= reserved_bytes;
+    if (entry == nullptr) {
+        mtx_unlock(&cache->mtx);
+        return nullptr;
+    }
+    link = lru_index_find(&cache->index, hash, path_matches, file->path);
+    if (*link != nullptr) {
+        struct content_cache_entry *concurrent_entry = lru_index_entry(*link, struct content_cache_entry, node);
+        if (file_cache_is_same_file(&concurrent_entry->stat, &entry->stat)) {
+            lru_index_acquire(&cache->index, &concurrent_entry->node);
+            mtx_unlock(&cache->mtx);
+            entry_free(entry);
+            return concurrent_entry;
+        }
+        if (index_remove(cache, link)) {
+            entry_free(concurrent_entry);
+        }
+    }
+    lru_index_insert(&cache->index, &entry->node, hash);
+    cache->bytes += entry_size(entry);
+    mtx_unlock(&cache->mtx);
+    return entry;
+}
+
+bool content_cache_compress(struct content_cache cache[static 1], struct content_cache_entry entry[static 1]) {
+    mtx_lock(&cache->mtx);
+    const bool is_compressed = entry->compressed_data != nullptr;
+    const bool is_incompressible = entry->is_incompressible;
+    mtx_unlock(&cache->mtx);
+    if (is_compressed || is_incompressible) {
+        return is_compressed;
+    }
+    // compressing may take a while, do not hold the lock meanwhile
+    const size_t size = entry->stat.st_size;
+    uint8_t *frames = size == 0 ? nullptr : malloc(compression_bound(size));
+    if (size != 0 && frames == nullptr) {
+        logger_log_warn(cache->logger, "Could not compress %s. %s", entry->path, strerror(errno));
+        return false;
+    }
+    const size_t frames_size = size == 0 ? 0 : compression_compress(entry->data, size, frames);
+    if (frames_size >= size) {
+        free(frames);
+        mtx_lock(&cache->mtx);
+        entry->is_incompressible = true;
+        mtx_unlock(&cache->mtx);
+        return false;
+    }
+    uint8_t *shrunk_frames = realloc(frames, frames_size);
+    frames = shrunk_frames != nullptr ? shrunk_frames : frames;
+    mtx_lock(&cache->mtx);
+    if (entry->compressed_data == nullptr) {
+        entry->compressed_data = frames;
+        entry->compressed_size = frames_size;
+        frames = nullptr;
+        if (entry->node.is_indexed) {
+            cache->bytes += frames_size;
+            evict_idle_entries(cache, 0);
+        }
+    }
+    mtx_unlock(&cache->mtx);
+    free(frames);
+    return true;
+}
+
+void content_cache_release(struct content_cache cache[static 1], struct content_cache_entry entry[static 1]) {
+    mtx_lock(&cache->mtx);
+    if (lru_index_release(&cache->index, &entry->node)) {
+        entry_free(entry);
+    }
+    mtx_unlock(&cache->mtx);
+}
+
+void content_cache_collect_counters(struct content_cache cache[static 1], uint64_t hits[static 1], uint64_t misses[static 1]) {
+    mtx_lock(&cache->mtx);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    cache->hits = 0;
+    cache->misses = 0;
+    mtx_unlock(&cache->mtx);
+}
+
+void content_cache_reset_counters(struct content_cache cache[static 1]) {
+    mtx_lock(&cache->mtx);
+    cache->hits = 0;
+    cache->misses = 0;
+    mtx_unlock(&cache->mtx);
+}
+
+static struct content_cache_entry *entry_load(struct content_cache cache[static 1], struct file_cache_entry file[static 1]) {
+    const size_t size = file->stat.st_size;
+    struct content_cache_entry *entry = malloc(sizeof *entry + strlen(file->path) + 1);
+    if (entry == nullptr) {
+        logger_log_warn(cache->logger, "Could not cache %s. %s", file->path, strerror(errno));
+        return nullptr;
+    }
+    *entry = (struct content_cache_entry) {
+        .path = strcpy((char *) (entry + 1), file->path),
+        .stat = file->stat,
+        .node.references = 1,
+    };
+    if (size == 0) {
+        return entry;
+    }
+    uint8_t *data = map_memory(cache, size, &entry->mapping_size);
+    if (data == nullptr) {
+        logger_log_warn(cache->logger, "Could not cache %s. %s", file->path, strerror(errno));
+        free(entry);
+        return nullptr;
+    }
+    size_t loaded = 0;
+    while (loaded < size) {
+        ssize_t bytes_read = pread(file->file_descriptor, &data[loaded], size - loaded, (off_t) loaded);
+        if (bytes_read == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            logger_log_warn(cache->logger, "Could not cache %s. %s", file->path, bytes_read == 0 ? "File was truncated." : strerror(errno));
+            munmap(data, entry->mapping_size);
+            free(entry);
+            return nullptr;
+        }
+        loaded += bytes_read;
+    }
+    mprotect(data, entry->mapping_size, PROT_READ);
+    if (cache->lock_memory && mlock(data, size) == -1) {
+        logger_log_warn(cache->logger, "Could not lock cached content of %s in memory. %s", file->path, strerror(errno));
+    }
+    entry->data = data;
+    return entry;
+}
+
+static void entry_free(struct content_cache_entry *entry) {
+    if (entry->data != nullptr) {
+        munmap((void *) entry->data, entry->mapping_size);
+    }
+    free((void *) entry->compressed_data);
+    free(entry);
+}
+
+static void *map_memory(struct content_cache cache[static 1], size_t size, size_t mapping_size[static 1]) {
+    const bool use_huge_pages = cache->use_huge_pages && size >= huge_page_size;
+    if (use_huge_pages) {
+        const size_t huge_pages_size = max_mapping_size(cache, size);
+        void *data = mmap(nullptr, huge_pages_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            *mapping_size = huge_pages_size;
+            return data;
+        }
+        logger_log_debug(cache->logger, "Could not map huge pages, falling back to transparent huge pages. %s", strerror(errno));
+    }
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    if (use_huge_pages) {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+    *mapping_size = size;
+    return data;
+}
+
+// Huge pages mappings are rounded up to the huge page size, other mappings have the size of the content.
+static size_t max_mapping_size(struct content_cache cache[static 1], size_t size) {
+    if (cache->use_huge_pages && size >= huge_page_size) {
+        return (size + huge_page_size - 1) & ~(huge_page_size - 1);
+    }
+    return size;
+}
+
+static bool path_matches(const struct lru_index_node node[static 1], const void *path) {
+    return strcmp(lru_index_entry(node, struct content_cache_entry, node)->path, path) == 0;
+}
+
+static void node_free(struct lru_index_node node[static 1]) {
+    entry_free(lru_index_entry(node, struct content_cache_entry, node));
+}
+
+// Removes the entry at link from the index and from the budget, returns true if the caller must free it.
+static bool index_remove(struct content_cache cache[static 1], struct lru_index_node **link) {
+    cache->bytes -= entry_size(lru_index_entry(*link, struct content_cache_entry, node));
+    return lru_index_remove(&cache->index, link);
+}
+
+// Makes room for bytes more in the budget, entries in use are never evicted.
+static void evict_idle_entries(struct content_cache cache[static 1], size_t bytes) {
+    struct lru_index_node *victim;
+    while (cache->bytes + bytes > cache->max_bytes && (victim = lru_index_evict(&cache->index)) != nullptr) {
+        struct content_cache_entry *entry = lru_index_entry(victim, struct content_cache_entry, node);
+        cache->bytes -= entry_size(entry);
+        entry_free(entry);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef CONTENT_CACHE_H
+#define CONTENT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <threads.h>
+
+#include <logger.h>
+
+#include "file_cache.h"
+#include "lru_index.h"
+
+/*
+ * Server-wide cache holding the whole content of small, frequently requested files.
+ * Entries are keyed by full path and are valid as long as inode, size and mtime of the file match,
+ *  idle entries are evicted in LRU order to keep the cached bytes under the configured budget.
+ * The compressed variant of an entry served with the compress option is built on its first request and counted in the
+ *  budget along with the content.
+ */
+
+struct content_cache_entry {
+    char *path;
+    struct stat stat;
+    const uint8_t *data;
+    const uint8_t *compressed_data;     // frames of the compressed content, see compression.h
+    size_t compressed_size;
+    /* private members */
+    size_t mapping_size;
+    bool is_incompressible;
+    struct lru_index_node node;
+};
+
+struct content_cache {
+    struct logger *logger;
+    mtx_t mtx;
+    size_t max_bytes;
+    size_t max_file_size;
+    bool use_huge_pages;
+    bool lock_memory;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    struct lru_index index;
+};
+
+// A max_bytes of 0 disables the cache.
+bool content_cache_init(struct content_cache cache[static 1],
+                        size_t max_bytes,
+                        size_t max_file_size,
+                        bool use_huge_pages,
+                        bool lock_memory,
+                        struct logger logger[static 1]);
+
+void content_cache_destroy(struct content_cache cache[static 1]);
+
+static inline bool content_cache_is_cacheable(struct content_cache cache[static 1], const struct stat stat[static 1]) {
+    return cache->max_bytes != 0
+           && S_ISREG(stat->st_mode)
+           && (size_t) stat->st_size <= cache->max_file_size
+           && (size_t) stat->st_size <= cache->max_bytes;
+}
+
+/*
+ * Returns the content of the opened file, loading it in memory on a miss.
+ * Returns nullptr if the file is not cacheable, could not be loaded or would not fit in the budget once idle entries
+ *  are evicted.
+ */
+struct content_cache_entry *content_cache_acquire(struct content_cache cache[static 1], struct file_cache_entry file[static 1]);
+
+/*
+ * Builds the compressed variant of the acquired entry, unless it already exists.
+ * Returns false if it could not be built or it would not be smaller than the content.
+ */
+bool content_cache_compress(struct content_cache cache[static 1], struct content_cache_entry entry[static 1]);
+
+void content_cache_release(struct content_cache cache[static 1], struct content_cache_entry entry[static 1]);
+
+// Reports hits and misses since the previous call.
+void content_cache_collect_counters(struct content_cache cache[static 1], uint64_t hits[static 1], uint64_t misses[static 1]);
+
+void content_cache_reset_counters(struct content_cache cache[static 1]);
+
+#endif // CONTENT_CACHE_H
@@ -0,0 +1,277 @@
+#include "digest_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../digest.h"
+#include "../utils/hash.h"
+
+static constexpr size_t ways = 4;
+static constexpr int max_read_attempts = 4;
+
+struct entry_snapshot {
+    uint64_t key[4];
+    uint64_t stored;
+    uint64_t digest;
+};
+
+static void get_key(const struct stat file_stat[static 1], uint64_t key[static 4]);
+static struct digest_cache_entry *get_set(struct digest_cache cache[static 1], const uint64_t key[static 4]);
+static bool read_entry(struct digest_cache_entry entry[static 1], struct entry_snapshot snapshot[static 1]);
+static int hash_routine(struct digest_cache cache[static 1]);
+static void hash_file(struct digest_cache cache[static 1], const struct digest_cache_request request[static 1]);
+
+bool digest_cache_init(struct digest_cache cache[static 1], size_t max_entries, struct logger logger[static 1]) {
+    *cache = (struct digest_cache) {
+        .sets_count = 0,
+        .entries = nullptr,
+        .logger = logger,
+    };
+    if (max_entries == 0) {
+        return true;
+    }
+    size_t entries_count = ways;
+    while (entries_count < max_entries) {
+        entries_count <<= 1;
+    }
+    cache->entries = calloc(entries_count, sizeof *cache->entries);
+    if (cache->entries == nullptr) {
+        logger_log_error(logger, "Could not allocate memory for the digest cache. %s", strerror(errno));
+        return false;
+    }
+    if (mtx_init(&cache->mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the digest cache mutex.");
+        goto fail;
+    }
+    if (cnd_init(&cache->request_added) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the digest cache condition variable.");
+        goto fail2;
+    }
+    if (thrd_create(&cache->thread, (thrd_start_t) hash_routine, cache) != thrd_success) {
+        logger_log_error(logger, "Could not start the digest cache thread.");
+        goto fail3;
+    }
+    cache->sets_count = entries_count / ways;
+    return true;
+fail3:
+    cnd_destroy(&cache->request_added);
+fail2:
+    mtx_destroy(&cache->mtx);
+fail:
+    free(cache->entries);
+    return false;
+}
+
+void digest_cache_destroy(struct digest_cache cache[static 1]) {
+    if (cache->sets_count == 0) {
+        return;
+    }
+    mtx_lock(&cache->mtx);
+    cache->should_stop = true;
+    cnd_signal(&cache->request_added);
+    mtx_unlock(&cache->mtx);
+    thrd_join(cache->thread, nullptr);
+    for (size_t i = 0; i < cache->count; i++) {
+        free(cache->requests[(cache->head + i) % digest_cache_max_requests].path);
+    }
+    cnd_destroy(&cache->request_added);
+    mtx_destroy(&cache->mtx);
+    free(cache->entries);
+}
+
+bool digest_cache_lookup(struct digest_cache cache[static 1], const struct stat file_stat[static 1], uint64_t digest[static 1]) {
+    if (cache->sets_count == 0) {
+        return false;
+    }
+    uint64_t key[4];
+    get_key(file_stat, key);
+    struct digest_cache_entry *set = get_set(cache, key);
+    for (size_t i = 0; i < ways; i++) {
+        struct entry_snapshot snapshot;
+        if (!read_entry(&set[i], &snapshot) || snapshot.stored == 0 || memcmp(snapshot.key, key, sizeof key) != 0) {
+            continue;
+        }
+        *digest = snapshot.digest;
+        return true;
+    }
+    return false;
+}
+
+void digest_cache_update(struct digest_cache cache[static 1], const struct stat file_stat[static 1], uint64_t digest) {
+    if (cache->sets_count == 0) {
+        return;
+    }
+    uint64_t key[4];
+    get_key(file_stat, key);
+    struct digest_cache_entry *set = get_set(cache, key);
+    struct digest_cache_entry *entry = &set[0];
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < ways; i++) {
+        struct entry_snapshot snapshot;
+        if (!read_entry(&set[i], &snapshot)) {
+            continue;
+        }
+        if (snapshot.stored != 0 && memcmp(snapshot.key, key, sizeof key) == 0) {
+            entry = &set[i];
+            break;
+        }
+        if (snapshot.stored < oldest) {
+            entry = &set[i];
+            oldest = snapshot.stored;
+        }
+    }
+    unsigned sequence = atomic_load_explicit(&entry->sequence, memory_order_relaxed);
+    if ((sequence & 1) != 0
+        || !atomic_compare_exchange_strong_explicit(&entry->sequence, &sequence, sequence + 1, memory_order_relaxed, memory_order_relaxed)) {
+        return;     // another worker is writing the entry
+    }
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < 4; i++) {
+        atomic_store_explicit(&entry->key[i], key[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&entry->stored, atomic_fetch_add_explicit(&cache->clock, 1, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&entry->digest, digest, memory_order_relaxed);
+    atomic_store_explicit(&entry->sequence, sequence + 2, memory_order_release);
+}
+
+void digest_cache_request(struct digest_cache cache[static 1], const char *root, const char filename[static 1], const struct stat file_stat[static 1]) {
+    if (cache->sets_count == 0) {
+        return;
+    }
+    struct digest_cache_request request;
+    get_key(file_stat, request.key);
+    mtx_lock(&cache->mtx);
+    bool is_queued = cache->count == digest_cache_max_requests;
+    for (size_t i = 0; i < cache->count && !is_queued; i++) {
+        is_queued = memcmp(cache->requests[(cache->head + i) % digest_cache_max_requests].key, request.key, sizeof request.key) == 0;
+    }
+    mtx_unlock(&cache->mtx);
+    if (is_queued) {
+        return;     // already waiting, or dropped until a later request finds room
+    }
+    const size_t root_length = root == nullptr ? 0 : strlen(root);
+    const size_t filename_length = strlen(filename);
+    request.path = malloc(root_length + 1 + filename_length + 1);
+    if (request.path == nullptr) {
+        logger_log_warn(cache->logger, "Could not allocate memory to queue the digest of '%s'. %s", filename, strerror(errno));
+        return;
+    }
+    if (root != nullptr) {
+        memcpy(request.path, root, root_length);
+        request.path[root_length] = '/';
+    }
+    memcpy(&request.path[root == nullptr ? 0 : root_length + 1], filename, filename_length + 1);
+    mtx_lock(&cache->mtx);
+    if (cache->count == digest_cache_max_requests) {
+        mtx_unlock(&cache->mtx);
+        free(request.path);
+        return;
+    }
+    cache->requests[(cache->head + cache->count) % digest_cache_max_requests] = request;
+    cache->count++;
+    cnd_signal(&cache->request_added);
+    mtx_unlock(&cache->mtx);
+}
+
+static void get_key(const struct stat file_stat[static 1], uint64_t key[static 4]) {
+    key[0] = file_stat->st_dev;
+    key[1] = file_stat->st_ino;
+    key[2] = file_stat->st_size;
+    key[3] = file_stat->st_mtim.tv_sec * 1'000'000'000ULL + file_stat->st_mtim.tv_nsec;
+}
+
+static struct digest_cache_entry *get_set(struct digest_cache cache[static 1], const uint64_t key[static 4]) {
+    const size_t set_index = hash_bytes(key, 4 * sizeof *key) & (cache->sets_count - 1);
+    return &cache->entries[set_index * ways];
+}
+
+static bool read_entry(struct digest_cache_entry entry[static 1], struct entry_snapshot snapshot[static 1]) {
+    for (int attempt = 0; attempt < max_read_attempts; attempt++) {
+        const unsigned sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        if ((sequence & 1) != 0) {
+            continue;
+        }
+        for (size_t i = 0; i < 4; i++) {
+            snapshot->key[i] = atomic_load_explicit(&entry->key[i], memory_order_relaxed);
+        }
+        snapshot->stored = atomic_load_explicit(&entry->stored, memory_order_relaxed);
+        snapshot->digest = atomic_load_explicit(&entry->digest, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&entry->sequence, memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int hash_routine(struct digest_cache cache[static 1]) {
+    mtx_lock(&cache->mtx);
+    while (!cache->should_stop) {
+        if (cache->count == 0) {
+            cnd_wait(&cache->request_added, &cache->mtx);
+            continue;
+        }
+        const struct digest_cache_request request = cache->requests[cache->head];
+        cache->head = (cache->head + 1) % digest_cache_max_requests;
+        cache->count--;
+        mtx_unlock(&cache->mtx);
+        hash_file(cache, &request);
+        free(request.path);
+        mtx_lock(&cache->mtx);
+    }
+    mtx_unlock(&cache->mtx);
+    return 0;
+}
+
+// The file is opened again by path, a version other than the requested one is left to its own request.
+static void hash_file(struct digest_cache cache[static 1], const struct digest_cache_request request[static 1]) {
+    int file_descriptor;
+    do {
+        file_descriptor = open(request->path, O_RDONLY | O_CLOEXEC);
+    } while (file_descriptor == -1 && errno == EINTR);
+    if (file_descriptor == -1) {
+        logger_log_warn(cache->logger, "Could not open file '%s' to compute its digest. %s", request->path, strerror(errno));
+        return;
+    }
+    struct stat file_stat;
+    uint64_t key[4];
+    uint64_t digest;
+    if (fstat(file_descriptor, &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) {
+        goto end;
+    }
+    get_key(&file_stat, key);
+    if (memcmp(key, request->key, sizeof key) != 0 || digest_cache_lookup(cache, &file_stat, &digest)) {
+        goto end;
+    }
+    struct digest_state state;
+    digest_init(&state);
+    uint8_t buffer[65536];
+    off_t offset = 0;
+    while (offset < file_stat.st_size) {
+        const ssize_t bytes_read = pread(file_descriptor, buffer, sizeof buffer, offset);
+        if (bytes_read == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            logger_log_warn(cache->logger, "Could not read file '%s' to compute its digest. %s", request->path, bytes_read == 0 ? "Unexpected end of file." : strerror(errno));
+            goto end;
+        }
+        digest_update(&state, buffer, bytes_read);
+        offset += bytes_read;
+    }
+    // a rewrite while hashing leaves content of both versions in the digest
+    struct stat hashed_stat;
+    uint64_t hashed_key[4];
+    if (fstat(file_descriptor, &hashed_stat) == -1) {
+        goto end;
+    }
+    get_key(&hashed_stat, hashed_key);
+    if (memcmp(hashed_key, key, sizeof key) == 0) {
+        digest_cache_update(cache, &file_stat, digest_final(&state));
+    }
+end:
+    close(file_descriptor);
+}
@@ -0,0 +1,62 @@
+#ifndef DIGEST_CACHE_H
+#define DIGEST_CACHE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <threads.h>
+
+#include <logger.h>
+
+/*
+ * Server-wide cache of the content digests advertised with the digest option, so that each version of a file is read
+ *  and hashed once. A version is identified by device, inode, size and modification time: a rewrite of the file
+ *  changes its modification time and the old digest is no longer found.
+ * The cache is a fixed array of 4-way sets, like the RTT cache, a version replaces the least recently stored entry of
+ *  its set. Each entry is guarded by a sequence lock so that workers never block each other.
+ * Digests are computed by a background thread: a worker missing a version queues it and goes on without the digest,
+ *  the following requests of that version find it in the cache.
+ */
+
+constexpr size_t digest_cache_max_requests = 16;    // versions waiting to be hashed, later ones are dropped
+
+struct digest_cache_entry {
+    atomic_uint sequence;               // odd while the entry is being written
+    atomic_uint_least64_t key[4];       // device, inode, size and modification time in nanoseconds
+    atomic_uint_least64_t stored;       // value of the cache clock when stored, 0 for an empty entry
+    atomic_uint_least64_t digest;
+};
+
+struct digest_cache_request {
+    uint64_t key[4];
+    char *path;
+};
+
+struct digest_cache {
+    size_t sets_count;      // power of two, 0 disables the cache
+    atomic_uint_least64_t clock;
+    struct digest_cache_entry *entries;
+    struct logger *logger;
+    mtx_t mtx;
+    cnd_t request_added;
+    bool should_stop;
+    thrd_t thread;
+    size_t head;
+    size_t count;
+    struct digest_cache_request requests[digest_cache_max_requests];
+};
+
+// A max_entries of 0 disables the cache, the number of entries is rounded up to a power of two.
+bool digest_cache_init(struct digest_cache cache[static 1], size_t max_entries, struct logger logger[static 1]);
+
+void digest_cache_destroy(struct digest_cache cache[static 1]);
+
+bool digest_cache_lookup(struct digest_cache cache[static 1], const struct stat file_stat[static 1], uint64_t digest[static 1]);
+
+void digest_cache_update(struct digest_cache cache[static 1], const struct stat file_stat[static 1], uint64_t digest);
+
+// Queues the version of filename, relative to root, to be hashed and stored unless the file changed in the meantime.
+void digest_cache_request(struct digest_cache cache[static 1], const char *root, const char filename[static 1], const struct stat file_stat[static 1]);
+
+#endif // DIGEST_CACHE_H
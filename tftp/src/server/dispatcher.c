@@ -1,58 +1,117 @@
 #include "dispatcher.h"
 
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
+// Submission entries are flushed to the kernel right after being prepared, a small queue is enough.
+static constexpr uint32_t max_submission_entries = 256;
+
+static struct io_uring_sqe *get_sqe(struct dispatcher dispatcher[static 1]);
+static int submit(struct dispatcher dispatcher[static 1]);
+static size_t reap_completions(struct dispatcher dispatcher[static 1]);
+static void complete(struct io_uring_cqe cqe[static 1]);
+
 bool dispatcher_init(struct dispatcher dispatcher[static 1], uint32_t max_requests, struct logger logger[static 1]) {
     *dispatcher = (struct dispatcher) {
             .logger = logger,
             .pending_requests = 0,
     };
-    dispatcher->logger = logger;
-    int ret = io_uring_queue_init(max_requests, &dispatcher->ring, 0);
+    // size the completion queue for every in-flight request, the kernel clamps it to its own limit
+    struct io_uring_params params = {
+        .flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP,
+        .cq_entries = max_requests,
+    };
+    const uint32_t sq_entries = max_requests < max_submission_entries ? max_requests : max_submission_entries;
+    int ret = io_uring_queue_init_params(sq_entries, &dispatcher->ring, &params);
     if (ret < 0) {
         logger_log_error(logger, "Failed to initialize server io_uring: %s.", strerror(-ret));
         return false;
     }
+    if (!(params.features & IORING_FEAT_NODROP)) {
+        logger_log_warn(logger, "The kernel may drop completions when more than %u requests are in flight.", params.cq_entries);
+    }
+    return true;
+}
+
+bool dispatcher_init_buffers(struct dispatcher dispatcher[static 1], uint16_t count, size_t size) {
+    dispatcher->buffers = malloc(count * size);
+    if (dispatcher->buffers == nullptr) {
+        logger_log_error(dispatcher->logger, "Could not allocate memory for the provided buffers. %s", strerror(errno));
+        return false;
+    }
+    int ret;
+    dispatcher->buffer_ring = io_uring_setup_buf_ring(&dispatcher->ring, count, dispatcher_buffer_group, 0, &ret);
+    if (dispatcher->buffer_ring == nullptr) {
+        logger_log_error(dispatcher->logger, "Could not register the provided buffers ring. %s", strerror(-ret));
+        free(dispatcher->buffers);
+        dispatcher->buffers = nullptr;
+        return false;
+    }
+    dispatcher->buffers_count = count;
+    dispatcher->buffer_size = size;
+    for (uint16_t i = 0; i < count; i++) {
+        io_uring_buf_ring_add(dispatcher->buffer_ring, dispatcher_get_buffer(dispatcher, i), size, i, io_uring_buf_ring_mask(count), i);
+    }
+    io_uring_buf_ring_advance(dispatcher->buffer_ring, count);
     return true;
 }
 
+void dispatcher_recycle_buffer(struct dispatcher dispatcher[static 1], uint16_t id) {
+    io_uring_buf_ring_add(dispatcher->buffer_ring, dispatcher_get_buffer(dispatcher, id), dispatcher->buffer_size, id, io_uring_buf_ring_mask(dispatcher->buffers_count), 0);
+    io_uring_buf_ring_advance(dispatcher->buffer_ring, 1);
+}
+
 bool dispatcher_destroy(struct dispatcher dispatcher[static 1]) {
+    if (dispatcher->buffer_ring != nullptr) {
+        io_uring_free_buf_ring(&dispatcher->ring, dispatcher->buffer_ring, dispatcher->buffers_count, dispatcher_buffer_group);
+    }
     io_uring_queue_exit(&dispatcher->ring);
+    free(dispatcher->buffers);
+    free(dispatcher->backlog);
     return true;
 }
 
 bool dispatcher_wait_event(struct dispatcher dispatcher[static 1], struct dispatcher_event *event[static 1]) {
+    if (dispatcher->backlog_count != 0) {
+        struct io_uring_cqe *cqe = &dispatcher->backlog[dispatcher->backlog_head];
+        complete(cqe);
+        *event = io_uring_cqe_get_data(cqe);
+        dispatcher->backlog_head = (dispatcher->backlog_head + 1) % dispatcher->backlog_capacity;
+        dispatcher->backlog_count--;
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            dispatcher->pending_requests--;
+        }
+        return true;
+    }
+    if (io_uring_sq_ready(&dispatcher->ring) != 0) {
+        submit(dispatcher);     // entries left behind by a busy completion queue
+    }
     struct io_uring_cqe *cqe;
     int ret = io_uring_wait_cqe(&dispatcher->ring, &cqe);
     if (ret < 0) {
         errno = -ret;
         return false;
     }
+    complete(cqe);
     *event = io_uring_cqe_get_data(cqe);
-    if (*event != nullptr) {
-        if (cqe->res < 0) {
-            (*event)->is_success = false;
-            (*event)->error_number = -cqe->res;
-        }
-        else {
-            (*event)->is_success = true;
-            (*event)->result = cqe->res;
-        }
+    // a multishot request stays pending until its last completion
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        dispatcher->pending_requests--;
     }
     io_uring_cqe_seen(&dispatcher->ring, cqe);
-    dispatcher->pending_requests--;
     return true;
 }
 
 bool dispatcher_submit(struct dispatcher dispatcher[static 1], struct dispatcher_event *event) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a sqe from the ring.");
         return false;
     }
     io_uring_prep_nop(sqe);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not submit a NOP request to the ring. %s", strerror(-ret));
         return false;
@@ -62,14 +121,14 @@ bool dispatcher_submit(struct dispatcher dispatcher[static 1], struct dispatcher
 }
 
 bool dispatcher_submit_timeout(struct dispatcher dispatcher[static 1], struct dispatcher_event_timeout event[static 1]) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
         return false;
     }
     io_uring_prep_timeout(sqe, &event->timeout, 0, 0);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not submit the timeout request. %s", strerror(-ret));
         return false;
@@ -83,14 +142,14 @@ bool dispatcher_submit_timeout_update(struct dispatcher dispatcher[static 1],
                                       struct dispatcher_event event[static 1],
                                       struct dispatcher_event_timeout event_to_update[static 1],
                                       struct __kernel_timespec timeout[static 1]) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
         return false;
     }
     io_uring_prep_timeout_update(sqe, timeout, (size_t) event_to_update, 0);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not update the timeout request. %s", strerror(-ret));
         return false;
@@ -102,14 +161,14 @@ bool dispatcher_submit_timeout_update(struct dispatcher dispatcher[static 1],
 bool dispatcher_submit_timeout_cancel(struct dispatcher dispatcher[static 1],
                                       struct dispatcher_event event[static 1],
                                       struct dispatcher_event_timeout event_to_cancel[static 1]) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
         return false;
     }
     io_uring_prep_timeout_remove(sqe, (size_t) event_to_cancel, 0);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not remove the timeout request. %s", strerror(-ret));
         return false;
@@ -118,15 +177,15 @@ bool dispatcher_submit_timeout_cancel(struct dispatcher dispatcher[static 1],
     return true;
 }
 
-bool dispatcher_submit_read(struct dispatcher dispatcher[static 1], struct dispatcher_event event[static 1], int fd, void *buffer, unsigned n_bytes) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+bool dispatcher_submit_read(struct dispatcher dispatcher[static 1], struct dispatcher_event event[static 1], int fd, void *buffer, unsigned n_bytes, uint64_t offset) {
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
         return false;
     }
-    io_uring_prep_read(sqe, fd, buffer, n_bytes, -1);
+    io_uring_prep_read(sqe, fd, buffer, n_bytes, offset);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not submit read request. %s", strerror(-ret));
         return false;
@@ -135,15 +194,32 @@ bool dispatcher_submit_read(struct dispatcher dispatcher[static 1], struct dispa
     return true;
 }
 
+bool dispatcher_submit_recv(struct dispatcher dispatcher[static 1], struct dispatcher_event event[static 1], int fd, void *buffer, size_t n_bytes, int flags) {
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
+    if (sqe == nullptr) {
+        logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
+        return false;
+    }
+    io_uring_prep_recv(sqe, fd, buffer, n_bytes, flags);
+    io_uring_sqe_set_data(sqe, event);
+    int ret = submit(dispatcher);
+    if (ret < 0) {
+        logger_log_error(dispatcher->logger, "Could not submit recv request. %s", strerror(-ret));
+        return false;
+    }
+    dispatcher->pending_requests++;
+    return true;
+}
+
 bool dispatcher_submit_recvmsg(struct dispatcher dispatcher[static 1], struct dispatcher_event event[static 1], int fd, struct msghdr msghdr[static 1], unsigned flags) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
         return false;
     }
     io_uring_prep_recvmsg(sqe, fd, msghdr, flags);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not submit recvmsg request. %s", strerror(-ret));
         return false;
@@ -152,6 +228,25 @@ bool dispatcher_submit_recvmsg(struct dispatcher dispatcher[static 1], struct di
     return true;
 }
 
+bool dispatcher_submit_recvmsg_multishot(struct dispatcher dispatcher[static 1], struct dispatcher_event event[static 1], int fd, struct msghdr msghdr[static 1]) {
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
+    if (sqe == nullptr) {
+        logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
+        return false;
+    }
+    io_uring_prep_recvmsg_multishot(sqe, fd, msghdr, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = dispatcher_buffer_group;
+    io_uring_sqe_set_data(sqe, event);
+    int ret = submit(dispatcher);
+    if (ret < 0) {
+        logger_log_error(dispatcher->logger, "Could not submit multishot recvmsg request. %s", strerror(-ret));
+        return false;
+    }
+    dispatcher->pending_requests++;
+    return true;
+}
+
 bool dispatcher_submit_sendto(struct dispatcher dispatcher[static 1],
                               struct dispatcher_event event[static 1],
                               int fd,
@@ -160,14 +255,14 @@ bool dispatcher_submit_sendto(struct dispatcher dispatcher[static 1],
                               int flags,
                               const struct sockaddr *addr,
                               socklen_t addrlen) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
         return false;
     }
     io_uring_prep_sendto(sqe, fd, buf, len, flags, addr, addrlen);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not submit sendto request: %s", strerror(-ret));
         return false;
@@ -177,14 +272,14 @@ bool dispatcher_submit_sendto(struct dispatcher dispatcher[static 1],
 }
 
 bool dispatcher_submit_cancel(struct dispatcher dispatcher[static 1], struct dispatcher_event *event, struct dispatcher_event event_to_cancel[static 1]) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    struct io_uring_sqe *sqe = get_sqe(dispatcher);
     if (sqe == nullptr) {
         logger_log_error(dispatcher->logger, "Could not get a submission queue entry.");
         return false;
     }
     io_uring_prep_cancel(sqe, event_to_cancel, 0);
     io_uring_sqe_set_data(sqe, event);
-    int ret = io_uring_submit(&dispatcher->ring);
+    int ret = submit(dispatcher);
     if (ret < 0) {
         logger_log_error(dispatcher->logger, "Could not remove the on data available request. %s", strerror(-ret));
         return false;
@@ -192,3 +287,71 @@ bool dispatcher_submit_cancel(struct dispatcher dispatcher[static 1], struct dis
     dispatcher->pending_requests++;
     return true;
 }
+
+static struct io_uring_sqe *get_sqe(struct dispatcher dispatcher[static 1]) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&dispatcher->ring);
+    if (sqe == nullptr && submit(dispatcher) >= 0) {
+        sqe = io_uring_get_sqe(&dispatcher->ring);
+    }
+    return sqe;
+}
+
+/*
+ * Submits the prepared entries.
+ * When the completion queue is full the kernel may refuse new submissions,
+ *  completions are then moved to the backlog to make room for them.
+ */
+static int submit(struct dispatcher dispatcher[static 1]) {
+    int ret;
+    while ((ret = io_uring_submit(&dispatcher->ring)) == -EBUSY || ret == -EAGAIN) {
+        if (reap_completions(dispatcher) == 0) {
+            break;
+        }
+    }
+    return ret;
+}
+
+static size_t reap_completions(struct dispatcher dispatcher[static 1]) {
+    struct io_uring_cqe *cqe;
+    size_t reaped = 0;
+    while (io_uring_peek_cqe(&dispatcher->ring, &cqe) == 0) {
+        if (dispatcher->backlog_count == dispatcher->backlog_capacity) {
+            const size_t capacity = dispatcher->backlog_capacity == 0 ? 64 : dispatcher->backlog_capacity * 2;
+            struct io_uring_cqe *backlog = malloc(capacity * sizeof *backlog);
+            if (backlog == nullptr) {
+                logger_log_error(dispatcher->logger, "Could not grow the completions backlog. %s", strerror(errno));
+                break;
+            }
+            for (size_t i = 0; i < dispatcher->backlog_count; i++) {
+                backlog[i] = dispatcher->backlog[(dispatcher->backlog_head + i) % dispatcher->backlog_capacity];
+            }
+            free(dispatcher->backlog);
+            dispatcher->backlog = backlog;
+            dispatcher->backlog_capacity = capacity;
+            dispatcher->backlog_head = 0;
+        }
+        // the completion is copied, a multishot request may complete again before its event is delivered
+        const size_t tail = (dispatcher->backlog_head + dispatcher->backlog_count) % dispatcher->backlog_capacity;
+        dispatcher->backlog[tail] = *cqe;
+        dispatcher->backlog_count++;
+        io_uring_cqe_seen(&dispatcher->ring, cqe);
+        reaped++;
+    }
+    return reaped;
+}
+
+static void complete(struct io_uring_cqe cqe[static 1]) {
+    struct dispatcher_event *event = io_uring_cqe_get_data(cqe);
+    if (event == nullptr) {
+        return;
+    }
+    event->flags = cqe->flags;
+    if (cqe->res < 0) {
+        event->is_success = false;
+        event->error_number = -cqe->res;
+    }
+    else {
+        event->is_success = true;
+        event->result = cqe->res;
+    }
+}
@@ -6,15 +6,26 @@
 #include <liburing.h>
 #include <logger.h>
 
+// A dispatcher is driven by a single thread, which is the only one submitting requests and waiting for events.
 struct dispatcher {
     struct io_uring ring;
     struct logger *logger;
-    uint8_t pending_requests;
+    uint32_t pending_requests;
+    /* private members */
+    struct io_uring_cqe *backlog;       // completions reaped while the ring was busy, delivered in order
+    size_t backlog_capacity;
+    size_t backlog_head;
+    size_t backlog_count;
+    struct io_uring_buf_ring *buffer_ring;
+    uint8_t *buffers;
+    uint16_t buffers_count;
+    size_t buffer_size;
 };
 
 struct dispatcher_event {
     uint64_t id;
     bool is_success;
+    uint32_t flags;     // completion flags, IORING_CQE_F_MORE while a multishot request stays armed
     union {
         int32_t result;
         int32_t error_number;
@@ -26,10 +37,33 @@ struct dispatcher_event_timeout {
     struct __kernel_timespec timeout;
 };
 
+// Offset to pass to dispatcher_submit_read to read from the current file position, mandatory for non-seekable files.
+constexpr uint64_t dispatcher_current_position = UINT64_MAX;
+
+// Buffer group of the buffers registered by dispatcher_init_buffers.
+constexpr uint16_t dispatcher_buffer_group = 0;
+
+/*
+ * The completion queue is sized for max_requests in-flight requests.
+ * More requests can still be submitted, completions not fitting the queue are kept until they are waited for.
+ */
 bool dispatcher_init(struct dispatcher dispatcher[static 1], uint32_t max_requests, struct logger logger[static 1]);
 
 bool dispatcher_destroy(struct dispatcher dispatcher[static 1]);
 
+/*
+ * Registers count buffers of size bytes the kernel picks from to complete multishot receives.
+ * count must be a power of two.
+ */
+bool dispatcher_init_buffers(struct dispatcher dispatcher[static 1], uint16_t count, size_t size);
+
+static inline void *dispatcher_get_buffer(struct dispatcher dispatcher[static 1], uint16_t id) {
+    return dispatcher->buffers + (size_t) id * dispatcher->buffer_size;
+}
+
+// Returns the buffer of a completed receive, the id is in the flags of the event, to the kernel.
+void dispatcher_recycle_buffer(struct dispatcher dispatcher[static 1], uint16_t id);
+
 bool dispatcher_wait_event(struct dispatcher dispatcher[static 1], struct dispatcher_event *event[static 1]);
 
 bool dispatcher_submit(struct dispatcher dispatcher[static 1], struct dispatcher_event *event);
@@ -50,7 +84,15 @@ bool dispatcher_submit_read(struct dispatcher dispatcher[static 1],
                             struct dispatcher_event event[static 1],
                             int fd,
                             void *buffer,
-                            unsigned n_bytes);
+                            unsigned n_bytes,
+                            uint64_t offset);
+
+bool dispatcher_submit_recv(struct dispatcher dispatcher[static 1],
+                            struct dispatcher_event event[static 1],
+                            int fd,
+                            void *buffer,
+                            size_t n_bytes,
+                            int flags);
 
 bool dispatcher_submit_recvmsg(struct dispatcher dispatcher[static 1],
                                struct dispatcher_event event[static 1],
@@ -58,6 +100,15 @@ bool dispatcher_submit_recvmsg(struct dispatcher dispatcher[static 1],
                                struct msghdr msghdr[static 1],
                                unsigned flags);
 
+/*
+ * Receives datagrams into the registered buffers until cancelled, the event is completed once per datagram.
+ * The request is over when a completion comes without IORING_CQE_F_MORE, e.g. when no buffer was available.
+ */
+bool dispatcher_submit_recvmsg_multishot(struct dispatcher dispatcher[static 1],
+                                         struct dispatcher_event event[static 1],
+                                         int fd,
+                                         struct msghdr msghdr[static 1]);
+
 bool dispatcher_submit_sendto(struct dispatcher dispatcher[static 1],
                               struct dispatcher_event event[static 1],
                               int fd,
@@ -0,0 +1,202 @@
+#include "file_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../utils/hash.h"
+
+static constexpr size_t min_buckets_count = 16;
+static constexpr size_t max_data_extents = 4096;
+
+static struct file_cache_entry *entry_open(const char path[static 1]);
+static void entry_close(struct file_cache_entry *entry);
+static void map_data_extents(struct file_cache_entry entry[static 1]);
+static bool path_matches(const struct lru_index_node node[static 1], const void *path);
+static void node_close(struct lru_index_node node[static 1]);
+
+bool file_cache_init(struct file_cache cache[static 1], size_t max_file_descriptors, struct logger logger[static 1]) {
+    *cache = (struct file_cache) {
+        .logger = logger,
+        .max_file_descriptors = max_file_descriptors,
+    };
+    if (!lru_index_init(&cache->index, max_file_descriptors < min_buckets_count ? min_buckets_count : max_file_descriptors)) {
+        logger_log_error(logger, "Could not allocate memory for the file cache index. %s", strerror(errno));
+        return false;
+    }
+    if (mtx_init(&cache->mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the file cache mutex.");
+        lru_index_destroy(&cache->index);
+        return false;
+    }
+    return true;
+}
+
+void file_cache_destroy(struct file_cache cache[static 1]) {
+    lru_index_clear(&cache->index, node_close);
+    lru_index_destroy(&cache->index);
+    mtx_destroy(&cache->mtx);
+}
+
+struct file_cache_entry *file_cache_acquire(struct file_cache cache[static 1], const char path[static 1]) {
+    if (cache->max_file_descriptors == 0) {
+        return entry_open(path);
+    }
+    // the path walk may block on slow storage, revalidate against a stat taken before locking
+    struct stat current_stat;
+    const bool is_stat_valid = stat(path, &current_stat) == 0;
+    const uint64_t hash = hash_string(path);
+    mtx_lock(&cache->mtx);
+    struct lru_index_node **link = lru_index_find(&cache->index, hash, path_matches, path);
+    if (*link != nullptr) {
+        struct file_cache_entry *entry = lru_index_entry(*link, struct file_cache_entry, node);
+        if (is_stat_valid && file_cache_is_same_file(&current_stat, &entry->stat)) {
+            lru_index_acquire(&cache->index, &entry->node);
+            mtx_unlock(&cache->mtx);
+            return entry;
+        }
+        logger_log_debug(cache->logger, "Cached file descriptor for %s is stale.", path);
+        if (lru_index_remove(&cache->index, link)) {
+            entry_close(entry);
+        }
+    }
+    mtx_unlock(&cache->mtx);
+    // open(2) may block on slow storage, do not hold the lock while waiting for it
+    struct file_cache_entry *entry = entry_open(path);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    if (!S_ISREG(entry->stat.st_mode) && !S_ISBLK(entry->stat.st_mode)) {
+        return entry;   // only files supporting positional reads can be shared
+    }
+    mtx_lock(&cache->mtx);
+    struct lru_index_node *concurrent_node = *lru_index_find(&cache->index, hash, path_matches, path);
+    if (concurrent_node != nullptr) {
+        struct file_cache_entry *concurrent_entry = lru_index_entry(concurrent_node, struct file_cache_entry, node);
+        if (file_cache_is_same_file(&concurrent_entry->stat, &entry->stat)) {
+            lru_index_acquire(&cache->index, &concurrent_entry->node);
+            mtx_unlock(&cache->mtx);
+            entry_close(entry);
+            return concurrent_entry;
+        }
+        mtx_unlock(&cache->mtx);
+        return entry;   // served uncached, closed on release
+    }
+    struct lru_index_node *victim;
+    while (cache->index.count >= cache->max_file_descriptors && (victim = lru_index_evict(&cache->index)) != nullptr) {
+        node_close(victim);
+    }
+    if (cache->index.count < cache->max_file_descriptors) {
+        lru_index_insert(&cache->index, &entry->node, hash);
+    }
+    mtx_unlock(&cache->mtx);
+    return entry;
+}
+
+void file_cache_release(struct file_cache cache[static 1], struct file_cache_entry entry[static 1]) {
+    if (cache->max_file_descriptors == 0) {
+        entry_close(entry);
+        return;
+    }
+    mtx_lock(&cache->mtx);
+    if (lru_index_release(&cache->index, &entry->node)) {
+        entry_close(entry);
+    }
+    mtx_unlock(&cache->mtx);
+}
+
+static struct file_cache_entry *entry_open(const char path[static 1]) {
+    struct file_cache_entry *entry = malloc(sizeof *entry + strlen(path) + 1);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    *entry = (struct file_cache_entry) {
+        .path = strcpy((char *) (entry + 1), path),
+        .node.references = 1,
+    };
+    do {
+        entry->file_descriptor = open(path, O_RDONLY);
+    } while (entry->file_descriptor == -1 && errno == EINTR);
+    if (entry->file_descriptor == -1) {
+        int error = errno;
+        free(entry);
+        errno = error;
+        return nullptr;
+    }
+    if (fstat(entry->file_descriptor, &entry->stat) == -1) {
+        int error = errno;
+        close(entry->file_descriptor);
+        free(entry);
+        errno = error;
+        return nullptr;
+    }
+    map_data_extents(entry);
+    return entry;
+}
+
+static void entry_close(struct file_cache_entry *entry) {
+    close(entry->file_descriptor);
+    free(entry->data_extents);
+    free(entry);
+}
+
+/*
+ * Maps the data regions of regular files having less blocks allocated than their size.
+ * The map is best effort: files that are too fragmented or whose filesystem does not report holes are left unmapped.
+ */
+static void map_data_extents(struct file_cache_entry entry[static 1]) {
+    const off_t size = entry->stat.st_size;
+    if (!S_ISREG(entry->stat.st_mode) || (off_t) entry->stat.st_blocks * 512 >= size) {
+        return;
+    }
+    struct file_extent *extents = nullptr;
+    size_t count = 0;
+    off_t offset = 0;
+    while (offset < size) {
+        const off_t data = lseek(entry->file_descriptor, offset, SEEK_DATA);
+        if (data == -1) {
+            if (errno == ENXIO) {
+                break;  // the rest of the file is a hole
+            }
+            goto fail;
+        }
+        const off_t hole = lseek(entry->file_descriptor, data, SEEK_HOLE);
+        if (hole == -1 || count == max_data_extents) {
+            goto fail;
+        }
+        if (count % 16 == 0) {
+            struct file_extent *new_extents = realloc(extents, (count + 16) * sizeof *extents);
+            if (new_extents == nullptr) {
+                goto fail;
+            }
+            extents = new_extents;
+        }
+        extents[count++] = (struct file_extent) {.begin = data, .end = hole < size ? hole : size};
+        offset = hole;
+    }
+    if (count == 1 && extents[0].begin == 0 && extents[0].end == size) {
+        goto fail;  // no holes after all
+    }
+    if (extents == nullptr) {
+        // a single hole, keep an empty map that still tells the file is sparse
+        extents = malloc(sizeof *extents);
+        if (extents == nullptr) {
+            return;
+        }
+    }
+    entry->data_extents = extents;
+    entry->data_extents_count = count;
+    return;
+fail:
+    free(extents);
+}
+
+static bool path_matches(const struct lru_index_node node[static 1], const void *path) {
+    return strcmp(lru_index_entry(node, struct file_cache_entry, node)->path, path) == 0;
+}
+
+static void node_close(struct lru_index_node node[static 1]) {
+    entry_close(lru_index_entry(node, struct file_cache_entry, node));
+}
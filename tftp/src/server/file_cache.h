@@ -0,0 +1,63 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <threads.h>
+
+#include <logger.h>
+
+#include "lru_index.h"
+
+/*
+ * Server-wide cache of read-only file descriptors shared between sessions.
+ * Entries are keyed by full path, revalidated against inode and mtime on every lookup and reference counted,
+ *  idle entries are kept in LRU order and closed when the file descriptors budget is exceeded.
+ * Since descriptors are shared, readers must use positional reads and never rely on the file position.
+ * Holes of sparse regular files are mapped once when the file is opened, so that readers can skip them.
+ */
+
+// Region [begin, end) of a file containing data.
+struct file_extent {
+    off_t begin;
+    off_t end;
+};
+
+struct file_cache_entry {
+    char *path;
+    int file_descriptor;
+    struct stat stat;
+    struct file_extent *data_extents;   // sorted data regions, nullptr if the file has no known holes
+    size_t data_extents_count;
+    /* private members */
+    struct lru_index_node node;
+};
+
+struct file_cache {
+    struct logger *logger;
+    mtx_t mtx;
+    size_t max_file_descriptors;
+    struct lru_index index;     // one entry per cached file descriptor
+};
+
+// True if both stats describe the same version of the same file.
+static inline bool file_cache_is_same_file(const struct stat a[static 1], const struct stat b[static 1]) {
+    return a->st_dev == b->st_dev
+           && a->st_ino == b->st_ino
+           && a->st_size == b->st_size
+           && a->st_mtim.tv_sec == b->st_mtim.tv_sec
+           && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+// A max_file_descriptors of 0 disables caching, every acquire will open a private file descriptor.
+bool file_cache_init(struct file_cache cache[static 1], size_t max_file_descriptors, struct logger logger[static 1]);
+
+void file_cache_destroy(struct file_cache cache[static 1]);
+
+// On failure returns nullptr and errno is set as by open(2).
+struct file_cache_entry *file_cache_acquire(struct file_cache cache[static 1], const char path[static 1]);
+
+void file_cache_release(struct file_cache cache[static 1], struct file_cache_entry entry[static 1]);
+
+#endif // FILE_CACHE_H
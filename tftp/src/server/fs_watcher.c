@@ -0,0 +1,101 @@
+#include "fs_watcher.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static constexpr uint32_t watch_mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_CLOSE_WRITE
+                                       | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+static int watcher_routine(struct fs_watcher watcher[static 1]);
+
+bool fs_watcher_init(struct fs_watcher watcher[static 1], struct logger logger[static 1]) {
+    *watcher = (struct fs_watcher) {
+        .logger = logger,
+        .inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC),
+        .stop_descriptor = -1,
+    };
+    if (watcher->inotify_descriptor == -1) {
+        logger_log_warn(logger, "Could not initialize inotify. %s", strerror(errno));
+        return false;
+    }
+    watcher->stop_descriptor = eventfd(0, EFD_CLOEXEC);
+    if (watcher->stop_descriptor == -1) {
+        logger_log_warn(logger, "Could not create the filesystem watcher stop event. %s", strerror(errno));
+        close(watcher->inotify_descriptor);
+        return false;
+    }
+    return true;
+}
+
+void fs_watcher_destroy(struct fs_watcher watcher[static 1]) {
+    if (watcher->subscribers_count != 0) {
+        eventfd_write(watcher->stop_descriptor, 1);
+        thrd_join(watcher->thread, nullptr);
+    }
+    close(watcher->stop_descriptor);
+    close(watcher->inotify_descriptor);
+}
+
+bool fs_watcher_subscribe(struct fs_watcher watcher[static 1], void (*callback)(void *arg), void *arg) {
+    if (watcher->subscribers_count == fs_watcher_max_subscribers) {
+        logger_log_error(watcher->logger, "Too many filesystem watcher subscribers.");
+        return false;
+    }
+    watcher->subscribers[watcher->subscribers_count++] = (struct fs_watcher_subscriber) {
+        .callback = callback,
+        .arg = arg,
+    };
+    return true;
+}
+
+bool fs_watcher_start(struct fs_watcher watcher[static 1]) {
+    if (watcher->subscribers_count == 0) {
+        return true;
+    }
+    if (thrd_create(&watcher->thread, (thrd_start_t) watcher_routine, watcher) != thrd_success) {
+        logger_log_error(watcher->logger, "Could not start the filesystem watcher thread.");
+        watcher->subscribers_count = 0;
+        return false;
+    }
+    return true;
+}
+
+bool fs_watcher_watch(struct fs_watcher watcher[static 1], const char directory[static 1]) {
+    return inotify_add_watch(watcher->inotify_descriptor, directory, watch_mask) != -1;
+}
+
+static int watcher_routine(struct fs_watcher watcher[static 1]) {
+    char buffer[4096];   // events are only drained, never parsed
+    struct pollfd descriptors[] = {
+        {.fd = watcher->inotify_descriptor, .events = POLLIN},
+        {.fd = watcher->stop_descriptor, .events = POLLIN},
+    };
+    while (true) {
+        if (poll(descriptors, sizeof descriptors / sizeof *descriptors, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logger_log_error(watcher->logger, "Filesystem watcher stopped. %s", strerror(errno));
+            return 1;
+        }
+        if (descriptors[1].revents & POLLIN) {
+            return 0;
+        }
+        bool has_changes = false;
+        ssize_t bytes_read;
+        while ((bytes_read = read(watcher->inotify_descriptor, buffer, sizeof buffer)) > 0 || (bytes_read == -1 && errno == EINTR)) {
+            has_changes |= bytes_read > 0;
+        }
+        if (!has_changes) {
+            continue;
+        }
+        logger_log_trace(watcher->logger, "Filesystem changes detected.");
+        for (size_t i = 0; i < watcher->subscribers_count; i++) {
+            watcher->subscribers[i].callback(watcher->subscribers[i].arg);
+        }
+    }
+}
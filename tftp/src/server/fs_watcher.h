@@ -0,0 +1,43 @@
+#ifndef FS_WATCHER_H
+#define FS_WATCHER_H
+
+#include <stddef.h>
+#include <threads.h>
+
+#include <logger.h>
+
+/*
+ * Background thread notifying subscribers whenever something changes inside one of the watched directories.
+ * Watches are not recursive, every directory of interest must be registered with fs_watcher_watch.
+ * Callbacks run on the watcher thread, once for every batch of filesystem events.
+ */
+
+constexpr size_t fs_watcher_max_subscribers = 4;
+
+struct fs_watcher_subscriber {
+    void (*callback)(void *arg);
+    void *arg;
+};
+
+struct fs_watcher {
+    struct logger *logger;
+    int inotify_descriptor;
+    int stop_descriptor;
+    thrd_t thread;
+    size_t subscribers_count;
+    struct fs_watcher_subscriber subscribers[fs_watcher_max_subscribers];
+};
+
+bool fs_watcher_init(struct fs_watcher watcher[static 1], struct logger logger[static 1]);
+
+void fs_watcher_destroy(struct fs_watcher watcher[static 1]);
+
+// Subscribers must be registered before the watcher is started.
+bool fs_watcher_subscribe(struct fs_watcher watcher[static 1], void (*callback)(void *arg), void *arg);
+
+bool fs_watcher_start(struct fs_watcher watcher[static 1]);
+
+// On failure errno is set as by inotify_add_watch(2), watching an already watched directory is a no-op.
+bool fs_watcher_watch(struct fs_watcher watcher[static 1], const char directory[static 1]);
+
+#endif // FS_WATCHER_H
@@ -0,0 +1,223 @@
+#include "listing_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../utils/hash.h"
+
+static constexpr size_t buckets_count = 64;
+
+struct listing_key {
+    const char *path;
+    enum listing_format format;
+};
+
+static struct listing_cache_entry *entry_render(const char path[static 1], enum listing_format format);
+static bool render(DIR *dir, enum listing_format format, FILE stream[static 1]);
+static void entry_free(struct listing_cache_entry *entry);
+static bool key_matches(const struct lru_index_node node[static 1], const void *key);
+static void node_free(struct lru_index_node node[static 1]);
+static void on_filesystem_change(void *arg);
+
+bool listing_cache_init(struct listing_cache cache[static 1],
+                        size_t max_entries,
+                        struct fs_watcher *watcher,
+                        struct logger logger[static 1]) {
+    *cache = (struct listing_cache) {
+        .logger = logger,
+        .watcher = watcher,
+        .max_entries = watcher == nullptr ? 0 : max_entries,
+    };
+    if (!lru_index_init(&cache->index, buckets_count)) {
+        logger_log_error(logger, "Could not allocate memory for the listing cache index. %s", strerror(errno));
+        return false;
+    }
+    if (mtx_init(&cache->mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the listing cache mutex.");
+        lru_index_destroy(&cache->index);
+        return false;
+    }
+    if (cache->max_entries != 0 && !fs_watcher_subscribe(watcher, on_filesystem_change, cache)) {
+        cache->max_entries = 0;
+    }
+    return true;
+}
+
+void listing_cache_destroy(struct listing_cache cache[static 1]) {
+    lru_index_clear(&cache->index, node_free);
+    lru_index_destroy(&cache->index);
+    mtx_destroy(&cache->mtx);
+}
+
+struct listing_cache_entry *listing_cache_acquire(struct listing_cache cache[static 1],
+                                                  const char path[static 1],
+                                                  enum listing_format format) {
+    if (cache->max_entries == 0) {
+        return entry_render(path, format);
+    }
+    const uint64_t hash = hash_string(path) + format;
+    const struct listing_key key = {.path = path, .format = format};
+    mtx_lock(&cache->mtx);
+    struct lru_index_node *node = *lru_index_find(&cache->index, hash, key_matches, &key);
+    if (node != nullptr) {
+        lru_index_acquire(&cache->index, node);
+        mtx_unlock(&cache->mtx);
+        return lru_index_entry(node, struct listing_cache_entry, node);
+    }
+    const uint64_t generation = cache->generation;
+    mtx_unlock(&cache->mtx);
+    // watch before reading the directory, changes happening while rendering must invalidate the result
+    const bool is_watched = fs_watcher_watch(cache->watcher, path);
+    struct listing_cache_entry *entry = entry_render(path, format);
+    if (entry == nullptr || !is_watched) {
+        return entry;
+    }
+    mtx_lock(&cache->mtx);
+    struct lru_index_node *concurrent_node = *lru_index_find(&cache->index, hash, key_matches, &key);
+    if (concurrent_node != nullptr) {
+        lru_index_acquire(&cache->index, concurrent_node);
+        mtx_unlock(&cache->mtx);
+        entry_free(entry);
+        return lru_index_entry(concurrent_node, struct listing_cache_entry, node);
+    }
+    if (generation != cache->generation) {
+        mtx_unlock(&cache->mtx);
+        return entry;   // already stale, served uncached and freed on release
+    }
+    struct lru_index_node *victim;
+    while (cache->index.count >= cache->max_entries && (victim = lru_index_evict(&cache->index)) != nullptr) {
+        node_free(victim);
+    }
+    if (cache->index.count < cache->max_entries) {
+        lru_index_insert(&cache->index, &entry->node, hash);
+    }
+    mtx_unlock(&cache->mtx);
+    return entry;
+}
+
+void listing_cache_release(struct listing_cache cache[static 1], struct listing_cache_entry entry[static 1]) {
+    if (cache->max_entries == 0) {
+        entry_free(entry);
+        return;
+    }
+    mtx_lock(&cache->mtx);
+    if (lru_index_release(&cache->index, &entry->node)) {
+        entry_free(entry);
+    }
+    mtx_unlock(&cache->mtx);
+}
+
+static struct listing_cache_entry *entry_render(const char path[static 1], enum listing_format format) {
+    struct listing_cache_entry *entry = malloc(sizeof *entry + strlen(path) + 1);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    *entry = (struct listing_cache_entry) {
+        .path = strcpy((char *) (entry + 1), path),
+        .format = format,
+        .file_descriptor = -1,
+        .node.references = 1,
+    };
+    char *listing = nullptr;
+    size_t listing_size = 0;
+    FILE *stream = nullptr;
+    DIR *dir = opendir(path);
+    if (dir == nullptr) {
+        goto fail;
+    }
+    stream = open_memstream(&listing, &listing_size);
+    if (stream == nullptr || !render(dir, format, stream)) {
+        goto fail;
+    }
+    if (fclose(stream) == EOF) {
+        stream = nullptr;
+        goto fail;
+    }
+    stream = nullptr;
+    entry->file_descriptor = memfd_create("tftp-listing", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (entry->file_descriptor == -1) {
+        goto fail;
+    }
+    for (size_t written = 0; written < listing_size;) {
+        ssize_t ret = write(entry->file_descriptor, &listing[written], listing_size - written);
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            goto fail;
+        }
+        written += ret;
+    }
+    if (fcntl(entry->file_descriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        goto fail;
+    }
+    entry->size = (off_t) listing_size;
+    free(listing);
+    closedir(dir);
+    return entry;
+fail:
+    int error = errno;
+    if (stream != nullptr) {
+        fclose(stream);
+    }
+    if (dir != nullptr) {
+        closedir(dir);
+    }
+    free(listing);
+    entry_free(entry);
+    errno = error;
+    return nullptr;
+}
+
+static bool render(DIR *dir, enum listing_format format, FILE stream[static 1]) {
+    errno = 0;
+    for (struct dirent *dirent = readdir(dir); dirent != nullptr; dirent = readdir(dir)) {
+        if (format == LISTING_FORMAT_NAMES) {
+            if (fprintf(stream, "%s\n", dirent->d_name) < 0) {
+                return false;
+            }
+            continue;
+        }
+        struct stat stat;
+        if (fstatat(dirfd(dir), dirent->d_name, &stat, 0) == -1) {
+            errno = 0;
+            continue;   // removed meanwhile, the change will invalidate the listing anyway
+        }
+        if (fprintf(stream, "%jd\t%jd\t%s\n", (intmax_t) stat.st_size, (intmax_t) stat.st_mtim.tv_sec, dirent->d_name) < 0) {
+            return false;
+        }
+    }
+    return errno == 0;
+}
+
+static void entry_free(struct listing_cache_entry *entry) {
+    if (entry->file_descriptor != -1) {
+        close(entry->file_descriptor);
+    }
+    free(entry);
+}
+
+static bool key_matches(const struct lru_index_node node[static 1], const void *key) {
+    const struct listing_cache_entry *entry = lru_index_entry(node, struct listing_cache_entry, node);
+    const struct listing_key *listing_key = key;
+    return entry->format == listing_key->format && strcmp(entry->path, listing_key->path) == 0;
+}
+
+static void node_free(struct lru_index_node node[static 1]) {
+    entry_free(lru_index_entry(node, struct listing_cache_entry, node));
+}
+
+static void on_filesystem_change(void *arg) {
+    struct listing_cache *cache = arg;
+    mtx_lock(&cache->mtx);
+    cache->generation++;
+    lru_index_clear(&cache->index, node_free);
+    mtx_unlock(&cache->mtx);
+}
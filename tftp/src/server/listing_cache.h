@@ -0,0 +1,59 @@
+#ifndef LISTING_CACHE_H
+#define LISTING_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <threads.h>
+
+#include <logger.h>
+
+#include "fs_watcher.h"
+#include "lru_index.h"
+
+/*
+ * Server-wide cache of rendered directory listings.
+ * Every listing is stored in a sealed memfd shared by all the sessions listing the same directory, so it can be
+ *  served through positional reads like any regular file.
+ * Listings are dropped whenever the filesystem watcher reports a change, without a watcher nothing is cached.
+ */
+
+enum listing_format {
+    LISTING_FORMAT_NAMES,       // one name per line
+    LISTING_FORMAT_DETAILED,    // one "<size>\t<mtime>\t<name>" line per entry, mtime in seconds since the epoch
+};
+
+struct listing_cache_entry {
+    char *path;
+    enum listing_format format;
+    int file_descriptor;
+    off_t size;
+    /* private members */
+    struct lru_index_node node;
+};
+
+struct listing_cache {
+    struct logger *logger;
+    struct fs_watcher *watcher;
+    mtx_t mtx;
+    size_t max_entries;
+    uint64_t generation;    // incremented on every invalidation
+    struct lru_index index;
+};
+
+// A max_entries of 0 or a nullptr watcher disables caching, every acquire will render a private listing.
+bool listing_cache_init(struct listing_cache cache[static 1],
+                        size_t max_entries,
+                        struct fs_watcher *watcher,
+                        struct logger logger[static 1]);
+
+void listing_cache_destroy(struct listing_cache cache[static 1]);
+
+// On failure returns nullptr and errno is set.
+struct listing_cache_entry *listing_cache_acquire(struct listing_cache cache[static 1],
+                                                  const char path[static 1],
+                                                  enum listing_format format);
+
+void listing_cache_release(struct listing_cache cache[static 1], struct listing_cache_entry entry[static 1]);
+
+#endif // LISTING_CACHE_H
@@ -0,0 +1,125 @@
+#include "lru_index.h"
+
+#include <stdlib.h>
+
+static void lru_remove(struct lru_index index[static 1], struct lru_index_node node[static 1]);
+static void lru_push_front(struct lru_index index[static 1], struct lru_index_node node[static 1]);
+
+bool lru_index_init(struct lru_index index[static 1], size_t buckets_count) {
+    size_t count = 1;
+    while (count < buckets_count) {
+        count <<= 1;
+    }
+    *index = (struct lru_index) {
+        .buckets_count = count,
+        .buckets = calloc(count, sizeof *index->buckets),
+    };
+    return index->buckets != nullptr;
+}
+
+void lru_index_destroy(struct lru_index index[static 1]) {
+    free(index->buckets);
+}
+
+struct lru_index_node **lru_index_find(struct lru_index index[static 1],
+                                       uint64_t hash,
+                                       bool (*matches)(const struct lru_index_node node[static 1], const void *key),
+                                       const void *key) {
+    struct lru_index_node **link = &index->buckets[hash & (index->buckets_count - 1)];
+    while (*link != nullptr && ((*link)->hash != hash || !matches(*link, key))) {
+        link = &(*link)->bucket_next;
+    }
+    return link;
+}
+
+void lru_index_insert(struct lru_index index[static 1], struct lru_index_node node[static 1], uint64_t hash) {
+    struct lru_index_node **bucket = &index->buckets[hash & (index->buckets_count - 1)];
+    node->hash = hash;
+    node->bucket_next = *bucket;
+    node->is_indexed = true;
+    *bucket = node;
+    index->count++;
+}
+
+void lru_index_acquire(struct lru_index index[static 1], struct lru_index_node node[static 1]) {
+    if (node->references++ == 0) {
+        lru_remove(index, node);
+    }
+}
+
+bool lru_index_release(struct lru_index index[static 1], struct lru_index_node node[static 1]) {
+    if (--node->references != 0) {
+        return false;
+    }
+    if (node->is_indexed) {
+        lru_push_front(index, node);
+        return false;
+    }
+    return true;
+}
+
+bool lru_index_remove(struct lru_index index[static 1], struct lru_index_node **link) {
+    struct lru_index_node *node = *link;
+    *link = node->bucket_next;
+    node->bucket_next = nullptr;
+    node->is_indexed = false;
+    index->count--;
+    if (node->references != 0) {
+        return false;
+    }
+    lru_remove(index, node);
+    return true;
+}
+
+struct lru_index_node *lru_index_evict(struct lru_index index[static 1]) {
+    struct lru_index_node *victim = index->lru_tail;
+    if (victim == nullptr) {
+        return nullptr;
+    }
+    struct lru_index_node **link = &index->buckets[victim->hash & (index->buckets_count - 1)];
+    while (*link != victim) {
+        link = &(*link)->bucket_next;
+    }
+    lru_index_remove(index, link);
+    return victim;
+}
+
+void lru_index_clear(struct lru_index index[static 1], void (*free_entry)(struct lru_index_node node[static 1])) {
+    for (size_t i = 0; i < index->buckets_count && index->count != 0; i++) {
+        while (index->buckets[i] != nullptr) {
+            struct lru_index_node *node = index->buckets[i];
+            if (lru_index_remove(index, &index->buckets[i])) {
+                free_entry(node);
+            }
+        }
+    }
+}
+
+static void lru_remove(struct lru_index index[static 1], struct lru_index_node node[static 1]) {
+    if (node->lru_prev != nullptr) {
+        node->lru_prev->lru_next = node->lru_next;
+    }
+    else {
+        index->lru_head = node->lru_next;
+    }
+    if (node->lru_next != nullptr) {
+        node->lru_next->lru_prev = node->lru_prev;
+    }
+    else {
+        index->lru_tail = node->lru_prev;
+    }
+    node->lru_prev = nullptr;
+    node->lru_next = nullptr;
+}
+
+static void lru_push_front(struct lru_index index[static 1], struct lru_index_node node[static 1]) {
+    node->lru_prev = nullptr;
+    node->lru_next = index->lru_head;
+    if (index->lru_head != nullptr) {
+        index->lru_head->lru_prev = node;
+    }
+    else {
+        index->lru_tail = node;
+    }
+    index->lru_head = node;
+}
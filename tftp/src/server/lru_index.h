@@ -0,0 +1,62 @@
+#ifndef LRU_INDEX_H
+#define LRU_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Intrusive hash index of reference counted cache entries, the indexed entries no longer referenced are idle and are
+ *  kept in LRU order until they are evicted.
+ * Entries embed a node and are found back with lru_index_entry, an entry removed from the index while still
+ *  referenced is freed by its owner on its last release.
+ * The index is not synchronized, the owning cache serializes the calls.
+ */
+
+struct lru_index_node {
+    uint64_t hash;
+    uint32_t references;
+    bool is_indexed;
+    struct lru_index_node *bucket_next;
+    struct lru_index_node *lru_prev;
+    struct lru_index_node *lru_next;
+};
+
+struct lru_index {
+    size_t count;                       // indexed entries
+    size_t buckets_count;               // power of two
+    struct lru_index_node **buckets;
+    struct lru_index_node *lru_head;    // most recently released idle entry
+    struct lru_index_node *lru_tail;    // next idle entry to be evicted
+};
+
+#define lru_index_entry(node, type, member) ((type *) ((char *) (node) - offsetof(type, member)))
+
+// The number of buckets is rounded up to a power of two, on failure errno is set as by calloc(3).
+bool lru_index_init(struct lru_index index[static 1], size_t buckets_count);
+
+void lru_index_destroy(struct lru_index index[static 1]);
+
+// Returns the link to the first entry with the hash matching key, or to the end of its bucket.
+struct lru_index_node **lru_index_find(struct lru_index index[static 1],
+                                       uint64_t hash,
+                                       bool (*matches)(const struct lru_index_node node[static 1], const void *key),
+                                       const void *key);
+
+// The entry must be referenced.
+void lru_index_insert(struct lru_index index[static 1], struct lru_index_node node[static 1], uint64_t hash);
+
+void lru_index_acquire(struct lru_index index[static 1], struct lru_index_node node[static 1]);
+
+// Returns true if the last reference to an entry no longer indexed was dropped, the caller must then free it.
+bool lru_index_release(struct lru_index index[static 1], struct lru_index_node node[static 1]);
+
+// Removes the entry at link, returns true if it was idle, the caller must then free it.
+bool lru_index_remove(struct lru_index index[static 1], struct lru_index_node **link);
+
+// Removes and returns the least recently released idle entry, nullptr if every indexed entry is referenced.
+struct lru_index_node *lru_index_evict(struct lru_index index[static 1]);
+
+// Removes every entry, the idle ones are passed to free_entry.
+void lru_index_clear(struct lru_index index[static 1], void (*free_entry)(struct lru_index_node node[static 1]));
+
+#endif // LRU_INDEX_H
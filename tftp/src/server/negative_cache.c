@@ -0,0 +1,210 @@
+#include "negative_cache.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../utils/hash.h"
+
+static constexpr size_t min_buckets_count = 16;
+
+static uint64_t now_ns(void);
+static bool watch_parent_directory(struct negative_cache cache[static 1], const char path[static 1], size_t root_length);
+static void expire_entries(struct negative_cache cache[static 1], uint64_t now);
+static void remove_oldest(struct negative_cache cache[static 1]);
+static struct negative_cache_entry **index_find(struct negative_cache cache[static 1], const char filename[static 1]);
+static void on_filesystem_change(void *arg);
+
+bool negative_cache_init(struct negative_cache cache[static 1],
+                         size_t max_entries,
+                         uint32_t ttl_ms,
+                         struct fs_watcher *watcher,
+                         struct logger logger[static 1]) {
+    size_t buckets_count = min_buckets_count;
+    while (buckets_count < max_entries) {
+        buckets_count <<= 1;
+    }
+    *cache = (struct negative_cache) {
+        .logger = logger,
+        .watcher = watcher,
+        .max_entries = max_entries,
+        .ttl_ns = (uint64_t) ttl_ms * 1'000'000,
+        .buckets_count = buckets_count,
+        .buckets = calloc(buckets_count, sizeof *cache->buckets),
+    };
+    if (cache->buckets == nullptr) {
+        logger_log_error(logger, "Could not allocate memory for the negative cache index. %s", strerror(errno));
+        return false;
+    }
+    if (mtx_init(&cache->mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the negative cache mutex.");
+        free(cache->buckets);
+        return false;
+    }
+    if (max_entries != 0 && watcher != nullptr && !fs_watcher_subscribe(watcher, on_filesystem_change, cache)) {
+        cache->watcher = nullptr;
+    }
+    return true;
+}
+
+void negative_cache_destroy(struct negative_cache cache[static 1]) {
+    negative_cache_clear(cache);
+    free(cache->buckets);
+    mtx_destroy(&cache->mtx);
+}
+
+bool negative_cache_contains(struct negative_cache cache[static 1], const char filename[static 1]) {
+    if (cache->max_entries == 0) {
+        return false;
+    }
+    const uint64_t now = now_ns();
+    mtx_lock(&cache->mtx);
+    expire_entries(cache, now);
+    const bool is_missing = *index_find(cache, filename) != nullptr;
+    cache->hits += is_missing;
+    mtx_unlock(&cache->mtx);
+    return is_missing;
+}
+
+void negative_cache_insert(struct negative_cache cache[static 1], const char *root, const char filename[static 1]) {
+    if (cache->max_entries == 0) {
+        return;
+    }
+    const size_t root_length = root == nullptr ? 0 : strlen(root);
+    const size_t filename_length = strlen(filename);
+    struct negative_cache_entry *entry = malloc(sizeof *entry + root_length + 1 + filename_length + 1);
+    if (entry == nullptr) {
+        return;
+    }
+    char *path = (char *) (entry + 1);
+    if (root != nullptr) {
+        memcpy(path, root, root_length);
+        path[root_length] = '/';
+    }
+    memcpy(&path[root == nullptr ? 0 : root_length + 1], filename, filename_length + 1);
+    mtx_lock(&cache->mtx);
+    const uint64_t generation = cache->generation;
+    mtx_unlock(&cache->mtx);
+    // the file may have been created before the directory was watched, check again once it is
+    if (!watch_parent_directory(cache, path, root_length) || access(path, F_OK) == 0) {
+        free(entry);
+        return;
+    }
+    *entry = (struct negative_cache_entry) {
+        .filename = strcpy(path, filename),
+        .expiration_ns = now_ns() + cache->ttl_ns,
+    };
+    mtx_lock(&cache->mtx);
+    struct negative_cache_entry **link = index_find(cache, filename);
+    // a change reported since the check may be the creation of the file
+    if (*link != nullptr || generation != cache->generation) {
+        mtx_unlock(&cache->mtx);
+        free(entry);
+        return;
+    }
+    if (cache->entries_count == cache->max_entries) {
+        remove_oldest(cache);
+        link = index_find(cache, filename);
+    }
+    *link = entry;
+    if (cache->fifo_tail != nullptr) {
+        cache->fifo_tail->fifo_next = entry;
+    }
+    else {
+        cache->fifo_head = entry;
+    }
+    cache->fifo_tail = entry;
+    cache->entries_count++;
+    mtx_unlock(&cache->mtx);
+}
+
+void negative_cache_clear(struct negative_cache cache[static 1]) {
+    mtx_lock(&cache->mtx);
+    while (cache->fifo_head != nullptr) {
+        remove_oldest(cache);
+    }
+    mtx_unlock(&cache->mtx);
+}
+
+uint64_t negative_cache_collect_hits(struct negative_cache cache[static 1]) {
+    mtx_lock(&cache->mtx);
+    uint64_t hits = cache->hits;
+    cache->hits = 0;
+    mtx_unlock(&cache->mtx);
+    return hits;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1'000'000'000 + now.tv_nsec;
+}
+
+/*
+ * Watches the deepest existing ancestor of path inside the root, so that the creation of any missing directory
+ *  along the way is reported as well.
+ * Returns false if no directory could be watched, the entry is not worth caching then since changes would go unnoticed.
+ */
+static bool watch_parent_directory(struct negative_cache cache[static 1], const char path[static 1], size_t root_length) {
+    if (cache->watcher == nullptr) {
+        return true;
+    }
+    char *directory = strdup(path);
+    if (directory == nullptr) {
+        return false;
+    }
+    bool is_watched = false;
+    for (char *separator = strrchr(directory, '/');
+         separator != nullptr && (size_t) (separator - directory) >= root_length;
+         separator = strrchr(directory, '/')) {
+        *separator = '\0';
+        is_watched = fs_watcher_watch(cache->watcher, separator == directory ? "/" : directory);
+        if (is_watched || (errno != ENOENT && errno != ENOTDIR)) {
+            break;
+        }
+    }
+    if (!is_watched) {
+        logger_log_debug(cache->logger, "Could not watch the parent directory of %s. %s", path, strerror(errno));
+    }
+    free(directory);
+    return is_watched;
+}
+
+static void expire_entries(struct negative_cache cache[static 1], uint64_t now) {
+    while (cache->fifo_head != nullptr && cache->fifo_head->expiration_ns <= now) {
+        remove_oldest(cache);
+    }
+}
+
+static void remove_oldest(struct negative_cache cache[static 1]) {
+    struct negative_cache_entry *entry = cache->fifo_head;
+    struct negative_cache_entry **link = index_find(cache, entry->filename);
+    *link = entry->bucket_next;
+    cache->fifo_head = entry->fifo_next;
+    if (cache->fifo_head == nullptr) {
+        cache->fifo_tail = nullptr;
+    }
+    cache->entries_count--;
+    free(entry);
+}
+
+static struct negative_cache_entry **index_find(struct negative_cache cache[static 1], const char filename[static 1]) {
+    struct negative_cache_entry **link = &cache->buckets[hash_string(filename) & (cache->buckets_count - 1)];
+    while (*link != nullptr && strcmp((*link)->filename, filename) != 0) {
+        link = &(*link)->bucket_next;
+    }
+    return link;
+}
+
+static void on_filesystem_change(void *arg) {
+    struct negative_cache *cache = arg;
+    logger_log_debug(cache->logger, "Filesystem changed, dropping the negative cache.");
+    mtx_lock(&cache->mtx);
+    cache->generation++;
+    while (cache->fifo_head != nullptr) {
+        remove_oldest(cache);
+    }
+    mtx_unlock(&cache->mtx);
+}
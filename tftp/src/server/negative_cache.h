@@ -0,0 +1,60 @@
+#ifndef NEGATIVE_CACHE_H
+#define NEGATIVE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include <logger.h>
+
+#include "fs_watcher.h"
+
+/*
+ * Server-wide cache of requested filenames known not to exist, so that repeated probes are answered without
+ *  touching the filesystem.
+ * Entries expire after a fixed time to live and the whole cache is dropped whenever the filesystem watcher reports
+ *  a change in a directory a missing file was looked up in.
+ */
+
+struct negative_cache_entry {
+    char *filename;
+    uint64_t expiration_ns;
+    struct negative_cache_entry *bucket_next;
+    struct negative_cache_entry *fifo_next;
+};
+
+struct negative_cache {
+    struct logger *logger;
+    struct fs_watcher *watcher;
+    mtx_t mtx;
+    size_t max_entries;
+    uint64_t ttl_ns;
+    size_t entries_count;
+    size_t buckets_count;
+    uint64_t hits;
+    uint64_t generation;    // incremented on every filesystem change
+    struct negative_cache_entry **buckets;
+    struct negative_cache_entry *fifo_head;     // oldest entry, first to expire
+    struct negative_cache_entry *fifo_tail;
+};
+
+// A max_entries of 0 disables the cache, watcher may be nullptr in which case entries are only dropped on expiration.
+bool negative_cache_init(struct negative_cache cache[static 1],
+                         size_t max_entries,
+                         uint32_t ttl_ms,
+                         struct fs_watcher *watcher,
+                         struct logger logger[static 1]);
+
+void negative_cache_destroy(struct negative_cache cache[static 1]);
+
+bool negative_cache_contains(struct negative_cache cache[static 1], const char filename[static 1]);
+
+// Records that filename, relative to root, does not exist.
+void negative_cache_insert(struct negative_cache cache[static 1], const char *root, const char filename[static 1]);
+
+void negative_cache_clear(struct negative_cache cache[static 1]);
+
+// Reports hits since the previous call.
+uint64_t negative_cache_collect_hits(struct negative_cache cache[static 1]);
+
+#endif // NEGATIVE_CACHE_H
@@ -0,0 +1,80 @@
+#include "packet_timestamps.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+
+#include <linux/net_tstamp.h>
+
+static constexpr int enabled_flags = SOF_TIMESTAMPING_TX_SOFTWARE
+                                     | SOF_TIMESTAMPING_RX_SOFTWARE
+                                     | SOF_TIMESTAMPING_SOFTWARE
+                                     | SOF_TIMESTAMPING_OPT_ID
+                                     | SOF_TIMESTAMPING_OPT_TSONLY;   // the error queue gets no copy of the payload
+
+// Error queue messages carry the timestamp and the extended error holding the index of the datagram.
+static constexpr size_t error_control_size = CMSG_SPACE(sizeof(struct scm_timestamping))
+                                             + CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6));
+
+bool packet_timestamps_enable(int sockfd) {
+    return setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &enabled_flags, sizeof enabled_flags) == 0;
+}
+
+bool packet_timestamps_disable(int sockfd) {
+    const int flags = 0;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof flags) == -1) {
+        return false;
+    }
+    struct packet_timestamp timestamps[16];
+    ssize_t count;
+    do {
+        count = packet_timestamps_read_sent(sockfd, timestamps, sizeof timestamps / sizeof *timestamps);
+    } while (count == sizeof timestamps / sizeof *timestamps);
+    return count != -1;
+}
+
+ssize_t packet_timestamps_read_sent(int sockfd, struct packet_timestamp timestamps[], size_t count) {
+    size_t n = 0;
+    while (n < count) {
+        alignas(struct cmsghdr) uint8_t control[error_control_size];
+        struct msghdr msghdr = {
+            .msg_control = control,
+            .msg_controllen = sizeof control,
+        };
+        if (recvmsg(sockfd, &msghdr, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        const struct scm_timestamping *timestamping = nullptr;
+        const struct sock_extended_err *error = nullptr;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                timestamping = (const void *) CMSG_DATA(cmsg);
+            }
+            else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                     || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                error = (const void *) CMSG_DATA(cmsg);
+            }
+        }
+        if (timestamping == nullptr || error == nullptr || error->ee_origin != SO_EE_ORIGIN_TIMESTAMPING) {
+            continue;   // not a timestamp, e.g. an ICMP error
+        }
+        timestamps[n++] = (struct packet_timestamp) {
+            .id = error->ee_data,
+            .time = timestamping->ts[0],
+        };
+    }
+    return (ssize_t) n;
+}
+
+bool packet_timestamps_get_received(struct msghdr msghdr[static 1], struct timespec timestamp[static 1]) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msghdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(msghdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            const struct scm_timestamping *timestamping = (const void *) CMSG_DATA(cmsg);
+            *timestamp = timestamping->ts[0];
+            return timestamp->tv_sec != 0 || timestamp->tv_nsec != 0;
+        }
+    }
+    return false;
+}
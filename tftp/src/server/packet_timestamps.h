@@ -0,0 +1,38 @@
+#ifndef PACKET_TIMESTAMPS_H
+#define PACKET_TIMESTAMPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <linux/errqueue.h>
+
+/*
+ * Software timestamps taken by the kernel when a datagram is handed to the device and when it is received, unlike the
+ *  clock read by the worker they leave out the time spent waiting in the submission and completion queues.
+ * Timestamps are CLOCK_REALTIME. The timestamp of a sent datagram is queued on the error queue of the socket, tagged
+ *  with the index of the datagram among the ones sent since timestamping was enabled.
+ */
+
+// Size of the control buffer needed to receive a datagram along with its timestamp.
+constexpr size_t packet_timestamps_control_size = CMSG_SPACE(sizeof(struct scm_timestamping));
+
+struct packet_timestamp {
+    uint32_t id;            // index of the sent datagram
+    struct timespec time;
+};
+
+bool packet_timestamps_enable(int sockfd);
+
+// Disables timestamping and drops the timestamps still queued, so that the socket can be used by another session.
+bool packet_timestamps_disable(int sockfd);
+
+// Reads up to count timestamps of sent datagrams without blocking, returns the number read or -1 on error.
+ssize_t packet_timestamps_read_sent(int sockfd, struct packet_timestamp timestamps[], size_t count);
+
+// Returns false when the kernel attached no timestamp to the received datagram.
+bool packet_timestamps_get_received(struct msghdr msghdr[static 1], struct timespec timestamp[static 1]);
+
+#endif // PACKET_TIMESTAMPS_H
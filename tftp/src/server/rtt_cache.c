@@ -0,0 +1,165 @@
+#include "rtt_cache.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../utils/hash.h"
+
+static constexpr size_t ways = 4;
+static constexpr int max_read_attempts = 4;
+
+struct entry_snapshot {
+    uint64_t address[2];
+    uint64_t updated_ns;
+    uint32_t smoothed_rtt_us;
+    uint32_t rtt_variation_us;
+};
+
+static bool get_key(const struct sockaddr peer[static 1], uint64_t key[static 2]);
+static struct rtt_cache_entry *get_set(struct rtt_cache cache[static 1], const uint64_t key[static 2]);
+static bool read_entry(struct rtt_cache_entry entry[static 1], struct entry_snapshot snapshot[static 1]);
+static uint32_t to_us(double seconds);
+static uint64_t now_ns(void);
+
+bool rtt_cache_init(struct rtt_cache cache[static 1], size_t max_entries, struct logger logger[static 1]) {
+    *cache = (struct rtt_cache) {
+        .sets_count = 0,
+        .entries = nullptr,
+    };
+    if (max_entries == 0) {
+        return true;
+    }
+    size_t entries_count = ways;
+    while (entries_count < max_entries) {
+        entries_count <<= 1;
+    }
+    cache->entries = calloc(entries_count, sizeof *cache->entries);
+    if (cache->entries == nullptr) {
+        logger_log_error(logger, "Could not allocate memory for the RTT cache. %s", strerror(errno));
+        return false;
+    }
+    cache->sets_count = entries_count / ways;
+    return true;
+}
+
+void rtt_cache_destroy(struct rtt_cache cache[static 1]) {
+    free(cache->entries);
+}
+
+bool rtt_cache_lookup(struct rtt_cache cache[static 1], const struct sockaddr peer[static 1], double smoothed_rtt[static 1], double rtt_variation[static 1]) {
+    uint64_t key[2];
+    if (cache->sets_count == 0 || !get_key(peer, key)) {
+        return false;
+    }
+    const uint64_t now = now_ns();
+    struct rtt_cache_entry *set = get_set(cache, key);
+    for (size_t i = 0; i < ways; i++) {
+        struct entry_snapshot snapshot;
+        if (!read_entry(&set[i], &snapshot)
+            || snapshot.updated_ns == 0
+            || snapshot.address[0] != key[0]
+            || snapshot.address[1] != key[1]) {
+            continue;
+        }
+        if (now - snapshot.updated_ns > rtt_cache_ttl_ns) {
+            return false;
+        }
+        *smoothed_rtt = snapshot.smoothed_rtt_us / 1e6;
+        *rtt_variation = snapshot.rtt_variation_us / 1e6;
+        return true;
+    }
+    return false;
+}
+
+void rtt_cache_update(struct rtt_cache cache[static 1], const struct sockaddr peer[static 1], double smoothed_rtt, double rtt_variation) {
+    uint64_t key[2];
+    if (cache->sets_count == 0 || !get_key(peer, key)) {
+        return;
+    }
+    struct rtt_cache_entry *set = get_set(cache, key);
+    struct rtt_cache_entry *entry = &set[0];
+    uint64_t oldest_ns = UINT64_MAX;
+    for (size_t i = 0; i < ways; i++) {
+        struct entry_snapshot snapshot;
+        if (!read_entry(&set[i], &snapshot)) {
+            continue;
+        }
+        if (snapshot.updated_ns != 0 && snapshot.address[0] == key[0] && snapshot.address[1] == key[1]) {
+            entry = &set[i];
+            break;
+        }
+        if (snapshot.updated_ns < oldest_ns) {
+            entry = &set[i];
+            oldest_ns = snapshot.updated_ns;
+        }
+    }
+    unsigned sequence = atomic_load_explicit(&entry->sequence, memory_order_relaxed);
+    if ((sequence & 1) != 0
+        || !atomic_compare_exchange_strong_explicit(&entry->sequence, &sequence, sequence + 1, memory_order_relaxed, memory_order_relaxed)) {
+        return;     // another worker is writing the entry
+    }
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&entry->address[0], key[0], memory_order_relaxed);
+    atomic_store_explicit(&entry->address[1], key[1], memory_order_relaxed);
+    atomic_store_explicit(&entry->updated_ns, now_ns(), memory_order_relaxed);
+    atomic_store_explicit(&entry->smoothed_rtt_us, to_us(smoothed_rtt), memory_order_relaxed);
+    atomic_store_explicit(&entry->rtt_variation_us, to_us(rtt_variation), memory_order_relaxed);
+    atomic_store_explicit(&entry->sequence, sequence + 2, memory_order_release);
+}
+
+static bool get_key(const struct sockaddr peer[static 1], uint64_t key[static 2]) {
+    struct in6_addr address;
+    switch (peer->sa_family) {
+        case AF_INET6:
+            address = ((const struct sockaddr_in6 *) peer)->sin6_addr;
+            break;
+        case AF_INET:
+            address = (struct in6_addr) {};
+            address.s6_addr[10] = 0xff;
+            address.s6_addr[11] = 0xff;
+            memcpy(&address.s6_addr[12], &((const struct sockaddr_in *) peer)->sin_addr, sizeof(struct in_addr));
+            break;
+        default:
+            return false;
+    }
+    memcpy(key, &address, sizeof address);
+    return true;
+}
+
+static struct rtt_cache_entry *get_set(struct rtt_cache cache[static 1], const uint64_t key[static 2]) {
+    const size_t set_index = hash_bytes(key, 2 * sizeof *key) & (cache->sets_count - 1);
+    return &cache->entries[set_index * ways];
+}
+
+static bool read_entry(struct rtt_cache_entry entry[static 1], struct entry_snapshot snapshot[static 1]) {
+    for (int attempt = 0; attempt < max_read_attempts; attempt++) {
+        const unsigned sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        if ((sequence & 1) != 0) {
+            continue;
+        }
+        snapshot->address[0] = atomic_load_explicit(&entry->address[0], memory_order_relaxed);
+        snapshot->address[1] = atomic_load_explicit(&entry->address[1], memory_order_relaxed);
+        snapshot->updated_ns = atomic_load_explicit(&entry->updated_ns, memory_order_relaxed);
+        snapshot->smoothed_rtt_us = atomic_load_explicit(&entry->smoothed_rtt_us, memory_order_relaxed);
+        snapshot->rtt_variation_us = atomic_load_explicit(&entry->rtt_variation_us, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&entry->sequence, memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t to_us(double seconds) {
+    const double us = seconds * 1e6 + 0.5;
+    return us < UINT32_MAX ? (uint32_t) us : UINT32_MAX;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1'000'000'000ULL + now.tv_nsec;
+}
@@ -0,0 +1,45 @@
+#ifndef RTT_CACHE_H
+#define RTT_CACHE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <logger.h>
+
+/*
+ * Server-wide cache of the round trip time estimates of recent peers, keyed by IP address, in the spirit of the Linux
+ *  TCP metrics cache: sessions seed their adaptive timeout from it and store their estimate when they close.
+ * The cache is a fixed array of 4-way sets, a peer is stored in the set its address hashes to and replaces the least
+ *  recently updated entry of the set. Entries older than rtt_cache_ttl_ns are ignored.
+ * Each entry is guarded by a sequence lock so that workers never block each other: readers retry while an update is
+ *  in progress, an update finding the entry already being written by another worker is dropped.
+ */
+
+constexpr uint64_t rtt_cache_ttl_ns = 600'000'000'000;   // paths change, old estimates are worse than the default RTO
+
+struct rtt_cache_entry {
+    atomic_uint sequence;                   // odd while the entry is being written
+    atomic_uint_least64_t address[2];       // IPv6 address, IPv4 addresses are mapped
+    atomic_uint_least64_t updated_ns;       // CLOCK_MONOTONIC, 0 for an empty entry
+    atomic_uint_least32_t smoothed_rtt_us;
+    atomic_uint_least32_t rtt_variation_us;
+};
+
+struct rtt_cache {
+    size_t sets_count;      // power of two, 0 disables the cache
+    struct rtt_cache_entry *entries;
+};
+
+// A max_entries of 0 disables the cache, the number of entries is rounded up to a power of two.
+bool rtt_cache_init(struct rtt_cache cache[static 1], size_t max_entries, struct logger logger[static 1]);
+
+void rtt_cache_destroy(struct rtt_cache cache[static 1]);
+
+// Gets the estimate, in seconds, stored for the address of peer, returns false if there is none.
+bool rtt_cache_lookup(struct rtt_cache cache[static 1], const struct sockaddr peer[static 1], double smoothed_rtt[static 1], double rtt_variation[static 1]);
+
+void rtt_cache_update(struct rtt_cache cache[static 1], const struct sockaddr peer[static 1], double smoothed_rtt, double rtt_variation);
+
+#endif // RTT_CACHE_H
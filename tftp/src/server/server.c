@@ -1,5 +1,6 @@
 #include <buracchi/tftp/server.h>
 
+#include <ctype.h>
 #include <errno.h>
 #include <netinet/in.h>
 #include <string.h>
@@ -11,7 +12,16 @@
 #include <logger.h>
 #include <stdlib.h>
 
+#include "content_cache.h"
+#include "digest_cache.h"
+#include "file_cache.h"
+#include "fs_watcher.h"
+#include "listing_cache.h"
+#include "negative_cache.h"
+#include "rtt_cache.h"
 #include "session.h"
+#include "session_file.h"
+#include "window_budget.h"
 #include "worker_pool.h"
 #include "../utils/time.h"
 #include "../utils/utils.h"
@@ -20,22 +30,112 @@ static bool parse_request_metadata(struct tftp_peer_message request_args[static
                                    struct msghdr msghdr[static 1],
                                    struct logger logger[static 1]);
 
+static void preload_content_cache(struct tftp_server server[static 1], const char manifest_path[static 1]);
+
+static bool collect_cache_counters(struct tftp_server server[static 1]);
+
 bool tftp_server_init(struct tftp_server server[static 1], struct tftp_server_arguments args, struct logger logger[static 1]) {
     *server = (struct tftp_server) {
         .logger = logger,
         .root = args.root,
         .retries = args.retries,
         .timeout = args.timeout_s,
+        .fast_retransmit_threshold = args.fast_retransmit_threshold,
+        .min_fec_group_size = args.min_fec_group_size,
+        .congestion_control = args.congestion_control,
         .is_adaptive_timeout_enabled = args.is_adaptive_timeout_enabled,
+        .is_pacing_enabled = args.is_pacing_enabled,
+        .is_compression_enabled = args.is_compression_enabled,
         .is_write_request_enabled = args.is_write_request_enabled,
         .is_list_request_enabled = args.is_list_request_enabled,
         .worker_pool = malloc(sizeof *server->worker_pool),
+        .file_cache = malloc(sizeof *server->file_cache),
+        .content_cache = malloc(sizeof *server->content_cache),
+        .fs_watcher = malloc(sizeof *server->fs_watcher),
+        .negative_cache = malloc(sizeof *server->negative_cache),
+        .listing_cache = malloc(sizeof *server->listing_cache),
+        .window_budget = malloc(sizeof *server->window_budget),
+        .rtt_cache = malloc(sizeof *server->rtt_cache),
+        .digest_cache = malloc(sizeof *server->digest_cache),
         .session_stats_callback = args.session_stats_callback,
     };
     if (server->worker_pool == nullptr) {
         logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the worker pool. %s", strerror_rbs(errno));
         return false;
     }
+    if (server->file_cache == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the file cache. %s", strerror_rbs(errno));
+        return false;
+    }
+    if (!file_cache_init(server->file_cache, args.max_cached_file_descriptors, logger)) {
+        logger_log_error(logger, "Failed to initialize the file cache.");
+        return false;
+    }
+    if (server->content_cache == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the content cache. %s", strerror_rbs(errno));
+        return false;
+    }
+    if (!content_cache_init(server->content_cache,
+                            args.content_cache_max_bytes,
+                            args.content_cache_max_file_size,
+                            args.is_content_cache_huge_pages_enabled,
+                            args.is_content_cache_mlock_enabled,
+                            logger)) {
+        logger_log_error(logger, "Failed to initialize the content cache.");
+        return false;
+    }
+    if (server->fs_watcher == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the filesystem watcher. %s", strerror_rbs(errno));
+        return false;
+    }
+    if (!fs_watcher_init(server->fs_watcher, logger)) {
+        logger_log_warn(logger, "Filesystem changes will not be tracked, missing files will only expire over time and directory listings will not be cached.");
+        free(server->fs_watcher);
+        server->fs_watcher = nullptr;
+    }
+    if (server->negative_cache == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the negative cache. %s", strerror_rbs(errno));
+        return false;
+    }
+    if (!negative_cache_init(server->negative_cache, args.negative_cache_max_entries, args.negative_cache_ttl_ms, server->fs_watcher, logger)) {
+        logger_log_error(logger, "Failed to initialize the negative cache.");
+        return false;
+    }
+    if (server->listing_cache == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the listing cache. %s", strerror_rbs(errno));
+        return false;
+    }
+    if (!listing_cache_init(server->listing_cache, args.listing_cache_max_entries, server->fs_watcher, logger)) {
+        logger_log_error(logger, "Failed to initialize the listing cache.");
+        return false;
+    }
+    if (server->window_budget == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the window budget. %s", strerror_rbs(errno));
+        return false;
+    }
+    window_budget_init(server->window_budget, args.window_memory_max_bytes);
+    if (server->rtt_cache == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the RTT cache. %s", strerror_rbs(errno));
+        return false;
+    }
+    if (!rtt_cache_init(server->rtt_cache, args.rtt_cache_max_entries, logger)) {
+        logger_log_error(logger, "Failed to initialize the RTT cache.");
+        return false;
+    }
+    if (server->digest_cache == nullptr) {
+        logger_log_error(logger, "Failed to initialize server. Could not allocate memory for the digest cache. %s", strerror_rbs(errno));
+        return false;
+    }
+    if (!digest_cache_init(server->digest_cache, args.digest_cache_max_entries, logger)) {
+        logger_log_error(logger, "Failed to initialize the digest cache.");
+        return false;
+    }
+    if (args.content_cache_manifest != nullptr) {
+        preload_content_cache(server, args.content_cache_manifest);
+    }
+    if (server->fs_watcher != nullptr && !fs_watcher_start(server->fs_watcher)) {
+        return false;
+    }
     if (!tftp_server_stats_init(&server->stats, args.stats_interval_seconds, args.server_stats_callback, logger)) {
         logger_log_error(logger, "Failed to initialize server statistics. %s", strerror_rbs(errno));
         return false;
@@ -46,6 +146,13 @@ bool tftp_server_init(struct tftp_server server[static 1], struct tftp_server_ar
     if (!worker_pool_init(server->worker_pool,
                                       args.workers,
                                       args.max_worker_sessions,
+                                      args.slab_max_cached_bytes,
+                                      args.is_slab_huge_pages_enabled,
+                                      server->listener.addrinfo.ai_addr,
+                                      server->listener.addrinfo.ai_addrlen,
+                                      args.socket_pool_size,
+                                      args.shared_socket_port,
+                                      args.shared_sockets_per_worker,
                                       server->logger)) {
         logger_log_error(server->logger, "Failed to initialize thread pool. %s", strerror_rbs(errno));
         return false;
@@ -56,11 +163,22 @@ bool tftp_server_init(struct tftp_server server[static 1], struct tftp_server_ar
 bool tftp_server_start(struct tftp_server server[static 1]) {
     struct tftp_server_info info = {
         .server_stats = &server->stats,
-        .server_addrinfo = &server->listener.addrinfo,
+        .file_cache = server->file_cache,
+        .content_cache = server->content_cache,
+        .negative_cache = server->negative_cache,
+        .listing_cache = server->listing_cache,
+        .window_budget = server->window_budget,
+        .rtt_cache = server->rtt_cache,
+        .digest_cache = server->digest_cache,
         .timeout = server->timeout,
         .retries = server->retries,
+        .fast_retransmit_threshold = server->fast_retransmit_threshold,
+        .min_fec_group_size = server->min_fec_group_size,
+        .congestion_control = server->congestion_control,
         .root = server->root,
         .is_adaptive_timeout_enabled = server->is_adaptive_timeout_enabled,
+        .is_pacing_enabled = server->is_pacing_enabled,
+        .is_compression_enabled = server->is_compression_enabled,
         .is_write_request_enabled = server->is_write_request_enabled,
         .is_list_request_enabled = server->is_list_request_enabled,
         .session_stats_callback = server->session_stats_callback,
@@ -76,18 +194,21 @@ bool tftp_server_start(struct tftp_server server[static 1]) {
     
     while (!server->should_stop) {
         struct worker_job *job = worker_pool_get_job(server->worker_pool);
-        tftp_session_init(&job->session, job->job_id, &info, job->dispatcher, server->logger);
-        job->session.request_args = (struct tftp_peer_message) {
-            .peer_addrlen = sizeof job->session.request_args.peer_addr,
+        if (job == nullptr) {
+            return false;
+        }
+        tftp_session_init(job->session, job->session_cold, job->job_id, &info, job->dispatcher, job->allocator, job->socket_pool, job->demux, job->timer_wheel, server->logger);
+        job->session_cold->request_args = (struct tftp_peer_message) {
+            .peer_addrlen = sizeof job->session_cold->request_args.peer_addr,
         };
-        ssize_t *bytes_recvd = &job->session.request_args.bytes_recvd;
+        ssize_t *bytes_recvd = &job->session_cold->request_args.bytes_recvd;
         memset(server->listener.msghdr.msg_control, 0, msg_control_size);
         server->listener.msghdr.msg_controllen = msg_control_size;
         server->listener.msghdr.msg_flags = 0;
-        server->listener.msghdr.msg_name = &job->session.request_args.peer_addr;
-        server->listener.msghdr.msg_namelen = job->session.request_args.peer_addrlen;
-        server->listener.msghdr.msg_iov[0].iov_base = job->session.request_args.buffer;
-        server->listener.msghdr.msg_iov[0].iov_len = sizeof job->session.request_args.buffer;
+        server->listener.msghdr.msg_name = &job->session_cold->request_args.peer_addr;
+        server->listener.msghdr.msg_namelen = job->session_cold->request_args.peer_addrlen;
+        server->listener.msghdr.msg_iov[0].iov_base = job->session_cold->request_args.buffer;
+        server->listener.msghdr.msg_iov[0].iov_len = sizeof job->session_cold->request_args.buffer;
         
         bool is_timeout = false;
         if (metrics_enabled) {
@@ -117,7 +238,7 @@ bool tftp_server_start(struct tftp_server server[static 1]) {
         
         switch (result) {
             case SUCCESS:
-                if (parse_request_metadata(&job->session.request_args, &server->listener.msghdr, server->logger)) {
+                if (parse_request_metadata(&job->session_cold->request_args, &server->listener.msghdr, server->logger)) {
                     int mtx_ret;
                     while ((mtx_ret = mtx_lock(&server->stats.mtx)) == thrd_error && errno == EINTR);
                     if (mtx_ret == thrd_error) {
@@ -125,12 +246,9 @@ bool tftp_server_start(struct tftp_server server[static 1]) {
                         server->should_stop = true;
                         break;
                     }
-                    if (worker_pool_start_job(server->worker_pool, job)) {
-                        server->stats.counters.sessions_count++;
-                    }
-                    else {
-                        logger_log_error(server->logger, "Failed to start session: %s", strerror_rbs(errno));
-                    }
+                    worker_pool_start_job(server->worker_pool, job);
+                    job = nullptr;
+                    server->stats.counters.sessions_count++;
                     while ((mtx_ret = mtx_unlock(&server->stats.mtx)) == thrd_error && errno == EINTR);
                     if (mtx_ret == thrd_error) {
                         logger_log_error(server->logger, "Failed to unlock server stats mutex: %s", strerror_rbs(errno));
@@ -139,6 +257,10 @@ bool tftp_server_start(struct tftp_server server[static 1]) {
                 }
                 break;
             case TIMEOUT:
+                if (!collect_cache_counters(server)) {
+                    server->should_stop = true;
+                    break;
+                }
                 logger_log_debug(server->logger, "Running the metrics callback.");
                 server->stats.metrics_callback(&server->stats);
                 clock_gettime(CLOCK_MONOTONIC, &start_time);
@@ -150,6 +272,9 @@ bool tftp_server_start(struct tftp_server server[static 1]) {
                 logger_log_error(server->logger, "Failed to receive message. %s", strerror_rbs(errno));
                 return false;
         }
+        if (job != nullptr) {
+            worker_pool_put_job(server->worker_pool, job);
+        }
     }
     logger_log_info(server->logger, "Server stopped listening for requests.");
     return true;
@@ -159,6 +284,23 @@ void tftp_server_destroy(struct tftp_server server[static 1]) {
     logger_log_info(server->logger, "Awaiting for active sessions termination...");
     worker_pool_destroy(server->worker_pool);
     free(server->worker_pool);
+    if (server->fs_watcher != nullptr) {
+        fs_watcher_destroy(server->fs_watcher);
+        free(server->fs_watcher);
+    }
+    listing_cache_destroy(server->listing_cache);
+    free(server->listing_cache);
+    free(server->window_budget);
+    digest_cache_destroy(server->digest_cache);
+    free(server->digest_cache);
+    rtt_cache_destroy(server->rtt_cache);
+    free(server->rtt_cache);
+    negative_cache_destroy(server->negative_cache);
+    free(server->negative_cache);
+    content_cache_destroy(server->content_cache);
+    free(server->content_cache);
+    file_cache_destroy(server->file_cache);
+    free(server->file_cache);
     tftp_server_listener_destroy(&server->listener);
     tftp_server_stats_destroy(&server->stats);
     logger_log_info(server->logger, "Server shut down.");
@@ -194,3 +336,73 @@ static bool parse_request_metadata(struct tftp_peer_message request_args[static
     }
     return true;
 }
+
+static void preload_content_cache(struct tftp_server server[static 1], const char manifest_path[static 1]) {
+    FILE *manifest = fopen(manifest_path, "r");
+    if (manifest == nullptr) {
+        logger_log_warn(server->logger, "Could not open content cache manifest %s. %s", manifest_path, strerror_rbs(errno));
+        return;
+    }
+    size_t files_count = 0;
+    char *line = nullptr;
+    size_t line_size = 0;
+    ssize_t line_length;
+    while ((line_length = getline(&line, &line_size, manifest)) != -1) {
+        while (line_length > 0 && isspace((unsigned char) line[line_length - 1])) {
+            line[--line_length] = '\0';
+        }
+        if (line_length == 0 || line[0] == '#') {
+            continue;
+        }
+        struct session_file file;
+        struct tftp_session_stats_error error = {};
+        if (!session_file_init(&file, line, server->root, SESSION_FILE_MODE_READ, TFTP_READ_TYPE_FILE, server->file_cache, server->content_cache, server->listing_cache, &error)) {
+            logger_log_warn(server->logger, "Could not preload %s. %s", line, error.error_message);
+            continue;
+        }
+        if (file.content_entry != nullptr) {
+            files_count++;
+        }
+        else {
+            logger_log_warn(server->logger, "Could not preload %s. The file does not fit in the content cache.", line);
+        }
+        session_file_destroy(&file, server->file_cache, server->content_cache, server->listing_cache);
+    }
+    free(line);
+    fclose(manifest);
+    // the first statistics report only the requests of the clients
+    content_cache_reset_counters(server->content_cache);
+    logger_log_info(server->logger, "Preloaded %zu files in the content cache.", files_count);
+}
+
+static bool collect_cache_counters(struct tftp_server server[static 1]) {
+    uint64_t hits;
+    uint64_t misses;
+    content_cache_collect_counters(server->content_cache, &hits, &misses);
+    uint64_t negative_hits = negative_cache_collect_hits(server->negative_cache);
+    uint64_t window_clamps = window_budget_collect_clamps(server->window_budget);
+    struct slab_allocator_stats slab_stats;
+    worker_pool_collect_slab_stats(server->worker_pool, &slab_stats);
+    uint64_t socket_pool_misses = worker_pool_collect_socket_pool_misses(server->worker_pool);
+    int mtx_ret;
+    while ((mtx_ret = mtx_lock(&server->stats.mtx)) == thrd_error && errno == EINTR);
+    if (mtx_ret == thrd_error) {
+        logger_log_error(server->logger, "Failed to lock server stats mutex: %s", strerror_rbs(errno));
+        return false;
+    }
+    server->stats.counters.content_cache_hits += hits;
+    server->stats.counters.content_cache_misses += misses;
+    server->stats.counters.negative_cache_hits += negative_hits;
+    server->stats.counters.window_budget_clamps += window_clamps;
+    server->stats.counters.slab_allocations += slab_stats.allocations;
+    server->stats.counters.slab_reuses += slab_stats.reuses;
+    server->stats.counters.slab_bytes_in_use = slab_stats.bytes_in_use;
+    server->stats.counters.slab_bytes_cached = slab_stats.bytes_cached;
+    server->stats.counters.socket_pool_misses += socket_pool_misses;
+    while ((mtx_ret = mtx_unlock(&server->stats.mtx)) == thrd_error && errno == EINTR);
+    if (mtx_ret == thrd_error) {
+        logger_log_error(server->logger, "Failed to unlock server stats mutex: %s", strerror_rbs(errno));
+        return false;
+    }
+    return true;
+}
@@ -5,11 +5,13 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <logger.h>
 
 #include "dispatcher.h"
 #include "session_file.h"
+#include "../fec.h"
 #include "../utils/inet.h"
 
 enum event : uint32_t {
@@ -18,9 +20,14 @@ enum event : uint32_t {
     EVENT_PACKET_RECEIVED,
     EVENT_PACKET_RECEIVED_REMOVED,
     EVENT_TIMEOUT,
-    EVENT_TIMEOUT_REMOVED,
+    EVENT_STRAY_PACKET_RECEIVED,
+    EVENT_STRAY_PACKET_RECEIVED_REMOVED,
+    EVENT_PACING,
+    EVENT_PACING_REMOVED,
 };
 
+constexpr uint64_t pacing_min_interval_ns = 10'000;    // shorter intervals cost more in timer completions than bursts do
+
 static inline struct __kernel_timespec timespec_to_kernel_timespec(struct timespec ts) {
     return (struct __kernel_timespec) {.tv_sec = ts.tv_sec, .tv_nsec = ts.tv_nsec};
 }
@@ -30,25 +37,99 @@ struct tftp_data_packet_info {
     uint16_t packet_size;
 };
 
+/*
+ * The session socket is connected, an ICMP port unreachable received for a previous packet makes the next send fail.
+ * The client is gone, the session is closed but the packet is reported as sent so that the failure is not fatal.
+ */
+static ssize_t check_client_reachable(struct tftp_session session[static 1], ssize_t ret, size_t packet_size) {
+    if (ret == -1 && errno == ECONNREFUSED) {
+        logger_log_warn(session->logger, "Client %s:%d is no longer reachable.", session->connection.client_address.str, session->connection.client_address.port);
+        session->should_close = true;
+        return (ssize_t) packet_size;
+    }
+    return ret;
+}
+
+static ssize_t send_packet(struct tftp_session session[static 1], const void *packet, size_t packet_size) {
+    if (session->connection.is_shared) {
+        auto client_address = &session->connection.client_address;
+        return sendto(session->connection.sockfd, packet, packet_size, 0, client_address->sockaddr, client_address->addrlen);
+    }
+    const ssize_t ret = send(session->connection.sockfd, packet, packet_size, 0);
+    if (ret != -1) {
+        session->connection.next_timestamp_id++;
+    }
+    return check_client_reachable(session, ret, packet_size);
+}
+
+static ssize_t send_data_packet(struct tftp_session session[static 1], const struct tftp_data_packet packet[static 1], size_t packet_size) {
+    const uint16_t packet_index = ((uint16_t) (ntohs(packet->block_number) - 1)) % session->window_size;
+    if (session->zero_packets == nullptr || !session->zero_packets[packet_index]) {
+        return send_packet(session, packet, packet_size);
+    }
+    static const uint8_t zero_payload[tftp_max_blksize] = {};
+    struct iovec iovec[] = {
+        {.iov_base = (void *) packet, .iov_len = sizeof *packet},
+        {.iov_base = (void *) zero_payload, .iov_len = packet_size - sizeof *packet},
+    };
+    const struct msghdr msghdr = {
+        .msg_name = session->connection.is_shared ? session->connection.client_address.sockaddr : nullptr,
+        .msg_namelen = session->connection.is_shared ? session->connection.client_address.addrlen : 0,
+        .msg_iov = iovec,
+        .msg_iovlen = sizeof iovec / sizeof *iovec,
+    };
+    const ssize_t ret = sendmsg(session->connection.sockfd, &msghdr, 0);
+    if (ret != -1) {
+        session->connection.next_timestamp_id++;
+    }
+    return check_client_reachable(session, ret, packet_size);
+}
+
 static struct tftp_data_packet_info get_data_packet_info(struct tftp_session session[static 1], uint16_t i);
 
 static bool fetch_data_octet_async(struct tftp_session session[static 1]);
+static bool fetch_data_memory(struct tftp_session session[static 1]);
+static bool fetch_data_hole(struct tftp_session session[static 1]);
 static bool recv_async(struct tftp_session session[static 1]);
+static bool stray_recv_async(struct tftp_session session[static 1]);
+static bool stray_recv_async_cancel(struct tftp_session session[static 1]);
+static bool on_stray_packet_received(struct tftp_session session[static 1], struct dispatcher_event event[static 1]);
 static bool recv_async_cancel(struct tftp_session session[static 1]);
-static bool submit_timeout(struct tftp_session session[static 1]);
-static bool submit_cancel_timeout(struct tftp_session session[static 1]);
+static void start_timeout(struct tftp_session session[static 1]);
+static void stop_timeout(struct tftp_session session[static 1]);
+static bool pace(struct tftp_session session[static 1], bool is_held[static 1]);
+static bool pacing_timer_cancel(struct tftp_session session[static 1]);
 
 static bool start(struct tftp_session session[static 1]);
 static void close_session(struct tftp_session session[static 1]);
 static bool on_data_available(struct tftp_session session[static 1], struct dispatcher_event event[static 1]);
+static bool send_next_data_packet(struct tftp_session session[static 1]);
+static bool add_to_fec_group(struct tftp_session session[static 1], const struct tftp_data_packet *packet, size_t payload_size);
+static ssize_t send_data_packet(struct tftp_session session[static 1], const struct tftp_data_packet packet[static 1], size_t packet_size);
 static bool on_timeout(struct tftp_session session[static 1]);
+static bool on_duplicate_ack(struct tftp_session session[static 1]);
+static bool retransmit_window(struct tftp_session session[static 1]);
+static struct session_rtt_sample *get_rtt_sample(struct tftp_session session[static 1], uint16_t block_number);
+static bool *get_sacked_packet(struct tftp_session session[static 1], uint16_t block_number);
+static void record_selective_acks(struct tftp_session session[static 1], uint16_t block_number, size_t ack_packet_size);
+static void record_send_time(struct tftp_session session[static 1], struct session_rtt_sample sample[static 1]);
+static void take_rtt_sample(struct tftp_session session[static 1], struct session_rtt_sample sample[static 1], uint16_t block_number);
+static void read_sent_timestamps(struct tftp_session session[static 1]);
+static struct session_rtt_sample *find_rtt_sample(struct tftp_session session[static 1], uint32_t timestamp_id);
 static bool on_packet_received(struct tftp_session session[static 1], struct dispatcher_event event[static 1]);
+static bool is_next_file_request(struct tftp_session session[static 1], size_t request_size);
+static bool start_next_file(struct tftp_session session[static 1], size_t request_size);
 
 static bool send_oack(struct tftp_session session[static 1]);
 static bool set_address_family(struct inet_address address[static 1]);
 static bool is_request_valid(struct tftp_session session[static 1]);
 static bool oack_packet_init(struct tftp_session session[static 1]);
 static bool error_packet_init(struct tftp_session session[static 1]);
+static void seed_rtt(struct tftp_session session[static 1]);
+static bool get_file_digest(struct tftp_session session[static 1], uint64_t digest[static 1]);
+static void reserve_window_memory(struct tftp_session session[static 1]);
+static bool send_error(struct tftp_session session[static 1]);
+static bool send_error_packet(struct tftp_session session[static 1], const struct tftp_error_packet packet[static 1], size_t packet_size);
 static bool fetch_data_netascii_async(struct tftp_session session[static 1]);
 static bool create_data_packets(struct tftp_session session[static 1], size_t bytes_read);
 static bool report_client_error(struct tftp_session session[static 1], size_t error_packet_size);
@@ -65,31 +146,79 @@ static inline size_t get_cumulative_ackd_payload_size(struct tftp_session sessio
            (block_number == session->last_packet ? session->last_block_size : session->block_size);
 }
 
+static inline bool should_fetch_data(struct tftp_session session[static 1]) {
+    return session->request_type == SESSION_READ_REQUEST
+           && !session->is_fetching_data
+           && !session->should_close
+           && (!session->cold->options.valid_options_required || session->cold->options.options_acknowledged)
+           && session->last_packet == -1
+           && is_in_range(session->next_data_packet_to_send,
+                          session->window_begin,
+                          session->window_begin + congestion_control_window(&session->congestion_control) - 1);
+}
+
+static inline uint64_t get_monotonic_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1'000'000'000ULL + now.tv_nsec;
+}
+
+// The window is spread over the smoothed round trip time, there is no pacing until the first sample.
+static inline uint64_t get_pacing_interval_ns(struct tftp_session session[static 1]) {
+    const double srtt = adaptive_timeout_get_smoothed_rtt(&session->adaptive_timeout);
+    const uint64_t interval = (uint64_t) (srtt * 1e9) / congestion_control_window(&session->congestion_control);
+    return interval < pacing_min_interval_ns ? 0 : interval;
+}
+
+static inline size_t get_next_hole_size(struct tftp_session session[static 1]) {
+    if (session->zero_packets == nullptr || session->incomplete_read || session->read_offset >= session->read_end) {
+        return 0;
+    }
+    const off_t remaining = session->read_end - session->read_offset;
+    const size_t size = remaining < session->block_size ? remaining : session->block_size;
+    return session_file_is_hole(&session->file, session->read_offset, size) ? size : 0;
+}
+
 static inline enum event get_event(struct dispatcher_event event[static 1]) {
     return (enum event) (event->id & 0xFFFF);
 }
 
 void tftp_session_init(struct tftp_session session[static 1],
+                       struct tftp_session_cold cold[static 1],
                        uint16_t session_id,
                        struct tftp_server_info server_info[static 1],
                        struct dispatcher dispatcher[static 1],
+                       struct slab_allocator allocator[static 1],
+                       struct socket_pool socket_pool[static 1],
+                       struct session_demux *demux,
+                       struct timer_wheel timer_wheel[static 1],
                        struct logger logger[static 1]) {
     *session = (struct tftp_session) {
         .server_info = server_info,
+        .cold = cold,
         .dispatcher = dispatcher,
+        .allocator = allocator,
         .logger = logger,
         .connection = { .sockfd = -1, },
+        .file = { .descriptor = -1, },
         .event_start = {.id = ((uint64_t) session_id << 48) | EVENT_START},
-        .event_timeout = {.event = {.id = ((uint64_t) session_id << 48) | EVENT_TIMEOUT}},
-        .event_cancel_timeout = {.id = ((uint64_t) session_id << 48) | EVENT_TIMEOUT_REMOVED},
+        .timer_wheel = timer_wheel,
+        .timeout_timer = {.id = ((uint64_t) session_id << 48) | EVENT_TIMEOUT},
         .event_packet_received = {.id = ((uint64_t) session_id << 48) | EVENT_PACKET_RECEIVED},
         .event_cancel_packet_received = {.id = ((uint64_t) session_id << 48) | EVENT_PACKET_RECEIVED_REMOVED},
         .event_next_block = {.id = ((uint64_t) session_id << 48) | EVENT_DATA_AVAILABLE},
+        .event_stray_packet_received = {.id = ((uint64_t) session_id << 48) | EVENT_STRAY_PACKET_RECEIVED},
+        .event_cancel_stray_packet_received = {.id = ((uint64_t) session_id << 48) | EVENT_STRAY_PACKET_RECEIVED_REMOVED},
+        .event_pacing = {.event = {.id = ((uint64_t) session_id << 48) | EVENT_PACING}},
+        .event_cancel_pacing = {.id = ((uint64_t) session_id << 48) | EVENT_PACING_REMOVED},
         .oack_packet = nullptr,
         .error_packet = nullptr,
         .data_packets = nullptr,
+        .rtt_samples = nullptr,
+        .sacked_packets = nullptr,
+        .fec_packet = nullptr,
         .retries = server_info->retries,
-        .timeout = server_info->timeout,
+        .timeout_us = server_info->timeout * 1'000'000U,
         .block_size = tftp_default_blksize,
         .window_size = 1,
         .netascii_buffer = -1,
@@ -98,6 +227,26 @@ void tftp_session_init(struct tftp_session session[static 1],
         .next_data_packet_to_send = 1,
         .expected_sequence_number = 1,
     };
+    // request_args are filled by the listener
+    cold->filename = nullptr;
+    cold->window_memory = 0;
+    cold->socket_pool = socket_pool;
+    cold->demux = demux;
+    cold->session_id = session_id;
+    cold->options = (struct session_options) {};
+    cold->stats = (struct tftp_session_stats) {};
+}
+
+enum tftp_session_state tftp_session_handle_packet(struct tftp_session session[static 1], const void *packet, size_t packet_size) {
+    if (!session->connection.is_recv_armed) {
+        return TFTP_SESSION_STATE_IDLE;     // the session is closing
+    }
+    session->connection.is_recv_armed = false;
+    const size_t size = packet_size < session->connection.recv_buffer_size ? packet_size : session->connection.recv_buffer_size;
+    memcpy(session->connection.recv_buffer, packet, size);
+    session->event_packet_received.is_success = true;
+    session->event_packet_received.result = (int32_t) size;
+    return tftp_session_handle_event(session, &session->event_packet_received);
 }
 
 enum tftp_session_state tftp_session_handle_event(struct tftp_session session[static 1], struct dispatcher_event event[static 1]) {
@@ -110,7 +259,7 @@ enum tftp_session_state tftp_session_handle_event(struct tftp_session session[st
             if (session->should_close) {
                 break;
             }
-            if (session->options.valid_options_required && !session->options.options_acknowledged) {
+            if (session->cold->options.valid_options_required && !session->cold->options.options_acknowledged) {
                 if (!send_oack(session)) {
                     return TFTP_SESSION_STATE_ERROR;
                 }
@@ -120,34 +269,24 @@ enum tftp_session_state tftp_session_handle_event(struct tftp_session session[st
                     .opcode = htons(TFTP_OPCODE_ACK),
                     .block_number = 0,
                 };
-                if (!sendto(session->connection.sockfd, &ack_packet, sizeof ack_packet, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen)) {
+                if (!send_packet(session, &ack_packet, sizeof ack_packet)) {
                     return TFTP_SESSION_STATE_ERROR;
                 }
                 logger_log_trace(session->logger, "Sent ACK <block=0> to %s:%d", session->connection.client_address.str, session->connection.client_address.port);
             }
-            if (!recv_async(session)) {
+            if (!recv_async(session) || (!session->connection.is_shared && !stray_recv_async(session))) {
                 return TFTP_SESSION_STATE_ERROR;
             }
             break;
         case EVENT_TIMEOUT:
-            session->pending_jobs--;
-            if (!event->is_success && (event->error_number == ENOENT || event->error_number == ECANCELED)) {
-                break;
-            }
-            if (session->should_close || !session->is_timer_active) {
+            // expired on the timer wheel of the worker, it holds no pending job
+            if (session->should_close) {
                 break;
             }
             if (!on_timeout(session)) {
                 return TFTP_SESSION_STATE_ERROR;
             }
             break;
-        case EVENT_TIMEOUT_REMOVED:
-            session->pending_jobs--;
-            if (!event->is_success && event->error_number != 0 && event->error_number != ENOENT && event->error_number != EALREADY) {
-                logger_log_error(session->logger, "Error while removing timeout: %s", strerror(event->error_number));
-                return TFTP_SESSION_STATE_ERROR;
-            }
-            break;
         case EVENT_PACKET_RECEIVED:
             session->pending_jobs--;
             if (session->should_close || (!event->is_success && event->error_number == ECANCELED)) {
@@ -162,7 +301,7 @@ enum tftp_session_state tftp_session_handle_event(struct tftp_session session[st
             if (!recv_async(session)) {
                 return TFTP_SESSION_STATE_ERROR;
             }
-            if (!session->options.options_acknowledged && session->options.valid_options_required) {
+            if (!session->cold->options.options_acknowledged && session->cold->options.valid_options_required) {
                 break;
             }
             break;
@@ -173,6 +312,34 @@ enum tftp_session_state tftp_session_handle_event(struct tftp_session session[st
                 return TFTP_SESSION_STATE_ERROR;
             }
             break;
+        case EVENT_STRAY_PACKET_RECEIVED:
+            session->pending_jobs--;
+            session->is_stray_recv_active = false;
+            if (session->should_close || (!event->is_success && event->error_number == ECANCELED)) {
+                break;
+            }
+            if (!on_stray_packet_received(session, event) || !stray_recv_async(session)) {
+                return TFTP_SESSION_STATE_ERROR;
+            }
+            break;
+        case EVENT_STRAY_PACKET_RECEIVED_REMOVED:
+            session->pending_jobs--;
+            if (!event->is_success && event->error_number != 0 && event->error_number != ENOENT && event->error_number != EALREADY) {
+                logger_log_error(session->logger, "Error while removing stray packet received event: %s", strerror(event->error_number));
+                return TFTP_SESSION_STATE_ERROR;
+            }
+            break;
+        case EVENT_PACING:
+            session->pending_jobs--;
+            session->is_pacing_timer_active = false;
+            break;
+        case EVENT_PACING_REMOVED:
+            session->pending_jobs--;
+            if (!event->is_success && event->error_number != 0 && event->error_number != ENOENT && event->error_number != EALREADY) {
+                logger_log_error(session->logger, "Error while removing pacing timeout: %s", strerror(event->error_number));
+                return TFTP_SESSION_STATE_ERROR;
+            }
+            break;
         case EVENT_DATA_AVAILABLE:
             session->pending_jobs--;
             session->is_fetching_data = false;
@@ -187,29 +354,56 @@ enum tftp_session_state tftp_session_handle_event(struct tftp_session session[st
             logger_log_error(session->logger, "Unknown event id: %lu", e);
             return TFTP_SESSION_STATE_ERROR;
     }
-    bool should_fetch_data = session->request_type == SESSION_READ_REQUEST
-                             && !session->is_fetching_data
-                             && !session->should_close
-                             && (!session->options.valid_options_required || session->options.options_acknowledged)
-                             && session->last_packet == -1
-                             && is_in_range(session->next_data_packet_to_send,
-                                            session->window_begin,
-                                            session->window_begin + session->window_size - 1);
-    if (should_fetch_data) {
+    while (should_fetch_data(session)) {
+        bool is_held;
+        if (!pace(session, &is_held)) {
+            return TFTP_SESSION_STATE_ERROR;
+        }
+        if (is_held) {
+            break;
+        }
+        if (session->mode == TFTP_MODE_OCTET && session->file.content_entry != nullptr) {
+            // served from memory, no need to wait for the data to be available
+            if (!fetch_data_memory(session) || !send_next_data_packet(session)) {
+                return TFTP_SESSION_STATE_ERROR;
+            }
+            continue;
+        }
+        if (session->mode == TFTP_MODE_OCTET && get_next_hole_size(session) != 0) {
+            if (!fetch_data_hole(session) || !send_next_data_packet(session)) {
+                return TFTP_SESSION_STATE_ERROR;
+            }
+            continue;
+        }
         session->is_fetching_data = true;
         auto fetch_data_async = session->mode == TFTP_MODE_OCTET ? fetch_data_octet_async : fetch_data_netascii_async;
         if (!fetch_data_async(session)) {
             return TFTP_SESSION_STATE_ERROR;
         }
+        break;
+    }
+    if (session->should_close && session->is_stray_recv_active && !stray_recv_async_cancel(session)) {
+        return TFTP_SESSION_STATE_ERROR;
+    }
+    if (session->should_close && session->is_pacing_timer_active && !pacing_timer_cancel(session)) {
+        return TFTP_SESSION_STATE_ERROR;
+    }
+    if (session->should_close && session->connection.is_recv_armed && !recv_async_cancel(session)) {
+        return TFTP_SESSION_STATE_ERROR;
     }
     if (session->should_close) {
         logger_log_trace(session->logger, "Waiting for %d pending jobs to finish.", session->pending_jobs);
     }
     if (session->should_close && session->pending_jobs == 0) {
         logger_log_debug(session->logger, "Closing session.");
-        session->stats.retransmits = session->total_retransmissions;
-        if (session->stats.callback != nullptr) {
-            session->stats.callback(&session->stats);
+        session->cold->stats.packets_sent = session->packets_sent;
+        session->cold->stats.packets_acked = session->packets_acked;
+        session->cold->stats.bytes_sent = session->bytes_sent;
+        session->cold->stats.retransmits = session->total_retransmissions;
+        session->cold->stats.fast_retransmits = session->fast_retransmissions;
+        session->cold->stats.congestion_window = congestion_control_window(&session->congestion_control);
+        if (session->cold->stats.callback != nullptr) {
+            session->cold->stats.callback(&session->cold->stats);
         }
         close_session(session);
         return TFTP_SESSION_STATE_CLOSED;
@@ -222,19 +416,16 @@ static bool send_oack(struct tftp_session session[static 1]) {
         logger_log_error(session->logger, "Could not initialize OACK packet.");
         return false;
     }
-    if (session->is_adaptive_timeout_active) {
-        adaptive_timeout_start_timer(&session->adaptive_timeout);
-        session->adaptive_timeout.starting_block_number = 0;
-    }
-    if (!submit_timeout(session)) {
-        return false;
+    if (session->is_rtt_sampling_active) {
+        record_send_time(session, &session->cold->oack_rtt_sample);
     }
-    ssize_t ret = sendto(session->connection.sockfd, session->oack_packet, session->oack_packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+    start_timeout(session);
+    ssize_t ret = send_packet(session, session->oack_packet, session->oack_packet_size);
     if (ret == -1) {
         logger_log_error(session->logger, "Error while sending OACK: %s", strerror(errno));
         return false;
     }
-    logger_log_trace(session->logger, "Sent OACK %s to %s:%d", session->stats.options_acked, session->connection.client_address.str, session->connection.client_address.port);
+    logger_log_trace(session->logger, "Sent OACK %s to %s:%d", session->cold->stats.options_acked, session->connection.client_address.str, session->connection.client_address.port);
     return true;
 }
 
@@ -247,7 +438,7 @@ static bool start(struct tftp_session session[static 1]) {
         return true;
     }
     logger_log_trace(session->logger, "Request validated.");
-    enum tftp_opcode opcode = tftp_get_opcode_unsafe(session->request_args.buffer);
+    enum tftp_opcode opcode = tftp_get_opcode_unsafe(session->cold->request_args.buffer);
     if (opcode == TFTP_OPCODE_WRQ) {
         session->request_type = SESSION_WRITE_REQUEST;
     }
@@ -256,79 +447,156 @@ static bool start(struct tftp_session session[static 1]) {
     }
     
     if (!session_connection_init(&session->connection,
-                                 session->server_info->server_addrinfo,
-                                 session->request_args.peer_addr,
-                                 session->request_args.peer_addrlen,
-                                 session->request_args.is_orig_dest_addr_ipv4,
+                                 session->cold->socket_pool,
+                                 session->cold->demux,
+                                 session->cold->session_id,
+                                 session->cold->request_args.peer_addr,
+                                 session->cold->request_args.peer_addrlen,
+                                 session->cold->request_args.is_orig_dest_addr_ipv4,
                                  session->logger)) {
         logger_log_error(session->logger, "Could not initialize session connection socket. Ignoring request.");
         return false;
     }
     
-    const char *filename = (char *)&session->request_args.buffer[2];
+    const char *filename = (char *)&session->cold->request_args.buffer[2];
     if (session->connection.client_address.str != nullptr) {
         const char *request_str = session->request_type == SESSION_READ_REQUEST ? "to read" : "to write";
         logger_log_info(session->logger, "New incoming connection from client '%s:%d' asking %s file '%s'", session->connection.client_address.str, session->connection.client_address.port, request_str, filename);
     }
     
-    session->stats = tftp_session_stat_init(session->connection.address.sockaddr,
+    session->cold->stats = tftp_session_stat_init(session->connection.address.sockaddr,
                                             session->connection.client_address.sockaddr,
                                             filename,
                                             session->server_info->session_stats_callback,
                                             session->logger);
     
-    bool ret = session_options_init(&session->options,
-                                    session->request_args.bytes_recvd - 2,
-                                    (const char *) &session->request_args.buffer[2],
-                                    &session->filename,
+    bool ret = session_options_init(&session->cold->options,
+                                    session->cold->request_args.bytes_recvd - 2,
+                                    (const char *) &session->cold->request_args.buffer[2],
+                                    &session->cold->filename,
                                     &session->mode,
-                                    &session->timeout,
+                                    &session->timeout_us,
                                     &session->block_size,
                                     &session->window_size,
                                     &session->is_adaptive_timeout_active,
-                                    &session->stats.error);
-    session->stats.mode = tftp_mode_to_string(session->mode);
+                                    &session->is_selective_ack_active,
+                                    &session->is_pipeline_active,
+                                    &session->fec_group_size,
+                                    &session->read_offset,
+                                    &session->read_end,
+                                    &session->cold->stats.error);
+    session->cold->stats.mode = tftp_mode_to_string(session->mode);
     if (!ret) {
-        return true;    // send error and close session
+        return send_error(session);
     }
     enum tftp_read_type read_type = TFTP_READ_TYPE_FILE;
-    if (session->options.options_str != nullptr
+    if (session->cold->options.options_str != nullptr
         && session->server_info->is_list_request_enabled
         && session->request_type == SESSION_READ_REQUEST) {
-        read_type = session_options_get_read_type(&session->options);
+        read_type = session_options_get_read_type(&session->cold->options);
+    }
+    const bool is_file_read = session->request_type == SESSION_READ_REQUEST && read_type == TFTP_READ_TYPE_FILE;
+    if (is_file_read && negative_cache_contains(session->server_info->negative_cache, session->cold->filename)) {
+        const struct tftp_error_packet_info *error = &tftp_error_packet_info[TFTP_ERROR_FILE_NOT_FOUND];
+        session->cold->stats.error = (struct tftp_session_stats_error) {
+            .error_occurred = true,
+            .error_number = TFTP_ERROR_FILE_NOT_FOUND,
+            .error_message = (const char *) error->packet->error_message,
+        };
+        return send_error_packet(session, error->packet, error->size);
     }
 
     enum session_file_mode file_mode = session->request_type == SESSION_READ_REQUEST ? SESSION_FILE_MODE_READ : SESSION_FILE_MODE_WRITE;
-    session->file_descriptor = session_file_init(session->filename, session->server_info->root, file_mode, read_type, &session->stats.error);
-    if (session->file_descriptor == -1) {
-        return true;    // send error and close session
+    if (!session_file_init(&session->file,
+                           session->cold->filename,
+                           session->server_info->root,
+                           file_mode,
+                           read_type,
+                           session->server_info->file_cache,
+                           session->server_info->content_cache,
+                           session->server_info->listing_cache,
+                           &session->cold->stats.error)) {
+        if (is_file_read && session->cold->stats.error.error_number == TFTP_ERROR_FILE_NOT_FOUND) {
+            negative_cache_insert(session->server_info->negative_cache, session->server_info->root, session->cold->filename);
+        }
+        return send_error(session);
     }
-    if (session->options.options_str == nullptr) {
-        logger_log_info(session->logger, "No options requested from peer %s:%d.", session->stats.peer_addr, session->stats.peer_port);
+    session->read_end = session->file.size;
+    if (session->cold->options.options_str == nullptr) {
+        logger_log_info(session->logger, "No options requested from peer %s:%d.", session->cold->stats.peer_addr, session->cold->stats.peer_port);
+        reserve_window_memory(session);
     }
     else {
-        tftp_format_option_strings(session->options.options_str_size, session->options.options_str, session->stats.options_in);
-        logger_log_info(session->logger, "Options requested from peer %s:%d are [%s]", session->stats.peer_addr, session->stats.peer_port, session->stats.options_in);
-        if (!parse_options(&session->options, session->file_descriptor, session->server_info->is_adaptive_timeout_enabled, session->server_info->is_list_request_enabled)) {
-            return true;
+        tftp_format_option_strings(session->cold->options.options_str_size, session->cold->options.options_str, session->cold->stats.options_in);
+        logger_log_info(session->logger, "Options requested from peer %s:%d are [%s]", session->cold->stats.peer_addr, session->cold->stats.peer_port, session->cold->stats.options_in);
+        if (!parse_options(&session->cold->options, &session->file, session->server_info->is_adaptive_timeout_enabled, session->server_info->is_list_request_enabled, session->request_type == SESSION_READ_REQUEST, session->server_info->min_fec_group_size, session->server_info->digest_cache->sets_count != 0, session->server_info->is_compression_enabled)) {
+            return send_error(session);
         }
-        tftp_format_options(session->options.recognized_options, session->stats.options_acked);
-        logger_log_info(session->logger, "Options to ack for peer %s:%d are %s", session->stats.peer_addr, session->stats.peer_port, session->stats.options_acked);
-        session->stats.blksize = session->block_size;
+        if (session->cold->options.recognized_options[TFTP_OPTION_DIGEST].is_active) {
+            uint64_t digest;
+            session_options_set_digest(&session->cold->options, get_file_digest(session, &digest) ? &digest : nullptr);
+        }
+        if (session->cold->options.recognized_options[TFTP_OPTION_COMPRESS].is_active) {
+            if (session_file_compress(&session->file, session->server_info->content_cache)) {
+                session->read_end = session->file.size;
+            }
+            else {
+                session->cold->options.recognized_options[TFTP_OPTION_COMPRESS].is_active = false;
+            }
+        }
+        reserve_window_memory(session);
+        tftp_format_options(session->cold->options.recognized_options, session->cold->stats.options_acked);
+        logger_log_info(session->logger, "Options to ack for peer %s:%d are %s", session->cold->stats.peer_addr, session->cold->stats.peer_port, session->cold->stats.options_acked);
+        session->cold->stats.blksize = session->block_size;
         if (session->request_type == SESSION_READ_REQUEST) {
-            session->stats.window_size = session->window_size;
+            session->cold->stats.window_size = session->window_size;
         }
     }
-    if (session->is_adaptive_timeout_active) {
+    session->is_rtt_sampling_active = session->is_adaptive_timeout_active
+                                      || (session->server_info->is_pacing_enabled && session->request_type == SESSION_READ_REQUEST);
+    if (session->is_rtt_sampling_active) {
         adaptive_timeout_init(&session->adaptive_timeout);
+        if (session->request_type == SESSION_READ_REQUEST) {
+            session_connection_enable_timestamping(&session->connection, session->logger);
+        }
     }
-    session->data_packets = malloc(session->window_size * (sizeof *session->data_packets + session->block_size));
+    congestion_control_init(&session->congestion_control, session->server_info->congestion_control, session->window_size);
+    session->data_packets = slab_alloc(session->allocator, session->window_size * (sizeof *session->data_packets + session->block_size));
     if (session->data_packets == nullptr) {
         logger_log_error(session->logger, "Could not initialize DATA packets storage. Not enough memory: %s.", strerror(errno));
         return false;
     }
+    if (session->is_rtt_sampling_active) {
+        session->rtt_samples = slab_calloc(session->allocator, session->window_size, sizeof *session->rtt_samples);
+        if (session->rtt_samples == nullptr) {
+            logger_log_error(session->logger, "Could not initialize RTT samples storage. Not enough memory: %s.", strerror(errno));
+            return false;
+        }
+    }
+    if (session->is_selective_ack_active) {
+        session->sacked_packets = slab_calloc(session->allocator, session->window_size, sizeof *session->sacked_packets);
+        if (session->sacked_packets == nullptr) {
+            logger_log_error(session->logger, "Could not initialize SACK storage. Not enough memory: %s.", strerror(errno));
+            return false;
+        }
+    }
+    if (session->fec_group_size != 0) {
+        session->fec_packet = slab_alloc(session->allocator, sizeof *session->fec_packet + session->block_size);
+        if (session->fec_packet == nullptr) {
+            logger_log_error(session->logger, "Could not initialize FEC packet. Not enough memory: %s.", strerror(errno));
+            return false;
+        }
+        session->fec_packet->opcode = htons(TFTP_OPCODE_FEC);
+    }
+    if (session->request_type == SESSION_READ_REQUEST && session->mode == TFTP_MODE_OCTET && session_file_has_holes(&session->file)) {
+        session->zero_packets = slab_calloc(session->allocator, session->window_size, sizeof *session->zero_packets);
+        if (session->zero_packets == nullptr) {
+            logger_log_error(session->logger, "Could not initialize DATA packets storage. Not enough memory: %s.", strerror(errno));
+            return false;
+        }
+    }
     size_t recv_buffer_size = sizeof(struct tftp_data_packet) + (session->block_size < tftp_default_blksize ? tftp_default_blksize : session->block_size);
-    void *recv_buffer = realloc(session->connection.recv_buffer, recv_buffer_size);
+    void *recv_buffer = slab_alloc(session->allocator, recv_buffer_size);
     if (recv_buffer == nullptr) {
         logger_log_error(session->logger, "Could not initialize receive buffer. Not enough memory: %s.", strerror(errno));
         return false;
@@ -336,30 +604,65 @@ static bool start(struct tftp_session session[static 1]) {
     session->connection.recv_buffer = recv_buffer;
     session->connection.recv_buffer_size = recv_buffer_size;
     
-    session->event_timeout.timeout.tv_sec = session->timeout;
-    if (session->stats.error.error_occurred) {
-        if (!error_packet_init(session)) {
-            logger_log_error(session->logger, "Could not initialize error packet.");
-            return false;
-        }
-        if (sendto(session->connection.sockfd, session->error_packet, session->error_packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen) == -1) {
-            logger_log_error(session->logger, "Error while sending ERROR: %s", strerror(errno));
-            return false;
-        }
-        logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->stats.error.error_message, session->connection.last_message_address.str, session->connection.last_message_address.port);
-        session->should_close = true;
-        return true;
+    session->timeout_ticks = ((uint64_t) session->timeout_us * 1'000 + timer_wheel_tick_ns - 1) / timer_wheel_tick_ns;
+    if (session->is_rtt_sampling_active) {
+        seed_rtt(session);
+    }
+    if (session->cold->stats.error.error_occurred) {
+        return send_error(session);
     }
     return true;
 }
 
+static void seed_rtt(struct tftp_session session[static 1]) {
+    double smoothed_rtt;
+    double rtt_variation;
+    if (!rtt_cache_lookup(session->server_info->rtt_cache, session->connection.client_address.sockaddr, &smoothed_rtt, &rtt_variation)) {
+        return;
+    }
+    adaptive_timeout_seed(&session->adaptive_timeout, smoothed_rtt, rtt_variation);
+    if (session->is_adaptive_timeout_active) {
+        session->timeout_ticks = timer_wheel_ticks_from_timespec(session->adaptive_timeout.rto);
+    }
+    logger_log_debug(session->logger, "RTT of peer %s:%d seeded from a previous session: %.6f s.", session->cold->stats.peer_addr, session->cold->stats.peer_port, smoothed_rtt);
+}
+
+static void reserve_window_memory(struct tftp_session session[static 1]) {
+    const uint16_t requested_block_size = session->block_size;
+    const uint16_t requested_window_size = session->window_size;
+    session->cold->window_memory = window_budget_reserve(session->server_info->window_budget, &session->block_size, &session->window_size);
+    if (session->block_size != requested_block_size || session->window_size != requested_window_size) {
+        logger_log_info(session->logger, "Window of peer %s:%d reduced from %hu to %hu blocks of %hu bytes to stay within the memory budget.",
+                        session->cold->stats.peer_addr, session->cold->stats.peer_port, requested_window_size, session->window_size, session->block_size);
+        session_options_set_window(&session->cold->options, session->block_size, session->window_size);
+    }
+}
+
+static bool send_error(struct tftp_session session[static 1]) {
+    if (!error_packet_init(session)) {
+        logger_log_error(session->logger, "Could not initialize error packet.");
+        return false;
+    }
+    return send_error_packet(session, session->error_packet, session->error_packet_size);
+}
+
+static bool send_error_packet(struct tftp_session session[static 1], const struct tftp_error_packet packet[static 1], size_t packet_size) {
+    session->should_close = true;
+    if (send_packet(session, packet, packet_size) == -1) {
+        logger_log_error(session->logger, "Error while sending ERROR: %s", strerror(errno));
+        return false;
+    }
+    logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->cold->stats.error.error_message, session->connection.client_address.str, session->connection.client_address.port);
+    return true;
+}
+
 static bool on_data_available(struct tftp_session session[static 1], struct dispatcher_event event[static 1]) {
     if (session->mode == TFTP_MODE_OCTET) {
         while (true) {
             if (!event->is_success) {
                 session->should_close = true;
                 logger_log_warn(session->logger, "Error while reading from source: %s", strerror(event->error_number));
-                session->stats.error = (struct tftp_session_stats_error) {
+                session->cold->stats.error = (struct tftp_session_stats_error) {
                     .error_occurred = true,
                     .error_number = TFTP_ERROR_NOT_DEFINED,
                     .error_message = "Error while reading from source"
@@ -368,12 +671,12 @@ static bool on_data_available(struct tftp_session session[static 1], struct disp
                     logger_log_error(session->logger, "Could not initialize error packet.");
                     return false;
                 }
-                ssize_t ret = sendto(session->connection.sockfd, session->error_packet, session->error_packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+                ssize_t ret = send_packet(session, session->error_packet, session->error_packet_size);
                 if (ret == -1) {
                     logger_log_error(session->logger, "Error while sending ERROR: %s", strerror(errno));
                     return false;
                 }
-                logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->stats.error.error_message, session->connection.last_message_address.str, session->connection.last_message_address.port);
+                logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->cold->stats.error.error_message, session->connection.client_address.str, session->connection.client_address.port);
                 return true;
             }
             if (!create_data_packets(session, event->result)) {
@@ -383,35 +686,90 @@ static bool on_data_available(struct tftp_session session[static 1], struct disp
             break;
         }
     }
-    if (session->is_adaptive_timeout_active) {
-        if (!session->adaptive_timeout.is_timer_active) {
-            adaptive_timeout_start_timer(&session->adaptive_timeout);
-            session->adaptive_timeout.starting_block_number = session->next_data_packet_to_send;
-        }
+    return send_next_data_packet(session);
+}
+
+static bool send_next_data_packet(struct tftp_session session[static 1]) {
+    if (session->is_rtt_sampling_active) {
+        record_send_time(session, get_rtt_sample(session, session->next_data_packet_to_send));
+    }
+    if (session->is_selective_ack_active) {
+        *get_sacked_packet(session, session->next_data_packet_to_send) = false;
     }
     auto packet_info = get_data_packet_info(session, session->next_data_packet_to_send);
     const size_t packet_size = sizeof(struct tftp_data_packet) + session->last_block_size;
-    ssize_t ret = sendto(session->connection.sockfd, packet_info.packet, packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+    ssize_t ret = send_data_packet(session, packet_info.packet, packet_size);
     if (ret == -1) {
         logger_log_error(session->logger, "Error while sending data: %s", strerror(errno));
         return false;
     }
-    session->stats.packets_sent += 1;
+    session->packets_sent += 1;
     uint16_t block_number = ntohs(packet_info.packet->block_number);
     logger_log_trace(session->logger, "Sent DATA <block=%d, size=%zu bytes> to %s:%d", block_number, ret - sizeof(struct tftp_data_packet), session->connection.client_address.str, session->connection.client_address.port);
     if (session->last_block_size < session->block_size) {
         session->last_packet = session->next_data_packet_to_send;
     }
+    if (session->fec_group_size != 0 && !add_to_fec_group(session, packet_info.packet, session->last_block_size)) {
+        return false;
+    }
     if (session->window_begin == session->next_data_packet_to_send) {
-        if (!submit_timeout(session)) {
-            return false;
-        }
+        start_timeout(session);
+    }
+    if (session->server_info->is_pacing_enabled) {
+        session->pacing_next_send = get_monotonic_time_ns() + get_pacing_interval_ns(session);
     }
     session->next_data_packet_to_send += 1;
     return true;
 }
 
+/*
+ * Only the first transmission of a block is added, the FEC packet is sent right after the last block of the group.
+ * Blocks sent from the shared zero buffer add nothing to the XOR but their size.
+ */
+static bool add_to_fec_group(struct tftp_session session[static 1], const struct tftp_data_packet *packet, size_t payload_size) {
+    const uint16_t block_number = ntohs(packet->block_number);
+    const uint16_t packet_index = ((uint16_t) (block_number - 1)) % session->window_size;
+    const bool is_zero_packet = session->zero_packets != nullptr && session->zero_packets[packet_index];
+    struct tftp_fec_packet *fec_packet = session->fec_packet;
+    if (session->fec_blocks_count == 0) {
+        fec_packet->block_number = packet->block_number;
+        session->fec_size_parity = 0;
+        session->fec_payload_size = 0;
+    }
+    if (payload_size > session->fec_payload_size) {
+        memset(&fec_packet->data[session->fec_payload_size], 0, payload_size - session->fec_payload_size);
+        session->fec_payload_size = payload_size;
+    }
+    if (!is_zero_packet) {
+        fec_xor(fec_packet->data, packet->data, payload_size);
+    }
+    session->fec_size_parity ^= payload_size;
+    session->fec_blocks_count += 1;
+    if (session->fec_blocks_count < session->fec_group_size && payload_size == session->block_size) {
+        return true;
+    }
+    fec_packet->blocks_count = htons(session->fec_blocks_count);
+    fec_packet->size_parity = htons(session->fec_size_parity);
+    session->fec_blocks_count = 0;
+    if (send_packet(session, fec_packet, sizeof *fec_packet + session->fec_payload_size) == -1) {
+        logger_log_error(session->logger, "Error while sending FEC: %s", strerror(errno));
+        return false;
+    }
+    logger_log_trace(session->logger, "Sent FEC <block=%d, blocks=%d> to %s:%d", ntohs(fec_packet->block_number), ntohs(fec_packet->blocks_count), session->connection.client_address.str, session->connection.client_address.port);
+    return true;
+}
+
 static bool on_timeout(struct tftp_session session[static 1]) {
+    if (session->is_awaiting_next_file) {
+        // the request of the next file may be lost as well
+        if (session->current_retransmission++ < session->retries) {
+            start_timeout(session);
+            return true;
+        }
+        logger_log_debug(session->logger, "No further request from client %s:%d.", session->connection.client_address.str, session->connection.client_address.port);
+        session->should_close = true;
+        return true;
+    }
     if (session->current_retransmission >= session->retries) {
         session->should_close = true;
         if (!recv_async_cancel(session)) {
@@ -424,34 +782,33 @@ static bool on_timeout(struct tftp_session session[static 1]) {
             logger_log_error(session->logger, "Could not initialize error packet.");
             return false;
         }
-        ssize_t ret = sendto(session->connection.sockfd, session->error_packet, session->error_packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+        ssize_t ret = send_packet(session, session->error_packet, session->error_packet_size);
         if (ret == -1) {
             logger_log_error(session->logger, "Error while sending data: %s", strerror(errno));
             return false;
         }
-        logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->stats.error.error_message, session->connection.client_address.str, session->connection.client_address.port);
+        logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->cold->stats.error.error_message, session->connection.client_address.str, session->connection.client_address.port);
         return true;
     }
     logger_log_debug(session->logger, "Timeout for client %s:%d. Retransmission no %d.", session->connection.client_address.str, session->connection.client_address.port, session->current_retransmission + 1);
     session->current_retransmission += 1;
     session->total_retransmissions += 1;
     if (session->is_adaptive_timeout_active) {
-        adaptive_timeout_cancel_timer(&session->adaptive_timeout);
         adaptive_timeout_backoff(&session->adaptive_timeout);
         auto timeout = timespec_to_kernel_timespec(session->adaptive_timeout.rto);
-        session->event_timeout.timeout = timeout;
+        session->timeout_ticks = timer_wheel_ticks_from_timespec(session->adaptive_timeout.rto);
         logger_log_trace(session->logger, "Adaptive timeout: RTO set to %lld.%.9ld seconds via exponential backoff.", timeout.tv_sec, timeout.tv_nsec);
     }
-    if (!submit_timeout(session)) {
-        return false;
-    }
-    if (session->options.valid_options_required && !session->options.options_acknowledged) {
-        ssize_t ret = sendto(session->connection.sockfd, session->oack_packet, session->oack_packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+    congestion_control_on_timeout(&session->congestion_control);
+    start_timeout(session);
+    if (session->cold->options.valid_options_required && !session->cold->options.options_acknowledged) {
+        session->cold->oack_rtt_sample.is_valid = false;
+        ssize_t ret = send_packet(session, session->oack_packet, session->oack_packet_size);
         if (ret == -1) {
             logger_log_error(session->logger, "Error while sending OACK: %s", strerror(errno));
             return false;
         }
-        logger_log_trace(session->logger, "Sent OACK %s to %s:%d", session->stats.options_acked, session->connection.client_address.str, session->connection.client_address.port);
+        logger_log_trace(session->logger, "Sent OACK %s to %s:%d", session->cold->stats.options_acked, session->connection.client_address.str, session->connection.client_address.port);
         return true;
     }
     if (session->request_type == SESSION_WRITE_REQUEST) {
@@ -459,7 +816,7 @@ static bool on_timeout(struct tftp_session session[static 1]) {
             .opcode = htons(TFTP_OPCODE_ACK),
             .block_number = htons(session->expected_sequence_number - 1),
         };
-        ssize_t ret = sendto(session->connection.sockfd, &ack_packet, sizeof ack_packet, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+        ssize_t ret = send_packet(session, &ack_packet, sizeof ack_packet);
         if (ret == -1) {
             logger_log_error(session->logger, "Error while sending ACK: %s", strerror(errno));
             return false;
@@ -467,10 +824,41 @@ static bool on_timeout(struct tftp_session session[static 1]) {
         logger_log_trace(session->logger, "Sent ACK <block=%d> to %s:%d", ntohs(ack_packet.block_number), session->connection.client_address.str, session->connection.client_address.port);
         return true;
     }
+    return retransmit_window(session);
+}
+
+/*
+ * Clients ACK the last block received in order, every DATA packet following a lost one is answered with a duplicate
+ *  ACK of the block before the window: the window is resent once the threshold is reached instead of waiting for the
+ *  timeout, then not again until the window moves.
+ */
+static bool on_duplicate_ack(struct tftp_session session[static 1]) {
+    const uint8_t threshold = session->server_info->fast_retransmit_threshold;
+    if (threshold == 0 || session->duplicate_acks >= threshold) {
+        return true;
+    }
+    if (++session->duplicate_acks < threshold) {
+        return true;
+    }
+    logger_log_debug(session->logger, "%d duplicate ACKs from client %s:%d. Fast retransmission.", threshold, session->connection.client_address.str, session->connection.client_address.port);
+    session->total_retransmissions += 1;
+    session->fast_retransmissions += 1;
+    congestion_control_on_loss(&session->congestion_control);
+    start_timeout(session);
+    return retransmit_window(session);
+}
+
+static bool retransmit_window(struct tftp_session session[static 1]) {
     logger_log_trace(session->logger, "Retransmitting DATA packets in window [%d, %d].", session->window_begin, (uint16_t) session->next_data_packet_to_send - 1);
     for (uint16_t i = session->window_begin; is_in_range(i, session->window_begin, session->next_data_packet_to_send - 1); i++) {
+        if (session->is_selective_ack_active && *get_sacked_packet(session, i)) {
+            continue;
+        }
         auto packet_info = get_data_packet_info(session, i);
-        ssize_t ret = sendto(session->connection.sockfd, packet_info.packet, packet_info.packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+        if (session->is_rtt_sampling_active) {
+            get_rtt_sample(session, i)->is_valid = false;
+        }
+        ssize_t ret = send_data_packet(session, packet_info.packet, packet_info.packet_size);
         if (ret == -1) {
             logger_log_error(session->logger, "Error while sending data: %s", strerror(errno));
             return false;
@@ -485,8 +873,181 @@ static bool on_timeout(struct tftp_session session[static 1]) {
     return true;
 }
 
+static struct session_rtt_sample *get_rtt_sample(struct tftp_session session[static 1], uint16_t block_number) {
+    return &session->rtt_samples[((uint16_t) (block_number - 1)) % session->window_size];
+}
+
+static bool *get_sacked_packet(struct tftp_session session[static 1], uint16_t block_number) {
+    return &session->sacked_packets[((uint16_t) (block_number - 1)) % session->window_size];
+}
+
+/*
+ * The SACK bitmap follows the block number of the ACK, it is read after the window moved to the block after
+ *  block_number. Blocks outside of the window, already delivered or never sent, are ignored.
+ * A block reported out of order is ACKed again once the hole before it is filled: its RTT sample is dropped since
+ *  that ACK would measure the recovery of the hole.
+ */
+static void record_selective_acks(struct tftp_session session[static 1], uint16_t block_number, size_t ack_packet_size) {
+    if (!session->is_selective_ack_active || ack_packet_size <= sizeof(struct tftp_sack_packet)) {
+        return;
+    }
+    const struct tftp_sack_packet *packet = (const struct tftp_sack_packet *) session->connection.recv_buffer;
+    size_t bitmap_size = ack_packet_size - sizeof *packet;
+    if (bitmap_size > tftp_sack_bitmap_max_size) {
+        bitmap_size = tftp_sack_bitmap_max_size;
+    }
+    for (size_t i = 0; i < bitmap_size * 8; i++) {
+        if ((packet->bitmap[i / 8] & (1U << (i % 8))) == 0) {
+            continue;
+        }
+        const uint16_t sacked_block = block_number + 2 + i;
+        if (!is_in_range(sacked_block, session->window_begin, session->next_data_packet_to_send - 1)) {
+            break;
+        }
+        bool *is_sacked = get_sacked_packet(session, sacked_block);
+        if (!*is_sacked && session->is_rtt_sampling_active) {
+            get_rtt_sample(session, sacked_block)->is_valid = false;
+        }
+        *is_sacked = true;
+    }
+}
+
+static void record_send_time(struct tftp_session session[static 1], struct session_rtt_sample sample[static 1]) {
+    *sample = (struct session_rtt_sample) {
+        .timestamp_id = session->connection.next_timestamp_id,
+        .has_kernel_timestamp = false,
+        .is_valid = true,
+    };
+    clock_gettime(CLOCK_MONOTONIC, &sample->sent);
+}
+
+static inline double get_elapsed_seconds(struct timespec from, struct timespec to) {
+    return (double) (to.tv_sec - from.tv_sec) + (double) (to.tv_nsec - from.tv_nsec) / 1e9;
+}
+
+/*
+ * Karn's algorithm: the ACK of a retransmitted packet may answer any of its transmissions and gives no sample.
+ * The kernel timestamps of the packet and of its ACK are used when both are available, they leave out the time the
+ *  ACK waited for the worker, the worker clock is used otherwise.
+ */
+static void take_rtt_sample(struct tftp_session session[static 1], struct session_rtt_sample sample[static 1], uint16_t block_number) {
+    if (!sample->is_valid) {
+        return;
+    }
+    sample->is_valid = false;
+    if (session->connection.is_timestamping_enabled) {
+        read_sent_timestamps(session);
+    }
+    const struct timespec received = session->connection.recv_timestamp;
+    double rtt = 0;
+    if (sample->has_kernel_timestamp && (received.tv_sec != 0 || received.tv_nsec != 0)) {
+        rtt = get_elapsed_seconds(sample->kernel_sent, received);
+    }
+    if (rtt <= 0) {     // no kernel timestamps, or CLOCK_REALTIME stepped back
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        rtt = get_elapsed_seconds(sample->sent, now);
+    }
+    adaptive_timeout_add_sample(&session->adaptive_timeout, rtt);
+    congestion_control_on_rtt_sample(&session->congestion_control, rtt, block_number, session->next_data_packet_to_send);
+    if (session->is_adaptive_timeout_active) {
+        auto timeout = timespec_to_kernel_timespec(session->adaptive_timeout.rto);
+        session->timeout_ticks = timer_wheel_ticks_from_timespec(session->adaptive_timeout.rto);
+        logger_log_trace(session->logger, "Adaptive timeout: RTO set to %lld.%.9ld seconds.", timeout.tv_sec, timeout.tv_nsec);
+    }
+}
+
+// The timestamps are read when an ACK needs them, the ones of packets already ACKed or retransmitted are dropped.
+static void read_sent_timestamps(struct tftp_session session[static 1]) {
+    struct packet_timestamp timestamps[16];
+    const ssize_t capacity = sizeof timestamps / sizeof *timestamps;
+    ssize_t count;
+    do {
+        count = packet_timestamps_read_sent(session->connection.sockfd, timestamps, capacity);
+        for (ssize_t i = 0; i < count; i++) {
+            struct session_rtt_sample *sample = find_rtt_sample(session, timestamps[i].id);
+            if (sample != nullptr) {
+                sample->kernel_sent = timestamps[i].time;
+                sample->has_kernel_timestamp = true;
+            }
+        }
+    } while (count == capacity);
+    if (count == -1) {
+        logger_log_warn(session->logger, "Could not read packet timestamps: %s", strerror(errno));
+    }
+}
+
+/*
+ * New DATA packets are sent in block order, the timestamp ids of the packets in the window storage grow with their
+ *  block number and are binary searched.
+ */
+static struct session_rtt_sample *find_rtt_sample(struct tftp_session session[static 1], uint32_t timestamp_id) {
+    struct session_rtt_sample *oack_sample = &session->cold->oack_rtt_sample;
+    if (oack_sample->is_valid && oack_sample->timestamp_id == timestamp_id) {
+        return oack_sample;
+    }
+    const uint16_t stored = session->packets_sent < session->window_size ? session->packets_sent : session->window_size;
+    const uint16_t first_block = session->next_data_packet_to_send - stored;
+    uint16_t low = 0;
+    uint16_t high = stored;
+    while (low < high) {
+        const uint16_t middle = low + (high - low) / 2;
+        struct session_rtt_sample *sample = get_rtt_sample(session, first_block + middle);
+        if (sample->timestamp_id == timestamp_id) {
+            return sample->is_valid ? sample : nullptr;
+        }
+        if (sample->timestamp_id < timestamp_id) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return nullptr;
+}
+
+static bool on_stray_packet_received(struct tftp_session session[static 1], struct dispatcher_event event[static 1]) {
+    auto sender_address = &session->connection.stray_address;
+    if (!event->is_success) {
+        logger_log_error(session->logger, "Error while receiving stray packet: %s", strerror(event->error_number));
+        return false;
+    }
+    if (!set_address_family(sender_address)) {
+        logger_log_warn(session->logger, "Unknown address family: %d. Ignoring packet.", sender_address->storage.ss_family);
+        return true;
+    }
+    if (sender_address->str == nullptr) {
+        logger_log_error(session->logger, "Unexpected sender, could not translate client address to a string representation.");
+    }
+    else {
+        logger_log_warn(session->logger, "Unexpected sender: '%s:%d', expected client: '%s:%d'.", sender_address->str, sender_address->port, session->connection.client_address.str, session->connection.client_address.port);
+    }
+    session->cold->stats.error = (struct tftp_session_stats_error) {
+        .error_occurred = true,
+        .error_number = TFTP_ERROR_UNKNOWN_TRANSFER_ID,
+        .error_message = "Unknown transfer ID.",
+    };
+    if (!error_packet_init(session)) {
+        logger_log_error(session->logger, "Could not initialize error packet.");
+        return false;
+    }
+    ssize_t ret = sendto(session->connection.stray_sockfd, session->error_packet, session->error_packet_size, 0, sender_address->sockaddr, sender_address->addrlen);
+    if (ret == -1) {
+        logger_log_warn(session->logger, "Error while sending ERROR to unexpected sender: %s", strerror(errno));
+    }
+    else {
+        logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->cold->stats.error.error_message, sender_address->str, sender_address->port);
+    }
+    session->cold->stats.error.error_occurred = false;
+    return true;
+}
+
 static bool on_packet_received(struct tftp_session session[static 1], struct dispatcher_event event[static 1]) {
-    auto sender_address = &session->connection.last_message_address;
+    if (!event->is_success && event->error_number == ECONNREFUSED) {
+        logger_log_warn(session->logger, "Client %s:%d is no longer reachable.", session->connection.client_address.str, session->connection.client_address.port);
+        session->should_close = true;
+        return true;
+    }
     if (!event->is_success) {
         logger_log_error(session->logger, "Error while receiving data: %s", strerror(event->error_number));
         return false;
@@ -495,34 +1056,9 @@ static bool on_packet_received(struct tftp_session session[static 1], struct dis
         logger_log_warn(session->logger, "Received packet is too short. Ignoring packet.");
         return true;
     }
-    if (!set_address_family(sender_address)) {
-        logger_log_warn(session->logger, "Unknown address family: %d. Ignoring packet.", sender_address->storage.ss_family);
-        return true;
-    }
-    if (!sockaddr_equals(&sender_address->storage, &session->connection.client_address.storage)) {
-        if (sender_address->str == nullptr) {
-            logger_log_error(session->logger, "Unexpected sender, could not translate client address to a string representation.");
-        }
-        else {
-            logger_log_warn(session->logger, "Unexpected sender: '%s:%d', expected client: '%s:%d'.", sender_address->str, sender_address->port, session->connection.client_address.str, session->connection.client_address.port);
-        }
-        session->stats.error = (struct tftp_session_stats_error) {
-            .error_occurred = true,
-            .error_number = TFTP_ERROR_UNKNOWN_TRANSFER_ID,
-            .error_message = "Unknown transfer ID.",
-        };
-        if (!error_packet_init(session)) {
-            logger_log_error(session->logger, "Could not initialize error packet.");
-            return false;
-        }
-        ssize_t ret = sendto(session->connection.sockfd, session->error_packet, session->error_packet_size, 0, sender_address->sockaddr, sender_address->addrlen);
-        if (ret == -1) {
-            logger_log_error(session->logger, "Error while sending data: %s", strerror(errno));
-            return false;
-        }
-        logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->stats.error.error_message, sender_address->str, sender_address->port);
-        session->stats.error.error_occurred = false;
-        return true;
+    session->connection.recv_timestamp = (struct timespec) {};
+    if (session->connection.is_timestamping_enabled) {
+        packet_timestamps_get_received(&session->connection.recv_msghdr, &session->connection.recv_timestamp);
     }
     enum tftp_opcode opcode = ntohs(*(uint16_t *) session->connection.recv_buffer);
     switch (opcode) {
@@ -536,9 +1072,9 @@ static bool on_packet_received(struct tftp_session session[static 1], struct dis
             }
             struct tftp_data_packet *data_packet = (struct tftp_data_packet *) session->connection.recv_buffer;
             uint16_t block_number = ntohs(data_packet->block_number);
-            if (!session->options.options_acknowledged && session->options.valid_options_required && block_number == 1) {
+            if (!session->cold->options.options_acknowledged && session->cold->options.valid_options_required && block_number == 1) {
                 logger_log_trace(session->logger, "Options acknowledged.");
-                session->options.options_acknowledged = true;
+                session->cold->options.options_acknowledged = true;
             }
             else if (block_number != session->expected_sequence_number) {
                 logger_log_trace(session->logger, "Received unexpected DATA <block=%d> from %s:%d, expected %d. Ignoring packet.", block_number, session->connection.client_address.str, session->connection.client_address.port, session->expected_sequence_number);
@@ -546,28 +1082,28 @@ static bool on_packet_received(struct tftp_session session[static 1], struct dis
             }
             size_t data_size = event->result - sizeof(struct tftp_data_packet);
             logger_log_trace(session->logger, "Received DATA <block=%d, size=%zu bytes> from %s:%d", block_number, data_size, session->connection.client_address.str, session->connection.client_address.port);
-            ssize_t bytes_written = write(session->file_descriptor, data_packet->data, data_size);
+            ssize_t bytes_written = write(session->file.descriptor, data_packet->data, data_size);
             if (bytes_written == -1) {
                 logger_log_error(session->logger, "Error while writing to file: %s", strerror(errno));
-                session->stats.error = (struct tftp_session_stats_error) {
+                session->cold->stats.error = (struct tftp_session_stats_error) {
                     .error_occurred = true,
                     .error_number = TFTP_ERROR_NOT_DEFINED,
                     .error_message = "Error writing to disk",
                 };
                 return false;
             }
-            session->stats.bytes_sent += bytes_written;
+            session->bytes_sent += bytes_written;
             const struct tftp_ack_packet ack_packet = {
                 .opcode = htons(TFTP_OPCODE_ACK),
                 .block_number = htons(block_number),
             };
-            if (sendto(session->connection.sockfd, &ack_packet, sizeof ack_packet, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen) == -1) {
+            if (send_packet(session, &ack_packet, sizeof ack_packet) == -1) {
                 logger_log_error(session->logger, "Error while sending ACK: %s", strerror(errno));
                 return false;
             }
             logger_log_trace(session->logger, "Sent ACK <block=%d> to %s:%d", block_number, session->connection.client_address.str, session->connection.client_address.port);
             session->expected_sequence_number++;
-            session->stats.packets_acked++;
+            session->packets_acked++;
             session->current_retransmission = 0;
             session->should_close = (data_size < session->block_size);
             return true;
@@ -577,47 +1113,77 @@ static bool on_packet_received(struct tftp_session session[static 1], struct dis
                 break;
             }
             uint16_t block_number = ntohs(*(uint16_t *) &session->connection.recv_buffer[2]);
-            if (!session->options.options_acknowledged && session->options.valid_options_required && block_number == 0) {
-                session->options.options_acknowledged = true;
+            if (session->is_awaiting_next_file) {
+                logger_log_trace(session->logger, "Received duplicate ACK <block=%d> from %s:%d after the last block. Ignoring packet.", block_number, session->connection.client_address.str, session->connection.client_address.port);
+                return true;
+            }
+            struct session_rtt_sample *rtt_sample;
+            if (!session->cold->options.options_acknowledged && session->cold->options.valid_options_required && block_number == 0) {
+                session->cold->options.options_acknowledged = true;
+                rtt_sample = &session->cold->oack_rtt_sample;
+            }
+            else if (block_number == (uint16_t) (session->window_begin - 1) && session->window_begin != session->next_data_packet_to_send) {
+                logger_log_trace(session->logger, "Received duplicate ACK <block=%d> from %s:%d", block_number, session->connection.client_address.str, session->connection.client_address.port);
+                record_selective_acks(session, block_number, event->result);
+                return on_duplicate_ack(session);
             }
             else if (!is_in_range(block_number, session->window_begin, session->next_data_packet_to_send - 1)) {
                 logger_log_trace(session->logger, "Received unexpected ACK <block=%d> from %s:%d not in window [%d, %d]. Ignoring packet.", block_number, session->connection.client_address.str, session->connection.client_address.port, session->window_begin, session->next_data_packet_to_send - 1);
                 return true;
             }
             else {
-                session->stats.bytes_sent += get_cumulative_ackd_payload_size(session, block_number);
+                session->bytes_sent += get_cumulative_ackd_payload_size(session, block_number);
+                congestion_control_on_ack(&session->congestion_control, (uint16_t) (block_number - session->window_begin) + 1);
+                rtt_sample = session->is_rtt_sampling_active ? get_rtt_sample(session, block_number) : nullptr;
             }
             logger_log_trace(session->logger, "Received ACK <block=%d> from %s:%d", block_number, session->connection.client_address.str, session->connection.client_address.port);
             session->window_begin = block_number + 1;
+            session->duplicate_acks = 0;
+            record_selective_acks(session, block_number, event->result);
             
-            if (session->is_adaptive_timeout_active
-                && session->adaptive_timeout.is_timer_active
-                && is_in_range(block_number, session->adaptive_timeout.starting_block_number, session->next_data_packet_to_send - 1)) {
-                adaptive_timeout_stop_timer(&session->adaptive_timeout);
-                auto timeout = timespec_to_kernel_timespec(session->adaptive_timeout.rto);
-                session->event_timeout.timeout = timeout;
-                logger_log_trace(session->logger, "Adaptive timeout: RTO set to %lld.%.9ld seconds.", timeout.tv_sec, timeout.tv_nsec);
-            }
-            if (!submit_cancel_timeout(session)) {
-                return false;
+            if (session->is_rtt_sampling_active) {
+                take_rtt_sample(session, rtt_sample, block_number);
             }
             // if packets to retransmit still exists restart timeout
             if (session->window_begin != session->next_data_packet_to_send) {
-                if (!submit_timeout(session)) {
-                    return false;
-                }
+                start_timeout(session);
+            }
+            else {
+                stop_timeout(session);
             }
             
-            session->stats.packets_acked += 1;
+            session->packets_acked += 1;
             session->current_retransmission = 0;
-            session->should_close = (session->last_packet != -1) && (block_number == session->last_packet);
+            if (session->last_packet == -1 || block_number != session->last_packet) {
+                return true;
+            }
+            if (!session->is_pipeline_active) {
+                session->should_close = true;
+                return true;
+            }
+            logger_log_debug(session->logger, "File '%s' transferred, waiting for the next request.", session->cold->filename);
+            session->is_awaiting_next_file = true;
+            start_timeout(session);
             return true;
         }
+        case TFTP_OPCODE_RRQ: {
+            if (!session->is_pipeline_active) {
+                break;
+            }
+            if (!is_next_file_request(session, event->result)) {
+                logger_log_trace(session->logger, "Received duplicate RRQ from %s:%d. Ignoring packet.", session->connection.client_address.str, session->connection.client_address.port);
+                return true;
+            }
+            return start_next_file(session, event->result);
+        }
+        case TFTP_OPCODE_FEC:
+            // repair packets only flow from the server to the client
+            break;
     }
     
     logger_log_error(session->logger, "Expected %s opcode from %s:%d, got: %hu.",  session->request_type == SESSION_READ_REQUEST ? "ACK" : "DATA", session->connection.client_address.str, session->connection.client_address.port, opcode);
     session->should_close = true;
-    session->stats.error = (struct tftp_session_stats_error) {
+    session->cold->stats.error = (struct tftp_session_stats_error) {
         .error_occurred = true,
         .error_number = TFTP_ERROR_ILLEGAL_OPERATION,
         .error_message = "Unexpected packet opcode.",
@@ -626,25 +1192,145 @@ static bool on_packet_received(struct tftp_session session[static 1], struct dis
         logger_log_error(session->logger, "Could not initialize error packet.");
         return false;
     }
-    ssize_t ret = sendto(session->connection.sockfd, session->error_packet, session->error_packet_size, 0, session->connection.client_address.sockaddr, session->connection.client_address.addrlen);
+    ssize_t ret = send_packet(session, session->error_packet, session->error_packet_size);
     if (ret == -1) {
         logger_log_error(session->logger, "Error while sending data: %s", strerror(errno));
         return false;
     }
-    logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->stats.error.error_message, session->connection.client_address.str, session->connection.client_address.port);
+    logger_log_trace(session->logger, "Sent ERROR <message=%s> to %s:%d", session->cold->stats.error.error_message, session->connection.client_address.str, session->connection.client_address.port);
     return true;
 }
 
-static void close_session(struct tftp_session session[static 1]) {
-    if (session->file_descriptor != -1) {
-        close(session->file_descriptor);
+/*
+ * The request of the next file carries the last block of the previous one, it also acknowledges the last window when
+ *  its ACK was lost. Retransmissions of a request already served carry an older block and are ignored.
+ */
+static bool is_next_file_request(struct tftp_session session[static 1], size_t request_size) {
+    if (session->last_packet == -1 || request_size > tftp_request_packet_max_size) {
+        return false;
     }
-    if (session->connection.sockfd != -1) {
-        session_connection_destroy(&session->connection, session->logger);
+    const char *request = (const char *) &session->connection.recv_buffer[2];
+    const size_t n = request_size - 2;
+    if (request[n - 1] != '\0') {
+        return false;
+    }
+    const char *mode = memchr(request, '\0', n);
+    const char *options = mode == nullptr ? nullptr : memchr(mode + 1, '\0', &request[n] - (mode + 1));
+    if (options == nullptr || ++options == &request[n]) {
+        return false;
+    }
+    struct tftp_option recognized_options[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(recognized_options, &request[n] - options, options);
+    const struct tftp_option pipeline = recognized_options[TFTP_OPTION_PIPELINE];
+    return pipeline.is_active && strtoul(pipeline.value, nullptr, 10) == (uint16_t) session->last_packet;
+}
+
+// Block numbers go on from the previous file, the negotiated options, the window storage and the RTT estimate are kept.
+static bool start_next_file(struct tftp_session session[static 1], size_t request_size) {
+    memcpy(session->cold->request_args.buffer, session->connection.recv_buffer, request_size);
+    session->cold->request_args.bytes_recvd = (ssize_t) request_size;
+    if (!is_request_valid(session)) {
+        return true;
+    }
+    if (session->window_begin != session->next_data_packet_to_send) {
+        session->bytes_sent += get_cumulative_ackd_payload_size(session, session->last_packet);
+    }
+    stop_timeout(session);
+    session_file_destroy(&session->file, session->server_info->file_cache, session->server_info->content_cache, session->server_info->listing_cache);
+    session->window_begin = session->next_data_packet_to_send;
+    session->last_packet = -1;
+    session->last_block_size = 0;
+    session->netascii_buffer = -1;
+    session->read_offset = 0;
+    session->current_retransmission = 0;
+    session->duplicate_acks = 0;
+    session->fec_blocks_count = 0;
+    session->is_awaiting_next_file = false;
+    session->is_fetching_data = false;
+    session->incomplete_read = false;
+    if (session->rtt_samples != nullptr) {
+        memset(session->rtt_samples, 0, session->window_size * sizeof *session->rtt_samples);
+    }
+    if (session->sacked_packets != nullptr) {
+        memset(session->sacked_packets, 0, session->window_size * sizeof *session->sacked_packets);
+    }
+    if (session->zero_packets != nullptr) {
+        memset(session->zero_packets, 0, session->window_size * sizeof *session->zero_packets);
+    }
+    // the options of the next request are not negotiated, only its file name and mode are used
+    if (!session_options_init(&session->cold->options,
+                              request_size - 2,
+                              (const char *) &session->cold->request_args.buffer[2],
+                              &session->cold->filename,
+                              &session->mode,
+                              &session->timeout_us,
+                              &session->block_size,
+                              &session->window_size,
+                              &session->is_adaptive_timeout_active,
+                              &session->is_selective_ack_active,
+                              &session->is_pipeline_active,
+                              &session->fec_group_size,
+                              &session->read_offset,
+                              &session->read_end,
+                              &session->cold->stats.error)) {
+        return send_error(session);
+    }
+    logger_log_info(session->logger, "Client '%s:%d' asking to read file '%s' on the same session", session->connection.client_address.str, session->connection.client_address.port, session->cold->filename);
+    if (negative_cache_contains(session->server_info->negative_cache, session->cold->filename)) {
+        const struct tftp_error_packet_info *error = &tftp_error_packet_info[TFTP_ERROR_FILE_NOT_FOUND];
+        session->cold->stats.error = (struct tftp_session_stats_error) {
+            .error_occurred = true,
+            .error_number = TFTP_ERROR_FILE_NOT_FOUND,
+            .error_message = (const char *) error->packet->error_message,
+        };
+        return send_error_packet(session, error->packet, error->size);
+    }
+    if (!session_file_init(&session->file,
+                           session->cold->filename,
+                           session->server_info->root,
+                           SESSION_FILE_MODE_READ,
+                           TFTP_READ_TYPE_FILE,
+                           session->server_info->file_cache,
+                           session->server_info->content_cache,
+                           session->server_info->listing_cache,
+                           &session->cold->stats.error)) {
+        if (session->cold->stats.error.error_number == TFTP_ERROR_FILE_NOT_FOUND) {
+            negative_cache_insert(session->server_info->negative_cache, session->server_info->root, session->cold->filename);
+        }
+        return send_error(session);
     }
-    free(session->oack_packet);
-    free(session->error_packet);
-    free(session->data_packets);
+    session->read_end = session->file.size;
+    if (session->mode == TFTP_MODE_OCTET && session_file_has_holes(&session->file) && session->zero_packets == nullptr) {
+        session->zero_packets = slab_calloc(session->allocator, session->window_size, sizeof *session->zero_packets);
+        if (session->zero_packets == nullptr) {
+            logger_log_error(session->logger, "Could not initialize DATA packets storage. Not enough memory: %s.", strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+static void close_session(struct tftp_session session[static 1]) {
+    stop_timeout(session);
+    if (session->is_rtt_sampling_active && adaptive_timeout_get_smoothed_rtt(&session->adaptive_timeout) > 0) {
+        rtt_cache_update(session->server_info->rtt_cache,
+                         session->connection.client_address.sockaddr,
+                         adaptive_timeout_get_smoothed_rtt(&session->adaptive_timeout),
+                         adaptive_timeout_get_rtt_variation(&session->adaptive_timeout));
+    }
+    session_file_destroy(&session->file, session->server_info->file_cache, session->server_info->content_cache, session->server_info->listing_cache);
+    if (session->connection.sockfd != -1) {
+        session_connection_destroy(&session->connection, session->cold->socket_pool, session->cold->demux, session->logger);
+    }
+    window_budget_release(session->server_info->window_budget, session->cold->window_memory);
+    slab_free(session->allocator, session->connection.recv_buffer);
+    slab_free(session->allocator, session->oack_packet);
+    slab_free(session->allocator, session->error_packet);
+    slab_free(session->allocator, session->data_packets);
+    slab_free(session->allocator, session->zero_packets);
+    slab_free(session->allocator, session->rtt_samples);
+    slab_free(session->allocator, session->sacked_packets);
+    slab_free(session->allocator, session->fec_packet);
     logger_log_debug(session->logger, "Session closed.");
 }
 
@@ -678,7 +1364,7 @@ static struct tftp_data_packet_info get_data_packet_info(struct tftp_session ses
 }
 
 static bool is_request_valid(struct tftp_session session[static 1]) {
-    enum tftp_opcode opcode = tftp_get_opcode_unsafe(session->request_args.buffer);
+    enum tftp_opcode opcode = tftp_get_opcode_unsafe(session->cold->request_args.buffer);
     if (opcode != TFTP_OPCODE_RRQ && opcode != TFTP_OPCODE_WRQ) {
         logger_log_warn(session->logger, "Unexpected TFTP opcode %d.", opcode);
         return false;
@@ -688,8 +1374,8 @@ static bool is_request_valid(struct tftp_session session[static 1]) {
         return false;
     }
     size_t token_length = 0;
-    size_t option_size = session->request_args.bytes_recvd - 2;
-    const char *option_ptr = (const char *) &session->request_args.buffer[2];
+    size_t option_size = session->cold->request_args.bytes_recvd - 2;
+    const char *option_ptr = (const char *) &session->cold->request_args.buffer[2];
     const char *end_ptr = &option_ptr[option_size - 1];
     while (option_ptr != nullptr && option_ptr < end_ptr) {
         option_ptr = memchr(option_ptr, '\0', end_ptr - option_ptr + 1);
@@ -712,14 +1398,21 @@ static bool fetch_data_octet_async(struct tftp_session session[static 1]) {
     
     session->last_block_size = session->incomplete_read ? session->last_block_size : 0;
     void *data = &(packet->data)[session->last_block_size];
-    const size_t block_size = session->block_size - session->last_block_size;
+    if (session->zero_packets != nullptr) {
+        session->zero_packets[packet_index] = false;
+    }
+    size_t block_size = session->block_size - session->last_block_size;
+    if (session->file.is_seekable && (off_t) block_size > session->read_end - session->read_offset) {
+        block_size = session->read_end - session->read_offset;
+    }
     session->incomplete_read = false;
     
     if (!dispatcher_submit_read(session->dispatcher,
                                 &session->event_next_block,
-                                session->file_descriptor,
+                                session->file.descriptor,
                                 data,
-                                block_size)) {
+                                block_size,
+                                session->file.is_seekable ? (uint64_t) session->read_offset : dispatcher_current_position)) {
         logger_log_error(session->logger, "Could not submit read request.");
         return false;
     }
@@ -727,6 +1420,32 @@ static bool fetch_data_octet_async(struct tftp_session session[static 1]) {
     return true;
 }
 
+static bool fetch_data_memory(struct tftp_session session[static 1]) {
+    const uint16_t packet_index = ((uint16_t) (session->next_data_packet_to_send - 1)) % session->window_size;
+    const size_t offset = packet_index * (sizeof(struct tftp_data_packet) + session->block_size);
+    struct tftp_data_packet *packet = (void *) ((uint8_t *) session->data_packets + offset);
+    const off_t remaining = session->read_end - session->read_offset;
+    const size_t block_size = remaining < session->block_size ? (size_t) remaining : session->block_size;
+    ssize_t bytes_read = session_file_read(&session->file, packet->data, block_size, session->read_offset);
+    session->read_offset += bytes_read;
+    session->last_block_size = bytes_read;
+    tftp_data_packet_init(packet, session->next_data_packet_to_send);
+    return true;
+}
+
+// The payload of holes is never read nor copied, send_data_packet takes it from a shared zero buffer.
+static bool fetch_data_hole(struct tftp_session session[static 1]) {
+    const uint16_t packet_index = ((uint16_t) (session->next_data_packet_to_send - 1)) % session->window_size;
+    const size_t offset = packet_index * (sizeof(struct tftp_data_packet) + session->block_size);
+    struct tftp_data_packet *packet = (void *) ((uint8_t *) session->data_packets + offset);
+    const size_t hole_size = get_next_hole_size(session);
+    session->zero_packets[packet_index] = true;
+    session->read_offset += hole_size;
+    session->last_block_size = hole_size;
+    tftp_data_packet_init(packet, session->next_data_packet_to_send);
+    return true;
+}
+
 /**
  * This is comically bad but I don't plan to improve this in the near future.
  */
@@ -740,10 +1459,10 @@ static bool fetch_data_netascii_async(struct tftp_session session[static 1]) {
             *block++ = session->netascii_buffer;
             session->netascii_buffer = -1;
         }
-        ssize_t byte_read = read(session->file_descriptor, block, 1);
+        ssize_t byte_read = session_file_read(&session->file, block, 1, session->read_offset);
         if (byte_read == -1) {
             logger_log_error(session->logger, "Error while reading from source: %s", strerror(errno));
-            session->stats.error = (struct tftp_session_stats_error) {
+            session->cold->stats.error = (struct tftp_session_stats_error) {
                 .error_occurred = true,
                 .error_number = TFTP_ERROR_NOT_DEFINED,
                 .error_message = "Error while reading from source"
@@ -753,6 +1472,7 @@ static bool fetch_data_netascii_async(struct tftp_session session[static 1]) {
         if (byte_read == 0) {
             break;
         }
+        session->read_offset += byte_read;
         int c = *block++;
         if (c == '\n' || c == '\r') {
             if (block - packet->data == session->block_size) {
@@ -774,16 +1494,29 @@ static bool fetch_data_netascii_async(struct tftp_session session[static 1]) {
 }
 
 static bool recv_async(struct tftp_session session[static 1]) {
-    session->connection.last_message_address.addrlen = sizeof session->connection.last_message_address.storage;
-    session->connection.iovec[0].iov_base = session->connection.recv_buffer;
-    session->connection.iovec[0].iov_len = session->connection.recv_buffer_size;
-    session->connection.msghdr.msg_name = &session->connection.last_message_address.storage;
-    session->connection.msghdr.msg_namelen = session->connection.last_message_address.addrlen;
-    bool ret = dispatcher_submit_recvmsg(session->dispatcher,
-                                         &session->event_packet_received,
-                                         session->connection.sockfd,
-                                         &session->connection.msghdr,
-                                         0);
+    if (session->connection.is_shared) {
+        // the worker hands the next packet of the client over, see tftp_session_handle_packet
+        session->connection.is_recv_armed = true;
+        session->pending_jobs++;
+        return true;
+    }
+    bool ret;
+    if (session->connection.is_timestamping_enabled) {
+        session_connection_prepare_recv(&session->connection);
+        ret = dispatcher_submit_recvmsg(session->dispatcher,
+                                        &session->event_packet_received,
+                                        session->connection.sockfd,
+                                        &session->connection.recv_msghdr,
+                                        0);
+    }
+    else {
+        ret = dispatcher_submit_recv(session->dispatcher,
+                                     &session->event_packet_received,
+                                     session->connection.sockfd,
+                                     session->connection.recv_buffer,
+                                     session->connection.recv_buffer_size,
+                                     0);
+    }
     if (!ret) {
         logger_log_error(session->logger, "Error while submitting receive new data request.");
         return false;
@@ -793,6 +1526,13 @@ static bool recv_async(struct tftp_session session[static 1]) {
 }
 
 static bool recv_async_cancel(struct tftp_session session[static 1]) {
+    if (session->connection.is_shared) {
+        if (session->connection.is_recv_armed) {
+            session->connection.is_recv_armed = false;
+            session->pending_jobs--;
+        }
+        return true;
+    }
     bool ret = dispatcher_submit_cancel(session->dispatcher, &session->event_cancel_packet_received, &session->event_packet_received);
     if (!ret) {
         logger_log_error(session->logger, "Error while submitting cancel receive new data request.");
@@ -802,36 +1542,95 @@ static bool recv_async_cancel(struct tftp_session session[static 1]) {
     return true;
 }
 
-static bool submit_timeout(struct tftp_session session[static 1]) {
-    if (!dispatcher_submit_timeout(session->dispatcher, &session->event_timeout)) {
-        logger_log_error(session->logger, "Could not submit timeout.");
+static bool stray_recv_async(struct tftp_session session[static 1]) {
+    session->connection.stray_msghdr.msg_name = &session->connection.stray_address.storage;
+    session->connection.stray_msghdr.msg_namelen = sizeof session->connection.stray_address.storage;
+    bool ret = dispatcher_submit_recvmsg(session->dispatcher,
+                                         &session->event_stray_packet_received,
+                                         session->connection.stray_sockfd,
+                                         &session->connection.stray_msghdr,
+                                         0);
+    if (!ret) {
+        logger_log_error(session->logger, "Error while submitting receive stray packet request.");
+        return false;
+    }
+    session->pending_jobs++;
+    session->is_stray_recv_active = true;
+    return true;
+}
+
+static bool stray_recv_async_cancel(struct tftp_session session[static 1]) {
+    bool ret = dispatcher_submit_cancel(session->dispatcher, &session->event_cancel_stray_packet_received, &session->event_stray_packet_received);
+    if (!ret) {
+        logger_log_error(session->logger, "Error while submitting cancel receive stray packet request.");
         return false;
     }
     session->pending_jobs++;
-    session->is_timer_active = true;
+    session->is_stray_recv_active = false;
     return true;
 }
 
-static bool submit_cancel_timeout(struct tftp_session session[static 1]) {
-    if (!dispatcher_submit_timeout_cancel(session->dispatcher, &session->event_cancel_timeout, &session->event_timeout)) {
-        logger_log_error(session->logger, "Error while submitting cancel timeout request.");
+// Arms or re-arms the retransmission timeout.
+static void start_timeout(struct tftp_session session[static 1]) {
+    timer_wheel_arm(session->timer_wheel, &session->timeout_timer, timer_wheel_get_tick(), session->timeout_ticks);
+}
+
+static void stop_timeout(struct tftp_session session[static 1]) {
+    timer_wheel_cancel(session->timer_wheel, &session->timeout_timer);
+}
+
+// Holds the next new DATA packet until its pacing time, is_held is set while the pacing timer is armed.
+static bool pace(struct tftp_session session[static 1], bool is_held[static 1]) {
+    *is_held = session->is_pacing_timer_active;
+    if (!session->server_info->is_pacing_enabled || session->is_pacing_timer_active) {
+        return true;
+    }
+    const uint64_t now = get_monotonic_time_ns();
+    if (now >= session->pacing_next_send) {
+        return true;
+    }
+    const uint64_t delay = session->pacing_next_send - now;
+    session->event_pacing.timeout = (struct __kernel_timespec) {.tv_sec = delay / 1'000'000'000, .tv_nsec = delay % 1'000'000'000};
+    if (!dispatcher_submit_timeout(session->dispatcher, &session->event_pacing)) {
+        logger_log_error(session->logger, "Could not submit pacing timeout.");
         return false;
     }
     session->pending_jobs++;
-    session->is_timer_active = false;
+    session->is_pacing_timer_active = true;
+    *is_held = true;
     return true;
 }
 
+static bool pacing_timer_cancel(struct tftp_session session[static 1]) {
+    if (!dispatcher_submit_timeout_cancel(session->dispatcher, &session->event_cancel_pacing, &session->event_pacing)) {
+        logger_log_error(session->logger, "Error while submitting cancel pacing timeout request.");
+        return false;
+    }
+    session->pending_jobs++;
+    session->is_pacing_timer_active = false;
+    return true;
+}
+
+// The first request of each version is served without the digest, it is hashed in the background for the next ones.
+static bool get_file_digest(struct tftp_session session[static 1], uint64_t digest[static 1]) {
+    const struct stat *file_stat = session_file_stat(&session->file);
+    if (digest_cache_lookup(session->server_info->digest_cache, file_stat, digest)) {
+        return true;
+    }
+    digest_cache_request(session->server_info->digest_cache, session->server_info->root, session->cold->filename, file_stat);
+    return false;
+}
+
 static bool oack_packet_init(struct tftp_session session[static 1]) {
     size_t options_values_length = 0;
     for (enum tftp_option_recognized option = 0; option < TFTP_OPTION_TOTAL_OPTIONS; option++) {
-        if (session->options.recognized_options[option].is_active) {
+        if (session->cold->options.recognized_options[option].is_active) {
             options_values_length += strlen(tftp_option_recognized_string[option]) + 1;
-            options_values_length += strlen(session->options.recognized_options[option].value) + 1;
+            options_values_length += strlen(session->cold->options.recognized_options[option].value) + 1;
         }
     }
     ssize_t packet_len = sizeof(struct tftp_oack_packet) + options_values_length;
-    session->oack_packet = malloc(packet_len);
+    session->oack_packet = slab_alloc(session->allocator, packet_len);
     if (session->oack_packet == nullptr) {
         logger_log_error(session->logger, "Not enough memory: %s", strerror(errno));
         return false;
@@ -839,11 +1638,11 @@ static bool oack_packet_init(struct tftp_session session[static 1]) {
     session->oack_packet->opcode = htons(TFTP_OPCODE_OACK);
     unsigned char *ptr = session->oack_packet->options_values;
     for (enum tftp_option_recognized option = 0; option < TFTP_OPTION_TOTAL_OPTIONS; option++) {
-        if (session->options.recognized_options[option].is_active) {
+        if (session->cold->options.recognized_options[option].is_active) {
             size_t len = strlen(tftp_option_recognized_string[option]) + 1;
             ptr = (unsigned char *) memcpy(ptr, tftp_option_recognized_string[option], len) + len;
-            len = strlen(session->options.recognized_options[option].value) + 1;
-            ptr = (unsigned char *) memcpy(ptr, session->options.recognized_options[option].value, len) + len;
+            len = strlen(session->cold->options.recognized_options[option].value) + 1;
+            ptr = (unsigned char *) memcpy(ptr, session->cold->options.recognized_options[option].value, len) + len;
         }
     }
     session->oack_packet_size = packet_len;
@@ -851,10 +1650,10 @@ static bool oack_packet_init(struct tftp_session session[static 1]) {
 }
 
 static bool error_packet_init(struct tftp_session session[static 1]) {
-    free(session->error_packet);
+    slab_free(session->allocator, session->error_packet);
     session->error_packet = nullptr;
-    ssize_t packet_len = sizeof(struct tftp_error_packet) + strlen(session->stats.error.error_message) + 1;
-    session->error_packet = malloc(packet_len);
+    ssize_t packet_len = sizeof(struct tftp_error_packet) + strlen(session->cold->stats.error.error_message) + 1;
+    session->error_packet = slab_alloc(session->allocator, packet_len);
     if (session->error_packet == nullptr) {
         logger_log_error(session->logger, "Not enough memory: %s", strerror(errno));
         return false;
@@ -862,16 +1661,17 @@ static bool error_packet_init(struct tftp_session session[static 1]) {
     memcpy(session->error_packet,
            &(struct tftp_error_packet) {
                .opcode = htons(TFTP_OPCODE_ERROR),
-               .error_code = htons(session->stats.error.error_number)
+               .error_code = htons(session->cold->stats.error.error_number)
            },
            sizeof *session->error_packet);
-    strcpy((char *) session->error_packet->error_message, session->stats.error.error_message);
+    strcpy((char *) session->error_packet->error_message, session->cold->stats.error.error_message);
     session->error_packet_size = packet_len;
     return true;
 }
 
 static bool create_data_packets(struct tftp_session session[static 1], size_t bytes_read) {
     session->last_block_size += bytes_read;
+    session->read_offset += bytes_read;
     if (bytes_read < session->block_size && !end_of_file(session, bytes_read)) {
         session->incomplete_read = true;
         return false;
@@ -893,7 +1693,7 @@ static bool set_max_retransmissions_error(struct tftp_session session[static 1])
         return false;
     }
     sprintf(error_msg, fmt, session->current_retransmission);
-    session->stats.error = (struct tftp_session_stats_error) {
+    session->cold->stats.error = (struct tftp_session_stats_error) {
         .error_occurred = true,
         .error_number = TFTP_ERROR_NOT_DEFINED,
         .error_message = error_msg,
@@ -918,22 +1718,18 @@ static bool report_client_error(struct tftp_session session[static 1], size_t er
         }
         strcpy(error_message, (const char *) error_packet->error_message);
     }
-    session->stats.error = (struct tftp_session_stats_error) {
+    session->cold->stats.error = (struct tftp_session_stats_error) {
         .error_occurred = true,
         .error_number = error_code,
         .error_message = error_message,
     };
-    logger_log_warn(session->logger, "Error reported from client: %s", session->stats.error.error_message);
+    logger_log_warn(session->logger, "Error reported from client: %s", session->cold->stats.error.error_message);
     return true;
 }
 
 static bool end_of_file(struct tftp_session session[static 1], size_t bytes_read) {
-    off_t cur_offset = lseek(session->file_descriptor, 0, SEEK_CUR);
-    bool is_file_seekable = (cur_offset != -1);
-    if (!is_file_seekable) {
+    if (!session->file.is_seekable) {
         return bytes_read == 0;
     }
-    off_t end_offset = lseek(session->file_descriptor, 0, SEEK_END);
-    lseek(session->file_descriptor, cur_offset, SEEK_SET);
-    return cur_offset == end_offset;
+    return bytes_read == 0 || session->read_offset >= session->read_end;
 }
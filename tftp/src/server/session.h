@@ -14,9 +14,22 @@
 #include <buracchi/tftp/server_stats.h>
 #include <buracchi/tftp/server_session_stats.h>
 
+#include "congestion_control.h"
 #include "dispatcher.h"
+#include "content_cache.h"
+#include "digest_cache.h"
+#include "file_cache.h"
+#include "listing_cache.h"
+#include "negative_cache.h"
+#include "rtt_cache.h"
 #include "session_connection.h"
+#include "session_demux.h"
+#include "session_file.h"
 #include "session_options.h"
+#include "slab_allocator.h"
+#include "socket_pool.h"
+#include "timer_wheel.h"
+#include "window_budget.h"
 #include "../adaptive_timeout.h"
 
 enum session_request_type {
@@ -25,72 +38,125 @@ enum session_request_type {
 };
 
 struct tftp_server_info {
-    struct addrinfo* server_addrinfo;
     const char *root;
     uint8_t retries;
     uint8_t timeout;
+    uint8_t fast_retransmit_threshold;
+    uint8_t min_fec_group_size;
+    enum tftp_congestion_control congestion_control;
     bool is_adaptive_timeout_enabled;
+    bool is_pacing_enabled;
+    bool is_compression_enabled;
     bool is_write_request_enabled;
     bool is_list_request_enabled;
     void (*session_stats_callback)(struct tftp_session_stats *);
     struct tftp_server_stats *server_stats;
+    struct file_cache *file_cache;
+    struct content_cache *content_cache;
+    struct negative_cache *negative_cache;
+    struct listing_cache *listing_cache;
+    struct window_budget *window_budget;
+    struct rtt_cache *rtt_cache;
+    struct digest_cache *digest_cache;
+};
+
+// Send times of a packet, its ACK gives an RTT sample.
+struct session_rtt_sample {
+    struct timespec sent;           // CLOCK_MONOTONIC, read by the worker
+    struct timespec kernel_sent;    // kernel timestamp, see packet_timestamps.h
+    uint32_t timestamp_id;
+    bool has_kernel_timestamp;
+    bool is_valid;                  // false once the packet is retransmitted or its ACK sampled
+};
+
+/*
+ * Data used only when the session starts or closes.
+ * It is kept apart from struct tftp_session so that the state touched for every packet stays in a few cache lines.
+ */
+struct tftp_session_cold {
+    struct tftp_peer_message request_args;
+    const char *filename;
+    struct session_options options;
+    struct tftp_session_stats stats;
+    size_t window_memory;   // bytes reserved in the window budget
+    struct socket_pool *socket_pool;
+    struct session_demux *demux;    // nullptr unless the worker shares its sockets between sessions
+    uint16_t session_id;
+    struct session_rtt_sample oack_rtt_sample;
 };
 
 struct tftp_session {
-    volatile atomic_bool is_active;
+    /* per packet state */
     struct dispatcher *dispatcher;
+    struct slab_allocator *allocator;
     struct logger *logger;
-    struct tftp_peer_message request_args;
+    struct timer_wheel *timer_wheel;
     struct tftp_server_info *server_info;
-    bool is_timer_active;
-    
     enum session_request_type request_type;
-
-    int file_descriptor;
-    
-    const char *filename;
     enum tftp_mode mode;
-    uint8_t retries;
-    uint8_t timeout;
     uint16_t block_size;
     uint16_t window_size;
-    bool is_adaptive_timeout_active;
-    
-    uint8_t current_retransmission;
-    int total_retransmissions;
-    
     uint16_t window_begin;
     uint16_t next_data_packet_to_send;
     uint16_t expected_sequence_number;
-    
-    int netascii_buffer; // buffer for control character that won't fit in the current packet and must be split
-    int32_t last_packet;
     uint16_t last_block_size;   // last data packet may have less than block_size used bytes
-    bool incomplete_read;
-    
-    struct session_connection connection;
-    struct tftp_session_stats stats;
-    
-    struct session_options options;
-    
+    int32_t last_packet;
+    int netascii_buffer; // buffer for control character that won't fit in the current packet and must be split
+    uint32_t timeout_us;        // retransmission timeout while the adaptive timeout is not active
+    off_t read_offset;          // file offset of the next byte to read, the file descriptor may be shared with other sessions
+    off_t read_end;             // file offset past the last byte to send, the file size unless the length option is negotiated
+    uint8_t retries;
+    uint8_t current_retransmission;
+    uint8_t duplicate_acks;     // ACKs of the block before the window since the window last moved
+    uint8_t fec_group_size;     // 0 without the fec option
+    uint8_t fec_blocks_count;   // new DATA packets added to fec_packet
+    uint8_t pending_jobs;
+    uint16_t fec_payload_size;
+    uint16_t fec_size_parity;
+    bool is_stray_recv_active;
+    bool is_adaptive_timeout_active;
+    bool is_rtt_sampling_active;    // RTT samples are also taken for pacing without the adaptive timeout
+    bool is_selective_ack_active;
+    bool is_pipeline_active;
+    bool is_awaiting_next_file;     // the last block was acknowledged, the client may request another file until the timeout
+    bool is_pacing_timer_active;
     bool is_fetching_data;
     bool should_close;
+    bool incomplete_read;
+    int total_retransmissions;
+    int fast_retransmissions;
+    int packets_sent;
+    int packets_acked;
+    size_t bytes_sent;
+    uint64_t pacing_next_send;  // CLOCK_MONOTONIC time in nanoseconds before which no new DATA packet is sent
+    struct tftp_data_packet *data_packets;
+    bool *zero_packets;     // for files with holes, DATA packets whose payload is sent from a shared zero buffer
+    struct session_rtt_sample *rtt_samples;     // one for each DATA packet of the window storage
+    bool *sacked_packets;   // DATA packets of the window the client reported in a SACK, they are not retransmitted
+    struct tftp_fec_packet *fec_packet;
     
-    uint8_t pending_jobs;
     struct dispatcher_event event_start;
-    struct dispatcher_event event_cancel_timeout;
-    struct dispatcher_event_timeout event_timeout;
     struct dispatcher_event event_cancel_packet_received;
     struct dispatcher_event event_packet_received;
     struct dispatcher_event event_next_block;
+    struct dispatcher_event event_cancel_stray_packet_received;
+    struct dispatcher_event event_stray_packet_received;
+    struct dispatcher_event event_cancel_pacing;
+    struct dispatcher_event_timeout event_pacing;
     
+    struct timer_wheel_timer timeout_timer;
+    uint64_t timeout_ticks;     // retransmission timeout
     struct adaptive_timeout adaptive_timeout;
+    struct congestion_control congestion_control;
+    struct session_file file;
+    struct session_connection connection;
     
+    /* start and close state */
+    struct tftp_session_cold *cold;
     struct tftp_error_packet *error_packet;
     size_t error_packet_size;
     struct tftp_oack_packet *oack_packet;
     size_t oack_packet_size;
-    struct tftp_data_packet *data_packets;
 };
 
 enum tftp_session_state {
@@ -100,11 +166,19 @@ enum tftp_session_state {
 };
 
 void tftp_session_init(struct tftp_session session[static 1],
+                       struct tftp_session_cold cold[static 1],
                        uint16_t session_id,
                        struct tftp_server_info server_info[static 1],
                        struct dispatcher dispatcher[static 1],
+                       struct slab_allocator allocator[static 1],
+                       struct socket_pool socket_pool[static 1],
+                       struct session_demux *demux,
+                       struct timer_wheel timer_wheel[static 1],
                        struct logger logger[static 1]);
 
 enum tftp_session_state tftp_session_handle_event(struct tftp_session session[static 1], struct dispatcher_event event[static 1]);
 
+// Delivers a packet of the client received on the shared socket of the session.
+enum tftp_session_state tftp_session_handle_packet(struct tftp_session session[static 1], const void *packet, size_t packet_size);
+
 #endif // TFTP_SESSION_H
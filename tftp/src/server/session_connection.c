@@ -3,21 +3,25 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
 
 #include "../utils/inet.h"
 
+static bool connect_pooled_socket(struct session_connection connection[static 1], struct socket_pool socket_pool[static 1], bool is_ipv4, struct logger logger[static 1]);
+static bool register_shared_socket(struct session_connection connection[static 1], struct session_demux demux[static 1], uint16_t session_id, struct logger logger[static 1]);
+
 bool session_connection_init(struct session_connection connection[static 1],
-                             struct addrinfo session_addr[static 1],
+                             struct socket_pool socket_pool[static 1],
+                             struct session_demux *demux,
+                             uint16_t session_id,
                              struct sockaddr_storage client_addr,
                              socklen_t client_addrlen,
                              bool is_ipv4,
                              struct logger logger[static 1]) {
     *connection = (struct session_connection) {
         .sockfd = -1,
+        .stray_sockfd = -1,
         .address = (struct inet_address) {
             .str = nullptr,
-            .addrlen = session_addr->ai_addrlen,
             .sockaddr = (struct sockaddr *) &connection->address.storage,
         },
         .client_address = (struct inet_address) {
@@ -26,36 +30,106 @@ bool session_connection_init(struct session_connection connection[static 1],
             .addrlen = client_addrlen,
             .sockaddr = (struct sockaddr *) &connection->client_address.storage,
         },
-        .msghdr = {},
-        .iovec = {},
-        .recv_buffer = malloc(tftp_default_blksize),
-        .recv_buffer_size = tftp_default_blksize,
+        .stray_address = (struct inet_address) {
+            .str = nullptr,
+            .sockaddr = (struct sockaddr *) &connection->stray_address.storage,
+        },
+        .stray_msghdr = {},
+        .stray_iovec = {},
+        .recv_buffer = nullptr,
+        .recv_buffer_size = 0,
+        .is_shared = demux != nullptr,
+        .is_timestamping_enabled = false,
+        .next_timestamp_id = 0,
+        .recv_timestamp = {},
     };
     {   // TODO: Remove block statement when io_uring_prep_recvfrom will be available.
-        connection->msghdr.msg_iov = connection->iovec;
-        connection->msghdr.msg_iovlen = 1;
-        connection->msghdr.msg_control = nullptr;
-        connection->msghdr.msg_controllen = 0;
-        connection->msghdr.msg_flags = 0;
+        connection->stray_iovec[0].iov_base = connection->stray_buffer;
+        connection->stray_iovec[0].iov_len = sizeof connection->stray_buffer;
+        connection->stray_msghdr.msg_iov = connection->stray_iovec;
+        connection->stray_msghdr.msg_iovlen = 1;
+        connection->stray_msghdr.msg_control = nullptr;
+        connection->stray_msghdr.msg_controllen = 0;
+        connection->stray_msghdr.msg_flags = 0;
     }
     
-    if (connection->recv_buffer == nullptr) {
-        logger_log_error(logger, "Could not allocate memory for the receive buffer.");
+    if (connection->is_shared) {
+        // the shared sockets serve IPv4 peers through their mapped address
+        connection->client_address.addrlen = client_addr.ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        if (!register_shared_socket(connection, demux, session_id, logger)) {
+            return false;
+        }
+    }
+    else if (!connect_pooled_socket(connection, socket_pool, is_ipv4, logger)) {
         return false;
     }
-    memcpy(&connection->address.storage, session_addr->ai_addr, session_addr->ai_addrlen);
-    
+    // set misc fields
+    if (sockaddr_ntop(connection->address.sockaddr, connection->address.str_storage, &connection->address.port) != nullptr) {
+        connection->address.str = connection->address.str_storage;
+    }
+    else {
+        logger_log_error(logger, "Could not translate session address to a string representation.");
+    }
+    if (sockaddr_ntop(connection->client_address.sockaddr, connection->client_address.str_storage, &connection->client_address.port) != nullptr) {
+        connection->client_address.str = connection->client_address.str_storage;
+    }
+    else {
+        logger_log_error(logger, "Could not translate client address to a string representation.");
+    }
+    return true;
+}
+
+void session_connection_destroy(struct session_connection connection[static 1],
+                                struct socket_pool socket_pool[static 1],
+                                struct session_demux *demux,
+                                struct logger logger[static 1]) {
+    if (connection->is_shared) {
+        logger_log_debug(logger, "Unregistering connection from the shared socket.");
+        session_demux_unregister(demux, connection->client_address.sockaddr, connection->shared_socket_index);
+        return;
+    }
+    if (connection->is_timestamping_enabled && !packet_timestamps_disable(connection->sockfd)) {
+        logger_log_warn(logger, "Could not disable packet timestamps: %s", strerror(errno));
+    }
+    logger_log_debug(logger, "Returning connection socket to the pool.");
+    socket_pool_release(socket_pool, &(struct socket_pool_socket) {
+        .file_descriptor = connection->sockfd,
+        .stray_file_descriptor = connection->stray_sockfd,
+        .address = connection->address.storage,
+        .addrlen = connection->address.addrlen,
+    });
+}
+
+bool session_connection_enable_timestamping(struct session_connection connection[static 1], struct logger logger[static 1]) {
+    if (connection->is_shared) {
+        return false;
+    }
+    if (!packet_timestamps_enable(connection->sockfd)) {
+        logger_log_debug(logger, "Could not enable packet timestamps, RTT is measured by the worker: %s", strerror(errno));
+        return false;
+    }
+    connection->is_timestamping_enabled = true;
+    connection->next_timestamp_id = 0;
+    return true;
+}
+
+void session_connection_prepare_recv(struct session_connection connection[static 1]) {
+    connection->recv_iovec[0] = (struct iovec) {
+        .iov_base = connection->recv_buffer,
+        .iov_len = connection->recv_buffer_size,
+    };
+    connection->recv_msghdr = (struct msghdr) {
+        .msg_iov = connection->recv_iovec,
+        .msg_iovlen = 1,
+        .msg_control = connection->recv_control,
+        .msg_controllen = sizeof connection->recv_control,
+    };
+}
+
+static bool connect_pooled_socket(struct session_connection connection[static 1], struct socket_pool socket_pool[static 1], bool is_ipv4, struct logger logger[static 1]) {
     if (is_ipv4) {
         logger_log_debug(logger, "Peer request an IPV4 response, using an IPV4 connection to support an IPV6 unaware client.");
-        struct sockaddr_storage ipv4_serv_addr = {};
         struct sockaddr_storage ipv4_clnt_addr = {};
-        if (sockaddr_in6_to_in((const struct sockaddr_in6 *) &connection->address.storage, (struct sockaddr_in *) &ipv4_serv_addr) < 0) {
-            logger_log_error(logger, "Could not translate server address to an IPV4 address.");
-            return false;
-        }
-        memcpy(&connection->address.storage, &ipv4_serv_addr, sizeof ipv4_serv_addr);
-        connection->address.addrlen = sizeof(struct sockaddr_in);
-        connection->address.storage.ss_family = AF_INET;
         if (sockaddr_in6_to_in((const struct sockaddr_in6 *) &connection->client_address.storage, (struct sockaddr_in *) &ipv4_clnt_addr) < 0) {
             logger_log_error(logger, "Could not translate peer address to an IPV4 address.");
             return false;
@@ -66,52 +140,33 @@ bool session_connection_init(struct session_connection connection[static 1],
     else {
         connection->client_address.addrlen = sizeof(struct sockaddr_in6);
     }
-    connection->sockfd = socket(connection->address.storage.ss_family, SOCK_DGRAM, 0);
-    if (connection->sockfd == -1) {
-        logger_log_error(logger, "Could not create socket: %s", strerror(errno));
-        return false;
-    }
-    // use an available ephemeral port for binding
-    in_port_t *port = is_ipv4 ?
-                      &((struct sockaddr_in *) &connection->address.storage)->sin_port :
-                      &((struct sockaddr_in6 *) &connection->address.storage)->sin6_port;
-    *port = 0;
-    if (bind(connection->sockfd, connection->address.sockaddr, connection->address.addrlen) == -1) {
-        logger_log_error(logger, "Could not bind socket: %s", strerror(errno));
-        close(connection->sockfd);
+    struct socket_pool_socket socket;
+    if (!socket_pool_acquire(socket_pool, is_ipv4 ? AF_INET : AF_INET6, &socket)) {
+        logger_log_error(logger, "Could not get a session socket: %s", strerror(errno));
         return false;
     }
-    if (getsockname(connection->sockfd, connection->address.sockaddr, &connection->address.addrlen) == -1) {
-        logger_log_error(logger, "Could not get socket name: %s", strerror(errno));
-        close(connection->sockfd);
+    connection->sockfd = socket.file_descriptor;
+    connection->stray_sockfd = socket.stray_file_descriptor;
+    connection->address.storage = socket.address;
+    connection->address.addrlen = socket.addrlen;
+    if (connect(connection->sockfd, connection->client_address.sockaddr, connection->client_address.addrlen) == -1) {
+        logger_log_error(logger, "Could not connect socket to the client: %s", strerror(errno));
+        session_connection_destroy(connection, socket_pool, nullptr, logger);
+        connection->sockfd = -1;
+        connection->stray_sockfd = -1;
         return false;
     }
-    // set misc fields
-    connection->last_message_address = (struct inet_address) {
-        .str = nullptr,
-        .storage = connection->client_address.storage,
-        .addrlen = connection->client_address.addrlen,
-        .sockaddr = (struct sockaddr *) &connection->last_message_address.storage,
-    };
-    if (sockaddr_ntop(connection->address.sockaddr, connection->address.str_storage, &connection->address.port) != nullptr) {
-        connection->address.str = connection->address.str_storage;
-    }
-    else {
-        logger_log_error(logger, "Could not translate session address to a string representation.");
-    }
-    if (sockaddr_ntop(connection->client_address.sockaddr, connection->client_address.str_storage, &connection->client_address.port) != nullptr) {
-        connection->client_address.str = connection->client_address.str_storage;
-        connection->last_message_address.str = connection->client_address.str;
-        connection->last_message_address.port = connection->client_address.port;
-    }
-    else {
-        logger_log_error(logger, "Could not translate client address to a string representation.");
-    }
     return true;
 }
 
-bool session_connection_destroy(struct session_connection connection[static 1], struct logger logger[static 1]) {
-    logger_log_debug(logger, "Closing connection socket.");
-    free(connection->recv_buffer);
-    return close(connection->sockfd);
+static bool register_shared_socket(struct session_connection connection[static 1], struct session_demux demux[static 1], uint16_t session_id, struct logger logger[static 1]) {
+    if (!session_demux_register(demux, connection->client_address.sockaddr, session_id, &connection->shared_socket_index)) {
+        logger_log_error(logger, "Client already has a session on every shared socket.");
+        return false;
+    }
+    const struct session_demux_socket *socket = &demux->sockets[connection->shared_socket_index];
+    connection->sockfd = socket->file_descriptor;
+    connection->address.storage = socket->address;
+    connection->address.addrlen = socket->addrlen;
+    return true;
 }
@@ -7,6 +7,10 @@
 #include <logger.h>
 #include <tftp.h>
 
+#include "packet_timestamps.h"
+#include "session_demux.h"
+#include "socket_pool.h"
+
 struct inet_address {
     char str_storage[INET6_ADDRSTRLEN];
     uint16_t port;
@@ -17,27 +21,57 @@ struct inet_address {
 };
 
 struct session_connection {
-    int sockfd;
+    int sockfd;             // connected to the client, the kernel filters out the packets of other peers
+    int stray_sockfd;       // bound to the same address, receives the packets of unknown transfer IDs
+    bool is_shared;         // sockfd is a shared socket of the worker, the worker routes the client packets
+    bool is_recv_armed;     // shared socket only, the next packet of the client is delivered to recv_buffer
+    bool is_timestamping_enabled;   // the kernel timestamps the packets of sockfd, see packet_timestamps.h
+    size_t shared_socket_index;
     
     struct inet_address address;
     struct inet_address client_address;
-    struct inet_address last_message_address;
+    struct inet_address stray_address;  // sender of the last packet received on stray_sockfd
     
-    uint8_t *recv_buffer;
+    uint8_t *recv_buffer;    // allocated by the session once the block size is negotiated
     size_t recv_buffer_size;
+    uint32_t next_timestamp_id;         // id of the timestamp of the next datagram sent on sockfd
+    struct timespec recv_timestamp;     // kernel timestamp of the last packet received, zero when there is none
+    struct msghdr recv_msghdr;          // packets are received with recvmsg to get their timestamp
+    struct iovec recv_iovec[1];
+    alignas(struct cmsghdr) uint8_t recv_control[packet_timestamps_control_size];
+    uint8_t stray_buffer[4];
     // TODO: As of Linux kernel version 6.10.4 IO_URING_OP_RECVFROM is not implemented, this is a workaround.
     //  Remove this fields and use io_uring_prep_recvfrom when available.
-    struct msghdr msghdr;
-    struct iovec iovec[1];
+    struct msghdr stray_msghdr;
+    struct iovec stray_iovec[1];
 };
 
+/*
+ * Connects a socket of the pool to the client.
+ * When demux is not nullptr the session is registered on one of the shared sockets of the worker instead.
+ */
 bool session_connection_init(struct session_connection connection[static 1],
-                             struct addrinfo session_addr[static 1],
+                             struct socket_pool socket_pool[static 1],
+                             struct session_demux *demux,
+                             uint16_t session_id,
                              struct sockaddr_storage client_addr,
                              socklen_t client_addrlen,
                              bool is_ipv4,
                              struct logger logger[static 1]);
 
-bool session_connection_destroy(struct session_connection connection[static 1], struct logger logger[static 1]);
+/*
+ * Enables the kernel timestamps of the packets sent and received on the session socket.
+ * Shared sockets are not timestamped: the timestamps of the packets of every session would be queued on the same socket.
+ */
+bool session_connection_enable_timestamping(struct session_connection connection[static 1], struct logger logger[static 1]);
+
+// Prepares recv_msghdr to receive the next packet of the client into recv_buffer.
+void session_connection_prepare_recv(struct session_connection connection[static 1]);
+
+// Returns the socket to the pool it was taken from, or unregisters the session from its shared socket.
+void session_connection_destroy(struct session_connection connection[static 1],
+                                struct socket_pool socket_pool[static 1],
+                                struct session_demux *demux,
+                                struct logger logger[static 1]);
 
 #endif // TFTP_SERVER_CONNECTION_H
@@ -0,0 +1,202 @@
+#include "session_demux.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../utils/hash.h"
+
+static bool entry_key_init(struct session_demux_entry key[static 1], const struct sockaddr peer_address[static 1], uint16_t local_port);
+static size_t entry_hash(const struct session_demux_entry entry[static 1]);
+static bool find(const struct session_demux demux[static 1], const struct session_demux_entry key[static 1], size_t slot[static 1]);
+static int socket_bind(struct session_demux demux[static 1], struct session_demux_socket entry[static 1]);
+
+bool session_demux_init(struct session_demux demux[static 1],
+                        const struct sockaddr server_address[static 1],
+                        socklen_t server_addrlen,
+                        uint16_t first_port,
+                        size_t sockets_count,
+                        size_t max_sessions,
+                        struct logger logger[static 1]) {
+    size_t capacity = 1;
+    while (capacity < 2 * max_sessions + 1) {
+        capacity *= 2;
+    }
+    *demux = (struct session_demux) {
+        .logger = logger,
+        .sockets = calloc(sockets_count, sizeof *demux->sockets),
+        .mask = capacity - 1,
+        .entries = calloc(capacity, sizeof *demux->entries),
+    };
+    if (demux->sockets == nullptr || demux->entries == nullptr) {
+        logger_log_error(logger, "Could not allocate memory for the shared sockets. %s", strerror(errno));
+        goto fail;
+    }
+    if (first_port == 0 || sockets_count == 0 || first_port + sockets_count - 1 > UINT16_MAX) {
+        logger_log_error(logger, "Invalid shared socket port range %hu + %zu.", first_port, sockets_count);
+        goto fail;
+    }
+    for (; demux->sockets_count < sockets_count; demux->sockets_count++) {
+        auto entry = &demux->sockets[demux->sockets_count];
+        memcpy(&entry->address, server_address, server_addrlen);
+        entry->addrlen = server_addrlen;
+        entry->port = first_port + demux->sockets_count;
+        if (server_address->sa_family == AF_INET6) {
+            ((struct sockaddr_in6 *) &entry->address)->sin6_port = htons(entry->port);
+        }
+        else {
+            ((struct sockaddr_in *) &entry->address)->sin_port = htons(entry->port);
+        }
+        entry->file_descriptor = socket_bind(demux, entry);
+        if (entry->file_descriptor == -1) {
+            goto fail2;
+        }
+    }
+    return true;
+fail2:
+    for (size_t i = 0; i < demux->sockets_count; i++) {
+        close(demux->sockets[i].file_descriptor);
+    }
+fail:
+    free(demux->sockets);
+    free(demux->entries);
+    return false;
+}
+
+void session_demux_destroy(struct session_demux demux[static 1]) {
+    for (size_t i = 0; i < demux->sockets_count; i++) {
+        close(demux->sockets[i].file_descriptor);
+    }
+    free(demux->sockets);
+    free(demux->entries);
+}
+
+bool session_demux_register(struct session_demux demux[static 1],
+                            const struct sockaddr peer_address[static 1],
+                            uint16_t session_id,
+                            size_t socket_index[static 1]) {
+    if (demux->count == demux->mask) {
+        return false;   // an empty slot always ends the probe sequences
+    }
+    // spread the sessions over the sockets, a peer only needs another socket for its concurrent sessions
+    for (size_t i = 0; i < demux->sockets_count; i++) {
+        const size_t index = (session_id + i) % demux->sockets_count;
+        struct session_demux_entry key;
+        if (!entry_key_init(&key, peer_address, demux->sockets[index].port)) {
+            return false;
+        }
+        size_t slot;
+        if (find(demux, &key, &slot)) {
+            continue;
+        }
+        key.session_id = session_id;
+        key.is_used = true;
+        demux->entries[slot] = key;
+        demux->count++;
+        *socket_index = index;
+        return true;
+    }
+    return false;
+}
+
+void session_demux_unregister(struct session_demux demux[static 1],
+                              const struct sockaddr peer_address[static 1],
+                              size_t socket_index) {
+    struct session_demux_entry key;
+    size_t hole;
+    if (!entry_key_init(&key, peer_address, demux->sockets[socket_index].port) || !find(demux, &key, &hole)) {
+        return;
+    }
+    demux->entries[hole].is_used = false;
+    demux->count--;
+    // backward shift deletion, entries of the probe sequence are moved back unless that would place them before their home slot
+    for (size_t i = (hole + 1) & demux->mask; demux->entries[i].is_used; i = (i + 1) & demux->mask) {
+        const size_t home = entry_hash(&demux->entries[i]) & demux->mask;
+        if (((i - home) & demux->mask) >= ((i - hole) & demux->mask)) {
+            demux->entries[hole] = demux->entries[i];
+            demux->entries[i].is_used = false;
+            hole = i;
+        }
+    }
+}
+
+bool session_demux_lookup(const struct session_demux demux[static 1],
+                          const struct sockaddr peer_address[static 1],
+                          size_t socket_index,
+                          uint16_t session_id[static 1]) {
+    struct session_demux_entry key;
+    size_t slot;
+    if (!entry_key_init(&key, peer_address, demux->sockets[socket_index].port) || !find(demux, &key, &slot)) {
+        return false;
+    }
+    *session_id = demux->entries[slot].session_id;
+    return true;
+}
+
+static bool entry_key_init(struct session_demux_entry key[static 1], const struct sockaddr peer_address[static 1], uint16_t local_port) {
+    *key = (struct session_demux_entry) {
+        .local_port = local_port,
+    };
+    switch (peer_address->sa_family) {
+        case AF_INET6: {
+            const struct sockaddr_in6 *ipv6 = (const struct sockaddr_in6 *) peer_address;
+            key->peer_address = ipv6->sin6_addr;
+            key->peer_port = ipv6->sin6_port;
+            return true;
+        }
+        case AF_INET: {
+            const struct sockaddr_in *ipv4 = (const struct sockaddr_in *) peer_address;
+            key->peer_address.s6_addr[10] = 0xFF;
+            key->peer_address.s6_addr[11] = 0xFF;
+            memcpy(&key->peer_address.s6_addr[12], &ipv4->sin_addr, sizeof ipv4->sin_addr);
+            key->peer_port = ipv4->sin_port;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static size_t entry_hash(const struct session_demux_entry entry[static 1]) {
+    // the peer address, the peer port and the local port are laid out without padding
+    return hash_bytes(entry, offsetof(struct session_demux_entry, session_id));
+}
+
+// Returns true if the key is in the table, slot is then its slot, otherwise the empty slot where it would be inserted.
+static bool find(const struct session_demux demux[static 1], const struct session_demux_entry key[static 1], size_t slot[static 1]) {
+    size_t i = entry_hash(key) & demux->mask;
+    for (; demux->entries[i].is_used; i = (i + 1) & demux->mask) {
+        const struct session_demux_entry *entry = &demux->entries[i];
+        if (entry->peer_port == key->peer_port
+            && entry->local_port == key->local_port
+            && memcmp(&entry->peer_address, &key->peer_address, sizeof key->peer_address) == 0) {
+            *slot = i;
+            return true;
+        }
+    }
+    *slot = i;
+    return false;
+}
+
+static int socket_bind(struct session_demux demux[static 1], struct session_demux_socket entry[static 1]) {
+    int file_descriptor = socket(entry->address.ss_family, SOCK_DGRAM, 0);
+    if (file_descriptor == -1) {
+        logger_log_error(demux->logger, "Could not create shared socket: %s", strerror(errno));
+        return -1;
+    }
+    if (entry->address.ss_family == AF_INET6 && setsockopt(file_descriptor, IPPROTO_IPV6, IPV6_V6ONLY, &(int) {false}, sizeof(int)) == -1) {
+        logger_log_error(demux->logger, "Could not set shared socket options: %s", strerror(errno));
+        goto fail;
+    }
+    if (bind(file_descriptor, (struct sockaddr *) &entry->address, entry->addrlen) == -1) {
+        logger_log_error(demux->logger, "Could not bind shared socket to port %hu: %s", entry->port, strerror(errno));
+        goto fail;
+    }
+    return file_descriptor;
+fail:
+    int error = errno;
+    close(file_descriptor);
+    errno = error;
+    return -1;
+}
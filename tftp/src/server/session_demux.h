@@ -0,0 +1,80 @@
+#ifndef SESSION_DEMUX_H
+#define SESSION_DEMUX_H
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <logger.h>
+
+/*
+ * Per-worker set of UDP sockets bound to a fixed port range, shared by all the sessions of the worker.
+ * Datagrams received on a shared socket are routed to their session through an open addressing hash table keyed by
+ *  the peer address and port and by the local port of the socket, so that a peer can run a session on each socket.
+ * The demux is only touched by the worker thread and needs no locking.
+ */
+
+// Session id reserved for the events of the shared sockets, session ids are always lower.
+constexpr uint16_t session_demux_id = UINT16_MAX;
+
+struct session_demux_socket {
+    int file_descriptor;
+    uint16_t port;                      // host byte order
+    struct sockaddr_storage address;    // bound address
+    socklen_t addrlen;
+};
+
+struct session_demux_entry {
+    struct in6_addr peer_address;       // IPv4 peers are stored as IPv4-mapped IPv6 addresses
+    uint16_t peer_port;                 // network byte order
+    uint16_t local_port;                // host byte order
+    uint16_t session_id;
+    bool is_used;
+};
+
+struct session_demux {
+    struct logger *logger;
+    size_t sockets_count;
+    struct session_demux_socket *sockets;
+    size_t mask;                        // capacity of the table minus one, the capacity is a power of two
+    size_t count;
+    struct session_demux_entry *entries;
+};
+
+/*
+ * Binds sockets_count sockets to the ports starting at first_port of server_address, an IPv6 socket also serves IPv4
+ *  peers through IPv4-mapped addresses.
+ * The table is sized for max_sessions sessions at most half full.
+ */
+bool session_demux_init(struct session_demux demux[static 1],
+                        const struct sockaddr server_address[static 1],
+                        socklen_t server_addrlen,
+                        uint16_t first_port,
+                        size_t sockets_count,
+                        size_t max_sessions,
+                        struct logger logger[static 1]);
+
+void session_demux_destroy(struct session_demux demux[static 1]);
+
+/*
+ * Assigns the session a shared socket on which the peer has no other session and routes the datagrams of the peer on
+ *  that socket to it.
+ * Returns false if the peer already has a session on every shared socket.
+ */
+bool session_demux_register(struct session_demux demux[static 1],
+                            const struct sockaddr peer_address[static 1],
+                            uint16_t session_id,
+                            size_t socket_index[static 1]);
+
+void session_demux_unregister(struct session_demux demux[static 1],
+                              const struct sockaddr peer_address[static 1],
+                              size_t socket_index);
+
+// Returns false if no session is registered for the peer on the socket.
+bool session_demux_lookup(const struct session_demux demux[static 1],
+                          const struct sockaddr peer_address[static 1],
+                          size_t socket_index,
+                          uint16_t session_id[static 1]);
+
+#endif // SESSION_DEMUX_H
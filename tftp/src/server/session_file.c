@@ -4,121 +4,87 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <tftp.h>
 
+#include "../utils/io.h"
+
 static inline const char *get_full_path(const char filename[static 1], const char root[static 1]);
 
-static int open_directory_as_memfile(const char filename[static 1],
-                                     const char *root,
-                                     struct tftp_session_stats_error error[static 1]) {
-    const char *dir_path = root == nullptr ? filename : get_full_path(filename, root);
-    if (!dir_path) {
+bool session_file_init(struct session_file file[static 1],
+                       const char filename[static 1],
+                       const char *root,
+                       enum session_file_mode mode,
+                       enum tftp_read_type read_type,
+                       struct file_cache cache[static 1],
+                       struct content_cache content_cache[static 1],
+                       struct listing_cache listing_cache[static 1],
+                       struct tftp_session_stats_error error[static 1]) {
+    *file = (struct session_file) {
+        .descriptor = -1,
+        .size = -1,
+    };
+    const char *path = root == nullptr ? filename : get_full_path(filename, root);
+    if (path == nullptr) {
         *error = (struct tftp_session_stats_error) {
             .error_occurred = true,
             .error_number = TFTP_ERROR_NOT_DEFINED,
-            .error_message = "Could not allocate memory to calculate the directory path.",
+            .error_message = "Could not allocate memory to calculate the file path.",
         };
-        return -1;
+        return false;
     }
-    struct __dirstream *dir = opendir(dir_path);
-    if (dir == nullptr) {
-        *error = (struct tftp_session_stats_error) {
-            .error_occurred = true,
-            .error_number = TFTP_ERROR_FILE_NOT_FOUND,
-            .error_message = "Could not open directory.",
-        };
-        if (root != nullptr) {
-            free((void *)dir_path);
+    errno = 0;
+    if (mode == SESSION_FILE_MODE_READ && (read_type == TFTP_READ_TYPE_DIRECTORY || read_type == TFTP_READ_TYPE_DIRECTORY_DETAILED)) {
+        const enum listing_format format = read_type == TFTP_READ_TYPE_DIRECTORY ? LISTING_FORMAT_NAMES : LISTING_FORMAT_DETAILED;
+        file->listing_entry = listing_cache_acquire(listing_cache, path, format);
+        if (file->listing_entry != nullptr) {
+            file->descriptor = file->listing_entry->file_descriptor;
+            file->is_seekable = true;
+            file->size = file->listing_entry->size;
         }
-        return -1;
-    }
-    if (dir_path != filename) {
-        free((void *)dir_path);
-    }
-    size_t size = 0;
-    for (struct dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
-        size += strlen(entry->d_name) + 1; // +1 for newline
-    }
-    rewinddir(dir);
-    int pipefd[2];
-    if (pipe(pipefd) == -1) {
-        *error = (struct tftp_session_stats_error) {
-            .error_occurred = true,
-            .error_number = TFTP_ERROR_NOT_DEFINED,
-            .error_message = "Could not create pipe.",
-        };
-        return -1;
     }
-    if (fcntl(pipefd[0], F_SETPIPE_SZ, size) == -1) {
-        close(pipefd[0]);
-        close(pipefd[1]);
-        *error = (struct tftp_session_stats_error) {
-            .error_occurred = true,
-            .error_number = TFTP_ERROR_NOT_DEFINED,
-            .error_message = "Could not set pipe size.",
-        };
-        return -1;
-    }
-    for (struct dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
-        size_t len = strlen(entry->d_name);
-        if (write(pipefd[1], entry->d_name, len) != (ssize_t)len
-         || write(pipefd[1], "\n", 1) != 1) {
-            closedir(dir);
-            close(pipefd[0]);
-            close(pipefd[1]);
-            *error = (struct tftp_session_stats_error) {
-                .error_occurred = true,
-                .error_number = TFTP_ERROR_NOT_DEFINED,
-                .error_message = "Could not write to pipe.",
-            };
-            return -1;
+    else if (mode == SESSION_FILE_MODE_READ) {
+        file->cache_entry = file_cache_acquire(cache, path);
+        if (file->cache_entry != nullptr) {
+            file->descriptor = file->cache_entry->file_descriptor;
+            switch (file->cache_entry->stat.st_mode & S_IFMT) {
+                case S_IFREG:
+                    file->is_seekable = true;
+                    file->size = file->cache_entry->stat.st_size;
+                    break;
+                case S_IFBLK:
+                    size_t size;
+                    file->is_seekable = file_size_octet(file->descriptor, &size);
+                    file->size = file->is_seekable ? (off_t) size : -1;
+                    break;
+                default:
+                    break;
+            }
+            file->content_entry = content_cache_acquire(content_cache, file->cache_entry);
+            if (file->content_entry != nullptr) {
+                // the content is in memory, there is no reason to keep holding a descriptor
+                file->content = file->content_entry->data;
+                file->descriptor = -1;
+                file_cache_release(cache, file->cache_entry);
+                file->cache_entry = nullptr;
+                if (root != nullptr) {
+                    free((void *) path);
+                }
+                return true;
+            }
         }
     }
-    closedir(dir);
-    close(pipefd[1]);
-    return pipefd[0];
-}
-
-int session_file_init(const char filename[static 1],
-                      const char *root,
-                      enum session_file_mode mode,
-                      enum tftp_read_type read_type,
-                      struct tftp_session_stats_error error[static 1]) {
-    int file_descriptor;
-    int oflag;
-    if (mode == SESSION_FILE_MODE_READ && read_type == TFTP_READ_TYPE_DIRECTORY) {
-        return open_directory_as_memfile(filename, root, error);
-    }
-    switch (mode) {
-        case SESSION_FILE_MODE_READ:
-            oflag = O_RDONLY;
-            break;
-        case SESSION_FILE_MODE_WRITE:
-            oflag = O_CREAT | O_WRONLY | O_TRUNC;
-            break;
-        default:
-            oflag = O_RDONLY;
-    }
-    const char *path = root == nullptr ? filename : get_full_path(filename, root);
-    if (path == nullptr) {
-        *error = (struct tftp_session_stats_error) {
-            .error_occurred = true,
-            .error_number = TFTP_ERROR_NOT_DEFINED,
-            .error_message = "Could not allocate memory to calculate the file path.",
-        };
-        return -1;
+    else {
+        do {
+            file->descriptor = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+        } while (file->descriptor == -1 && errno == EINTR);
     }
-    errno = 0;
-    do {
-        file_descriptor = open(path, oflag, 0644);
-    } while (file_descriptor == -1 && errno == EINTR);
     if (root != nullptr) {
         free((void *) path);
     }
-    if (file_descriptor == -1) {
+    if (file->descriptor == -1) {
         enum tftp_error_code error_code;
         char *message;
         switch (errno) {
@@ -139,8 +105,96 @@ int session_file_init(const char filename[static 1],
             .error_number = error_code,
             .error_message = message,
         };
+        return false;
+    }
+    return true;
+}
+
+void session_file_destroy(struct session_file file[static 1],
+                          struct file_cache cache[static 1],
+                          struct content_cache content_cache[static 1],
+                          struct listing_cache listing_cache[static 1]) {
+    if (file->content_entry != nullptr) {
+        content_cache_release(content_cache, file->content_entry);
+    }
+    else if (file->listing_entry != nullptr) {
+        listing_cache_release(listing_cache, file->listing_entry);
+    }
+    else if (file->cache_entry != nullptr) {
+        file_cache_release(cache, file->cache_entry);
+    }
+    else if (file->descriptor != -1) {
+        close(file->descriptor);
+    }
+    file->content_entry = nullptr;
+    file->content = nullptr;
+    file->listing_entry = nullptr;
+    file->cache_entry = nullptr;
+    file->descriptor = -1;
+}
+
+ssize_t session_file_read(struct session_file file[static 1], void *buffer, size_t n, off_t offset) {
+    if (file->content_entry != nullptr) {
+        size_t available = offset < file->size ? file->size - offset : 0;
+        n = n < available ? n : available;
+        memcpy(buffer, &file->content[offset], n);
+        return n;
+    }
+    ssize_t bytes_read;
+    do {
+        bytes_read = file->is_seekable ? pread(file->descriptor, buffer, n, offset) : read(file->descriptor, buffer, n);
+    } while (bytes_read == -1 && errno == EINTR);
+    return bytes_read;
+}
+
+bool session_file_is_hole(const struct session_file file[static 1], off_t offset, size_t n) {
+    if (!session_file_has_holes(file) || n == 0) {
+        return false;
+    }
+    const struct file_extent *extents = file->cache_entry->data_extents;
+    size_t begin = 0;
+    size_t end = file->cache_entry->data_extents_count;
+    while (begin < end) {
+        const size_t middle = begin + (end - begin) / 2;
+        if (extents[middle].end <= offset) {
+            begin = middle + 1;
+        }
+        else {
+            end = middle;
+        }
+    }
+    // begin is the first extent ending after offset
+    return begin == file->cache_entry->data_extents_count || extents[begin].begin >= offset + (off_t) n;
+}
+
+bool session_file_compress(struct session_file file[static 1], struct content_cache content_cache[static 1]) {
+    if (file->content_entry == nullptr || !content_cache_compress(content_cache, file->content_entry)) {
+        return false;
+    }
+    file->content = file->content_entry->compressed_data;
+    file->size = (off_t) file->content_entry->compressed_size;
+    return true;
+}
+
+bool session_file_size(struct session_file file[static 1], enum tftp_mode mode, size_t size[static 1]) {
+    if (!file->is_seekable) {
+        return false;
+    }
+    if (mode == TFTP_MODE_OCTET) {
+        *size = file->size;
+        return true;
+    }
+    if (file->content_entry == nullptr) {
+        return file_size_netascii(file->descriptor, size);
+    }
+    size_t netascii_size = file->size;
+    for (off_t i = 0; i < file->size; i++) {
+        if (file->content[i] == '\n' || file->content[i] == '\r') {
+            ++netascii_size;
+        }
     }
-    return file_descriptor;
+    *size = netascii_size;
+    return true;
 }
 
 static inline const char *get_full_path(const char filename[static 1], const char root[static 1]) {
@@ -1,17 +1,68 @@
 #ifndef SESSION_FILE_H
 #define SESSION_FILE_H
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
 #include <buracchi/tftp/server_session_stats.h>
 
+#include "content_cache.h"
+#include "file_cache.h"
+#include "listing_cache.h"
+
 enum session_file_mode {
     SESSION_FILE_MODE_READ,
     SESSION_FILE_MODE_WRITE,
 };
 
-int session_file_init(const char filename[static 1],
-                      const char *root,
-                      enum session_file_mode mode,
-                      enum tftp_read_type read_type,
-                      struct tftp_session_stats_error error[static 1]);
+struct session_file {
+    int descriptor;
+    bool is_seekable;   // when false the descriptor must be read sequentially (e.g. pipes)
+    off_t size;         // valid only if is_seekable
+    struct file_cache_entry *cache_entry;
+    struct content_cache_entry *content_entry;
+    struct listing_cache_entry *listing_entry;
+    const uint8_t *content;     // whole file content when served from memory, descriptor is not valid in that case
+};
+
+bool session_file_init(struct session_file file[static 1],
+                       const char filename[static 1],
+                       const char *root,
+                       enum session_file_mode mode,
+                       enum tftp_read_type read_type,
+                       struct file_cache cache[static 1],
+                       struct content_cache content_cache[static 1],
+                       struct listing_cache listing_cache[static 1],
+                       struct tftp_session_stats_error error[static 1]);
+
+void session_file_destroy(struct session_file file[static 1],
+                          struct file_cache cache[static 1],
+                          struct content_cache content_cache[static 1],
+                          struct listing_cache listing_cache[static 1]);
+
+// Reads at offset if the file is seekable, otherwise from the current position of the descriptor.
+ssize_t session_file_read(struct session_file file[static 1], void *buffer, size_t n, off_t offset);
+
+// Metadata of the regular file being read, nullptr for listings, devices and files being written.
+static inline const struct stat *session_file_stat(const struct session_file file[static 1]) {
+    const struct stat *file_stat = file->content_entry != nullptr ? &file->content_entry->stat :
+                                   file->cache_entry != nullptr ? &file->cache_entry->stat :
+                                                                  nullptr;
+    return file_stat != nullptr && S_ISREG(file_stat->st_mode) ? file_stat : nullptr;
+}
+
+// Serves the compressed variant of a file read from memory, its size becomes the size of the compressed frames.
+bool session_file_compress(struct session_file file[static 1], struct content_cache content_cache[static 1]);
+
+// True if the file is known to contain holes, see session_file_is_hole.
+static inline bool session_file_has_holes(const struct session_file file[static 1]) {
+    return file->cache_entry != nullptr && file->cache_entry->data_extents != nullptr;
+}
+
+// True if the whole region [offset, offset + n) is known to read as zeros without being stored.
+bool session_file_is_hole(const struct session_file file[static 1], off_t offset, size_t n);
+
+// Size of the file once transferred in the given mode, fails for files whose size is not known in advance.
+bool session_file_size(struct session_file file[static 1], enum tftp_mode mode, size_t size[static 1]);
 
 #endif // SESSION_FILE_H
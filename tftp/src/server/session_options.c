@@ -3,7 +3,6 @@
 #include <string.h>
 
 #include "session_options.h"
-#include "../utils/io.h"
 
 static bool parse_mode(enum tftp_mode *mode, const char mode_str[static 1]);
 
@@ -12,18 +11,28 @@ bool session_options_init(struct session_options session_options[static 1],
                           const char options[static n],
                           const char *path[static 1],
                           enum tftp_mode mode[static 1],
-                          uint8_t timeout[static 1],
+                          uint32_t timeout_us[static 1],
                           uint16_t block_size[static 1],
                           uint16_t window_size[static 1],
                           bool adaptive_timeout[static 1],
+                          bool selective_ack[static 1],
+                          bool pipeline[static 1],
+                          uint8_t fec_group_size[static 1],
+                          off_t read_offset[static 1],
+                          off_t read_end[static 1],
                           struct tftp_session_stats_error error[static 1]) {
     *session_options = (struct session_options) {
         .path = path,
         .mode = mode,
-        .timeout = timeout,
+        .timeout_us = timeout_us,
         .block_size = block_size,
         .window_size = window_size,
         .adaptive_timeout = adaptive_timeout,
+        .selective_ack = selective_ack,
+        .pipeline = pipeline,
+        .fec_group_size = fec_group_size,
+        .read_offset = read_offset,
+        .read_end = read_end,
     };
     memcpy(session_options->options_storage, options, n);
     *path = &session_options->options_storage[0];
@@ -54,11 +63,32 @@ static bool parse_mode(enum tftp_mode *mode, const char mode_str[static 1]) {
     return false;
 }
 
-bool parse_options(struct session_options options[static 1], int file_descriptor, bool is_adaptive_timeout_enabled, bool is_list_request_enabled) {
+bool parse_options(struct session_options options[static 1], struct session_file file[static 1], bool is_adaptive_timeout_enabled, bool is_list_request_enabled, bool is_read_request, uint8_t min_fec_group_size, bool is_digest_enabled, bool is_compression_enabled) {
     tftp_parse_options(options->recognized_options, options->options_str_size, options->options_str);
     if (!is_list_request_enabled) {
         options->recognized_options[TFTP_OPTION_READ_TYPE].is_active = false;
     }
+    if (!is_read_request) {
+        options->recognized_options[TFTP_OPTION_SACK].is_active = false;
+        options->recognized_options[TFTP_OPTION_PIPELINE].is_active = false;
+    }
+    if (!is_read_request || min_fec_group_size == 0) {
+        options->recognized_options[TFTP_OPTION_FEC].is_active = false;
+    }
+    if (!is_read_request || *options->mode != TFTP_MODE_OCTET || !file->is_seekable) {
+        options->recognized_options[TFTP_OPTION_OFFSET].is_active = false;
+        options->recognized_options[TFTP_OPTION_LENGTH].is_active = false;
+    }
+    if (!is_read_request || !is_digest_enabled || *options->mode != TFTP_MODE_OCTET || session_file_stat(file) == nullptr) {
+        options->recognized_options[TFTP_OPTION_DIGEST].is_active = false;
+    }
+    // only files served from memory have a compressed variant, the compressed stream has no byte ranges nor pipelined files
+    if (!is_read_request || !is_compression_enabled || *options->mode != TFTP_MODE_OCTET || file->content_entry == nullptr
+        || options->recognized_options[TFTP_OPTION_OFFSET].is_active
+        || options->recognized_options[TFTP_OPTION_LENGTH].is_active
+        || options->recognized_options[TFTP_OPTION_PIPELINE].is_active) {
+        options->recognized_options[TFTP_OPTION_COMPRESS].is_active = false;
+    }
     if (is_adaptive_timeout_enabled) {
         const char *option = options->options_str;
         const char *end_ptr = &options->options_str[options->options_str_size - 1];
@@ -88,13 +118,15 @@ bool parse_options(struct session_options options[static 1], int file_descriptor
                         *options->adaptive_timeout = true;
                     }
                     else {
-                        *options->timeout = strtoul(options->recognized_options[o].value, nullptr, 10);
+                        *options->timeout_us = strtoul(options->recognized_options[o].value, nullptr, 10) * 1'000'000;
                     }
                     break;
+                case TFTP_OPTION_UTIMEOUT:
+                    *options->timeout_us = strtoul(options->recognized_options[o].value, nullptr, 10);
+                    break;
                 case TFTP_OPTION_TSIZE:
                     size_t size;
-                    auto file_size_cb = (*options->mode == TFTP_MODE_OCTET) ? file_size_octet : file_size_netascii;
-                    if (!file_size_cb(file_descriptor, &size)) {
+                    if (!session_file_size(file, *options->mode, &size)) {
                         // File does not support being queried for file size.
                         options->recognized_options[o].is_active = false;
                         break;
@@ -104,6 +136,40 @@ bool parse_options(struct session_options options[static 1], int file_descriptor
                 case TFTP_OPTION_WINDOWSIZE:
                     *options->window_size = strtoul(options->recognized_options[o].value, nullptr, 10);
                     break;
+                case TFTP_OPTION_SACK:
+                    *options->selective_ack = true;
+                    break;
+                case TFTP_OPTION_PIPELINE:
+                    *options->pipeline = true;
+                    break;
+                case TFTP_OPTION_FEC: {
+                    const unsigned long group_size = strtoul(options->recognized_options[o].value, nullptr, 10);
+                    if (group_size < min_fec_group_size) {
+                        // the overhead is above the server limit, the transfer goes on without FEC
+                        options->recognized_options[o].is_active = false;
+                        break;
+                    }
+                    *options->fec_group_size = group_size;
+                    break;
+                }
+                case TFTP_OPTION_OFFSET: {
+                    // an offset past the end of the file gives an empty transfer
+                    const unsigned long long offset = strtoull(options->recognized_options[o].value, nullptr, 10);
+                    *options->read_offset = offset < (unsigned long long) *options->read_end ? (off_t) offset : *options->read_end;
+                    break;
+                }
+                case TFTP_OPTION_LENGTH: {
+                    // handled after the offset, the enumeration order matters
+                    const unsigned long long length = strtoull(options->recognized_options[o].value, nullptr, 10);
+                    if (length < (unsigned long long) (*options->read_end - *options->read_offset)) {
+                        *options->read_end = *options->read_offset + (off_t) length;
+                    }
+                    break;
+                }
+                case TFTP_OPTION_DIGEST:
+                    // computed by the session, see session_options_set_digest
+                case TFTP_OPTION_COMPRESS:
+                    // served by the session, see session_file_compress
                 case TFTP_OPTION_READ_TYPE:
                     break;
                 default:
@@ -114,10 +180,30 @@ bool parse_options(struct session_options options[static 1], int file_descriptor
     return true;
 }
 
+void session_options_set_window(struct session_options options[static 1], uint16_t block_size, uint16_t window_size) {
+    // values can only shrink, the new ones always fit in the storage of the requested ones
+    if (options->recognized_options[TFTP_OPTION_BLKSIZE].is_active) {
+        sprintf((char *) options->recognized_options[TFTP_OPTION_BLKSIZE].value, "%hu", block_size);
+    }
+    if (options->recognized_options[TFTP_OPTION_WINDOWSIZE].is_active) {
+        sprintf((char *) options->recognized_options[TFTP_OPTION_WINDOWSIZE].value, "%hu", window_size);
+    }
+}
+
+void session_options_set_digest(struct session_options options[static 1], const uint64_t *digest) {
+    if (digest == nullptr) {
+        options->recognized_options[TFTP_OPTION_DIGEST].is_active = false;
+        return;
+    }
+    digest_format(*digest, options->digest_str);
+    options->recognized_options[TFTP_OPTION_DIGEST].value = options->digest_str;
+}
+
 enum tftp_read_type session_options_get_read_type(struct session_options options[static 1]) {
     tftp_parse_options(options->recognized_options, options->options_str_size, options->options_str);
     struct tftp_option o = options->recognized_options[TFTP_OPTION_READ_TYPE];
     return !o.is_active ? TFTP_READ_TYPE_FILE :
            strcasecmp(o.value, "directory") == 0 ? TFTP_READ_TYPE_DIRECTORY :
+           strcasecmp(o.value, "directory-detailed") == 0 ? TFTP_READ_TYPE_DIRECTORY_DETAILED :
                                                    TFTP_READ_TYPE_INVALID;
 }
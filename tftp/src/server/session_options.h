@@ -7,13 +7,21 @@
 #include <buracchi/tftp/server_session_stats.h>
 #include <tftp.h>
 
+#include "../digest.h"
+#include "session_file.h"
+
 struct session_options {
     const char **path;
     enum tftp_mode *mode;
-    uint8_t *timeout;
+    uint32_t *timeout_us;
     uint16_t *block_size;
     uint16_t *window_size;
     bool *adaptive_timeout;
+    bool *selective_ack;
+    bool *pipeline;
+    uint8_t *fec_group_size;
+    off_t *read_offset;
+    off_t *read_end;
     
     bool valid_options_required;
     bool options_acknowledged;
@@ -22,6 +30,7 @@ struct session_options {
     char *options_str;
     size_t options_str_size;
     const char *mode_str;
+    char digest_str[digest_string_size];
 };
 
 // if n > tftp_request_packet_max_size - sizeof(enum tftp_opcode) behaviour is undefined
@@ -30,13 +39,25 @@ bool session_options_init(struct session_options session_options[static 1],
                           const char options[static n],
                           const char *path[static 1],
                           enum tftp_mode mode[static 1],
-                          uint8_t timeout[static 1],
+                          uint32_t timeout_us[static 1],
                           uint16_t block_size[static 1],
                           uint16_t window_size[static 1],
                           bool adaptive_timeout[static 1],
+                          bool selective_ack[static 1],
+                          bool pipeline[static 1],
+                          uint8_t fec_group_size[static 1],
+                          off_t read_offset[static 1],
+                          off_t read_end[static 1],
                           struct tftp_session_stats_error error[static 1]);
 
-bool parse_options(struct session_options options[static 1], int file_descriptor, bool is_adaptive_timeout_enabled, bool is_list_request_enabled);
+// The offset and length options restrict [read_offset, read_end), which must span the whole file when called.
+bool parse_options(struct session_options options[static 1], struct session_file file[static 1], bool is_adaptive_timeout_enabled, bool is_list_request_enabled, bool is_read_request, uint8_t min_fec_group_size, bool is_digest_enabled, bool is_compression_enabled);
+
+// Rewrites the acknowledged blksize and windowsize values after the window was shrunk.
+void session_options_set_window(struct session_options options[static 1], uint16_t block_size, uint16_t window_size);
+
+// Sets the digest acknowledged to the peer, a nullptr digest leaves the option unacknowledged.
+void session_options_set_digest(struct session_options options[static 1], const uint64_t *digest);
 
 enum tftp_read_type session_options_get_read_type(struct session_options options[static 1]);
 
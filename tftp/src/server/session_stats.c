@@ -23,6 +23,7 @@ struct tftp_session_stats tftp_session_stat_init(const struct sockaddr server_ad
         .packets_acked = 0,
         .bytes_sent = 0,
         .retransmits = 0,
+        .fast_retransmits = 0,
         .blksize = tftp_default_blksize,
         .window_size = tftp_default_window_size,
         .callback = callback,
@@ -0,0 +1,169 @@
+#include "slab_allocator.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static constexpr size_t min_class_size = 64;
+static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+static constexpr uint32_t unpooled_class = UINT32_MAX;
+
+union slab_block {
+    struct {
+        union slab_block *next;     // next free block of the same class
+        size_t size;                // usable bytes
+        size_t mapping_size;        // 0 if the block was obtained with malloc
+        uint32_t size_class;
+    };
+    max_align_t alignment;
+};
+
+static uint32_t size_class(size_t size);
+static size_t class_size(uint32_t size_class);
+static union slab_block *block_new(struct slab_allocator allocator[static 1], size_t size, uint32_t size_class);
+static void block_delete(union slab_block *block);
+
+void slab_allocator_init(struct slab_allocator allocator[static 1],
+                         size_t max_cached_bytes,
+                         bool use_huge_pages,
+                         struct logger logger[static 1]) {
+    *allocator = (struct slab_allocator) {
+        .logger = logger,
+        .max_cached_bytes = max_cached_bytes,
+        .use_huge_pages = use_huge_pages,
+    };
+}
+
+void slab_allocator_destroy(struct slab_allocator allocator[static 1]) {
+    for (size_t i = 0; i < slab_classes_count; i++) {
+        union slab_block *block = allocator->free_lists[i];
+        while (block != nullptr) {
+            union slab_block *next = block->next;
+            block_delete(block);
+            block = next;
+        }
+        allocator->free_lists[i] = nullptr;
+    }
+}
+
+void *slab_alloc(struct slab_allocator allocator[static 1], size_t size) {
+    const uint32_t c = size_class(size);
+    union slab_block *block;
+    if (c != unpooled_class && allocator->free_lists[c] != nullptr) {
+        block = allocator->free_lists[c];
+        allocator->free_lists[c] = block->next;
+        allocator->bytes_cached -= block->size;
+        allocator->reuses++;
+    }
+    else {
+        block = block_new(allocator, c == unpooled_class ? size : class_size(c), c);
+        if (block == nullptr) {
+            return nullptr;
+        }
+    }
+    allocator->allocations++;
+    allocator->bytes_in_use += block->size;
+    return block + 1;
+}
+
+void *slab_calloc(struct slab_allocator allocator[static 1], size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    void *ptr = slab_alloc(allocator, count * size);
+    if (ptr != nullptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void slab_free(struct slab_allocator allocator[static 1], void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    union slab_block *block = (union slab_block *) ptr - 1;
+    allocator->bytes_in_use -= block->size;
+    if (block->size_class == unpooled_class || allocator->bytes_cached + block->size > allocator->max_cached_bytes) {
+        block_delete(block);
+        return;
+    }
+    block->next = allocator->free_lists[block->size_class];
+    allocator->free_lists[block->size_class] = block;
+    allocator->bytes_cached += block->size;
+}
+
+void slab_allocator_collect_stats(struct slab_allocator allocator[static 1], struct slab_allocator_stats stats[static 1]) {
+    *stats = (struct slab_allocator_stats) {
+        .allocations = atomic_exchange(&allocator->allocations, 0),
+        .reuses = atomic_exchange(&allocator->reuses, 0),
+        .bytes_in_use = atomic_load(&allocator->bytes_in_use),
+        .bytes_cached = atomic_load(&allocator->bytes_cached),
+    };
+}
+
+/*
+ * Classes are 64 bytes followed by four evenly spaced sizes for every power of two, up to 64 MiB:
+ *  80, 96, 112, 128, 160, 192, 224, 256, 320, ...
+ * so that rounding wastes at most a fifth of a block.
+ */
+static uint32_t size_class(size_t size) {
+    if (size <= min_class_size) {
+        return 0;
+    }
+    unsigned k = 6;     // floor(log2(size - 1))
+    while ((size - 1) >> (k + 1) != 0) {
+        k++;
+    }
+    const size_t c = (k - 6) * 4 + (((size - 1) >> (k - 2)) & 3) + 1;
+    return c < slab_classes_count ? c : unpooled_class;
+}
+
+static size_t class_size(uint32_t size_class) {
+    if (size_class == 0) {
+        return min_class_size;
+    }
+    const unsigned k = 6 + (size_class - 1) / 4;
+    return ((size_t) 1 << k) + (((size_class - 1) % 4) + 1) * ((size_t) 1 << (k - 2));
+}
+
+static union slab_block *block_new(struct slab_allocator allocator[static 1], size_t size, uint32_t size_class) {
+    const size_t total_size = sizeof(union slab_block) + size;
+    union slab_block *block = nullptr;
+    size_t mapping_size = 0;
+    if (allocator->use_huge_pages && total_size >= huge_page_size) {
+        mapping_size = (total_size + huge_page_size - 1) & ~(huge_page_size - 1);
+        block = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block == MAP_FAILED) {
+            logger_log_debug(allocator->logger, "Could not map huge pages, falling back to transparent huge pages. %s", strerror(errno));
+            mapping_size = total_size;
+            block = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (block == MAP_FAILED) {
+                return nullptr;
+            }
+            madvise(block, mapping_size, MADV_HUGEPAGE);
+        }
+    }
+    else {
+        block = malloc(total_size);
+        if (block == nullptr) {
+            return nullptr;
+        }
+    }
+    *block = (union slab_block) {
+        .size = size,
+        .mapping_size = mapping_size,
+        .size_class = size_class,
+    };
+    return block;
+}
+
+static void block_delete(union slab_block *block) {
+    if (block->mapping_size != 0) {
+        munmap(block, block->mapping_size);
+    }
+    else {
+        free(block);
+    }
+}
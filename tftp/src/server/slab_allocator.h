@@ -0,0 +1,60 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <logger.h>
+
+/*
+ * Per-worker allocator for session buffers (DATA windows, receive buffers, OACK and ERROR packets).
+ * Sizes are rounded up to size classes, four per power of two, and freed blocks are kept on a free list per class,
+ *  handed out again in LIFO order so that the most recently used, still cache warm, block is reused first.
+ * Freed blocks exceeding the cache budget and blocks larger than the biggest class are given back to the system.
+ * Blocks of at least a huge page can be backed by huge pages, falling back to transparent huge pages.
+ * Not thread safe, only the statistics may be collected from other threads.
+ */
+
+constexpr size_t slab_classes_count = 81;
+
+union slab_block;
+
+struct slab_allocator_stats {
+    uint64_t allocations;
+    uint64_t reuses;            // allocations served from a free list
+    size_t bytes_in_use;
+    size_t bytes_cached;        // bytes held in free lists
+};
+
+struct slab_allocator {
+    struct logger *logger;
+    size_t max_cached_bytes;
+    bool use_huge_pages;
+    union slab_block *free_lists[slab_classes_count];
+    atomic_uint_least64_t allocations;
+    atomic_uint_least64_t reuses;
+    atomic_size_t bytes_in_use;
+    atomic_size_t bytes_cached;
+};
+
+// A max_cached_bytes of 0 disables recycling, every block is given back to the system when freed.
+void slab_allocator_init(struct slab_allocator allocator[static 1],
+                         size_t max_cached_bytes,
+                         bool use_huge_pages,
+                         struct logger logger[static 1]);
+
+void slab_allocator_destroy(struct slab_allocator allocator[static 1]);
+
+// On failure returns nullptr and errno is set.
+void *slab_alloc(struct slab_allocator allocator[static 1], size_t size);
+
+// Like slab_alloc but the memory is zeroed.
+void *slab_calloc(struct slab_allocator allocator[static 1], size_t count, size_t size);
+
+void slab_free(struct slab_allocator allocator[static 1], void *ptr);
+
+// Reports allocations and reuses since the previous call along with the current memory usage.
+void slab_allocator_collect_stats(struct slab_allocator allocator[static 1], struct slab_allocator_stats stats[static 1]);
+
+#endif // SLAB_ALLOCATOR_H
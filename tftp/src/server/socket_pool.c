@@ -0,0 +1,271 @@
+#include "socket_pool.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include "../utils/inet.h"
+
+static int refill_routine(struct socket_pool pool[static 1]);
+static size_t refill_target(struct socket_pool pool[static 1]);
+static bool socket_open(struct socket_pool pool[static 1], size_t family_index, struct socket_pool_socket entry[static 1]);
+static int socket_bind(struct socket_pool pool[static 1],
+                       struct sockaddr_storage address[static 1],
+                       socklen_t addrlen[static 1],
+                       bool is_shared);
+static bool socket_share(struct socket_pool pool[static 1], int file_descriptor);
+static void socket_close(const struct socket_pool_socket entry[static 1]);
+static void socket_drain(int file_descriptor);
+
+bool socket_pool_init(struct socket_pool pool[static 1],
+                      const struct sockaddr server_address[static 1],
+                      socklen_t server_addrlen,
+                      size_t capacity,
+                      struct logger logger[static 1]) {
+    *pool = (struct socket_pool) {
+        .logger = logger,
+        .capacity = capacity,
+    };
+    auto ipv6 = &pool->families[socket_pool_family_index(AF_INET6)];
+    auto ipv4 = &pool->families[socket_pool_family_index(AF_INET)];
+    if (server_address->sa_family == AF_INET6) {
+        memcpy(&ipv6->address, server_address, server_addrlen);
+        ipv6->addrlen = sizeof(struct sockaddr_in6);
+        ((struct sockaddr_in6 *) &ipv6->address)->sin6_port = 0;
+        ipv6->is_available = true;
+        if (sockaddr_in6_to_in((const struct sockaddr_in6 *) &ipv6->address, (struct sockaddr_in *) &ipv4->address) == 0) {
+            ipv4->address.ss_family = AF_INET;
+            ipv4->addrlen = sizeof(struct sockaddr_in);
+            ((struct sockaddr_in *) &ipv4->address)->sin_port = 0;
+            ipv4->is_available = true;
+        }
+        else {
+            logger_log_warn(logger, "Could not translate server address to an IPV4 address, IPV4 sessions will not be served.");
+        }
+    }
+    else {
+        memcpy(&ipv4->address, server_address, server_addrlen);
+        ipv4->addrlen = sizeof(struct sockaddr_in);
+        ((struct sockaddr_in *) &ipv4->address)->sin_port = 0;
+        ipv4->is_available = true;
+    }
+    if (capacity == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < 2; i++) {
+        if (pool->families[i].is_available) {
+            pool->families[i].sockets = malloc(capacity * sizeof *pool->families[i].sockets);
+            if (pool->families[i].sockets == nullptr) {
+                logger_log_error(logger, "Could not allocate memory for the socket pool. %s", strerror(errno));
+                goto fail;
+            }
+        }
+    }
+    if (mtx_init(&pool->mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the socket pool mutex.");
+        goto fail;
+    }
+    if (cnd_init(&pool->refill_needed) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the socket pool condition variable.");
+        goto fail2;
+    }
+    if (thrd_create(&pool->thread, (thrd_start_t) refill_routine, pool) != thrd_success) {
+        logger_log_error(logger, "Could not start the socket pool thread.");
+        goto fail3;
+    }
+    return true;
+fail3:
+    cnd_destroy(&pool->refill_needed);
+fail2:
+    mtx_destroy(&pool->mtx);
+fail:
+    free(pool->families[0].sockets);
+    free(pool->families[1].sockets);
+    return false;
+}
+
+void socket_pool_destroy(struct socket_pool pool[static 1]) {
+    if (pool->capacity == 0) {
+        return;
+    }
+    mtx_lock(&pool->mtx);
+    pool->should_stop = true;
+    cnd_signal(&pool->refill_needed);
+    mtx_unlock(&pool->mtx);
+    thrd_join(pool->thread, nullptr);
+    for (size_t i = 0; i < 2; i++) {
+        auto family = &pool->families[i];
+        for (size_t j = 0; j < family->count; j++) {
+            socket_close(&family->sockets[(family->head + j) % pool->capacity]);
+        }
+        free(family->sockets);
+    }
+    cnd_destroy(&pool->refill_needed);
+    mtx_destroy(&pool->mtx);
+}
+
+bool socket_pool_acquire(struct socket_pool pool[static 1], sa_family_t family, struct socket_pool_socket socket[static 1]) {
+    const size_t family_index = socket_pool_family_index(family);
+    auto pooled = &pool->families[family_index];
+    if (!pooled->is_available) {
+        errno = EAFNOSUPPORT;
+        return false;
+    }
+    if (pool->capacity == 0) {
+        return socket_open(pool, family_index, socket);
+    }
+    mtx_lock(&pool->mtx);
+    const bool is_hit = pooled->count != 0;
+    if (is_hit) {
+        *socket = pooled->sockets[pooled->head];
+        pooled->head = (pooled->head + 1) % pool->capacity;
+        pooled->count--;
+    }
+    if (pooled->count < refill_target(pool)) {
+        cnd_signal(&pool->refill_needed);
+    }
+    mtx_unlock(&pool->mtx);
+    if (!is_hit) {
+        pool->misses++;
+        return socket_open(pool, family_index, socket);
+    }
+    socket_drain(socket->file_descriptor);
+    socket_drain(socket->stray_file_descriptor);
+    return true;
+}
+
+void socket_pool_release(struct socket_pool pool[static 1], const struct socket_pool_socket socket[static 1]) {
+    const bool is_disconnected = connect(socket->file_descriptor, &(struct sockaddr) {.sa_family = AF_UNSPEC}, sizeof(struct sockaddr)) == 0;
+    if (pool->capacity != 0 && is_disconnected) {
+        auto pooled = &pool->families[socket_pool_family_index(socket->address.ss_family)];
+        mtx_lock(&pool->mtx);
+        const bool is_pooled = pooled->count < pool->capacity;
+        if (is_pooled) {
+            pooled->sockets[(pooled->head + pooled->count) % pool->capacity] = *socket;
+            pooled->count++;
+        }
+        mtx_unlock(&pool->mtx);
+        if (is_pooled) {
+            return;
+        }
+    }
+    socket_close(socket);
+}
+
+uint64_t socket_pool_collect_misses(struct socket_pool pool[static 1]) {
+    return atomic_exchange(&pool->misses, 0);
+}
+
+static int refill_routine(struct socket_pool pool[static 1]) {
+    mtx_lock(&pool->mtx);
+    while (!pool->should_stop) {
+        bool is_full = true;
+        for (size_t i = 0; i < 2 && !pool->should_stop; i++) {
+            auto family = &pool->families[i];
+            if (!family->is_available || family->count >= refill_target(pool)) {
+                continue;
+            }
+            // sockets are created without holding the lock, sessions may keep checking out meanwhile
+            mtx_unlock(&pool->mtx);
+            struct socket_pool_socket entry;
+            const bool is_opened = socket_open(pool, i, &entry);
+            mtx_lock(&pool->mtx);
+            if (!is_opened) {
+                continue;   // retried on the next checkout
+            }
+            if (family->count >= refill_target(pool)) {
+                socket_close(&entry);
+                continue;
+            }
+            family->sockets[(family->head + family->count) % pool->capacity] = entry;
+            family->count++;
+            is_full = false;
+        }
+        if (is_full) {
+            cnd_wait(&pool->refill_needed, &pool->mtx);
+        }
+    }
+    mtx_unlock(&pool->mtx);
+    return 0;
+}
+
+// The thread only tops the pool up to half its capacity, the other half is left to sockets returned by sessions.
+static size_t refill_target(struct socket_pool pool[static 1]) {
+    return (pool->capacity + 1) / 2;
+}
+
+static bool socket_open(struct socket_pool pool[static 1], size_t family_index, struct socket_pool_socket entry[static 1]) {
+    auto family = &pool->families[family_index];
+    *entry = (struct socket_pool_socket) {
+        .addrlen = family->addrlen,
+    };
+    memcpy(&entry->address, &family->address, family->addrlen);
+    // the stray socket picks the ephemeral port without sharing it so that no other socket is given the same one, it is
+    //  shared afterwards with the session socket bound explicitly to it, which keeps it once disconnected
+    entry->stray_file_descriptor = socket_bind(pool, &entry->address, &entry->addrlen, false);
+    if (entry->stray_file_descriptor == -1) {
+        return false;
+    }
+    if (!socket_share(pool, entry->stray_file_descriptor)) {
+        goto fail;
+    }
+    entry->file_descriptor = socket_bind(pool, &entry->address, &entry->addrlen, true);
+    if (entry->file_descriptor == -1) {
+        goto fail;
+    }
+    return true;
+fail:
+    int error = errno;
+    close(entry->stray_file_descriptor);
+    errno = error;
+    return false;
+}
+
+static int socket_bind(struct socket_pool pool[static 1],
+                       struct sockaddr_storage address[static 1],
+                       socklen_t addrlen[static 1],
+                       bool is_shared) {
+    int file_descriptor = socket(address->ss_family, SOCK_DGRAM, 0);
+    if (file_descriptor == -1) {
+        logger_log_error(pool->logger, "Could not create socket: %s", strerror(errno));
+        return -1;
+    }
+    if (is_shared && !socket_share(pool, file_descriptor)) {
+        goto fail;
+    }
+    if (bind(file_descriptor, (struct sockaddr *) address, *addrlen) == -1) {
+        logger_log_error(pool->logger, "Could not bind socket: %s", strerror(errno));
+        goto fail;
+    }
+    if (getsockname(file_descriptor, (struct sockaddr *) address, addrlen) == -1) {
+        logger_log_error(pool->logger, "Could not get socket name: %s", strerror(errno));
+        goto fail;
+    }
+    return file_descriptor;
+fail:
+    int error = errno;
+    close(file_descriptor);
+    errno = error;
+    return -1;
+}
+
+static bool socket_share(struct socket_pool pool[static 1], int file_descriptor) {
+    // unlike SO_REUSEADDR the port can only be shared with sockets of the same effective user
+    if (setsockopt(file_descriptor, SOL_SOCKET, SO_REUSEPORT, &(int) {true}, sizeof(int)) == -1) {
+        logger_log_error(pool->logger, "Could not set socket options: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static void socket_close(const struct socket_pool_socket entry[static 1]) {
+    close(entry->file_descriptor);
+    close(entry->stray_file_descriptor);
+}
+
+static void socket_drain(int file_descriptor) {
+    // a zero length receive discards a whole datagram
+    while (recv(file_descriptor, nullptr, 0, MSG_DONTWAIT | MSG_TRUNC) != -1 || errno == EINTR);
+}
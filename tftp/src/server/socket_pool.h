@@ -0,0 +1,75 @@
+#ifndef SOCKET_POOL_H
+#define SOCKET_POOL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <threads.h>
+
+#include <logger.h>
+
+/*
+ * Per-worker pool of UDP sockets already bound to an ephemeral port of the server address, for IPv6 and IPv4 peers.
+ * Sessions check a socket out when they start and return it when they close, a background thread keeps the pool
+ *  at least half full so that sessions do not pay for socket creation and port search.
+ * Every session socket is paired with a stray socket bound to the same port: once the session socket is connected to
+ *  its peer the kernel delivers the datagrams of any other peer to the stray socket.
+ * Returned sockets are disconnected and queued behind the idle ones, leaving stray retransmissions of the previous peer
+ *  time to be discarded, pending datagrams are drained when the socket is checked out again.
+ */
+
+struct socket_pool_socket {
+    int file_descriptor;
+    int stray_file_descriptor;          // bound to the same address, receives the datagrams of other peers once connected
+    struct sockaddr_storage address;    // bound address
+    socklen_t addrlen;
+};
+
+struct socket_pool {
+    struct logger *logger;
+    size_t capacity;        // maximum idle sockets kept for each family
+    mtx_t mtx;
+    cnd_t refill_needed;
+    bool should_stop;
+    thrd_t thread;
+    struct {
+        bool is_available;
+        struct sockaddr_storage address;    // address the sockets are bound to, with port 0
+        socklen_t addrlen;
+        size_t head;
+        size_t count;
+        struct socket_pool_socket *sockets;
+    } families[2];    // indexed by socket_pool_family_index
+    atomic_uint_least64_t misses;
+};
+
+static inline size_t socket_pool_family_index(sa_family_t family) {
+    return family == AF_INET6 ? 0 : 1;
+}
+
+/*
+ * The pool binds its sockets to server_address, an IPv6 server address also provides IPv4 sockets when it can be
+ *  translated to an IPv4 address.
+ * A capacity of 0 disables pooling, sockets are then created on checkout and closed when returned.
+ */
+bool socket_pool_init(struct socket_pool pool[static 1],
+                      const struct sockaddr server_address[static 1],
+                      socklen_t server_addrlen,
+                      size_t capacity,
+                      struct logger logger[static 1]);
+
+void socket_pool_destroy(struct socket_pool pool[static 1]);
+
+/*
+ * Checks out a socket of the given family (AF_INET6 or AF_INET), a new one is created if the pool is empty.
+ * On failure returns false and errno is set.
+ */
+bool socket_pool_acquire(struct socket_pool pool[static 1], sa_family_t family, struct socket_pool_socket socket[static 1]);
+
+void socket_pool_release(struct socket_pool pool[static 1], const struct socket_pool_socket socket[static 1]);
+
+// Reports the checkouts that found the pool empty since the previous call.
+uint64_t socket_pool_collect_misses(struct socket_pool pool[static 1]);
+
+#endif // SOCKET_POOL_H
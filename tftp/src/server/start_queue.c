@@ -0,0 +1,66 @@
+#include "start_queue.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+bool start_queue_init(struct start_queue queue[static 1], uint16_t capacity, struct logger logger[static 1]) {
+    *queue = (struct start_queue) {
+        .event_descriptor = -1,
+        .capacity = capacity,
+        .job_ids = malloc(capacity * sizeof *queue->job_ids),
+    };
+    if (queue->job_ids == nullptr) {
+        logger_log_error(logger, "Could not allocate memory for the start queue. %s", strerror(errno));
+        return false;
+    }
+    queue->event_descriptor = eventfd(0, EFD_CLOEXEC);
+    if (queue->event_descriptor == -1) {
+        logger_log_error(logger, "Could not create the start queue event. %s", strerror(errno));
+        free(queue->job_ids);
+        return false;
+    }
+    if (mtx_init(&queue->mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the start queue mutex.");
+        close(queue->event_descriptor);
+        free(queue->job_ids);
+        return false;
+    }
+    return true;
+}
+
+void start_queue_destroy(struct start_queue queue[static 1]) {
+    mtx_destroy(&queue->mtx);
+    close(queue->event_descriptor);
+    free(queue->job_ids);
+}
+
+bool start_queue_push(struct start_queue queue[static 1], uint16_t job_id) {
+    mtx_lock(&queue->mtx);
+    queue->job_ids[(queue->head + queue->count) % queue->capacity] = job_id;
+    queue->count++;
+    mtx_unlock(&queue->mtx);
+    return start_queue_notify(queue);
+}
+
+bool start_queue_notify(struct start_queue queue[static 1]) {
+    int ret;
+    do {
+        ret = eventfd_write(queue->event_descriptor, 1);
+    } while (ret == -1 && errno == EINTR);
+    return ret == 0;
+}
+
+bool start_queue_pop(struct start_queue queue[static 1], uint16_t job_id[static 1]) {
+    mtx_lock(&queue->mtx);
+    const bool is_empty = queue->count == 0;
+    if (!is_empty) {
+        *job_id = queue->job_ids[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+    }
+    mtx_unlock(&queue->mtx);
+    return !is_empty;
+}
@@ -0,0 +1,37 @@
+#ifndef START_QUEUE_H
+#define START_QUEUE_H
+
+#include <stdint.h>
+#include <threads.h>
+
+#include <logger.h>
+
+/*
+ * Sessions handed over by the listener thread to a worker.
+ * The ring of a worker is only driven by the worker thread: the listener queues the job and signals the eventfd, the
+ *  worker keeps a read armed on it and starts the queued jobs when it completes.
+ */
+
+struct start_queue {
+    mtx_t mtx;
+    int event_descriptor;
+    uint16_t capacity;
+    uint16_t head;
+    uint16_t count;
+    uint16_t *job_ids;
+};
+
+bool start_queue_init(struct start_queue queue[static 1], uint16_t capacity, struct logger logger[static 1]);
+
+void start_queue_destroy(struct start_queue queue[static 1]);
+
+// Queues a job and wakes up the worker, a job is never queued again before being taken so the queue cannot overflow.
+bool start_queue_push(struct start_queue queue[static 1], uint16_t job_id);
+
+// Wakes up the worker without queueing a job.
+bool start_queue_notify(struct start_queue queue[static 1]);
+
+// Takes the oldest queued job, returns false if there is none.
+bool start_queue_pop(struct start_queue queue[static 1], uint16_t job_id[static 1]);
+
+#endif // START_QUEUE_H
@@ -0,0 +1,120 @@
+#include "timer_wheel.h"
+
+static constexpr uint64_t slot_mask = timer_wheel_slots - 1;
+static constexpr uint64_t max_ticks = (1ULL << (timer_wheel_levels * timer_wheel_slot_bits)) - 1;
+
+static void list_init(struct timer_wheel_timer head[static 1]);
+static void list_push(struct timer_wheel_timer head[static 1], struct timer_wheel_timer timer[static 1]);
+static void list_remove(struct timer_wheel_timer timer[static 1]);
+static void place(struct timer_wheel wheel[static 1], struct timer_wheel_timer timer[static 1]);
+static void cascade(struct timer_wheel wheel[static 1], size_t level);
+
+void timer_wheel_init(struct timer_wheel wheel[static 1], uint64_t now) {
+    wheel->now = now;
+    wheel->count = 0;
+    list_init(&wheel->expired);
+    for (size_t level = 0; level < timer_wheel_levels; level++) {
+        for (size_t slot = 0; slot < timer_wheel_slots; slot++) {
+            list_init(&wheel->slots[level][slot]);
+        }
+    }
+}
+
+void timer_wheel_arm(struct timer_wheel wheel[static 1], struct timer_wheel_timer timer[static 1], uint64_t now, uint64_t ticks) {
+    if (timer_wheel_timer_is_armed(timer)) {
+        list_remove(timer);
+    }
+    else {
+        wheel->count++;
+    }
+    if (wheel->count == 1 && now > wheel->now) {
+        wheel->now = now;   // the wheel is not advanced while empty
+    }
+    timer->expiry = now + (ticks == 0 ? 1 : ticks);
+    place(wheel, timer);
+}
+
+void timer_wheel_cancel(struct timer_wheel wheel[static 1], struct timer_wheel_timer timer[static 1]) {
+    if (!timer_wheel_timer_is_armed(timer)) {
+        return;
+    }
+    list_remove(timer);
+    wheel->count--;
+}
+
+void timer_wheel_advance(struct timer_wheel wheel[static 1], uint64_t now) {
+    if (wheel->count == 0) {
+        wheel->now = now > wheel->now ? now : wheel->now;
+        return;
+    }
+    while (wheel->now < now) {
+        wheel->now++;
+        // the coarser levels are cascaded first, their timers may land in the slots of the finer levels due now
+        size_t level = 0;
+        while (level + 1 < timer_wheel_levels && (wheel->now & ((1ULL << ((level + 1) * timer_wheel_slot_bits)) - 1)) == 0) {
+            level++;
+        }
+        for (; level > 0; level--) {
+            cascade(wheel, level);
+        }
+        struct timer_wheel_timer *head = &wheel->slots[0][wheel->now & slot_mask];
+        while (head->next != head) {
+            struct timer_wheel_timer *timer = head->next;
+            list_remove(timer);
+            list_push(&wheel->expired, timer);
+        }
+    }
+}
+
+struct timer_wheel_timer *timer_wheel_pop_expired(struct timer_wheel wheel[static 1]) {
+    struct timer_wheel_timer *timer = wheel->expired.next;
+    if (timer == &wheel->expired) {
+        return nullptr;
+    }
+    list_remove(timer);
+    wheel->count--;
+    return timer;
+}
+
+static void list_init(struct timer_wheel_timer head[static 1]) {
+    head->next = head;
+    head->prev = head;
+}
+
+static void list_push(struct timer_wheel_timer head[static 1], struct timer_wheel_timer timer[static 1]) {
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+static void list_remove(struct timer_wheel_timer timer[static 1]) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = nullptr;
+    timer->prev = nullptr;
+}
+
+static void place(struct timer_wheel wheel[static 1], struct timer_wheel_timer timer[static 1]) {
+    if (timer->expiry <= wheel->now) {
+        list_push(&wheel->expired, timer);
+        return;
+    }
+    // timers beyond the range of the wheel wait in the coarsest level and are placed again when cascaded
+    const uint64_t delta = timer->expiry - wheel->now < max_ticks ? timer->expiry - wheel->now : max_ticks;
+    size_t level = 0;
+    while (level + 1 < timer_wheel_levels && (delta >> ((level + 1) * timer_wheel_slot_bits)) != 0) {
+        level++;
+    }
+    const size_t slot = ((wheel->now + delta) >> (level * timer_wheel_slot_bits)) & slot_mask;
+    list_push(&wheel->slots[level][slot], timer);
+}
+
+static void cascade(struct timer_wheel wheel[static 1], size_t level) {
+    struct timer_wheel_timer *head = &wheel->slots[level][(wheel->now >> (level * timer_wheel_slot_bits)) & slot_mask];
+    while (head->next != head) {
+        struct timer_wheel_timer *timer = head->next;
+        list_remove(timer);
+        place(wheel, timer);
+    }
+}
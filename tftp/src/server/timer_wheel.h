@@ -0,0 +1,69 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Hierarchical timing wheel, arming and cancelling a timer are O(1) and need no system call.
+ * Each level has 64 slots, a slot of level n spans 64^n ticks: timers are placed in the finest level able to hold them
+ *  and cascade to the finer levels as their expiry gets close, 4 levels cover about 4.6 hours of 1 ms ticks.
+ * The owner advances the wheel, every tick while timers are armed, and collects the expired timers.
+ * A wheel is only touched by its worker thread and needs no locking.
+ */
+
+constexpr uint64_t timer_wheel_tick_ns = 1'000'000;
+constexpr size_t timer_wheel_levels = 4;
+constexpr size_t timer_wheel_slot_bits = 6;
+constexpr size_t timer_wheel_slots = 1 << timer_wheel_slot_bits;
+
+struct timer_wheel_timer {
+    struct timer_wheel_timer *next;     // nullptr while the timer is not armed
+    struct timer_wheel_timer *prev;
+    uint64_t expiry;                    // tick
+    uint64_t id;                        // set by the owner of the timer
+};
+
+struct timer_wheel {
+    uint64_t now;                       // last tick the wheel was advanced to
+    size_t count;                       // armed timers, the expired ones not yet collected included
+    struct timer_wheel_timer expired;   // head of the list of expired timers
+    struct timer_wheel_timer slots[timer_wheel_levels][timer_wheel_slots];  // heads of circular lists
+};
+
+void timer_wheel_init(struct timer_wheel wheel[static 1], uint64_t now);
+
+// Returns the current tick of CLOCK_MONOTONIC.
+static inline uint64_t timer_wheel_get_tick(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1'000'000'000ULL + now.tv_nsec) / timer_wheel_tick_ns;
+}
+
+// Rounds up to a whole number of ticks.
+static inline uint64_t timer_wheel_ticks_from_timespec(struct timespec duration) {
+    return (duration.tv_sec * 1'000'000'000ULL + duration.tv_nsec + timer_wheel_tick_ns - 1) / timer_wheel_tick_ns;
+}
+
+static inline bool timer_wheel_is_empty(const struct timer_wheel wheel[static 1]) {
+    return wheel->count == 0;
+}
+
+static inline bool timer_wheel_timer_is_armed(const struct timer_wheel_timer timer[static 1]) {
+    return timer->next != nullptr;
+}
+
+// Arms the timer to expire ticks ticks, at least one, after the tick now, an armed timer is moved.
+void timer_wheel_arm(struct timer_wheel wheel[static 1], struct timer_wheel_timer timer[static 1], uint64_t now, uint64_t ticks);
+
+// Disarms the timer, whether it is waiting or already expired but not collected.
+void timer_wheel_cancel(struct timer_wheel wheel[static 1], struct timer_wheel_timer timer[static 1]);
+
+// Moves the timers expiring up to the tick now to the expired list.
+void timer_wheel_advance(struct timer_wheel wheel[static 1], uint64_t now);
+
+// Disarms and returns the next expired timer, nullptr if there is none.
+struct timer_wheel_timer *timer_wheel_pop_expired(struct timer_wheel wheel[static 1]);
+
+#endif // TIMER_WHEEL_H
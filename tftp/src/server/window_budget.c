@@ -0,0 +1,61 @@
+#include "window_budget.h"
+
+#include <tftp.h>
+
+void window_budget_init(struct window_budget budget[static 1], size_t max_bytes) {
+    *budget = (struct window_budget) {
+        .max_bytes = max_bytes,
+    };
+}
+
+size_t window_budget_cost(uint16_t block_size, uint16_t window_size) {
+    const size_t receive_buffer_size = sizeof(struct tftp_data_packet) + (block_size < tftp_default_blksize ? tftp_default_blksize : block_size);
+    return (size_t) window_size * (sizeof(struct tftp_data_packet) + block_size) + receive_buffer_size;
+}
+
+size_t window_budget_reserve(struct window_budget budget[static 1], uint16_t block_size[static 1], uint16_t window_size[static 1]) {
+    if (budget->max_bytes == 0) {
+        return 0;
+    }
+    const uint16_t min_block_size = *block_size < tftp_default_blksize ? *block_size : tftp_default_blksize;
+    size_t reserved = atomic_load(&budget->reserved_bytes);
+    uint16_t granted_block_size;
+    uint16_t granted_window_size;
+    size_t cost;
+    do {
+        granted_block_size = *block_size;
+        granted_window_size = *window_size;
+        cost = window_budget_cost(granted_block_size, granted_window_size);
+        const size_t headroom = budget->max_bytes > reserved ? budget->max_bytes - reserved : 0;
+        if (cost <= headroom) {
+            continue;
+        }
+        const size_t receive_buffer_size = window_budget_cost(granted_block_size, 0);
+        const size_t fitting_blocks = headroom > receive_buffer_size
+                                      ? (headroom - receive_buffer_size) / (sizeof(struct tftp_data_packet) + granted_block_size)
+                                      : 0;
+        granted_window_size = fitting_blocks == 0 ? 1 : fitting_blocks;
+        if (window_budget_cost(granted_block_size, 1) > headroom) {
+            // a single block takes room in both the window and the receive buffer
+            const size_t fitting_block_size = headroom > 2 * sizeof(struct tftp_data_packet)
+                                              ? (headroom - 2 * sizeof(struct tftp_data_packet)) / 2
+                                              : 0;
+            granted_block_size = fitting_block_size > min_block_size ? fitting_block_size : min_block_size;
+        }
+        cost = window_budget_cost(granted_block_size, granted_window_size);
+    } while (!atomic_compare_exchange_weak(&budget->reserved_bytes, &reserved, reserved + cost));
+    if (granted_block_size != *block_size || granted_window_size != *window_size) {
+        budget->clamps++;
+        *block_size = granted_block_size;
+        *window_size = granted_window_size;
+    }
+    return cost;
+}
+
+void window_budget_release(struct window_budget budget[static 1], size_t bytes) {
+    budget->reserved_bytes -= bytes;
+}
+
+uint64_t window_budget_collect_clamps(struct window_budget budget[static 1]) {
+    return atomic_exchange(&budget->clamps, 0);
+}
@@ -0,0 +1,38 @@
+#ifndef WINDOW_BUDGET_H
+#define WINDOW_BUDGET_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Server-wide budget for the memory sessions hold for their DATA window and receive buffer.
+ * When a session starts, the window negotiated by the peer is shrunk to fit the memory left by the other sessions:
+ *  the window size is reduced first and the block size only if a single block still does not fit.
+ * A single block of at most the default size is always granted, so the budget can be exceeded by that much per session.
+ */
+
+struct window_budget {
+    size_t max_bytes;
+    atomic_size_t reserved_bytes;
+    atomic_uint_least64_t clamps;   // sessions whose window was shrunk since the last collection
+};
+
+// A max_bytes of 0 disables the budget.
+void window_budget_init(struct window_budget budget[static 1], size_t max_bytes);
+
+// Memory needed by a session for a window of window_size blocks of block_size bytes.
+size_t window_budget_cost(uint16_t block_size, uint16_t window_size);
+
+/*
+ * Reserves the memory for a window, shrinking block_size and window_size to fit the budget.
+ * Returns the reserved bytes to give back with window_budget_release.
+ */
+size_t window_budget_reserve(struct window_budget budget[static 1], uint16_t block_size[static 1], uint16_t window_size[static 1]);
+
+void window_budget_release(struct window_budget budget[static 1], size_t bytes);
+
+// Reports the number of shrunk windows since the previous call.
+uint64_t window_budget_collect_clamps(struct window_budget budget[static 1]);
+
+#endif // WINDOW_BUDGET_H
@@ -7,11 +7,32 @@
 
 #include "dispatcher.h"
 
+static constexpr size_t cache_line_size = 64;
+static constexpr uint16_t demux_buffers_count = 64;
+static constexpr size_t demux_buffer_size = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) + sizeof(struct tftp_data_packet) + tftp_max_blksize;
+
 static int worker_routine(struct worker worker[static 1]);
+static void handle_job_state(struct worker worker[static 1], struct worker_job job[static 1], enum job_state state);
+static bool demux_init(struct worker worker[static 1], const struct sockaddr server_address[static 1], socklen_t server_addrlen, uint16_t first_port, size_t sockets_count);
+static bool demux_recv_async(struct worker worker[static 1], size_t socket_index);
+static void demux_recv_async_cancel(struct worker worker[static 1]);
+static void on_shared_socket_event(struct worker worker[static 1], struct dispatcher_event event[static 1]);
+static void route_packet(struct worker worker[static 1], size_t socket_index, void *buffer, size_t size);
+static bool tick_async(struct worker worker[static 1]);
+static void on_tick(struct worker worker[static 1]);
+static bool wakeup_async(struct worker worker[static 1]);
+static void on_wakeup(struct worker worker[static 1]);
 
 bool worker_init(struct worker worker[static 1],
                                     size_t id,
                                     size_t max_jobs,
+                                    size_t slab_max_cached_bytes,
+                                    bool use_huge_pages,
+                                    const struct sockaddr server_address[static 1],
+                                    socklen_t server_addrlen,
+                                    size_t socket_pool_capacity,
+                                    uint16_t shared_socket_first_port,
+                                    size_t shared_sockets_count,
                                     atomic_bool shutdown[static 1],
                                     struct logger logger[static 1]) {
     *worker = (struct worker) {
@@ -20,80 +41,335 @@ bool worker_init(struct worker worker[static 1],
         .jobs = calloc(max_jobs, sizeof *worker->jobs),
         .max_jobs = max_jobs,
         .logger = logger,
+        .free_jobs_count = max_jobs,
+        .free_jobs = malloc(max_jobs * sizeof *worker->free_jobs),
     };
-    if (worker->jobs == nullptr) {
+    if (worker->jobs == nullptr || worker->free_jobs == nullptr) {
         logger_log_error(logger, "Could not allocate memory for the jobs array.");
-        return false;
+        goto fail;
     }
     for (size_t i = 0; i < max_jobs; i++) {
         worker->jobs[i].job_id = i;
+        worker->jobs[i].worker = worker;
         worker->jobs[i].dispatcher = &worker->dispatcher;
+        worker->jobs[i].allocator = &worker->allocator;
+        worker->jobs[i].socket_pool = &worker->socket_pool;
+        worker->jobs[i].demux = shared_sockets_count != 0 ? &worker->demux : nullptr;
+        worker->jobs[i].timer_wheel = &worker->timer_wheel;
+        worker->free_jobs[i] = max_jobs - 1 - i;
     }
-    if (sem_init(&worker->available_jobs, 0, max_jobs) == -1) {
-        logger_log_error(logger, "Could not initialize the jobs semaphore. %s", strerror(errno));
+    if (mtx_init(&worker->free_jobs_mtx, mtx_plain) != thrd_success) {
+        logger_log_error(logger, "Could not initialize the jobs mutex.");
         goto fail;
     }
-    // Dispatcher should hold up to 1 AIO linked to 1 TIMEOUT and 1 pending TIMEOUT canceled
-    if (!dispatcher_init(&worker->dispatcher, max_jobs * 3, logger)) {
+    if (sem_init(&worker->available_jobs, 0, max_jobs) == -1) {
+        logger_log_error(logger, "Could not initialize the jobs semaphore. %s", strerror(errno));
         goto fail2;
     }
-    if (thrd_create(&worker->thread, (thrd_start_t) worker_routine, worker) != thrd_success) {
+    // Dispatcher should hold up to 1 AIO linked to 1 pacing TIMEOUT and 1 pending TIMEOUT canceled, plus the stray packets receive and its cancel
+    if (!dispatcher_init(&worker->dispatcher, max_jobs * 5 + shared_sockets_count * 2 + 1, logger)) {
         goto fail3;
     }
+    if (!start_queue_init(&worker->start_queue, max_jobs, logger)) {
+        goto fail4;
+    }
+    if (!wakeup_async(worker)) {
+        goto fail5;
+    }
+    timer_wheel_init(&worker->timer_wheel, timer_wheel_get_tick());
+    worker->tick_event = (struct dispatcher_event_timeout) {.timeout = {.tv_nsec = timer_wheel_tick_ns}};
+    slab_allocator_init(&worker->allocator, slab_max_cached_bytes, use_huge_pages, logger);
+    if (!socket_pool_init(&worker->socket_pool, server_address, server_addrlen, socket_pool_capacity, logger)) {
+        goto fail6;
+    }
+    if (shared_sockets_count != 0 && !demux_init(worker, server_address, server_addrlen, shared_socket_first_port, shared_sockets_count)) {
+        goto fail7;
+    }
+    if (thrd_create(&worker->thread, (thrd_start_t) worker_routine, worker) != thrd_success) {
+        goto fail8;
+    }
     return true;
-fail3:
+fail8:
+    if (worker->is_demux_enabled) {
+        session_demux_destroy(&worker->demux);
+        free(worker->demux_events);
+    }
+fail7:
+    socket_pool_destroy(&worker->socket_pool);
+fail6:
+    slab_allocator_destroy(&worker->allocator);
+fail5:
+    // the ring goes first, it holds a read of the start queue event
     dispatcher_destroy(&worker->dispatcher);
-fail2:
+    start_queue_destroy(&worker->start_queue);
+    goto fail3;
+fail4:
+    dispatcher_destroy(&worker->dispatcher);
+fail3:
     sem_destroy(&worker->available_jobs);
+fail2:
+    mtx_destroy(&worker->free_jobs_mtx);
 fail:
+    free(worker->free_jobs);
     free(worker->jobs);
     return false;
 }
 
 void worker_destroy(struct worker worker[static 1]) {
-    dispatcher_submit(&worker->dispatcher, nullptr);    // wake up the worker
+    if (!start_queue_notify(&worker->start_queue)) {
+        logger_log_fatal(worker->logger, "Could not wake up worker %zu. %s", worker->id, strerror(errno));
+        exit(1);
+    }
     thrd_join(worker->thread, nullptr);
     dispatcher_destroy(&worker->dispatcher);
+    start_queue_destroy(&worker->start_queue);
+    if (worker->is_demux_enabled) {
+        session_demux_destroy(&worker->demux);
+        free(worker->demux_events);
+    }
+    socket_pool_destroy(&worker->socket_pool);
+    slab_allocator_destroy(&worker->allocator);
     sem_destroy(&worker->available_jobs);
+    mtx_destroy(&worker->free_jobs_mtx);
+    for (size_t i = 0; i < worker->max_jobs; i++) {
+        free(worker->jobs[i].session);
+        free(worker->jobs[i].session_cold);
+    }
+    free(worker->free_jobs);
     free(worker->jobs);
 }
 
+struct worker_job *worker_acquire_job(struct worker worker[static 1]) {
+    mtx_lock(&worker->free_jobs_mtx);
+    struct worker_job *job = &worker->jobs[worker->free_jobs[--worker->free_jobs_count]];
+    mtx_unlock(&worker->free_jobs_mtx);
+    if (job->session == nullptr) {
+        // the per packet state of the session starts on its own cache line
+        job->session = aligned_alloc(cache_line_size, (sizeof *job->session + cache_line_size - 1) & ~(cache_line_size - 1));
+        job->session_cold = malloc(sizeof *job->session_cold);
+        if (job->session == nullptr || job->session_cold == nullptr) {
+            logger_log_error(worker->logger, "Could not allocate memory for a session. %s", strerror(errno));
+            free(job->session);
+            free(job->session_cold);
+            job->session = nullptr;
+            job->session_cold = nullptr;
+            worker_release_job(worker, job);
+            return nullptr;
+        }
+    }
+    return job;
+}
+
+void worker_release_job(struct worker worker[static 1], struct worker_job job[static 1]) {
+    mtx_lock(&worker->free_jobs_mtx);
+    worker->free_jobs[worker->free_jobs_count++] = job->job_id;
+    mtx_unlock(&worker->free_jobs_mtx);
+    int ret;
+    do {
+        ret = sem_post(&worker->available_jobs);
+    } while (ret == -1 && errno == EINTR);
+    if (ret == -1) {
+        logger_log_fatal(worker->logger, "Worker %zu encountered fatal error", worker->id);
+        exit(1);
+    }
+}
+
+void worker_start_job(struct worker worker[static 1], struct worker_job job[static 1]) {
+    if (!start_queue_push(&worker->start_queue, job->job_id)) {
+        logger_log_fatal(worker->logger, "Could not wake up worker %zu. %s", worker->id, strerror(errno));
+        exit(1);
+    }
+}
+
 static int worker_routine(struct worker worker[static 1]) {
-    while (!*worker->shutdown || worker->dispatcher.pending_requests != 0) {
+    while (!*worker->shutdown || worker->dispatcher.pending_requests != 0 || !timer_wheel_is_empty(&worker->timer_wheel)) {
+        if (!worker->is_tick_armed && !timer_wheel_is_empty(&worker->timer_wheel) && !tick_async(worker)) {
+            logger_log_fatal(worker->logger, "Worker %zu could not arm its timer.", worker->id);
+            exit(1);
+        }
         struct dispatcher_event *event;
         if (!dispatcher_wait_event(&worker->dispatcher, &event)) {
             if (errno == EINTR) {
                 continue;
             }
-            logger_log_fatal(worker->logger, "Worker %d is dead.", worker->id);
+            logger_log_fatal(worker->logger, "Worker %zu is dead.", worker->id);
             exit(1);
         }
         if (event == nullptr) {
             continue;
         }
+        if (event == &worker->wakeup_event) {
+            on_wakeup(worker);
+            continue;
+        }
+        if (event == &worker->tick_event.event) {
+            on_tick(worker);
+            continue;
+        }
         uint16_t sid = event->id >> 48;
+        if (sid == session_demux_id) {
+            on_shared_socket_event(worker, event);
+            continue;
+        }
         struct worker_job* job = &worker->jobs[sid];
         //logger_log_trace(worker->logger, "Worker %zu received event for session %d.", worker->id, sid);
-        switch (job_handle_event(job, event)) {
-            case JOB_STATE_ERROR:
-                logger_log_fatal(worker->logger, "Worker %zu encountered fatal error", worker->id);
-                exit(1);
-                break;
-            case JOB_STATE_TERMINATED:
-                job->is_active = false;
-                int ret;
-                do {
-                    ret = sem_post(&worker->available_jobs);
-                } while (ret == -1 && errno == EINTR);
-                if (ret == -1) {
-                    logger_log_fatal(worker->logger, "Worker %zu encountered fatal error", worker->id);
-                    exit(1);
-                }
-                logger_log_trace(worker->logger, "Worker %zu released handler for session %d.", worker->id, sid);
-                break;
-            default:
-                break;
-        }
+        handle_job_state(worker, job, job_handle_event(job, event));
     }
     return 0;
 }
+
+static void handle_job_state(struct worker worker[static 1], struct worker_job job[static 1], enum job_state state) {
+    switch (state) {
+        case JOB_STATE_ERROR:
+            logger_log_fatal(worker->logger, "Worker %zu encountered fatal error", worker->id);
+            exit(1);
+            break;
+        case JOB_STATE_TERMINATED:
+            free(job->session);
+            free(job->session_cold);
+            job->session = nullptr;
+            job->session_cold = nullptr;
+            worker_release_job(worker, job);
+            logger_log_trace(worker->logger, "Worker %zu released handler for session %d.", worker->id, job->job_id);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool demux_init(struct worker worker[static 1], const struct sockaddr server_address[static 1], socklen_t server_addrlen, uint16_t first_port, size_t sockets_count) {
+    if (!session_demux_init(&worker->demux, server_address, server_addrlen, first_port, sockets_count, worker->max_jobs, worker->logger)) {
+        return false;
+    }
+    worker->demux_events = malloc(sockets_count * sizeof *worker->demux_events);
+    if (worker->demux_events == nullptr) {
+        logger_log_error(worker->logger, "Could not allocate memory for the shared sockets events. %s", strerror(errno));
+        goto fail;
+    }
+    if (!dispatcher_init_buffers(&worker->dispatcher, demux_buffers_count, demux_buffer_size)) {
+        goto fail2;
+    }
+    worker->demux_msghdr = (struct msghdr) {
+        .msg_namelen = sizeof(struct sockaddr_storage),
+    };
+    for (size_t i = 0; i < sockets_count; i++) {
+        worker->demux_events[i] = (struct dispatcher_event) {.id = ((uint64_t) session_demux_id << 48) | i};
+        if (!demux_recv_async(worker, i)) {
+            goto fail2;     // receives already armed are cancelled when the ring is destroyed
+        }
+    }
+    worker->is_demux_enabled = true;
+    return true;
+fail2:
+    free(worker->demux_events);
+fail:
+    session_demux_destroy(&worker->demux);
+    return false;
+}
+
+static bool demux_recv_async(struct worker worker[static 1], size_t socket_index) {
+    return dispatcher_submit_recvmsg_multishot(&worker->dispatcher,
+                                               &worker->demux_events[socket_index],
+                                               worker->demux.sockets[socket_index].file_descriptor,
+                                               &worker->demux_msghdr);
+}
+
+static void demux_recv_async_cancel(struct worker worker[static 1]) {
+    for (size_t i = 0; i < worker->demux.sockets_count; i++) {
+        dispatcher_submit_cancel(&worker->dispatcher, nullptr, &worker->demux_events[i]);
+    }
+}
+
+static void on_shared_socket_event(struct worker worker[static 1], struct dispatcher_event event[static 1]) {
+    const size_t socket_index = event->id & 0xFFFF;
+    if (event->flags & IORING_CQE_F_BUFFER) {
+        const uint16_t buffer_id = event->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (event->is_success) {
+            route_packet(worker, socket_index, dispatcher_get_buffer(&worker->dispatcher, buffer_id), event->result);
+        }
+        dispatcher_recycle_buffer(&worker->dispatcher, buffer_id);
+    }
+    else if (!event->is_success && event->error_number != ECANCELED && event->error_number != ENOBUFS) {
+        logger_log_error(worker->logger, "Error while receiving on shared socket %hu: %s", worker->demux.sockets[socket_index].port, strerror(event->error_number));
+    }
+    // the receive is over when the buffers ran out, the datagrams wait in the socket until it is armed again
+    if (!(event->flags & IORING_CQE_F_MORE) && !*worker->shutdown && !demux_recv_async(worker, socket_index)) {
+        logger_log_fatal(worker->logger, "Worker %zu could not receive on its shared sockets", worker->id);
+        exit(1);
+    }
+}
+
+static void route_packet(struct worker worker[static 1], size_t socket_index, void *buffer, size_t size) {
+    struct io_uring_recvmsg_out *out = io_uring_recvmsg_validate(buffer, (int) size, &worker->demux_msghdr);
+    if (out == nullptr) {
+        return;
+    }
+    const struct sockaddr *peer_address = io_uring_recvmsg_name(out);
+    uint16_t sid;
+    if (!session_demux_lookup(&worker->demux, peer_address, socket_index, &sid)) {
+        const struct tftp_error_packet_info *error = &tftp_error_packet_info[TFTP_ERROR_UNKNOWN_TRANSFER_ID];
+        const socklen_t addrlen = out->namelen < worker->demux_msghdr.msg_namelen ? out->namelen : worker->demux_msghdr.msg_namelen;
+        if (sendto(worker->demux.sockets[socket_index].file_descriptor, error->packet, error->size, 0, peer_address, addrlen) == -1) {
+            logger_log_warn(worker->logger, "Error while sending ERROR to unexpected sender: %s", strerror(errno));
+        }
+        return;
+    }
+    struct worker_job *job = &worker->jobs[sid];
+    const void *payload = io_uring_recvmsg_payload(out, &worker->demux_msghdr);
+    const size_t payload_size = io_uring_recvmsg_payload_length(out, (int) size, &worker->demux_msghdr);
+    handle_job_state(worker, job, job_handle_packet(job, payload, payload_size));
+}
+
+// The timer wheel is only ticking while it holds timers.
+static bool tick_async(struct worker worker[static 1]) {
+    if (!dispatcher_submit_timeout(&worker->dispatcher, &worker->tick_event)) {
+        return false;
+    }
+    worker->is_tick_armed = true;
+    return true;
+}
+
+static void on_tick(struct worker worker[static 1]) {
+    worker->is_tick_armed = false;
+    timer_wheel_advance(&worker->timer_wheel, timer_wheel_get_tick());
+    struct timer_wheel_timer *timer;
+    while ((timer = timer_wheel_pop_expired(&worker->timer_wheel)) != nullptr) {
+        struct dispatcher_event event = {.id = timer->id, .is_success = true};
+        struct worker_job *job = &worker->jobs[event.id >> 48];
+        handle_job_state(worker, job, job_handle_event(job, &event));
+    }
+}
+
+// The start queue event is read through the ring, so that the worker thread is the only one driving it.
+static bool wakeup_async(struct worker worker[static 1]) {
+    return dispatcher_submit_read(&worker->dispatcher,
+                                  &worker->wakeup_event,
+                                  worker->start_queue.event_descriptor,
+                                  &worker->wakeup_counter,
+                                  sizeof worker->wakeup_counter,
+                                  dispatcher_current_position);
+}
+
+static void on_wakeup(struct worker worker[static 1]) {
+    if (!worker->wakeup_event.is_success) {
+        logger_log_fatal(worker->logger, "Worker %zu could not read its start queue event. %s", worker->id, strerror(worker->wakeup_event.error_number));
+        exit(1);
+    }
+    uint16_t job_id;
+    while (start_queue_pop(&worker->start_queue, &job_id)) {
+        struct worker_job *job = &worker->jobs[job_id];
+        job->session->event_start.is_success = true;
+        handle_job_state(worker, job, job_handle_event(job, &job->session->event_start));
+    }
+    if (*worker->shutdown) {
+        // the read is not armed again, the worker exits once the pending requests are over
+        if (worker->is_demux_enabled) {
+            demux_recv_async_cancel(worker);
+        }
+        return;
+    }
+    if (!wakeup_async(worker)) {
+        logger_log_fatal(worker->logger, "Worker %zu could not wait for new sessions.", worker->id);
+        exit(1);
+    }
+}
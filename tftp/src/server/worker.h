@@ -9,6 +9,11 @@
 #include <logger.h>
 
 #include "dispatcher.h"
+#include "session_demux.h"
+#include "slab_allocator.h"
+#include "socket_pool.h"
+#include "start_queue.h"
+#include "timer_wheel.h"
 #include "worker_job.h"
 
 struct worker {
@@ -17,17 +22,51 @@ struct worker {
     thrd_t thread;
     uint16_t max_jobs;
     struct dispatcher dispatcher;
+    struct slab_allocator allocator;
+    struct socket_pool socket_pool;
+    bool is_demux_enabled;
+    struct session_demux demux;
+    struct msghdr demux_msghdr;                 // layout of the datagrams received on the shared sockets
+    struct dispatcher_event *demux_events;      // multishot receive of each shared socket
+    bool is_tick_armed;
+    struct dispatcher_event_timeout tick_event; // a single kernel timeout per tick drives the timer wheel
+    struct timer_wheel timer_wheel;             // retransmission timeouts of the sessions
+    struct start_queue start_queue;             // sessions handed over by the listener
+    uint64_t wakeup_counter;
+    struct dispatcher_event wakeup_event;       // read of the start queue event
     sem_t available_jobs;
     struct logger *logger;
     struct worker_job *jobs;
+    mtx_t free_jobs_mtx;
+    uint16_t free_jobs_count;
+    uint16_t *free_jobs;            // stack of idle job ids, the most recently released on top
 };
 
 bool worker_init(struct worker worker[static 1],
                  size_t id,
                  size_t max_jobs,
+                 size_t slab_max_cached_bytes,
+                 bool use_huge_pages,
+                 const struct sockaddr server_address[static 1],
+                 socklen_t server_addrlen,
+                 size_t socket_pool_capacity,
+                 uint16_t shared_socket_first_port,
+                 size_t shared_sockets_count,
                  atomic_bool shutdown[static 1],
                  struct logger logger[static 1]);
 
 void worker_destroy(struct worker worker[static 1]);
 
+/*
+ * Takes an idle job, the caller must have already reserved it on the available_jobs semaphore.
+ * Returns nullptr if the session memory could not be allocated, the reservation is then released.
+ */
+struct worker_job *worker_acquire_job(struct worker worker[static 1]);
+
+// Gives back a job that is not running, releasing its reservation on the available_jobs semaphore.
+void worker_release_job(struct worker worker[static 1], struct worker_job job[static 1]);
+
+// Hands an acquired job over to the worker thread, which starts its session.
+void worker_start_job(struct worker worker[static 1], struct worker_job job[static 1]);
+
 #endif // WORKER_H
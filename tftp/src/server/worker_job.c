@@ -1,7 +1,17 @@
 #include "worker_job.h"
 
+static enum job_state get_job_state(enum tftp_session_state state);
+
 enum job_state job_handle_event(struct worker_job job[static 1], struct dispatcher_event event[static 1]) {
-    switch (tftp_session_handle_event(&job->session, event)) {
+    return get_job_state(tftp_session_handle_event(job->session, event));
+}
+
+enum job_state job_handle_packet(struct worker_job job[static 1], const void *packet, size_t packet_size) {
+    return get_job_state(tftp_session_handle_packet(job->session, packet, packet_size));
+}
+
+static enum job_state get_job_state(enum tftp_session_state state) {
+    switch (state) {
         case TFTP_SESSION_STATE_IDLE:
             return JOB_STATE_RUNNING;
         case TFTP_SESSION_STATE_CLOSED:
@@ -3,11 +3,18 @@
 
 #include "session.h"
 
+struct worker;
+
 struct worker_job {
     uint16_t job_id;
-    volatile atomic_bool is_active;
+    struct worker *worker;
     struct dispatcher *dispatcher;
-    struct tftp_session session;
+    struct slab_allocator *allocator;
+    struct socket_pool *socket_pool;
+    struct session_demux *demux;    // nullptr unless the worker shares its sockets between sessions
+    struct timer_wheel *timer_wheel;
+    struct tftp_session *session;   // allocated when the job is acquired, released when the session terminates
+    struct tftp_session_cold *session_cold;
 };
 
 enum job_state {
@@ -18,4 +25,6 @@ enum job_state {
 
 enum job_state job_handle_event(struct worker_job job[static 1], struct dispatcher_event event[static 1]);
 
+enum job_state job_handle_packet(struct worker_job job[static 1], const void *packet, size_t packet_size);
+
 #endif // WORKER_JOB_H
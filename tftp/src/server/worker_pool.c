@@ -4,7 +4,6 @@
 #include <stddef.h>
 #include <string.h>
 
-#include "dispatcher.h"
 #include "worker.h"
 
 static struct worker *get_least_busy_worker(struct tftp_server_worker_pool *pool);
@@ -12,6 +11,13 @@ static struct worker *get_least_busy_worker(struct tftp_server_worker_pool *pool
 bool worker_pool_init(struct tftp_server_worker_pool pool[static 1],
                                   uint16_t workers_number,
                                   uint16_t worker_max_jobs,
+                                  size_t slab_max_cached_bytes,
+                                  bool use_huge_pages,
+                                  const struct sockaddr server_address[static 1],
+                                  socklen_t server_addrlen,
+                                  size_t socket_pool_capacity,
+                                  uint16_t shared_socket_first_port,
+                                  uint16_t shared_sockets_per_worker,
                                   struct logger logger[static 1]) {
     *pool = (struct tftp_server_worker_pool) {
         .logger = logger,
@@ -22,8 +28,15 @@ bool worker_pool_init(struct tftp_server_worker_pool pool[static 1],
     if (pool->workers == nullptr) {
         return false;
     }
+    const size_t shared_sockets_count = shared_socket_first_port != 0 ? shared_sockets_per_worker : 0;
+    if (shared_socket_first_port + (size_t) workers_number * shared_sockets_count > UINT16_MAX + 1) {
+        logger_log_error(logger, "The shared sockets of %hu workers do not fit in the ports above %hu.", workers_number, shared_socket_first_port);
+        free(pool->workers);
+        return false;
+    }
     for (size_t i = 0; i < workers_number; i++) {
-        if (!worker_init(&pool->workers[i], i, worker_max_jobs, &pool->shutdown, logger)) {
+        const uint16_t first_port = shared_socket_first_port + i * shared_sockets_count;
+        if (!worker_init(&pool->workers[i], i, worker_max_jobs, slab_max_cached_bytes, use_huge_pages, server_address, server_addrlen, socket_pool_capacity, first_port, shared_sockets_count, &pool->shutdown, logger)) {
             for (size_t j = 0; j < i; j++) {
                 worker_destroy(&pool->workers[j]);
             }
@@ -53,22 +66,36 @@ struct worker_job *worker_pool_get_job(struct tftp_server_worker_pool pool[stati
         logger_log_fatal(pool->logger, "Worker %zu encountered fatal error. %s.", worker->id, strerror(errno));
         exit(1);
     }
-    for (size_t i = 0; i < worker->max_jobs; i++) {
-        if (!worker->jobs[i].is_active) {
-            return &worker->jobs[i];
-        }
+    return worker_acquire_job(worker);
+}
+
+void worker_pool_put_job([[maybe_unused]] struct tftp_server_worker_pool pool[static 1], struct worker_job job[static 1]) {
+    worker_release_job(job->worker, job);
+}
+
+void worker_pool_collect_slab_stats(struct tftp_server_worker_pool pool[static 1], struct slab_allocator_stats stats[static 1]) {
+    *stats = (struct slab_allocator_stats) {};
+    for (size_t i = 0; i < pool->workers_number; i++) {
+        struct slab_allocator_stats worker_stats;
+        slab_allocator_collect_stats(&pool->workers[i].allocator, &worker_stats);
+        stats->allocations += worker_stats.allocations;
+        stats->reuses += worker_stats.reuses;
+        stats->bytes_in_use += worker_stats.bytes_in_use;
+        stats->bytes_cached += worker_stats.bytes_cached;
     }
-    unreachable();
 }
 
-bool worker_pool_start_job(struct tftp_server_worker_pool pool[static 1], struct worker_job job[static 1]) {
-    logger_log_debug(pool->logger, "Starting session.");
-    job->is_active = true;
-    if (!dispatcher_submit(job->session.dispatcher, &job->session.event_start)) {
-        job->is_active = false;
-        return false;
+uint64_t worker_pool_collect_socket_pool_misses(struct tftp_server_worker_pool pool[static 1]) {
+    uint64_t misses = 0;
+    for (size_t i = 0; i < pool->workers_number; i++) {
+        misses += socket_pool_collect_misses(&pool->workers[i].socket_pool);
     }
-    return true;
+    return misses;
+}
+
+void worker_pool_start_job(struct tftp_server_worker_pool pool[static 1], struct worker_job job[static 1]) {
+    logger_log_debug(pool->logger, "Starting session.");
+    worker_start_job(job->worker, job);
 }
 
 // TODO implement a reasonable load balancing strategy
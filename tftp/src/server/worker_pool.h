@@ -17,16 +17,37 @@ struct tftp_server_worker_pool {
     struct worker *workers;
 };
 
+/*
+ * When shared_socket_first_port is not 0 each worker binds shared_sockets_per_worker sockets, the ports of a worker
+ *  following the ones of the previous worker, and its sessions are served on them instead of a socket each.
+ */
 bool worker_pool_init(struct tftp_server_worker_pool pool[static 1],
                                   uint16_t workers_number,
                                   uint16_t worker_max_jobs,
+                                  size_t slab_max_cached_bytes,
+                                  bool use_huge_pages,
+                                  const struct sockaddr server_address[static 1],
+                                  socklen_t server_addrlen,
+                                  size_t socket_pool_capacity,
+                                  uint16_t shared_socket_first_port,
+                                  uint16_t shared_sockets_per_worker,
                                   struct logger logger[static 1]);
 
 bool worker_pool_destroy(struct tftp_server_worker_pool pool[static 1]);
 
+// Returns nullptr if the job could not be allocated.
 struct worker_job *worker_pool_get_job(struct tftp_server_worker_pool pool[static 1]);
 
-bool worker_pool_start_job(struct tftp_server_worker_pool pool[static 1],
-                                       struct worker_job job[static 1]);
+// Gives back a job obtained by worker_pool_get_job that was not started.
+void worker_pool_put_job(struct tftp_server_worker_pool pool[static 1], struct worker_job job[static 1]);
+
+// The session is started by the worker thread owning the job.
+void worker_pool_start_job(struct tftp_server_worker_pool pool[static 1], struct worker_job job[static 1]);
+
+// Sums the session buffer allocators statistics of all workers, see slab_allocator_collect_stats.
+void worker_pool_collect_slab_stats(struct tftp_server_worker_pool pool[static 1], struct slab_allocator_stats stats[static 1]);
+
+// Sums the socket pool misses of all workers, see socket_pool_collect_misses.
+uint64_t worker_pool_collect_socket_pool_misses(struct tftp_server_worker_pool pool[static 1]);
 
 #endif // WORKER_POOL_H
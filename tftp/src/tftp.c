@@ -9,6 +9,9 @@
 #include <strings.h>
 #include <netinet/in.h>
 
+#include "compression.h"
+#include "digest.h"
+
 /**
  * While being approved for C23, as of the time of writing, N3022 is still unsupported by any compiler I know.
  * The following code is a workaround for the lack of support of the <stdbit.h> header.
@@ -75,8 +78,16 @@ static enum tftp_mode tftp_get_mode(size_t n, const char mode[static n]);
 const char *tftp_option_recognized_string[] = {
         [TFTP_OPTION_BLKSIZE] = "blksize",
         [TFTP_OPTION_TIMEOUT] = "timeout",
+        [TFTP_OPTION_UTIMEOUT] = "utimeout",
         [TFTP_OPTION_TSIZE] = "tsize",
         [TFTP_OPTION_WINDOWSIZE] = "windowsize",
+        [TFTP_OPTION_SACK] = "sack",
+        [TFTP_OPTION_FEC] = "fec",
+        [TFTP_OPTION_OFFSET] = "offset",
+        [TFTP_OPTION_LENGTH] = "length",
+        [TFTP_OPTION_PIPELINE] = "pipeline",
+        [TFTP_OPTION_DIGEST] = "digest",
+        [TFTP_OPTION_COMPRESS] = "compress",
         [TFTP_OPTION_READ_TYPE] = "type",
 };
 
@@ -240,6 +251,20 @@ extern bool tftp_parse_packet(struct tftp_packet packet[static 1], size_t n, con
             data_to_parse_size -= sizeof packet->error.error_code;
             memcpy(packet->error.error_message, data_to_parse, data_to_parse_size);
             break;
+        case TFTP_OPCODE_FEC:
+            // the parity covers at least a block and is never larger than a block
+            if (n < sizeof(struct tftp_fec_packet) || n - sizeof(struct tftp_fec_packet) > sizeof packet->fec.data) {
+                return false;
+            }
+            packet->opcode = opcode;
+            packet->fec.block_number = ntohs(*(uint16_t *) data_to_parse);
+            packet->fec.blocks_count = ntohs(*(uint16_t *) (data_to_parse + 2));
+            packet->fec.size_parity = ntohs(*(uint16_t *) (data_to_parse + 4));
+            if (packet->fec.blocks_count == 0) {
+                return false;
+            }
+            memcpy(packet->fec.data, data_to_parse + 6, n - sizeof(struct tftp_fec_packet));
+            break;
     }
     return true;
 }
@@ -330,7 +355,7 @@ void tftp_parse_options(struct tftp_option options[static TFTP_OPTION_TOTAL_OPTI
                         char *not_parsed;
                         errno = 0;
                         size_t blksize = strtoul(val, &not_parsed, 10);
-                        if (*val == '\0' || *not_parsed != '\0' || blksize < 8 || blksize > 65464) {
+                        if (*val == '\0' || *not_parsed != '\0' || blksize < 8 || blksize > tftp_max_blksize) {
                             is_val_valid = false;
                             break;
                         }
@@ -352,6 +377,19 @@ void tftp_parse_options(struct tftp_option options[static TFTP_OPTION_TOTAL_OPTI
                         }
                         break;
                     }
+                    case TFTP_OPTION_UTIMEOUT: {
+                        char *not_parsed;
+                        errno = 0;
+                        unsigned long utimeout = strtoul(val, &not_parsed, 10);
+                        if (*val == '\0' || *not_parsed != '\0' || utimeout < tftp_min_utimeout_us || utimeout > tftp_max_utimeout_us) {
+                            is_val_valid = false;
+                            break;
+                        }
+                        while (isspace(*val) || *val == '+') {
+                            val++;
+                        }
+                        break;
+                    }
                     case TFTP_OPTION_TSIZE: {
                         if (strcmp(val, "0") == 0) {
                             val = calloc(1, 3 * sizeof(size_t) + 1);    // TODO remove malloc
@@ -382,8 +420,65 @@ void tftp_parse_options(struct tftp_option options[static TFTP_OPTION_TOTAL_OPTI
                         }
                         break;
                     }
+                    case TFTP_OPTION_SACK:
+                        if (strcmp(val, "1") != 0) {
+                            is_val_valid = false;
+                        }
+                        break;
+                    case TFTP_OPTION_FEC: {
+                        char *not_parsed;
+                        errno = 0;
+                        unsigned long group_size = strtoul(val, &not_parsed, 10);
+                        if (*val == '\0' || *not_parsed != '\0' || group_size < 1 || group_size > 255) {
+                            is_val_valid = false;
+                            break;
+                        }
+                        while (isspace(*val) || *val == '+') {
+                            val++;
+                        }
+                        break;
+                    }
+                    case TFTP_OPTION_OFFSET:
+                    case TFTP_OPTION_LENGTH: {
+                        char *not_parsed;
+                        errno = 0;
+                        unsigned long long bytes = strtoull(val, &not_parsed, 10);
+                        if (*val == '\0' || *not_parsed != '\0' || strchr(val, '-') != nullptr || bytes > INT64_MAX) {
+                            is_val_valid = false;
+                            break;
+                        }
+                        while (isspace(*val) || *val == '+') {
+                            val++;
+                        }
+                        break;
+                    }
+                    case TFTP_OPTION_PIPELINE: {
+                        char *not_parsed;
+                        errno = 0;
+                        unsigned long block_number = strtoul(val, &not_parsed, 10);
+                        if (*val == '\0' || *not_parsed != '\0' || strchr(val, '-') != nullptr || block_number > 65535) {
+                            is_val_valid = false;
+                            break;
+                        }
+                        while (isspace(*val) || *val == '+') {
+                            val++;
+                        }
+                        break;
+                    }
+                    case TFTP_OPTION_DIGEST: {
+                        uint64_t digest;
+                        if (strcasecmp(val, digest_algorithm) != 0 && !digest_parse(val, &digest)) {
+                            is_val_valid = false;
+                        }
+                        break;
+                    }
+                    case TFTP_OPTION_COMPRESS:
+                        if (strcasecmp(val, compression_algorithm) != 0) {
+                            is_val_valid = false;
+                        }
+                        break;
                     case TFTP_OPTION_READ_TYPE:
-                        if (strcasecmp(val, "directory") != 0) {
+                        if (strcasecmp(val, "directory") != 0 && strcasecmp(val, "directory-detailed") != 0) {
                             is_val_valid = false;
                         }
                         break;
@@ -0,0 +1,25 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FNV-1a
+static inline uint64_t hash_string(const char str[static 1]) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const unsigned char *c = (const unsigned char *) str; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 0x100000001b3;
+    }
+    return hash;
+}
+
+// FNV-1a
+static inline uint64_t hash_bytes(const void *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const unsigned char *c = data; c < (const unsigned char *) data + size; c++) {
+        hash = (hash ^ *c) * 0x100000001b3;
+    }
+    return hash;
+}
+
+#endif // HASH_H
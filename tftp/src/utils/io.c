@@ -42,24 +42,23 @@ bool file_size_netascii(int fd, size_t size[static 1]) {
     if (buffer == nullptr) {
         return false;
     }
+    off_t offset = 0;
     while (bytes_to_read) {
-        ssize_t bytes_read = read(fd, buffer, buffer_size);
-        if (bytes_read == -1) {
+        ssize_t bytes_read = pread(fd, buffer, buffer_size, offset);
+        if (bytes_read == -1 || bytes_read == 0) {
             free(buffer);
             return false;
         }
         netascii_size += bytes_read;
-        for (size_t i = 0; i < buffer_size; i++) {
+        for (ssize_t i = 0; i < bytes_read; i++) {
             if (buffer[i] == '\n' || buffer[i] == '\r') {
                 ++netascii_size;
             }
         }
         bytes_to_read -= bytes_read;
+        offset += bytes_read;
     }
     free(buffer);
-    if (lseek(fd, 0, SEEK_SET) == -1) {
-        return false;
-    }
     *size = netascii_size;
     return true;
 }
@@ -1,5 +1,125 @@
 #include <buracchi/cutest/cutest.h>
 
+#include <string.h>
+
+#include <tftp.h>
+
 TEST(tftp, dummy) {
     ASSERT_EQ(0, 0);
 }
+
+TEST(tftp, utimeout_option_is_recognized_along_with_timeout) {
+    const char options[] = "utimeout\0" "+250000\0" "timeout\0" "1";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof options, options);
+    ASSERT_TRUE(parsed[TFTP_OPTION_UTIMEOUT].is_active);
+    ASSERT_EQ(strcmp(parsed[TFTP_OPTION_UTIMEOUT].value, "250000"), 0);
+    ASSERT_TRUE(parsed[TFTP_OPTION_TIMEOUT].is_active);
+}
+
+TEST(tftp, utimeout_option_out_of_range_is_not_recognized) {
+    const char too_short[] = "utimeout\0" "999";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof too_short, too_short);
+    ASSERT_FALSE(parsed[TFTP_OPTION_UTIMEOUT].is_active);
+    const char too_long[] = "utimeout\0" "255000001";
+    tftp_parse_options(parsed, sizeof too_long, too_long);
+    ASSERT_FALSE(parsed[TFTP_OPTION_UTIMEOUT].is_active);
+}
+
+TEST(tftp, sack_option_is_recognized_only_when_enabled) {
+    const char enabled[] = "windowsize\0" "8\0" "SACK\0" "1";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof enabled, enabled);
+    ASSERT_TRUE(parsed[TFTP_OPTION_SACK].is_active);
+    ASSERT_TRUE(parsed[TFTP_OPTION_WINDOWSIZE].is_active);
+    const char disabled[] = "sack\0" "0";
+    struct tftp_option parsed_disabled[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_disabled, sizeof disabled, disabled);
+    ASSERT_FALSE(parsed_disabled[TFTP_OPTION_SACK].is_active);
+}
+
+TEST(tftp, fec_option_group_size_must_be_between_1_and_255) {
+    const char valid[] = "fec\0" "8";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof valid, valid);
+    ASSERT_TRUE(parsed[TFTP_OPTION_FEC].is_active);
+    ASSERT_EQ(strcmp(parsed[TFTP_OPTION_FEC].value, "8"), 0);
+    const char zero[] = "fec\0" "0";
+    struct tftp_option parsed_zero[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_zero, sizeof zero, zero);
+    ASSERT_FALSE(parsed_zero[TFTP_OPTION_FEC].is_active);
+    const char too_large[] = "fec\0" "256";
+    struct tftp_option parsed_too_large[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_too_large, sizeof too_large, too_large);
+    ASSERT_FALSE(parsed_too_large[TFTP_OPTION_FEC].is_active);
+}
+
+TEST(tftp, offset_and_length_options_must_be_non_negative_byte_counts) {
+    const char valid[] = "offset\0" "1048576\0" "length\0" "0";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof valid, valid);
+    ASSERT_TRUE(parsed[TFTP_OPTION_OFFSET].is_active);
+    ASSERT_EQ(strcmp(parsed[TFTP_OPTION_OFFSET].value, "1048576"), 0);
+    ASSERT_TRUE(parsed[TFTP_OPTION_LENGTH].is_active);
+    const char invalid[] = "offset\0" "-1\0" "length\0" "9223372036854775808";
+    struct tftp_option parsed_invalid[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_invalid, sizeof invalid, invalid);
+    ASSERT_FALSE(parsed_invalid[TFTP_OPTION_OFFSET].is_active);
+    ASSERT_FALSE(parsed_invalid[TFTP_OPTION_LENGTH].is_active);
+}
+
+TEST(tftp, pipeline_option_must_be_a_block_number) {
+    const char valid[] = "pipeline\0" "65535";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof valid, valid);
+    ASSERT_TRUE(parsed[TFTP_OPTION_PIPELINE].is_active);
+    ASSERT_EQ(strcmp(parsed[TFTP_OPTION_PIPELINE].value, "65535"), 0);
+    const char invalid[] = "pipeline\0" "65536";
+    struct tftp_option parsed_invalid[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_invalid, sizeof invalid, invalid);
+    ASSERT_FALSE(parsed_invalid[TFTP_OPTION_PIPELINE].is_active);
+}
+
+TEST(tftp, digest_option_must_name_the_algorithm_or_a_digest) {
+    const char request[] = "digest\0" "XXH64";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof request, request);
+    ASSERT_TRUE(parsed[TFTP_OPTION_DIGEST].is_active);
+    const char oack[] = "digest\0" "xxh64:0123456789abcdef";
+    struct tftp_option parsed_oack[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_oack, sizeof oack, oack);
+    ASSERT_TRUE(parsed_oack[TFTP_OPTION_DIGEST].is_active);
+    const char invalid[] = "digest\0" "sha256:0123456789abcdef";
+    struct tftp_option parsed_invalid[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_invalid, sizeof invalid, invalid);
+    ASSERT_FALSE(parsed_invalid[TFTP_OPTION_DIGEST].is_active);
+}
+
+TEST(tftp, compress_option_must_name_the_algorithm) {
+    const char valid[] = "compress\0" "LZ77";
+    struct tftp_option parsed[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed, sizeof valid, valid);
+    ASSERT_TRUE(parsed[TFTP_OPTION_COMPRESS].is_active);
+    const char invalid[] = "compress\0" "zstd";
+    struct tftp_option parsed_invalid[TFTP_OPTION_TOTAL_OPTIONS] = {};
+    tftp_parse_options(parsed_invalid, sizeof invalid, invalid);
+    ASSERT_FALSE(parsed_invalid[TFTP_OPTION_COMPRESS].is_active);
+}
+
+TEST(tftp, fec_packet_is_parsed_and_validated) {
+    struct tftp_packet packet;
+    const uint8_t valid[] = {0, TFTP_OPCODE_FEC, 0, 9, 0, 4, 0x02, 0x01, 0xAA, 0xBB};
+    ASSERT_TRUE(tftp_parse_packet(&packet, sizeof valid, valid));
+    ASSERT_EQ(packet.fec.block_number, 9);
+    ASSERT_EQ(packet.fec.blocks_count, 4);
+    ASSERT_EQ(packet.fec.size_parity, 0x0201);
+    ASSERT_EQ(packet.fec.data[0], 0xAA);
+    ASSERT_EQ(packet.fec.data[1], 0xBB);
+    const uint8_t truncated[] = {0, TFTP_OPCODE_FEC, 0, 9, 0, 4, 0};
+    ASSERT_FALSE(tftp_parse_packet(&packet, sizeof truncated, truncated));
+    const uint8_t empty_group[] = {0, TFTP_OPCODE_FEC, 0, 9, 0, 0, 0, 0};
+    ASSERT_FALSE(tftp_parse_packet(&packet, sizeof empty_group, empty_group));
+    uint8_t oversized[sizeof(struct tftp_fec_packet) + 513] = {0, TFTP_OPCODE_FEC, 0, 9, 0, 4};
+    ASSERT_FALSE(tftp_parse_packet(&packet, sizeof oversized, oversized));
+}
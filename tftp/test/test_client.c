@@ -150,3 +150,87 @@ TEST(client, on_unexpected_peer_send_error_packet) {
     close(expected_socket);
     wait(nullptr);
 }
+
+static void send_data(int server_socket, uint16_t block_number, size_t data_size, struct sockaddr *client_addr, socklen_t addr_len) {
+    uint8_t buffer[516] = {};
+    tftp_data_packet_init((struct tftp_data_packet *) buffer, block_number);
+    sendto(server_socket, buffer, sizeof(struct tftp_data_packet) + data_size, 0, client_addr, addr_len);
+}
+
+TEST(client, sack_bitmap_reports_buffered_blocks) {
+    uint16_t server_port = 1240;
+    char server_port_str[6];
+    snprintf(server_port_str, sizeof server_port_str, "%hu", server_port);
+    FILE *out = tmpfile();
+    ASSERT_NE(out, nullptr);
+    struct sockaddr_in6 server_addr = {
+        .sin6_family = AF_INET6,
+        .sin6_addr = in6addr_loopback,
+        .sin6_port = htons(server_port),
+    };
+    int server_socket;
+    ASSERT_NE(server_socket = socket(AF_INET6, SOCK_DGRAM, 0), -1);
+    ASSERT_NE(setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &(int){true}, sizeof(int)), -1);
+    ASSERT_NE(setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout)), -1);
+    ASSERT_NE(bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)), -1);
+    
+    if (fork() == 0) {
+        struct tftp_client_options options = {
+            .window_size = &(uint16_t) {4},
+            .use_sack = true,
+        };
+        auto const ret = tftp_client_read(&(struct logger) {}, 0, "::", server_port_str, "test", TFTP_MODE_OCTET, &options, out);
+        exit(ret.is_success ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    
+    uint8_t buffer[516];
+    struct sockaddr_in6 client_addr_in6;
+    socklen_t addr_len = sizeof(client_addr_in6);
+    struct sockaddr *client_addr = (struct sockaddr *) &client_addr_in6;
+    auto const sack = (struct tftp_sack_packet *) buffer;
+    
+    ASSERT_GT(recvfrom(server_socket, buffer, sizeof buffer, 0, client_addr, &addr_len), 0);
+    const char oack[] = "\0\6windowsize\0" "4\0" "sack\0" "1";
+    sendto(server_socket, oack, sizeof oack, 0, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof(struct tftp_ack_packet));
+    ASSERT_EQ(ntohs(sack->block_number), 0);
+    send_data(server_socket, 1, 512, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof(struct tftp_ack_packet));
+    ASSERT_EQ(ntohs(sack->block_number), 1);
+    // block 2 is lost, bit i reports block 3 + i
+    send_data(server_socket, 3, 512, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof *sack + 1);
+    ASSERT_EQ(ntohs(sack->block_number), 1);
+    ASSERT_EQ(sack->bitmap[0], 0b001);
+    send_data(server_socket, 4, 512, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof *sack + 1);
+    ASSERT_EQ(ntohs(sack->block_number), 1);
+    ASSERT_EQ(sack->bitmap[0], 0b011);
+    // filling the hole delivers the buffered blocks and leaves nothing to report
+    send_data(server_socket, 2, 512, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof(struct tftp_ack_packet));
+    ASSERT_EQ(ntohs(sack->block_number), 4);
+    // block 5 is lost, block 8 is stored in the slot before the ones of blocks 6 and 7
+    send_data(server_socket, 6, 512, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof *sack + 1);
+    ASSERT_EQ(ntohs(sack->block_number), 4);
+    ASSERT_EQ(sack->bitmap[0], 0b001);
+    send_data(server_socket, 8, 10, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof *sack + 1);
+    ASSERT_EQ(ntohs(sack->block_number), 4);
+    ASSERT_EQ(sack->bitmap[0], 0b101);
+    send_data(server_socket, 5, 512, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof *sack + 1);
+    ASSERT_EQ(ntohs(sack->block_number), 6);
+    ASSERT_EQ(sack->bitmap[0], 0b001);
+    send_data(server_socket, 7, 512, client_addr, addr_len);
+    ASSERT_EQ(recv(server_socket, buffer, sizeof buffer, 0), (ssize_t) sizeof(struct tftp_ack_packet));
+    ASSERT_EQ(ntohs(sack->block_number), 8);
+    close(server_socket);
+    int status;
+    wait(&status);
+    ASSERT_EQ(WEXITSTATUS(status), EXIT_SUCCESS);
+    ASSERT_EQ(fseek(out, 0, SEEK_END), 0);
+    ASSERT_EQ(ftell(out), 7 * 512 + 10);
+    fclose(out);
+}
@@ -0,0 +1,95 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/compression.h"
+#include "mock_logger.h"
+
+// Feeds the frames in pieces of at most step bytes and appends the chunks to content, returns the content size or -1.
+static ssize_t decompress(size_t size, const uint8_t frames[static size], size_t step, uint8_t content[]) {
+    struct logger logger;
+    struct decompressor decompressor;
+    if (!decompressor_init(&decompressor, &logger)) {
+        return -1;
+    }
+    size_t content_size = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        const size_t piece = size - offset < step ? size - offset : step;
+        size_t piece_offset = 0;
+        while (piece_offset < piece) {
+            const uint8_t *chunk;
+            size_t chunk_size;
+            const ssize_t consumed = decompressor_feed(&decompressor, piece - piece_offset, &frames[offset + piece_offset], &chunk, &chunk_size);
+            if (consumed < 0) {
+                decompressor_destroy(&decompressor);
+                return -1;
+            }
+            if (chunk_size != 0) {
+                memcpy(&content[content_size], chunk, chunk_size);
+                content_size += chunk_size;
+            }
+            piece_offset += consumed;
+        }
+        offset += piece;
+    }
+    const bool is_complete = decompressor_is_at_frame_boundary(&decompressor);
+    decompressor_destroy(&decompressor);
+    return is_complete ? (ssize_t) content_size : -1;
+}
+
+TEST(compression, repetitive_content_shrinks_and_is_restored) {
+    const size_t size = 3 * compression_chunk_size + 1000;
+    uint8_t *content = malloc(size);
+    uint8_t *frames = malloc(compression_bound(size));
+    uint8_t *restored = malloc(size);
+    const char line[] = "option domain-name-servers 10.0.0.1, 10.0.0.2;\n";
+    for (size_t i = 0; i < size; i++) {
+        content[i] = (uint8_t) line[i % (sizeof line - 1)];
+    }
+    const size_t frames_size = compression_compress(content, size, frames);
+    ASSERT_TRUE(frames_size < size / 10);
+    ASSERT_EQ(decompress(frames_size, frames, 512, restored), (ssize_t) size);
+    ASSERT_EQ(memcmp(restored, content, size), 0);
+    free(content);
+    free(frames);
+    free(restored);
+}
+
+TEST(compression, incompressible_chunks_are_stored_as_is) {
+    const size_t size = compression_chunk_size + 3;
+    uint8_t *content = malloc(size);
+    uint8_t *frames = malloc(compression_bound(size));
+    uint8_t *restored = malloc(size);
+    uint32_t state = 1;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 1103515245 + 12345;
+        content[i] = (uint8_t) (state >> 16);
+    }
+    const size_t frames_size = compression_compress(content, size, frames);
+    ASSERT_EQ(frames_size, size + 2 * compression_frame_header_size);
+    ASSERT_EQ(decompress(frames_size, frames, 1, restored), (ssize_t) size);
+    ASSERT_EQ(memcmp(restored, content, size), 0);
+    free(content);
+    free(frames);
+    free(restored);
+}
+
+TEST(compression, ill_formed_frames_are_rejected) {
+    uint8_t content[4096];
+    uint8_t frames[compression_frame_header_size + 4096 + 32];
+    uint8_t restored[4096];
+    for (size_t i = 0; i < sizeof content; i++) {
+        content[i] = (uint8_t) (i % 7);
+    }
+    const size_t frames_size = compression_compress(content, sizeof content, frames);
+    ASSERT_TRUE(frames_size < sizeof content);
+    // a match reaching before the start of the chunk
+    uint8_t corrupted[sizeof frames];
+    memcpy(corrupted, frames, frames_size);
+    corrupted[compression_frame_header_size + 1 + 7] = 0xff;
+    ASSERT_EQ(decompress(frames_size, corrupted, frames_size, restored), -1);
+    // a truncated frame
+    ASSERT_EQ(decompress(frames_size - 1, frames, frames_size, restored), -1);
+}
@@ -0,0 +1,46 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <string.h>
+
+#include "../src/digest.h"
+
+static uint64_t digest_of(const void *data, size_t size) {
+    struct digest_state state;
+    digest_init(&state);
+    digest_update(&state, data, size);
+    return digest_final(&state);
+}
+
+TEST(digest, matches_the_xxh64_reference_values) {
+    ASSERT_EQ(digest_of("", 0), 0xEF46DB3751D8E999);
+    ASSERT_EQ(digest_of("a", 1), 0xD24EC4F1A98C6E5B);
+    ASSERT_EQ(digest_of("abc", 3), 0x44BC2CF5AD770999);
+    const char long_input[] = "Nobody inspects the spammish repetition";
+    ASSERT_EQ(digest_of(long_input, sizeof long_input - 1), 0xFBCEA83C8A378BF1);
+}
+
+TEST(digest, chunked_updates_match_a_single_update) {
+    uint8_t data[10'000];
+    for (size_t i = 0; i < sizeof data; i++) {
+        data[i] = (uint8_t) (i * 7 + 3);
+    }
+    struct digest_state state;
+    digest_init(&state);
+    for (size_t offset = 0, chunk = 1; offset < sizeof data; offset += chunk, chunk = chunk % 77 + 1) {
+        digest_update(&state, &data[offset], chunk < sizeof data - offset ? chunk : sizeof data - offset);
+    }
+    ASSERT_EQ(digest_final(&state), digest_of(data, sizeof data));
+}
+
+TEST(digest, formatted_value_is_parsed_back) {
+    char str[digest_string_size];
+    digest_format(0x00A1B2C3D4E5F607, str);
+    ASSERT_EQ(strcmp(str, "xxh64:00a1b2c3d4e5f607"), 0);
+    uint64_t digest;
+    ASSERT_TRUE(digest_parse(str, &digest));
+    ASSERT_EQ(digest, 0x00A1B2C3D4E5F607);
+    ASSERT_FALSE(digest_parse("xxh64", &digest));
+    ASSERT_FALSE(digest_parse("xxh3:00a1b2c3d4e5f607", &digest));
+    ASSERT_FALSE(digest_parse("xxh64:00a1b2c3d4e5f6", &digest));
+    ASSERT_FALSE(digest_parse("xxh64:00a1b2c3d4e5f60g", &digest));
+}
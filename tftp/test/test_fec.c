@@ -0,0 +1,167 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <string.h>
+
+#include "../src/fec.h"
+#include "mock_logger.h"
+
+constexpr uint16_t block_size = 16;
+
+static void fill_block(uint8_t block[static block_size], uint64_t block_number) {
+    for (size_t i = 0; i < block_size; i++) {
+        block[i] = (uint8_t) (block_number * 31 + i);
+    }
+}
+
+// Builds the FEC packet of the blocks_count blocks starting from first_block, the last one is size bytes long.
+static void encode(uint64_t first_block, uint16_t blocks_count, size_t last_size, uint8_t parity[static block_size], uint16_t size_parity[static 1]) {
+    memset(parity, 0, block_size);
+    *size_parity = 0;
+    for (uint16_t i = 0; i < blocks_count; i++) {
+        uint8_t block[block_size];
+        fill_block(block, first_block + i);
+        const size_t size = i == blocks_count - 1 ? last_size : block_size;
+        fec_xor(parity, block, size);
+        *size_parity ^= size;
+    }
+}
+
+TEST(fec, xor_of_unaligned_sizes_matches_the_bytewise_xor) {
+    uint8_t destination[37];
+    uint8_t source[37];
+    uint8_t expected[37];
+    for (size_t i = 0; i < sizeof destination; i++) {
+        destination[i] = (uint8_t) (i * 7);
+        source[i] = (uint8_t) (i * 13 + 1);
+        expected[i] = destination[i] ^ source[i];
+    }
+    fec_xor(destination, source, sizeof destination);
+    ASSERT_EQ(memcmp(destination, expected, sizeof expected), 0);
+}
+
+TEST(fec, single_missing_block_is_recovered) {
+    struct logger logger;
+    struct fec_decoder decoder;
+    ASSERT_TRUE(fec_decoder_init(&decoder, 4, block_size, 8, &logger));
+    uint8_t parity[block_size];
+    uint16_t size_parity;
+    encode(5, 4, block_size, parity, &size_parity);
+    for (uint64_t b = 5; b < 9; b++) {
+        uint8_t block[block_size];
+        fill_block(block, b);
+        if (b != 7) {
+            fec_decoder_add_block(&decoder, b, block, block_size);
+        }
+    }
+    uint64_t recovered_block;
+    const uint8_t *data;
+    size_t size;
+    ASSERT_FALSE(fec_decoder_recover(&decoder, 5, &recovered_block, &data, &size));
+    fec_decoder_add_fec(&decoder, 5, 4, size_parity, parity, block_size);
+    ASSERT_TRUE(fec_decoder_recover(&decoder, 5, &recovered_block, &data, &size));
+    ASSERT_EQ(recovered_block, 7);
+    ASSERT_EQ(size, block_size);
+    uint8_t expected[block_size];
+    fill_block(expected, 7);
+    ASSERT_EQ(memcmp(data, expected, block_size), 0);
+    ASSERT_FALSE(fec_decoder_recover(&decoder, 5, &recovered_block, &data, &size));
+    fec_decoder_destroy(&decoder);
+}
+
+TEST(fec, short_last_block_of_a_truncated_group_is_recovered) {
+    struct logger logger;
+    struct fec_decoder decoder;
+    ASSERT_TRUE(fec_decoder_init(&decoder, 4, block_size, 8, &logger));
+    uint8_t parity[block_size];
+    uint16_t size_parity;
+    encode(1, 3, 5, parity, &size_parity);
+    uint8_t block[block_size];
+    fill_block(block, 1);
+    fec_decoder_add_block(&decoder, 1, block, block_size);
+    fec_decoder_add_fec(&decoder, 1, 3, size_parity, parity, block_size);
+    fill_block(block, 2);
+    fec_decoder_add_block(&decoder, 2, block, block_size);
+    uint64_t recovered_block;
+    const uint8_t *data;
+    size_t size;
+    ASSERT_TRUE(fec_decoder_recover(&decoder, 2, &recovered_block, &data, &size));
+    ASSERT_EQ(recovered_block, 3);
+    ASSERT_EQ(size, 5);
+    fill_block(block, 3);
+    ASSERT_EQ(memcmp(data, block, 5), 0);
+    fec_decoder_destroy(&decoder);
+}
+
+TEST(fec, two_missing_blocks_are_not_recovered_and_duplicates_are_ignored) {
+    struct logger logger;
+    struct fec_decoder decoder;
+    ASSERT_TRUE(fec_decoder_init(&decoder, 4, block_size, 8, &logger));
+    uint8_t parity[block_size];
+    uint16_t size_parity;
+    encode(1, 4, block_size, parity, &size_parity);
+    uint8_t block[block_size];
+    fill_block(block, 1);
+    fec_decoder_add_block(&decoder, 1, block, block_size);
+    fec_decoder_add_block(&decoder, 1, block, block_size);
+    fill_block(block, 2);
+    fec_decoder_add_block(&decoder, 2, block, block_size);
+    fec_decoder_add_fec(&decoder, 1, 4, size_parity, parity, block_size);
+    fec_decoder_add_fec(&decoder, 1, 4, size_parity, parity, block_size);
+    uint64_t recovered_block;
+    const uint8_t *data;
+    size_t size;
+    ASSERT_FALSE(fec_decoder_recover(&decoder, 1, &recovered_block, &data, &size));
+    fill_block(block, 4);
+    fec_decoder_add_block(&decoder, 4, block, block_size);
+    ASSERT_TRUE(fec_decoder_recover(&decoder, 4, &recovered_block, &data, &size));
+    ASSERT_EQ(recovered_block, 3);
+    fill_block(block, 3);
+    ASSERT_EQ(memcmp(data, block, block_size), 0);
+    fec_decoder_destroy(&decoder);
+}
+
+TEST(fec, blocks_are_counted_from_1_again_after_a_reset) {
+    struct logger logger;
+    struct fec_decoder decoder;
+    ASSERT_TRUE(fec_decoder_init(&decoder, 2, block_size, 8, &logger));
+    uint8_t block[block_size];
+    for (uint64_t b = 1; b <= 6; b++) {
+        fill_block(block, b);
+        fec_decoder_add_block(&decoder, b, block, block_size);
+    }
+    fec_decoder_reset(&decoder);
+    uint8_t parity[block_size];
+    uint16_t size_parity;
+    encode(1, 2, block_size, parity, &size_parity);
+    fill_block(block, 1);
+    fec_decoder_add_block(&decoder, 1, block, block_size);
+    fec_decoder_add_fec(&decoder, 1, 2, size_parity, parity, block_size);
+    uint64_t recovered_block;
+    const uint8_t *data;
+    size_t size;
+    ASSERT_TRUE(fec_decoder_recover(&decoder, 1, &recovered_block, &data, &size));
+    ASSERT_EQ(recovered_block, 2);
+    fill_block(block, 2);
+    ASSERT_EQ(memcmp(data, block, block_size), 0);
+    fec_decoder_destroy(&decoder);
+}
+
+TEST(fec, groups_older_than_the_span_are_dropped) {
+    struct logger logger;
+    struct fec_decoder decoder;
+    ASSERT_TRUE(fec_decoder_init(&decoder, 2, block_size, 2, &logger));
+    uint8_t parity[block_size];
+    uint16_t size_parity;
+    encode(1, 2, block_size, parity, &size_parity);
+    uint8_t block[block_size];
+    fill_block(block, 1);
+    fec_decoder_add_block(&decoder, 1, block, block_size);
+    fill_block(block, 5);
+    fec_decoder_add_block(&decoder, 5, block, block_size);
+    fec_decoder_add_fec(&decoder, 1, 2, size_parity, parity, block_size);
+    uint64_t recovered_block;
+    const uint8_t *data;
+    size_t size;
+    ASSERT_FALSE(fec_decoder_recover(&decoder, 1, &recovered_block, &data, &size));
+    fec_decoder_destroy(&decoder);
+}
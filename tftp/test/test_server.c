@@ -207,6 +207,192 @@ TEST(server, on_unexpected_peer_send_error_packet) {
     tftp_server_destroy(&server);
 }
 
+TEST(server, duplicate_acks_trigger_fast_retransmit) {
+    thrd_t server_thrd;
+    struct tftp_server server;
+    uint16_t server_port = 1238;
+    char server_port_str[6];
+    snprintf(server_port_str, sizeof server_port_str, "%hu", server_port);
+    struct tftp_server_arguments args = {
+        .ip = "::",
+        .port = server_port_str,
+        .root = "/dev",
+        .retries = 3,
+        .timeout_s = 5,
+        .fast_retransmit_threshold = 3,
+        .workers = 1,
+        .max_worker_sessions = 1,
+        .server_stats_callback = nullptr,
+        .session_stats_callback = nullptr,
+        .stats_interval_seconds = 60,
+    };
+    struct sockaddr_in6 server_addr = {
+        .sin6_family = AF_INET6,
+        .sin6_addr = in6addr_loopback,
+        .sin6_port = htons(server_port),
+    };
+    ASSERT_TRUE(tftp_server_init(&server, args, &(struct logger) {}));
+    ASSERT_EQ(thrd_create(&server_thrd, server_thread, &server), thrd_success);
+    
+    struct tftp_rrq_packet rrq;
+    char filename[] = "zero";
+    size_t rrq_size = tftp_rrq_packet_init(
+        &rrq,
+        sizeof filename,
+        filename,
+        TFTP_MODE_OCTET,
+        (struct tftp_option[TFTP_OPTION_TOTAL_OPTIONS]) {
+            [TFTP_OPTION_BLKSIZE] = {.is_active = false},
+            [TFTP_OPTION_TIMEOUT] = {.is_active = false},
+            [TFTP_OPTION_TSIZE] = {.is_active = false},
+            [TFTP_OPTION_WINDOWSIZE] = {.is_active = true, .value = "4"},
+        });
+    struct sockaddr_in6 client_addr = {
+        .sin6_family = AF_INET6,
+        .sin6_addr = in6addr_loopback,
+        .sin6_port = htons(2346),
+    };
+    int client_socket;
+    ASSERT_NE(client_socket = socket(AF_INET6, SOCK_DGRAM, 0), -1);
+    ASSERT_NE(setsockopt(client_socket, SOL_SOCKET, SO_REUSEADDR, &(int){true}, sizeof(int)), -1);
+    ASSERT_NE(setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout)), -1);
+    ASSERT_NE(bind(client_socket, (struct sockaddr *)&client_addr, sizeof(client_addr)), -1);
+    
+    struct sockaddr_storage session_addr = {};
+    socklen_t session_addr_len = sizeof session_addr;
+    uint8_t buffer[1024] = {};
+    struct tftp_data_packet *data_packet = (struct tftp_data_packet *) buffer;
+    struct tftp_ack_packet ack;
+    
+    sendto(client_socket, &rrq, rrq_size, 0, (struct sockaddr *)&server_addr, sizeof(server_addr));
+    ASSERT_TRUE(recvfrom(client_socket, buffer, sizeof buffer, 0, (struct sockaddr *) &session_addr, &session_addr_len) > 0);
+    ASSERT_EQ(ntohs(data_packet->opcode), TFTP_OPCODE_OACK);
+    tftp_ack_packet_init(&ack, 0);
+    sendto(client_socket, &ack, sizeof ack, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    for (uint16_t block = 1; block <= 4; block++) {
+        ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+        ASSERT_EQ(ntohs(data_packet->block_number), block);
+    }
+    // block 2 is lost, the window moves to [2, 5] and every later block is answered with a duplicate ACK of block 1
+    tftp_ack_packet_init(&ack, 1);
+    sendto(client_socket, &ack, sizeof ack, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+    ASSERT_EQ(ntohs(data_packet->block_number), 5);
+    for (int i = 0; i < 3; i++) {
+        sendto(client_socket, &ack, sizeof ack, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    }
+    // the retransmission comes well before the 5 seconds timeout
+    ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+    ASSERT_EQ(ntohs(data_packet->opcode), TFTP_OPCODE_DATA);
+    ASSERT_EQ(ntohs(data_packet->block_number), 2);
+    
+    const struct tftp_error_packet_info *error = &tftp_error_packet_info[TFTP_ERROR_ILLEGAL_OPERATION];
+    sendto(client_socket, error->packet, error->size, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    tftp_server_stop(&server);
+    // sending invalid opcode to exit from the recvmsg server loop
+    sendto(client_socket, &(char[]){0xF}, 1, 0, (struct sockaddr *)&server_addr, sizeof(server_addr));
+    thrd_join(server_thrd, nullptr);
+    close(client_socket);
+    tftp_server_destroy(&server);
+}
+
+TEST(server, selective_acks_are_not_retransmitted) {
+    thrd_t server_thrd;
+    struct tftp_server server;
+    uint16_t server_port = 1241;
+    char server_port_str[6];
+    snprintf(server_port_str, sizeof server_port_str, "%hu", server_port);
+    struct tftp_server_arguments args = {
+        .ip = "::",
+        .port = server_port_str,
+        .root = "/dev",
+        .retries = 3,
+        .timeout_s = 5,
+        .fast_retransmit_threshold = 3,
+        .workers = 1,
+        .max_worker_sessions = 1,
+        .server_stats_callback = nullptr,
+        .session_stats_callback = nullptr,
+        .stats_interval_seconds = 60,
+    };
+    struct sockaddr_in6 server_addr = {
+        .sin6_family = AF_INET6,
+        .sin6_addr = in6addr_loopback,
+        .sin6_port = htons(server_port),
+    };
+    ASSERT_TRUE(tftp_server_init(&server, args, &(struct logger) {}));
+    ASSERT_EQ(thrd_create(&server_thrd, server_thread, &server), thrd_success);
+    
+    struct tftp_rrq_packet rrq;
+    char filename[] = "zero";
+    size_t rrq_size = tftp_rrq_packet_init(
+        &rrq,
+        sizeof filename,
+        filename,
+        TFTP_MODE_OCTET,
+        (struct tftp_option[TFTP_OPTION_TOTAL_OPTIONS]) {
+            [TFTP_OPTION_WINDOWSIZE] = {.is_active = true, .value = "4"},
+            [TFTP_OPTION_SACK] = {.is_active = true, .value = "1"},
+        });
+    struct sockaddr_in6 client_addr = {
+        .sin6_family = AF_INET6,
+        .sin6_addr = in6addr_loopback,
+        .sin6_port = htons(2347),
+    };
+    int client_socket;
+    ASSERT_NE(client_socket = socket(AF_INET6, SOCK_DGRAM, 0), -1);
+    ASSERT_NE(setsockopt(client_socket, SOL_SOCKET, SO_REUSEADDR, &(int){true}, sizeof(int)), -1);
+    ASSERT_NE(setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout)), -1);
+    ASSERT_NE(bind(client_socket, (struct sockaddr *)&client_addr, sizeof(client_addr)), -1);
+    
+    struct sockaddr_storage session_addr = {};
+    socklen_t session_addr_len = sizeof session_addr;
+    uint8_t buffer[1024] = {};
+    struct tftp_data_packet *data_packet = (struct tftp_data_packet *) buffer;
+    struct tftp_ack_packet ack;
+    uint8_t sack_buffer[sizeof(struct tftp_sack_packet) + 1];
+    struct tftp_sack_packet *sack = (struct tftp_sack_packet *) sack_buffer;
+    
+    sendto(client_socket, &rrq, rrq_size, 0, (struct sockaddr *)&server_addr, sizeof(server_addr));
+    ASSERT_TRUE(recvfrom(client_socket, buffer, sizeof buffer, 0, (struct sockaddr *) &session_addr, &session_addr_len) > 0);
+    ASSERT_EQ(ntohs(data_packet->opcode), TFTP_OPCODE_OACK);
+    tftp_ack_packet_init(&ack, 0);
+    sendto(client_socket, &ack, sizeof ack, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    for (uint16_t block = 1; block <= 4; block++) {
+        ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+        ASSERT_EQ(ntohs(data_packet->block_number), block);
+    }
+    // block 2 is lost, the window moves to [2, 5] and the client reports block 3
+    tftp_ack_packet_init((struct tftp_ack_packet *) sack, 1);
+    sack->bitmap[0] = 0b001;
+    sendto(client_socket, sack_buffer, sizeof sack_buffer, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+    ASSERT_EQ(ntohs(data_packet->block_number), 5);
+    sack->bitmap[0] = 0b101;
+    for (int i = 0; i < 3; i++) {
+        sendto(client_socket, sack_buffer, sizeof sack_buffer, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    }
+    // only the blocks missing from the bitmap are retransmitted
+    ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+    ASSERT_EQ(ntohs(data_packet->opcode), TFTP_OPCODE_DATA);
+    ASSERT_EQ(ntohs(data_packet->block_number), 2);
+    ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+    ASSERT_EQ(ntohs(data_packet->block_number), 4);
+    tftp_ack_packet_init(&ack, 5);
+    sendto(client_socket, &ack, sizeof ack, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    ASSERT_TRUE(recv(client_socket, buffer, sizeof buffer, 0) > 0);
+    ASSERT_EQ(ntohs(data_packet->block_number), 6);
+    
+    const struct tftp_error_packet_info *error = &tftp_error_packet_info[TFTP_ERROR_ILLEGAL_OPERATION];
+    sendto(client_socket, error->packet, error->size, 0, (struct sockaddr *) &session_addr, session_addr_len);
+    tftp_server_stop(&server);
+    // sending invalid opcode to exit from the recvmsg server loop
+    sendto(client_socket, &(char[]){0xF}, 1, 0, (struct sockaddr *)&server_addr, sizeof(server_addr));
+    thrd_join(server_thrd, nullptr);
+    close(client_socket);
+    tftp_server_destroy(&server);
+}
+
 // testRRQ
 // Send an RRQ packet with a filename, mode, and some options to the server.
 // Asserts that the server correctly parses the RRQ and that the handler's attributes (addr, peer, path, and options) are set as expected.
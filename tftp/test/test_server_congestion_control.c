@@ -0,0 +1,92 @@
+#include <buracchi/cutest/cutest.h>
+
+#include "congestion_control.h"
+#include "mock_logger.h"
+
+TEST(congestion_control, disabled_keeps_the_negotiated_window) {
+    struct congestion_control cc;
+    congestion_control_init(&cc, TFTP_CONGESTION_CONTROL_NONE, 16);
+    ASSERT_EQ(congestion_control_window(&cc), 16);
+    congestion_control_on_loss(&cc);
+    congestion_control_on_timeout(&cc);
+    ASSERT_EQ(congestion_control_window(&cc), 16);
+}
+
+TEST(congestion_control, slow_start_doubles_the_window_up_to_the_negotiated_one) {
+    struct congestion_control cc;
+    congestion_control_init(&cc, TFTP_CONGESTION_CONTROL_RENO, 16);
+    ASSERT_EQ(congestion_control_window(&cc), 4);
+    congestion_control_on_ack(&cc, 4);
+    ASSERT_EQ(congestion_control_window(&cc), 8);
+    congestion_control_on_ack(&cc, 8);
+    ASSERT_EQ(congestion_control_window(&cc), 16);
+    congestion_control_on_ack(&cc, 16);
+    ASSERT_EQ(congestion_control_window(&cc), 16);
+}
+
+TEST(congestion_control, congestion_avoidance_grows_a_packet_per_window) {
+    struct congestion_control cc;
+    congestion_control_init(&cc, TFTP_CONGESTION_CONTROL_RENO, 32);
+    congestion_control_on_ack(&cc, 4);
+    congestion_control_on_ack(&cc, 8);
+    congestion_control_on_loss(&cc);
+    ASSERT_EQ(congestion_control_window(&cc), 8);
+    congestion_control_on_ack(&cc, 7);
+    ASSERT_EQ(congestion_control_window(&cc), 8);
+    congestion_control_on_ack(&cc, 1);
+    ASSERT_EQ(congestion_control_window(&cc), 9);
+}
+
+TEST(congestion_control, timeout_restarts_slow_start) {
+    struct congestion_control cc;
+    congestion_control_init(&cc, TFTP_CONGESTION_CONTROL_RENO, 32);
+    congestion_control_on_ack(&cc, 4);
+    congestion_control_on_ack(&cc, 8);
+    congestion_control_on_timeout(&cc);
+    ASSERT_EQ(congestion_control_window(&cc), 1);
+    congestion_control_on_ack(&cc, 1);
+    congestion_control_on_ack(&cc, 2);
+    congestion_control_on_ack(&cc, 4);
+    ASSERT_EQ(congestion_control_window(&cc), 8);
+    congestion_control_on_ack(&cc, 8);
+    ASSERT_EQ(congestion_control_window(&cc), 9);
+}
+
+TEST(congestion_control, vegas_follows_the_queueing_delay) {
+    struct congestion_control cc;
+    congestion_control_init(&cc, TFTP_CONGESTION_CONTROL_VEGAS, 32);
+    // the OACK sample starts the first round trip, it ends with the ACK of block 4
+    congestion_control_on_rtt_sample(&cc, 0.010, 0, 1);
+    congestion_control_on_ack(&cc, 4);
+    ASSERT_EQ(congestion_control_window(&cc), 8);
+    congestion_control_on_rtt_sample(&cc, 0.020, 4, 13);
+    // 8 * (1 - 10 / 20) = 4 packets queued end slow start
+    congestion_control_on_rtt_sample(&cc, 0.020, 12, 21);
+    congestion_control_on_ack(&cc, 8);
+    ASSERT_EQ(congestion_control_window(&cc), 8);
+    congestion_control_on_rtt_sample(&cc, 0.010, 16, 21);
+    congestion_control_on_rtt_sample(&cc, 0.010, 20, 29);
+    ASSERT_EQ(congestion_control_window(&cc), 9);
+    congestion_control_on_rtt_sample(&cc, 0.030, 28, 38);
+    ASSERT_EQ(congestion_control_window(&cc), 8);
+}
+
+TEST(congestion_control, vegas_moves_the_window_once_per_round_trip) {
+    struct congestion_control cc;
+    congestion_control_init(&cc, TFTP_CONGESTION_CONTROL_VEGAS, 32);
+    congestion_control_on_loss(&cc);
+    ASSERT_EQ(congestion_control_window(&cc), 2);
+    congestion_control_on_rtt_sample(&cc, 0.010, 0, 3);
+    congestion_control_on_rtt_sample(&cc, 0.010, 2, 5);
+    ASSERT_EQ(congestion_control_window(&cc), 3);
+    // every ACK of the round trip ending with block 4 gives a sample, the window grows once
+    congestion_control_on_rtt_sample(&cc, 0.010, 3, 6);
+    ASSERT_EQ(congestion_control_window(&cc), 3);
+    congestion_control_on_rtt_sample(&cc, 0.010, 4, 8);
+    ASSERT_EQ(congestion_control_window(&cc), 4);
+    // the smallest sample of the round trip is used, queueing delay on some ACKs does not shrink the window
+    congestion_control_on_rtt_sample(&cc, 0.040, 5, 9);
+    congestion_control_on_rtt_sample(&cc, 0.040, 6, 10);
+    congestion_control_on_rtt_sample(&cc, 0.010, 7, 11);
+    ASSERT_EQ(congestion_control_window(&cc), 5);
+}
@@ -0,0 +1,139 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "content_cache.h"
+#include "file_cache.h"
+#include "mock_logger.h"
+
+static bool create_file(char path[static 1], const char content[static 1]) {
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        return false;
+    }
+    size_t len = strlen(content);
+    bool ret = write(fd, content, len) == (ssize_t) len;
+    close(fd);
+    return ret;
+}
+
+TEST(content_cache, hit_serves_loaded_content) {
+    struct file_cache file_cache;
+    struct content_cache cache;
+    char path[] = "/tmp/tftp_content_cache_XXXXXX";
+    ASSERT_TRUE(create_file(path, "content"));
+    ASSERT_TRUE(file_cache_init(&file_cache, 4, &(struct logger) {}));
+    ASSERT_TRUE(content_cache_init(&cache, 1 << 20, 1 << 20, false, false, &(struct logger) {}));
+    struct file_cache_entry *file = file_cache_acquire(&file_cache, path);
+    ASSERT_NE(file, nullptr);
+    struct content_cache_entry *first = content_cache_acquire(&cache, file);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(memcmp(first->data, "content", strlen("content")), 0);
+    content_cache_release(&cache, first);
+    struct content_cache_entry *second = content_cache_acquire(&cache, file);
+    ASSERT_EQ(second, first);
+    content_cache_release(&cache, second);
+    uint64_t hits;
+    uint64_t misses;
+    content_cache_collect_counters(&cache, &hits, &misses);
+    ASSERT_EQ(hits, 1);
+    ASSERT_EQ(misses, 1);
+    file_cache_release(&file_cache, file);
+    content_cache_destroy(&cache);
+    file_cache_destroy(&file_cache);
+    unlink(path);
+}
+
+TEST(content_cache, files_over_limit_are_not_cached) {
+    struct file_cache file_cache;
+    struct content_cache cache;
+    char path[] = "/tmp/tftp_content_cache_XXXXXX";
+    ASSERT_TRUE(create_file(path, "content"));
+    ASSERT_TRUE(file_cache_init(&file_cache, 4, &(struct logger) {}));
+    ASSERT_TRUE(content_cache_init(&cache, 1 << 20, 4, false, false, &(struct logger) {}));
+    struct file_cache_entry *file = file_cache_acquire(&file_cache, path);
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(content_cache_acquire(&cache, file), nullptr);
+    file_cache_release(&file_cache, file);
+    content_cache_destroy(&cache);
+    file_cache_destroy(&file_cache);
+    unlink(path);
+}
+
+TEST(content_cache, files_over_budget_are_not_loaded) {
+    struct file_cache file_cache;
+    struct content_cache cache;
+    char first_path[] = "/tmp/tftp_content_cache_XXXXXX";
+    char second_path[] = "/tmp/tftp_content_cache_XXXXXX";
+    ASSERT_TRUE(create_file(first_path, "content"));
+    ASSERT_TRUE(create_file(second_path, "content"));
+    ASSERT_TRUE(file_cache_init(&file_cache, 4, &(struct logger) {}));
+    ASSERT_TRUE(content_cache_init(&cache, 10, 10, false, false, &(struct logger) {}));
+    struct file_cache_entry *first_file = file_cache_acquire(&file_cache, first_path);
+    struct file_cache_entry *second_file = file_cache_acquire(&file_cache, second_path);
+    ASSERT_NE(first_file, nullptr);
+    ASSERT_NE(second_file, nullptr);
+    struct content_cache_entry *first = content_cache_acquire(&cache, first_file);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(content_cache_acquire(&cache, second_file), nullptr);
+    ASSERT_EQ(cache.bytes, strlen("content"));
+    content_cache_release(&cache, first);
+    struct content_cache_entry *second = content_cache_acquire(&cache, second_file);
+    ASSERT_NE(second, nullptr);
+    ASSERT_EQ(cache.bytes, strlen("content"));
+    content_cache_release(&cache, second);
+    file_cache_release(&file_cache, first_file);
+    file_cache_release(&file_cache, second_file);
+    content_cache_destroy(&cache);
+    file_cache_destroy(&file_cache);
+    unlink(first_path);
+    unlink(second_path);
+}
+
+TEST(content_cache, compressed_variant_is_built_once) {
+    struct file_cache file_cache;
+    struct content_cache cache;
+    char path[] = "/tmp/tftp_content_cache_XXXXXX";
+    ASSERT_TRUE(create_file(path, "content content content content content content content content"));
+    ASSERT_TRUE(file_cache_init(&file_cache, 4, &(struct logger) {}));
+    ASSERT_TRUE(content_cache_init(&cache, 1 << 20, 1 << 20, false, false, &(struct logger) {}));
+    struct file_cache_entry *file = file_cache_acquire(&file_cache, path);
+    ASSERT_NE(file, nullptr);
+    struct content_cache_entry *entry = content_cache_acquire(&cache, file);
+    ASSERT_NE(entry, nullptr);
+    ASSERT_TRUE(content_cache_compress(&cache, entry));
+    const uint8_t *compressed_data = entry->compressed_data;
+    ASSERT_NE(compressed_data, nullptr);
+    ASSERT_TRUE(entry->compressed_size < (size_t) entry->stat.st_size);
+    ASSERT_EQ(cache.bytes, entry->stat.st_size + entry->compressed_size);
+    ASSERT_TRUE(content_cache_compress(&cache, entry));
+    ASSERT_EQ(entry->compressed_data, compressed_data);
+    content_cache_release(&cache, entry);
+    file_cache_release(&file_cache, file);
+    content_cache_destroy(&cache);
+    file_cache_destroy(&file_cache);
+    unlink(path);
+}
+
+TEST(content_cache, incompressible_content_has_no_compressed_variant) {
+    struct file_cache file_cache;
+    struct content_cache cache;
+    char path[] = "/tmp/tftp_content_cache_XXXXXX";
+    ASSERT_TRUE(create_file(path, "content"));
+    ASSERT_TRUE(file_cache_init(&file_cache, 4, &(struct logger) {}));
+    ASSERT_TRUE(content_cache_init(&cache, 1 << 20, 1 << 20, false, false, &(struct logger) {}));
+    struct file_cache_entry *file = file_cache_acquire(&file_cache, path);
+    ASSERT_NE(file, nullptr);
+    struct content_cache_entry *entry = content_cache_acquire(&cache, file);
+    ASSERT_NE(entry, nullptr);
+    ASSERT_FALSE(content_cache_compress(&cache, entry));
+    ASSERT_EQ(entry->compressed_data, nullptr);
+    ASSERT_FALSE(content_cache_compress(&cache, entry));
+    content_cache_release(&cache, entry);
+    file_cache_release(&file_cache, file);
+    content_cache_destroy(&cache);
+    file_cache_destroy(&file_cache);
+    unlink(path);
+}
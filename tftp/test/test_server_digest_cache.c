@@ -0,0 +1,127 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/digest.h"
+#include "digest_cache.h"
+#include "mock_logger.h"
+
+static struct stat file_version(ino_t inode, off_t size, time_t mtime) {
+    return (struct stat) {
+        .st_dev = 1,
+        .st_ino = inode,
+        .st_size = size,
+        .st_mtim = {.tv_sec = mtime, .tv_nsec = 500},
+    };
+}
+
+static bool create_file(char path[static 1], const char content[static 1], struct stat file_stat[static 1]) {
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        return false;
+    }
+    size_t len = strlen(content);
+    bool ret = write(fd, content, len) == (ssize_t) len && fstat(fd, file_stat) == 0;
+    close(fd);
+    return ret;
+}
+
+static bool wait_digest(struct digest_cache cache[static 1], const struct stat file_stat[static 1], uint64_t digest[static 1]) {
+    for (int i = 0; i < 1000; i++) {
+        if (digest_cache_lookup(cache, file_stat, digest)) {
+            return true;
+        }
+        nanosleep(&(struct timespec) {.tv_nsec = 1'000'000}, nullptr);
+    }
+    return false;
+}
+
+TEST(digest_cache, stored_digest_is_found_for_the_same_version_only) {
+    struct logger logger;
+    struct digest_cache cache;
+    ASSERT_TRUE(digest_cache_init(&cache, 16, &logger));
+    auto version = file_version(42, 1000, 1'700'000'000);
+    uint64_t digest;
+    ASSERT_FALSE(digest_cache_lookup(&cache, &version, &digest));
+    digest_cache_update(&cache, &version, 0xABCD);
+    ASSERT_TRUE(digest_cache_lookup(&cache, &version, &digest));
+    ASSERT_EQ(digest, 0xABCD);
+    auto rewritten = file_version(42, 1000, 1'700'000'001);
+    ASSERT_FALSE(digest_cache_lookup(&cache, &rewritten, &digest));
+    auto other_file = file_version(43, 1000, 1'700'000'000);
+    ASSERT_FALSE(digest_cache_lookup(&cache, &other_file, &digest));
+    digest_cache_destroy(&cache);
+}
+
+TEST(digest_cache, cache_stays_bounded) {
+    struct logger logger;
+    struct digest_cache cache;
+    ASSERT_TRUE(digest_cache_init(&cache, 8, &logger));
+    for (ino_t i = 1; i <= 1000; i++) {
+        auto version = file_version(i, 1000, 1'700'000'000);
+        digest_cache_update(&cache, &version, i);
+    }
+    size_t found = 0;
+    for (ino_t i = 1; i <= 1000; i++) {
+        auto version = file_version(i, 1000, 1'700'000'000);
+        uint64_t digest;
+        if (digest_cache_lookup(&cache, &version, &digest)) {
+            ASSERT_EQ(digest, i);
+            found++;
+        }
+    }
+    ASSERT_TRUE(found <= 8);
+    ASSERT_TRUE(found > 0);
+    digest_cache_destroy(&cache);
+}
+
+TEST(digest_cache, disabled_cache_stores_nothing) {
+    struct logger logger;
+    struct digest_cache cache;
+    ASSERT_TRUE(digest_cache_init(&cache, 0, &logger));
+    auto version = file_version(42, 1000, 1'700'000'000);
+    digest_cache_update(&cache, &version, 0xABCD);
+    uint64_t digest;
+    ASSERT_FALSE(digest_cache_lookup(&cache, &version, &digest));
+    digest_cache_destroy(&cache);
+}
+
+TEST(digest_cache, requested_version_is_hashed_in_the_background) {
+    struct logger logger;
+    struct digest_cache cache;
+    char path[] = "/tmp/tftp_digest_cache_XXXXXX";
+    struct stat file_stat;
+    ASSERT_TRUE(create_file(path, "content", &file_stat));
+    ASSERT_TRUE(digest_cache_init(&cache, 16, &logger));
+    digest_cache_request(&cache, nullptr, path, &file_stat);
+    uint64_t digest;
+    ASSERT_TRUE(wait_digest(&cache, &file_stat, &digest));
+    struct digest_state state;
+    digest_init(&state);
+    digest_update(&state, "content", strlen("content"));
+    ASSERT_EQ(digest, digest_final(&state));
+    digest_cache_destroy(&cache);
+    unlink(path);
+}
+
+TEST(digest_cache, versions_no_longer_on_disk_are_not_hashed) {
+    struct logger logger;
+    struct digest_cache cache;
+    char path[] = "/tmp/tftp_digest_cache_XXXXXX";
+    struct stat file_stat;
+    ASSERT_TRUE(create_file(path, "content", &file_stat));
+    ASSERT_TRUE(digest_cache_init(&cache, 16, &logger));
+    struct stat previous_stat = file_stat;
+    previous_stat.st_mtim.tv_sec--;
+    digest_cache_request(&cache, nullptr, path, &previous_stat);
+    // requests are served in order, the current version is stored after the previous one was dropped
+    digest_cache_request(&cache, nullptr, path, &file_stat);
+    uint64_t digest;
+    ASSERT_TRUE(wait_digest(&cache, &file_stat, &digest));
+    ASSERT_FALSE(digest_cache_lookup(&cache, &previous_stat, &digest));
+    digest_cache_destroy(&cache);
+    unlink(path);
+}
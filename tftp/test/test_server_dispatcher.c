@@ -1,5 +1,6 @@
 #include <buracchi/cutest/cutest.h>
 
+#include <stdlib.h>
 #include <time.h>
 
 #include "dispatcher.h"
@@ -111,3 +112,56 @@ TEST(dispatcher, reset_timeout) {
     ASSERT_TRUE(elapsed >= timeout_ns / 1e9);
     ASSERT_TRUE(dispatcher_destroy(&dispatcher));
 }
+
+TEST(dispatcher, completions_exceeding_queue_size_are_delivered) {
+    constexpr size_t requests = 1000;
+    struct dispatcher dispatcher;
+    struct dispatcher_event *event;
+    struct dispatcher_event *events = calloc(requests, sizeof *events);
+    ASSERT_NE(events, nullptr);
+    ASSERT_TRUE(dispatcher_init(&dispatcher, 16, &(struct logger) {}));
+    for (size_t i = 0; i < requests; i++) {
+        events[i].id = i;
+        ASSERT_TRUE(dispatcher_submit(&dispatcher, &events[i]));
+    }
+    ASSERT_EQ(dispatcher.pending_requests, requests);
+    size_t delivered = 0;
+    while (dispatcher.pending_requests != 0) {
+        ASSERT_TRUE(dispatcher_wait_event(&dispatcher, &event));
+        ASSERT_TRUE(event->is_success);
+        event->id = requests;
+        delivered++;
+    }
+    ASSERT_EQ(delivered, requests);
+    for (size_t i = 0; i < requests; i++) {
+        ASSERT_EQ(events[i].id, requests);
+    }
+    ASSERT_TRUE(dispatcher_destroy(&dispatcher));
+    free(events);
+}
+
+TEST(dispatcher, round_trips_complete_with_many_pending_sessions) {
+    constexpr size_t sessions = 10'000;
+    constexpr size_t samples = 1000;
+    struct dispatcher dispatcher;
+    struct dispatcher_event_timeout *timeouts = calloc(sessions, sizeof *timeouts);
+    ASSERT_NE(timeouts, nullptr);
+    ASSERT_TRUE(dispatcher_init(&dispatcher, sessions * 3, &(struct logger) {}));
+    // every session waits for its peer with a pending timeout
+    for (size_t i = 0; i < sessions; i++) {
+        timeouts[i].timeout.tv_sec = 60;
+        ASSERT_TRUE(dispatcher_submit_timeout(&dispatcher, &timeouts[i]));
+    }
+    ASSERT_EQ(dispatcher.pending_requests, sessions);
+    struct dispatcher_event event;
+    struct dispatcher_event *completed;
+    for (size_t i = 0; i < samples; i++) {
+        ASSERT_TRUE(dispatcher_submit(&dispatcher, &event));
+        ASSERT_TRUE(dispatcher_wait_event(&dispatcher, &completed));
+        ASSERT_EQ(completed, &event);
+        ASSERT_TRUE(completed->is_success);
+        ASSERT_EQ(dispatcher.pending_requests, sessions);
+    }
+    ASSERT_TRUE(dispatcher_destroy(&dispatcher));
+    free(timeouts);
+}
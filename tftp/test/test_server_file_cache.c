@@ -0,0 +1,107 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "file_cache.h"
+#include "mock_logger.h"
+
+static bool create_file(char path[static 1], const char content[static 1]) {
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        return false;
+    }
+    size_t len = strlen(content);
+    bool ret = write(fd, content, len) == (ssize_t) len;
+    close(fd);
+    return ret;
+}
+
+TEST(file_cache, same_path_shares_file_descriptor) {
+    struct file_cache cache;
+    char path[] = "/tmp/tftp_file_cache_XXXXXX";
+    ASSERT_TRUE(create_file(path, "content"));
+    ASSERT_TRUE(file_cache_init(&cache, 4, &(struct logger) {}));
+    struct file_cache_entry *first = file_cache_acquire(&cache, path);
+    struct file_cache_entry *second = file_cache_acquire(&cache, path);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(cache.index.count, 1);
+    file_cache_release(&cache, first);
+    file_cache_release(&cache, second);
+    ASSERT_EQ(file_cache_acquire(&cache, path), first);
+    file_cache_release(&cache, first);
+    file_cache_destroy(&cache);
+    unlink(path);
+}
+
+TEST(file_cache, modified_file_is_reopened) {
+    struct file_cache cache;
+    char path[] = "/tmp/tftp_file_cache_XXXXXX";
+    ASSERT_TRUE(create_file(path, "content"));
+    ASSERT_TRUE(file_cache_init(&cache, 4, &(struct logger) {}));
+    struct file_cache_entry *stale = file_cache_acquire(&cache, path);
+    ASSERT_NE(stale, nullptr);
+    char new_path[] = "/tmp/tftp_file_cache_XXXXXX";
+    ASSERT_TRUE(create_file(new_path, "new content"));
+    ASSERT_EQ(rename(new_path, path), 0);
+    struct file_cache_entry *fresh = file_cache_acquire(&cache, path);
+    ASSERT_NE(fresh, nullptr);
+    ASSERT_NE(fresh, stale);
+    ASSERT_EQ(fresh->stat.st_size, (off_t) strlen("new content"));
+    ASSERT_EQ(cache.index.count, 1);
+    file_cache_release(&cache, stale);
+    file_cache_release(&cache, fresh);
+    file_cache_destroy(&cache);
+    unlink(path);
+}
+
+TEST(file_cache, idle_entries_are_evicted_over_budget) {
+    struct file_cache cache;
+    char paths[3][sizeof "/tmp/tftp_file_cache_XXXXXX"] = {
+        "/tmp/tftp_file_cache_XXXXXX",
+        "/tmp/tftp_file_cache_XXXXXX",
+        "/tmp/tftp_file_cache_XXXXXX",
+    };
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(create_file(paths[i], "content"));
+    }
+    ASSERT_TRUE(file_cache_init(&cache, 2, &(struct logger) {}));
+    struct file_cache_entry *in_use = file_cache_acquire(&cache, paths[0]);
+    file_cache_release(&cache, file_cache_acquire(&cache, paths[1]));
+    file_cache_release(&cache, file_cache_acquire(&cache, paths[2]));
+    ASSERT_EQ(cache.index.count, 2);
+    ASSERT_EQ(cache.index.lru_head, cache.index.lru_tail);
+    ASSERT_STREQ(lru_index_entry(cache.index.lru_head, struct file_cache_entry, node)->path, paths[2]);
+    ASSERT_EQ(file_cache_acquire(&cache, paths[0]), in_use);
+    file_cache_release(&cache, in_use);
+    file_cache_release(&cache, in_use);
+    file_cache_destroy(&cache);
+    for (size_t i = 0; i < 3; i++) {
+        unlink(paths[i]);
+    }
+}
+
+TEST(file_cache, holes_of_sparse_files_are_mapped) {
+    struct file_cache cache;
+    char path[] = "/tmp/tftp_file_cache_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    constexpr off_t size = 1 << 20;
+    constexpr off_t data_offset = size / 2;
+    ASSERT_EQ(ftruncate(fd, size), 0);
+    ASSERT_EQ(pwrite(fd, "content", strlen("content"), data_offset), (ssize_t) strlen("content"));
+    close(fd);
+    ASSERT_TRUE(file_cache_init(&cache, 4, &(struct logger) {}));
+    struct file_cache_entry *entry = file_cache_acquire(&cache, path);
+    ASSERT_NE(entry, nullptr);
+    ASSERT_NE(entry->data_extents, nullptr);
+    ASSERT_EQ(entry->data_extents_count, 1);
+    ASSERT_TRUE(entry->data_extents[0].begin <= data_offset);
+    ASSERT_TRUE(entry->data_extents[0].end > data_offset);
+    ASSERT_TRUE(entry->data_extents[0].end < size);
+    file_cache_release(&cache, entry);
+    file_cache_destroy(&cache);
+    unlink(path);
+}
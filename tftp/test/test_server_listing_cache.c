@@ -0,0 +1,110 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fs_watcher.h"
+#include "listing_cache.h"
+#include "mock_logger.h"
+
+static bool create_file(const char root[static 1], const char name[static 1], const char content[static 1]) {
+    char path[256];
+    snprintf(path, sizeof path, "%s/%s", root, name);
+    int fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+    if (fd == -1) {
+        return false;
+    }
+    size_t len = strlen(content);
+    bool ret = write(fd, content, len) == (ssize_t) len;
+    close(fd);
+    return ret;
+}
+
+static bool read_listing(struct listing_cache_entry entry[static 1], size_t n, char buffer[static n]) {
+    ssize_t bytes_read = pread(entry->file_descriptor, buffer, n - 1, 0);
+    if (bytes_read != entry->size) {
+        return false;
+    }
+    buffer[bytes_read] = '\0';
+    return true;
+}
+
+static void remove_file(const char root[static 1], const char name[static 1]) {
+    char path[256];
+    snprintf(path, sizeof path, "%s/%s", root, name);
+    unlink(path);
+}
+
+TEST(listing_cache, listing_is_sealed_and_shared) {
+    struct fs_watcher watcher;
+    struct listing_cache cache;
+    char root[] = "/tmp/tftp_listing_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    ASSERT_TRUE(create_file(root, "file", "content"));
+    ASSERT_TRUE(fs_watcher_init(&watcher, &(struct logger) {}));
+    ASSERT_TRUE(listing_cache_init(&cache, 4, &watcher, &(struct logger) {}));
+    struct listing_cache_entry *first = listing_cache_acquire(&cache, root, LISTING_FORMAT_NAMES);
+    struct listing_cache_entry *second = listing_cache_acquire(&cache, root, LISTING_FORMAT_NAMES);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(first, second);
+    char listing[256];
+    ASSERT_TRUE(read_listing(first, sizeof listing, listing));
+    ASSERT_NE(strstr(listing, "file\n"), nullptr);
+    ASSERT_EQ(pwrite(first->file_descriptor, "x", 1, 0), -1);
+    listing_cache_release(&cache, first);
+    listing_cache_release(&cache, second);
+    fs_watcher_destroy(&watcher);
+    listing_cache_destroy(&cache);
+    remove_file(root, "file");
+    rmdir(root);
+}
+
+TEST(listing_cache, detailed_format_reports_size) {
+    struct fs_watcher watcher;
+    struct listing_cache cache;
+    char root[] = "/tmp/tftp_listing_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    ASSERT_TRUE(create_file(root, "file", "content"));
+    ASSERT_TRUE(fs_watcher_init(&watcher, &(struct logger) {}));
+    ASSERT_TRUE(listing_cache_init(&cache, 4, &watcher, &(struct logger) {}));
+    struct listing_cache_entry *entry = listing_cache_acquire(&cache, root, LISTING_FORMAT_DETAILED);
+    ASSERT_NE(entry, nullptr);
+    char listing[256];
+    ASSERT_TRUE(read_listing(entry, sizeof listing, listing));
+    ASSERT_NE(strstr(listing, "7\t"), nullptr);
+    ASSERT_NE(strstr(listing, "\tfile\n"), nullptr);
+    listing_cache_release(&cache, entry);
+    fs_watcher_destroy(&watcher);
+    listing_cache_destroy(&cache);
+    remove_file(root, "file");
+    rmdir(root);
+}
+
+TEST(listing_cache, changes_invalidate_listing) {
+    struct fs_watcher watcher;
+    struct listing_cache cache;
+    char root[] = "/tmp/tftp_listing_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    ASSERT_TRUE(fs_watcher_init(&watcher, &(struct logger) {}));
+    ASSERT_TRUE(listing_cache_init(&cache, 4, &watcher, &(struct logger) {}));
+    ASSERT_TRUE(fs_watcher_start(&watcher));
+    listing_cache_release(&cache, listing_cache_acquire(&cache, root, LISTING_FORMAT_NAMES));
+    ASSERT_EQ(cache.index.count, 1);
+    ASSERT_TRUE(create_file(root, "file", "content"));
+    for (int i = 0; i < 1000 && cache.index.count != 0; i++) {
+        nanosleep(&(struct timespec) {.tv_nsec = 1'000'000}, nullptr);
+    }
+    struct listing_cache_entry *entry = listing_cache_acquire(&cache, root, LISTING_FORMAT_NAMES);
+    ASSERT_NE(entry, nullptr);
+    char listing[256];
+    ASSERT_TRUE(read_listing(entry, sizeof listing, listing));
+    ASSERT_NE(strstr(listing, "file\n"), nullptr);
+    listing_cache_release(&cache, entry);
+    fs_watcher_destroy(&watcher);
+    listing_cache_destroy(&cache);
+    remove_file(root, "file");
+    rmdir(root);
+}
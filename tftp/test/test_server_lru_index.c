@@ -0,0 +1,69 @@
+#include <buracchi/cutest/cutest.h>
+
+#include "lru_index.h"
+#include "mock_logger.h"
+
+struct entry {
+    int key;
+    bool is_freed;
+    struct lru_index_node node;
+};
+
+static bool key_matches(const struct lru_index_node node[static 1], const void *key) {
+    return lru_index_entry(node, struct entry, node)->key == *(const int *) key;
+}
+
+static void node_free(struct lru_index_node node[static 1]) {
+    lru_index_entry(node, struct entry, node)->is_freed = true;
+}
+
+static struct lru_index_node *find(struct lru_index index[static 1], int key) {
+    // a constant hash puts every entry in the same bucket
+    return *lru_index_find(index, 7, key_matches, &key);
+}
+
+TEST(lru_index, idle_entries_are_evicted_least_recently_released_first) {
+    struct lru_index index;
+    ASSERT_TRUE(lru_index_init(&index, 4));
+    struct entry entries[3] = {
+        {.key = 0, .node.references = 1},
+        {.key = 1, .node.references = 1},
+        {.key = 2, .node.references = 1},
+    };
+    for (size_t i = 0; i < 3; i++) {
+        lru_index_insert(&index, &entries[i].node, 7);
+    }
+    ASSERT_EQ(index.count, 3);
+    ASSERT_EQ(find(&index, 1), &entries[1].node);
+    ASSERT_FALSE(lru_index_release(&index, &entries[1].node));
+    ASSERT_FALSE(lru_index_release(&index, &entries[0].node));
+    ASSERT_EQ(lru_index_evict(&index), &entries[1].node);
+    ASSERT_EQ(find(&index, 1), nullptr);
+    lru_index_acquire(&index, &entries[0].node);
+    ASSERT_EQ(lru_index_evict(&index), nullptr);
+    ASSERT_EQ(index.count, 2);
+    ASSERT_FALSE(lru_index_release(&index, &entries[0].node));
+    ASSERT_FALSE(lru_index_release(&index, &entries[2].node));
+    ASSERT_EQ(lru_index_evict(&index), &entries[0].node);
+    ASSERT_EQ(lru_index_evict(&index), &entries[2].node);
+    ASSERT_EQ(index.count, 0);
+    lru_index_destroy(&index);
+}
+
+TEST(lru_index, removed_entries_are_freed_on_last_release) {
+    struct lru_index index;
+    ASSERT_TRUE(lru_index_init(&index, 4));
+    struct entry in_use = {.key = 0, .node.references = 1};
+    struct entry idle = {.key = 1, .node.references = 1};
+    lru_index_insert(&index, &in_use.node, 7);
+    lru_index_insert(&index, &idle.node, 7);
+    ASSERT_FALSE(lru_index_release(&index, &idle.node));
+    lru_index_clear(&index, node_free);
+    ASSERT_EQ(index.count, 0);
+    ASSERT_TRUE(idle.is_freed);
+    ASSERT_FALSE(in_use.is_freed);
+    ASSERT_EQ(find(&index, 0), nullptr);
+    ASSERT_EQ(index.lru_head, nullptr);
+    ASSERT_TRUE(lru_index_release(&index, &in_use.node));
+    lru_index_destroy(&index);
+}
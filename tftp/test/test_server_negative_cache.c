@@ -0,0 +1,78 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fs_watcher.h"
+#include "mock_logger.h"
+#include "negative_cache.h"
+
+TEST(negative_cache, missing_file_is_remembered) {
+    struct negative_cache cache;
+    char root[] = "/tmp/tftp_negative_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    ASSERT_TRUE(negative_cache_init(&cache, 4, 60'000, nullptr, &(struct logger) {}));
+    ASSERT_FALSE(negative_cache_contains(&cache, "missing"));
+    negative_cache_insert(&cache, root, "missing");
+    ASSERT_TRUE(negative_cache_contains(&cache, "missing"));
+    ASSERT_FALSE(negative_cache_contains(&cache, "other"));
+    ASSERT_EQ(negative_cache_collect_hits(&cache), 1);
+    negative_cache_destroy(&cache);
+    rmdir(root);
+}
+
+TEST(negative_cache, entries_expire) {
+    struct negative_cache cache;
+    char root[] = "/tmp/tftp_negative_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    ASSERT_TRUE(negative_cache_init(&cache, 4, 1, nullptr, &(struct logger) {}));
+    negative_cache_insert(&cache, root, "missing");
+    nanosleep(&(struct timespec) {.tv_nsec = 2'000'000}, nullptr);
+    ASSERT_FALSE(negative_cache_contains(&cache, "missing"));
+    ASSERT_EQ(cache.entries_count, 0);
+    negative_cache_destroy(&cache);
+    rmdir(root);
+}
+
+TEST(negative_cache, oldest_entry_is_evicted_when_full) {
+    struct negative_cache cache;
+    char root[] = "/tmp/tftp_negative_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    ASSERT_TRUE(negative_cache_init(&cache, 2, 60'000, nullptr, &(struct logger) {}));
+    negative_cache_insert(&cache, root, "first");
+    negative_cache_insert(&cache, root, "second");
+    negative_cache_insert(&cache, root, "third");
+    ASSERT_EQ(cache.entries_count, 2);
+    ASSERT_FALSE(negative_cache_contains(&cache, "first"));
+    ASSERT_TRUE(negative_cache_contains(&cache, "third"));
+    negative_cache_destroy(&cache);
+    rmdir(root);
+}
+
+TEST(negative_cache, file_creation_invalidates_cache) {
+    struct fs_watcher watcher;
+    struct negative_cache cache;
+    char root[] = "/tmp/tftp_negative_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    ASSERT_TRUE(fs_watcher_init(&watcher, &(struct logger) {}));
+    ASSERT_TRUE(negative_cache_init(&cache, 4, 60'000, &watcher, &(struct logger) {}));
+    ASSERT_TRUE(fs_watcher_start(&watcher));
+    negative_cache_insert(&cache, root, "directory/missing");
+    ASSERT_TRUE(negative_cache_contains(&cache, "directory/missing"));
+    char path[sizeof root + sizeof "/directory"];
+    sprintf(path, "%s/directory", root);
+    ASSERT_EQ(mkdir(path, 0700), 0);
+    bool is_invalidated = false;
+    for (int i = 0; i < 1000 && !is_invalidated; i++) {
+        nanosleep(&(struct timespec) {.tv_nsec = 1'000'000}, nullptr);
+        is_invalidated = !negative_cache_contains(&cache, "directory/missing");
+    }
+    ASSERT_TRUE(is_invalidated);
+    fs_watcher_destroy(&watcher);
+    negative_cache_destroy(&cache);
+    rmdir(path);
+    rmdir(root);
+}
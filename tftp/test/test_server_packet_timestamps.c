@@ -0,0 +1,88 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "packet_timestamps.h"
+#include "mock_logger.h"
+
+static void open_loopback_pair(int sender[static 1], int receiver[static 1]) {
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof address;
+    *receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    bind(*receiver, (struct sockaddr *) &address, addrlen);
+    getsockname(*receiver, (struct sockaddr *) &address, &addrlen);
+    *sender = socket(AF_INET, SOCK_DGRAM, 0);
+    connect(*sender, (struct sockaddr *) &address, addrlen);
+}
+
+static double timespec_to_double(struct timespec time) {
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+TEST(packet_timestamps, sent_datagrams_are_timestamped_in_order) {
+    int sender;
+    int receiver;
+    open_loopback_pair(&sender, &receiver);
+    ASSERT_TRUE(packet_timestamps_enable(sender));
+    ASSERT_EQ(send(sender, "a", 1, 0), 1);
+    ASSERT_EQ(send(sender, "b", 1, 0), 1);
+    struct packet_timestamp timestamps[4];
+    ASSERT_EQ(packet_timestamps_read_sent(sender, timestamps, 4), 2);
+    ASSERT_EQ(timestamps[0].id, 0);
+    ASSERT_EQ(timestamps[1].id, 1);
+    ASSERT_TRUE(timespec_to_double(timestamps[0].time) <= timespec_to_double(timestamps[1].time));
+    ASSERT_EQ(packet_timestamps_read_sent(sender, timestamps, 4), 0);
+    close(sender);
+    close(receiver);
+}
+
+TEST(packet_timestamps, received_datagram_is_timestamped_after_it_is_sent) {
+    int sender;
+    int receiver;
+    open_loopback_pair(&sender, &receiver);
+    ASSERT_TRUE(packet_timestamps_enable(sender));
+    ASSERT_TRUE(packet_timestamps_enable(receiver));
+    ASSERT_EQ(send(sender, "a", 1, 0), 1);
+    struct packet_timestamp sent;
+    ASSERT_EQ(packet_timestamps_read_sent(sender, &sent, 1), 1);
+    uint8_t buffer[1];
+    struct iovec iovec = {.iov_base = buffer, .iov_len = sizeof buffer};
+    alignas(struct cmsghdr) uint8_t control[packet_timestamps_control_size];
+    struct msghdr msghdr = {
+        .msg_iov = &iovec,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof control,
+    };
+    ASSERT_EQ(recvmsg(receiver, &msghdr, 0), 1);
+    struct timespec received;
+    ASSERT_TRUE(packet_timestamps_get_received(&msghdr, &received));
+    ASSERT_TRUE(timespec_to_double(sent.time) <= timespec_to_double(received));
+    close(sender);
+    close(receiver);
+}
+
+TEST(packet_timestamps, disabling_drops_queued_timestamps_and_resets_the_index) {
+    int sender;
+    int receiver;
+    open_loopback_pair(&sender, &receiver);
+    ASSERT_TRUE(packet_timestamps_enable(sender));
+    ASSERT_EQ(send(sender, "a", 1, 0), 1);
+    ASSERT_TRUE(packet_timestamps_disable(sender));
+    struct packet_timestamp timestamp;
+    ASSERT_EQ(packet_timestamps_read_sent(sender, &timestamp, 1), 0);
+    ASSERT_EQ(send(sender, "b", 1, 0), 1);
+    ASSERT_EQ(packet_timestamps_read_sent(sender, &timestamp, 1), 0);
+    ASSERT_TRUE(packet_timestamps_enable(sender));
+    ASSERT_EQ(send(sender, "c", 1, 0), 1);
+    ASSERT_EQ(packet_timestamps_read_sent(sender, &timestamp, 1), 1);
+    ASSERT_EQ(timestamp.id, 0);
+    close(sender);
+    close(receiver);
+}
@@ -0,0 +1,127 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <threads.h>
+
+#include "rtt_cache.h"
+#include "mock_logger.h"
+
+static struct sockaddr_in ipv4_address(uint32_t address) {
+    return (struct sockaddr_in) {
+        .sin_family = AF_INET,
+        .sin_port = htons(12345),
+        .sin_addr.s_addr = htonl(address),
+    };
+}
+
+TEST(rtt_cache, stored_estimate_is_found_for_the_same_address_on_any_port) {
+    struct logger logger;
+    struct rtt_cache cache;
+    ASSERT_TRUE(rtt_cache_init(&cache, 16, &logger));
+    auto peer = ipv4_address(0x0A000001);
+    double smoothed_rtt;
+    double rtt_variation;
+    ASSERT_FALSE(rtt_cache_lookup(&cache, (struct sockaddr *) &peer, &smoothed_rtt, &rtt_variation));
+    rtt_cache_update(&cache, (struct sockaddr *) &peer, 0.002, 0.0005);
+    peer.sin_port = htons(54321);
+    ASSERT_TRUE(rtt_cache_lookup(&cache, (struct sockaddr *) &peer, &smoothed_rtt, &rtt_variation));
+    ASSERT_EQ(smoothed_rtt, 0.002);
+    ASSERT_EQ(rtt_variation, 0.0005);
+    auto other = ipv4_address(0x0A000002);
+    ASSERT_FALSE(rtt_cache_lookup(&cache, (struct sockaddr *) &other, &smoothed_rtt, &rtt_variation));
+    rtt_cache_destroy(&cache);
+}
+
+TEST(rtt_cache, ipv4_peers_match_their_mapped_ipv6_address) {
+    struct logger logger;
+    struct rtt_cache cache;
+    ASSERT_TRUE(rtt_cache_init(&cache, 16, &logger));
+    auto peer = ipv4_address(0xC0A80001);
+    struct sockaddr_in6 mapped = {.sin6_family = AF_INET6};
+    inet_pton(AF_INET6, "::ffff:192.168.0.1", &mapped.sin6_addr);
+    rtt_cache_update(&cache, (struct sockaddr *) &mapped, 0.001, 0.0005);
+    double smoothed_rtt;
+    double rtt_variation;
+    ASSERT_TRUE(rtt_cache_lookup(&cache, (struct sockaddr *) &peer, &smoothed_rtt, &rtt_variation));
+    ASSERT_EQ(smoothed_rtt, 0.001);
+    rtt_cache_destroy(&cache);
+}
+
+TEST(rtt_cache, updates_replace_the_previous_estimate_and_the_cache_stays_bounded) {
+    struct logger logger;
+    struct rtt_cache cache;
+    ASSERT_TRUE(rtt_cache_init(&cache, 8, &logger));
+    auto peer = ipv4_address(0x0A000001);
+    rtt_cache_update(&cache, (struct sockaddr *) &peer, 0.002, 0.001);
+    rtt_cache_update(&cache, (struct sockaddr *) &peer, 0.004, 0.002);
+    double smoothed_rtt;
+    double rtt_variation;
+    ASSERT_TRUE(rtt_cache_lookup(&cache, (struct sockaddr *) &peer, &smoothed_rtt, &rtt_variation));
+    ASSERT_EQ(smoothed_rtt, 0.004);
+    for (uint32_t i = 0; i < 1000; i++) {
+        auto other = ipv4_address(0x0B000000 + i);
+        rtt_cache_update(&cache, (struct sockaddr *) &other, 0.001, 0.001);
+    }
+    size_t found = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        auto other = ipv4_address(0x0B000000 + i);
+        found += rtt_cache_lookup(&cache, (struct sockaddr *) &other, &smoothed_rtt, &rtt_variation);
+    }
+    ASSERT_TRUE(found <= 8);
+    ASSERT_TRUE(found > 0);
+    rtt_cache_destroy(&cache);
+}
+
+TEST(rtt_cache, disabled_cache_stores_nothing) {
+    struct logger logger;
+    struct rtt_cache cache;
+    ASSERT_TRUE(rtt_cache_init(&cache, 0, &logger));
+    auto peer = ipv4_address(0x0A000001);
+    rtt_cache_update(&cache, (struct sockaddr *) &peer, 0.002, 0.001);
+    double smoothed_rtt;
+    double rtt_variation;
+    ASSERT_FALSE(rtt_cache_lookup(&cache, (struct sockaddr *) &peer, &smoothed_rtt, &rtt_variation));
+    rtt_cache_destroy(&cache);
+}
+
+static struct rtt_cache shared_cache;
+static atomic_bool is_torn;
+
+// Every writer stores a variation of half the smoothed RTT, a reader seeing anything else read a torn entry.
+static int write_estimates(void *arg) {
+    auto peer = ipv4_address(0x0A000001);
+    for (uint32_t i = 1; i <= 100'000; i++) {
+        const double smoothed_rtt = (2 * i + (uintptr_t) arg) / 1e6;
+        rtt_cache_update(&shared_cache, (struct sockaddr *) &peer, smoothed_rtt, smoothed_rtt / 2);
+    }
+    return 0;
+}
+
+static int read_estimates(void *) {
+    auto peer = ipv4_address(0x0A000001);
+    for (int i = 0; i < 100'000; i++) {
+        double smoothed_rtt;
+        double rtt_variation;
+        if (rtt_cache_lookup(&shared_cache, (struct sockaddr *) &peer, &smoothed_rtt, &rtt_variation)
+            && (uint32_t) (smoothed_rtt * 1e6 + 0.5) / 2 != (uint32_t) (rtt_variation * 1e6 + 0.5)) {
+            atomic_store(&is_torn, true);
+        }
+    }
+    return 0;
+}
+
+TEST(rtt_cache, concurrent_readers_never_see_torn_entries) {
+    struct logger logger;
+    ASSERT_TRUE(rtt_cache_init(&shared_cache, 4, &logger));
+    thrd_t threads[4];
+    thrd_create(&threads[0], write_estimates, (void *) 0);
+    thrd_create(&threads[1], write_estimates, (void *) 2);
+    thrd_create(&threads[2], read_estimates, nullptr);
+    thrd_create(&threads[3], read_estimates, nullptr);
+    for (size_t i = 0; i < 4; i++) {
+        thrd_join(threads[i], nullptr);
+    }
+    ASSERT_FALSE(atomic_load(&is_torn));
+    rtt_cache_destroy(&shared_cache);
+}
@@ -0,0 +1,96 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "session_demux.h"
+#include "mock_logger.h"
+
+static constexpr uint16_t first_port = 47100;
+
+static struct sockaddr_in6 ipv6_peer(uint16_t port) {
+    return (struct sockaddr_in6) {.sin6_family = AF_INET6, .sin6_addr = in6addr_loopback, .sin6_port = htons(port)};
+}
+
+static bool demux_init(struct session_demux demux[static 1], size_t sockets_count, size_t max_sessions) {
+    const struct sockaddr_in6 address = {.sin6_family = AF_INET6, .sin6_addr = in6addr_loopback};
+    return session_demux_init(demux, (const struct sockaddr *) &address, sizeof address, first_port, sockets_count, max_sessions, &(struct logger) {});
+}
+
+TEST(session_demux, sockets_are_bound_to_the_port_range) {
+    struct session_demux demux;
+    ASSERT_TRUE(demux_init(&demux, 2, 4));
+    for (size_t i = 0; i < 2; i++) {
+        struct sockaddr_in6 address;
+        socklen_t addrlen = sizeof address;
+        ASSERT_EQ(getsockname(demux.sockets[i].file_descriptor, (struct sockaddr *) &address, &addrlen), 0);
+        ASSERT_EQ(ntohs(address.sin6_port), first_port + i);
+        ASSERT_EQ(demux.sockets[i].port, first_port + i);
+    }
+    session_demux_destroy(&demux);
+}
+
+TEST(session_demux, concurrent_sessions_of_a_peer_use_distinct_sockets) {
+    struct session_demux demux;
+    ASSERT_TRUE(demux_init(&demux, 2, 4));
+    const struct sockaddr_in6 peer = ipv6_peer(5000);
+    size_t first_socket;
+    size_t second_socket;
+    ASSERT_TRUE(session_demux_register(&demux, (const struct sockaddr *) &peer, 0, &first_socket));
+    ASSERT_TRUE(session_demux_register(&demux, (const struct sockaddr *) &peer, 1, &second_socket));
+    ASSERT_NE(first_socket, second_socket);
+    size_t third_socket;
+    ASSERT_FALSE(session_demux_register(&demux, (const struct sockaddr *) &peer, 2, &third_socket));
+    uint16_t session_id;
+    ASSERT_TRUE(session_demux_lookup(&demux, (const struct sockaddr *) &peer, first_socket, &session_id));
+    ASSERT_EQ(session_id, 0);
+    ASSERT_TRUE(session_demux_lookup(&demux, (const struct sockaddr *) &peer, second_socket, &session_id));
+    ASSERT_EQ(session_id, 1);
+    const struct sockaddr_in6 stranger = ipv6_peer(5001);
+    ASSERT_FALSE(session_demux_lookup(&demux, (const struct sockaddr *) &stranger, first_socket, &session_id));
+    session_demux_destroy(&demux);
+}
+
+TEST(session_demux, ipv4_peers_match_their_mapped_address) {
+    struct session_demux demux;
+    ASSERT_TRUE(demux_init(&demux, 1, 4));
+    const struct sockaddr_in ipv4 = {.sin_family = AF_INET, .sin_addr = {htonl(INADDR_LOOPBACK)}, .sin_port = htons(5000)};
+    struct sockaddr_in6 mapped = {.sin6_family = AF_INET6, .sin6_port = htons(5000)};
+    ASSERT_EQ(inet_pton(AF_INET6, "::ffff:127.0.0.1", &mapped.sin6_addr), 1);
+    size_t socket_index;
+    ASSERT_TRUE(session_demux_register(&demux, (const struct sockaddr *) &ipv4, 3, &socket_index));
+    uint16_t session_id;
+    ASSERT_TRUE(session_demux_lookup(&demux, (const struct sockaddr *) &mapped, socket_index, &session_id));
+    ASSERT_EQ(session_id, 3);
+    session_demux_unregister(&demux, (const struct sockaddr *) &mapped, socket_index);
+    ASSERT_FALSE(session_demux_lookup(&demux, (const struct sockaddr *) &ipv4, socket_index, &session_id));
+    session_demux_destroy(&demux);
+}
+
+TEST(session_demux, unregistering_keeps_the_other_sessions_reachable) {
+    constexpr uint16_t sessions = 200;
+    struct session_demux demux;
+    ASSERT_TRUE(demux_init(&demux, 1, sessions));
+    for (uint16_t i = 0; i < sessions; i++) {
+        const struct sockaddr_in6 peer = ipv6_peer(1000 + i);
+        size_t socket_index;
+        ASSERT_TRUE(session_demux_register(&demux, (const struct sockaddr *) &peer, i, &socket_index));
+    }
+    for (uint16_t i = 0; i < sessions; i += 2) {
+        const struct sockaddr_in6 peer = ipv6_peer(1000 + i);
+        session_demux_unregister(&demux, (const struct sockaddr *) &peer, 0);
+    }
+    ASSERT_EQ(demux.count, sessions / 2);
+    for (uint16_t i = 0; i < sessions; i++) {
+        const struct sockaddr_in6 peer = ipv6_peer(1000 + i);
+        uint16_t session_id;
+        const bool is_found = session_demux_lookup(&demux, (const struct sockaddr *) &peer, 0, &session_id);
+        ASSERT_EQ(is_found, i % 2 == 1);
+        if (is_found) {
+            ASSERT_EQ(session_id, i);
+        }
+    }
+    session_demux_destroy(&demux);
+}
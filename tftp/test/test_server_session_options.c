@@ -0,0 +1,76 @@
+#include <buracchi/cutest/cutest.h>
+
+#include "session_options.h"
+#include "mock_logger.h"
+
+constexpr off_t file_size = 1000;
+
+struct range {
+    off_t offset;
+    off_t end;
+};
+
+// Parses a read request of an octet file of file_size bytes, the request is given with its terminating null character.
+static bool parse_range(size_t n, const char request[static n], bool is_seekable, struct range range[static 1]) {
+    const char *path;
+    enum tftp_mode mode;
+    uint32_t timeout_us = 0;
+    uint16_t block_size = tftp_default_blksize;
+    uint16_t window_size = tftp_default_window_size;
+    bool adaptive_timeout = false;
+    bool selective_ack = false;
+    bool pipeline = false;
+    uint8_t fec_group_size = 0;
+    struct tftp_session_stats_error error;
+    struct session_options options;
+    struct session_file file = {
+        .descriptor = -1,
+        .is_seekable = is_seekable,
+        .size = file_size,
+    };
+    *range = (struct range) {.offset = 0, .end = file_size};
+    return session_options_init(&options, n, request, &path, &mode, &timeout_us, &block_size, &window_size,
+                                &adaptive_timeout, &selective_ack, &pipeline, &fec_group_size, &range->offset,
+                                &range->end, &error)
+           && parse_options(&options, &file, false, false, true, 0, false, false);
+}
+
+TEST(session_options, offset_and_length_restrict_the_range) {
+    const char request[] = "file\0octet\0offset\0" "100\0length\0" "50";
+    struct range range;
+    ASSERT_TRUE(parse_range(sizeof request, request, true, &range));
+    ASSERT_EQ(range.offset, 100);
+    ASSERT_EQ(range.end, 150);
+}
+
+TEST(session_options, offset_past_the_end_gives_an_empty_range) {
+    const char request[] = "file\0octet\0offset\0" "5000\0length\0" "50";
+    struct range range;
+    ASSERT_TRUE(parse_range(sizeof request, request, true, &range));
+    ASSERT_EQ(range.offset, file_size);
+    ASSERT_EQ(range.end, file_size);
+}
+
+TEST(session_options, length_past_the_end_is_clamped_to_the_file) {
+    const char request[] = "file\0octet\0offset\0" "900\0length\0" "500";
+    struct range range;
+    ASSERT_TRUE(parse_range(sizeof request, request, true, &range));
+    ASSERT_EQ(range.offset, 900);
+    ASSERT_EQ(range.end, file_size);
+}
+
+TEST(session_options, length_alone_starts_from_the_beginning) {
+    const char request[] = "file\0octet\0length\0" "18446744073709551615";
+    struct range range;
+    ASSERT_TRUE(parse_range(sizeof request, request, true, &range));
+    ASSERT_EQ(range.offset, 0);
+    ASSERT_EQ(range.end, file_size);
+}
+
+TEST(session_options, unseekable_files_are_read_whole) {
+    const char request[] = "file\0octet\0offset\0" "100\0length\0" "50";
+    struct range range;
+    ASSERT_TRUE(parse_range(sizeof request, request, false, &range));
+    ASSERT_EQ(range.offset, 0);
+    ASSERT_EQ(range.end, file_size);
+}
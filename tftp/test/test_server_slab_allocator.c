@@ -0,0 +1,58 @@
+#include <buracchi/cutest/cutest.h>
+
+#include "slab_allocator.h"
+#include "mock_logger.h"
+
+TEST(slab_allocator, freed_blocks_are_reused_last_in_first_out) {
+    struct slab_allocator allocator;
+    struct slab_allocator_stats stats;
+    slab_allocator_init(&allocator, 1 << 20, false, &(struct logger) {});
+    void *first = slab_alloc(&allocator, 100);
+    void *second = slab_alloc(&allocator, 100);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    slab_free(&allocator, first);
+    slab_free(&allocator, second);
+    ASSERT_EQ(slab_alloc(&allocator, 110), second);
+    ASSERT_EQ(slab_alloc(&allocator, 100), first);
+    slab_allocator_collect_stats(&allocator, &stats);
+    ASSERT_EQ(stats.allocations, 4);
+    ASSERT_EQ(stats.reuses, 2);
+    ASSERT_EQ(stats.bytes_cached, 0);
+    slab_free(&allocator, first);
+    slab_free(&allocator, second);
+    slab_allocator_collect_stats(&allocator, &stats);
+    ASSERT_EQ(stats.allocations, 0);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+    slab_allocator_destroy(&allocator);
+}
+
+TEST(slab_allocator, size_classes_bound_wasted_memory) {
+    struct slab_allocator allocator;
+    struct slab_allocator_stats stats;
+    slab_allocator_init(&allocator, 0, false, &(struct logger) {});
+    for (size_t size = 65; size < (1 << 24); size = size * 3 / 2 + 7) {
+        void *block = slab_alloc(&allocator, size);
+        ASSERT_NE(block, nullptr);
+        slab_allocator_collect_stats(&allocator, &stats);
+        ASSERT_TRUE(stats.bytes_in_use >= size);
+        ASSERT_TRUE(stats.bytes_in_use <= size + size / 4);
+        slab_free(&allocator, block);
+    }
+    slab_allocator_destroy(&allocator);
+}
+
+TEST(slab_allocator, blocks_over_budget_are_released) {
+    struct slab_allocator allocator;
+    struct slab_allocator_stats stats;
+    slab_allocator_init(&allocator, 256, false, &(struct logger) {});
+    void *first = slab_alloc(&allocator, 200);
+    void *second = slab_alloc(&allocator, 200);
+    slab_free(&allocator, first);
+    slab_free(&allocator, second);
+    slab_allocator_collect_stats(&allocator, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+    ASSERT_TRUE(stats.bytes_cached >= 200);
+    ASSERT_TRUE(stats.bytes_cached <= 256);
+    slab_allocator_destroy(&allocator);
+}
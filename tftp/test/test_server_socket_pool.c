@@ -0,0 +1,109 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "socket_pool.h"
+#include "mock_logger.h"
+
+static uint16_t get_port(const struct socket_pool_socket socket[static 1]) {
+    return socket->address.ss_family == AF_INET6 ?
+           ntohs(((const struct sockaddr_in6 *) &socket->address)->sin6_port) :
+           ntohs(((const struct sockaddr_in *) &socket->address)->sin_port);
+}
+
+TEST(socket_pool, sockets_are_bound_to_ephemeral_ports) {
+    struct socket_pool pool;
+    const struct sockaddr_in6 address = {.sin6_family = AF_INET6, .sin6_addr = in6addr_loopback};
+    ASSERT_TRUE(socket_pool_init(&pool, (const struct sockaddr *) &address, sizeof address, 4, &(struct logger) {}));
+    struct socket_pool_socket first;
+    struct socket_pool_socket second;
+    ASSERT_TRUE(socket_pool_acquire(&pool, AF_INET6, &first));
+    ASSERT_TRUE(socket_pool_acquire(&pool, AF_INET6, &second));
+    ASSERT_EQ(first.address.ss_family, AF_INET6);
+    ASSERT_NE(get_port(&first), 0);
+    ASSERT_NE(get_port(&second), 0);
+    ASSERT_NE(get_port(&first), get_port(&second));
+    socket_pool_release(&pool, &first);
+    socket_pool_release(&pool, &second);
+    socket_pool_destroy(&pool);
+}
+
+TEST(socket_pool, returned_sockets_are_drained_before_reuse) {
+    constexpr size_t capacity = 4;
+    struct socket_pool pool;
+    const struct sockaddr_in6 address = {.sin6_family = AF_INET6, .sin6_addr = in6addr_loopback};
+    ASSERT_TRUE(socket_pool_init(&pool, (const struct sockaddr *) &address, sizeof address, capacity, &(struct logger) {}));
+    struct socket_pool_socket returned;
+    ASSERT_TRUE(socket_pool_acquire(&pool, AF_INET6, &returned));
+    int peer = socket(AF_INET6, SOCK_DGRAM, 0);
+    ASSERT_NE(peer, -1);
+    ASSERT_EQ(bind(peer, (const struct sockaddr *) &address, sizeof address), 0);
+    struct sockaddr_storage peer_address;
+    socklen_t peer_addrlen = sizeof peer_address;
+    ASSERT_EQ(getsockname(peer, (struct sockaddr *) &peer_address, &peer_addrlen), 0);
+    ASSERT_EQ(connect(returned.file_descriptor, (const struct sockaddr *) &peer_address, peer_addrlen), 0);
+    ASSERT_EQ(sendto(peer, "stale", 5, 0, (const struct sockaddr *) &returned.address, returned.addrlen), 5);
+    close(peer);
+    const uint16_t returned_port = get_port(&returned);
+    socket_pool_release(&pool, &returned);
+    // returned sockets are disconnected, keeping their port, and queued behind the idle ones
+    struct socket_pool_socket sockets[capacity + 1];
+    size_t count = 0;
+    bool is_reused = false;
+    while (!is_reused && count < capacity + 1) {
+        ASSERT_TRUE(socket_pool_acquire(&pool, AF_INET6, &sockets[count]));
+        is_reused = get_port(&sockets[count++]) == returned_port;
+    }
+    ASSERT_TRUE(is_reused);
+    char buffer[8];
+    ASSERT_EQ(recv(sockets[count - 1].file_descriptor, buffer, sizeof buffer, MSG_DONTWAIT), -1);
+    ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+    for (size_t i = 0; i < count; i++) {
+        socket_pool_release(&pool, &sockets[i]);
+    }
+    socket_pool_destroy(&pool);
+}
+
+TEST(socket_pool, connected_sockets_leave_other_peers_to_the_stray_socket) {
+    struct socket_pool pool;
+    const struct sockaddr_in6 address = {.sin6_family = AF_INET6, .sin6_addr = in6addr_loopback};
+    ASSERT_TRUE(socket_pool_init(&pool, (const struct sockaddr *) &address, sizeof address, 2, &(struct logger) {}));
+    struct socket_pool_socket pooled;
+    ASSERT_TRUE(socket_pool_acquire(&pool, AF_INET6, &pooled));
+    int client = socket(AF_INET6, SOCK_DGRAM, 0);
+    int stranger = socket(AF_INET6, SOCK_DGRAM, 0);
+    ASSERT_NE(client, -1);
+    ASSERT_NE(stranger, -1);
+    ASSERT_EQ(bind(client, (const struct sockaddr *) &address, sizeof address), 0);
+    struct sockaddr_storage client_address;
+    socklen_t client_addrlen = sizeof client_address;
+    ASSERT_EQ(getsockname(client, (struct sockaddr *) &client_address, &client_addrlen), 0);
+    ASSERT_EQ(connect(pooled.file_descriptor, (const struct sockaddr *) &client_address, client_addrlen), 0);
+    ASSERT_EQ(sendto(stranger, "stranger", 8, 0, (const struct sockaddr *) &pooled.address, pooled.addrlen), 8);
+    ASSERT_EQ(sendto(client, "client", 6, 0, (const struct sockaddr *) &pooled.address, pooled.addrlen), 6);
+    char buffer[16];
+    ASSERT_EQ(recv(pooled.file_descriptor, buffer, sizeof buffer, MSG_DONTWAIT), 6);
+    ASSERT_EQ(recv(pooled.file_descriptor, buffer, sizeof buffer, MSG_DONTWAIT), -1);
+    ASSERT_EQ(recv(pooled.stray_file_descriptor, buffer, sizeof buffer, MSG_DONTWAIT), 8);
+    close(client);
+    close(stranger);
+    socket_pool_release(&pool, &pooled);
+    socket_pool_destroy(&pool);
+}
+
+TEST(socket_pool, disabled_pool_serves_ipv4_peers_of_an_ipv6_server) {
+    struct socket_pool pool;
+    const struct sockaddr_in6 address = {.sin6_family = AF_INET6, .sin6_addr = in6addr_any};
+    ASSERT_TRUE(socket_pool_init(&pool, (const struct sockaddr *) &address, sizeof address, 0, &(struct logger) {}));
+    struct socket_pool_socket pooled;
+    ASSERT_TRUE(socket_pool_acquire(&pool, AF_INET, &pooled));
+    ASSERT_EQ(pooled.address.ss_family, AF_INET);
+    ASSERT_EQ(pooled.addrlen, sizeof(struct sockaddr_in));
+    ASSERT_NE(get_port(&pooled), 0);
+    socket_pool_release(&pool, &pooled);
+    ASSERT_EQ(socket_pool_collect_misses(&pool), 0);
+    socket_pool_destroy(&pool);
+}
@@ -0,0 +1,58 @@
+#include <buracchi/cutest/cutest.h>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include "start_queue.h"
+#include "mock_logger.h"
+
+static constexpr uint16_t jobs_count = 64;
+
+static int push_jobs(void *arg) {
+    struct start_queue *queue = arg;
+    for (uint16_t i = 0; i < jobs_count; i++) {
+        if (!start_queue_push(queue, i)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+TEST(start_queue, jobs_pushed_by_another_thread_are_taken_in_order) {
+    struct start_queue queue;
+    ASSERT_TRUE(start_queue_init(&queue, jobs_count, &(struct logger) {}));
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, push_jobs, &queue), thrd_success);
+    uint16_t taken = 0;
+    while (taken < jobs_count) {
+        eventfd_t value;
+        ASSERT_EQ(eventfd_read(queue.event_descriptor, &value), 0);
+        ASSERT_TRUE(value > 0);
+        uint16_t job_id;
+        while (start_queue_pop(&queue, &job_id)) {
+            ASSERT_EQ(job_id, taken);
+            taken++;
+        }
+    }
+    int ret;
+    ASSERT_EQ(thrd_join(thread, &ret), thrd_success);
+    ASSERT_EQ(ret, 0);
+    uint16_t job_id;
+    ASSERT_FALSE(start_queue_pop(&queue, &job_id));
+    start_queue_destroy(&queue);
+}
+
+TEST(start_queue, notify_wakes_up_without_a_job) {
+    struct start_queue queue;
+    ASSERT_TRUE(start_queue_init(&queue, 1, &(struct logger) {}));
+    struct pollfd pollfd = {.fd = queue.event_descriptor, .events = POLLIN};
+    ASSERT_EQ(poll(&pollfd, 1, 0), 0);
+    ASSERT_TRUE(start_queue_notify(&queue));
+    ASSERT_EQ(poll(&pollfd, 1, 0), 1);
+    uint16_t job_id;
+    ASSERT_FALSE(start_queue_pop(&queue, &job_id));
+    ASSERT_TRUE(start_queue_push(&queue, 7));
+    ASSERT_TRUE(start_queue_pop(&queue, &job_id));
+    ASSERT_EQ(job_id, 7);
+    start_queue_destroy(&queue);
+}
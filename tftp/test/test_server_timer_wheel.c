@@ -0,0 +1,88 @@
+#include <buracchi/cutest/cutest.h>
+
+#include "timer_wheel.h"
+#include "mock_logger.h"
+
+static constexpr uint64_t start = 1'000'000;
+
+TEST(timer_wheel, timer_expires_at_its_tick) {
+    static struct timer_wheel wheel;
+    timer_wheel_init(&wheel, start);
+    struct timer_wheel_timer timer = {.id = 42};
+    timer_wheel_arm(&wheel, &timer, start, 5);
+    timer_wheel_advance(&wheel, start + 4);
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), nullptr);
+    timer_wheel_advance(&wheel, start + 5);
+    struct timer_wheel_timer *expired = timer_wheel_pop_expired(&wheel);
+    ASSERT_EQ(expired, &timer);
+    ASSERT_EQ(expired->id, 42);
+    ASSERT_FALSE(timer_wheel_timer_is_armed(&timer));
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), nullptr);
+    ASSERT_TRUE(timer_wheel_is_empty(&wheel));
+}
+
+TEST(timer_wheel, cancelled_and_rearmed_timers) {
+    static struct timer_wheel wheel;
+    timer_wheel_init(&wheel, start);
+    struct timer_wheel_timer cancelled = {};
+    struct timer_wheel_timer rearmed = {};
+    timer_wheel_arm(&wheel, &cancelled, start, 10);
+    timer_wheel_arm(&wheel, &rearmed, start, 10);
+    timer_wheel_cancel(&wheel, &cancelled);
+    timer_wheel_arm(&wheel, &rearmed, start + 5, 10);
+    timer_wheel_advance(&wheel, start + 10);
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), nullptr);
+    timer_wheel_advance(&wheel, start + 15);
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), &rearmed);
+    ASSERT_TRUE(timer_wheel_is_empty(&wheel));
+}
+
+TEST(timer_wheel, expired_timers_can_be_cancelled_before_collection) {
+    static struct timer_wheel wheel;
+    timer_wheel_init(&wheel, start);
+    struct timer_wheel_timer first = {};
+    struct timer_wheel_timer second = {};
+    timer_wheel_arm(&wheel, &first, start, 1);
+    timer_wheel_arm(&wheel, &second, start, 1);
+    timer_wheel_advance(&wheel, start + 1);
+    timer_wheel_cancel(&wheel, &second);
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), &first);
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), nullptr);
+    ASSERT_TRUE(timer_wheel_is_empty(&wheel));
+}
+
+TEST(timer_wheel, timers_of_every_level_cascade_to_their_exact_tick) {
+    static struct timer_wheel wheel;
+    constexpr uint64_t delays[] = {1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145, 300000};
+    constexpr size_t count = sizeof delays / sizeof *delays;
+    const uint64_t now = start + 17;     // not aligned on a slot boundary
+    timer_wheel_init(&wheel, now);
+    struct timer_wheel_timer timers[count];
+    for (size_t i = 0; i < count; i++) {
+        timers[i] = (struct timer_wheel_timer) {.id = i};
+        timer_wheel_arm(&wheel, &timers[i], now, delays[i]);
+    }
+    size_t expired_count = 0;
+    for (uint64_t tick = now + 1; tick <= now + delays[count - 1]; tick++) {
+        timer_wheel_advance(&wheel, tick);
+        struct timer_wheel_timer *expired;
+        while ((expired = timer_wheel_pop_expired(&wheel)) != nullptr) {
+            ASSERT_EQ(now + delays[expired->id], tick);
+            expired_count++;
+        }
+    }
+    ASSERT_EQ(expired_count, count);
+    ASSERT_TRUE(timer_wheel_is_empty(&wheel));
+}
+
+TEST(timer_wheel, idle_wheel_catches_up_when_armed) {
+    static struct timer_wheel wheel;
+    timer_wheel_init(&wheel, start);
+    struct timer_wheel_timer timer = {};
+    const uint64_t later = start + 10'000'000;
+    timer_wheel_arm(&wheel, &timer, later, 3);
+    timer_wheel_advance(&wheel, later + 2);
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), nullptr);
+    timer_wheel_advance(&wheel, later + 3);
+    ASSERT_EQ(timer_wheel_pop_expired(&wheel), &timer);
+}
@@ -0,0 +1,50 @@
+#include <buracchi/cutest/cutest.h>
+
+#include "window_budget.h"
+#include "mock_logger.h"
+
+TEST(window_budget, window_fitting_the_budget_is_granted) {
+    struct window_budget budget;
+    window_budget_init(&budget, 1 << 20);
+    uint16_t block_size = 1024;
+    uint16_t window_size = 16;
+    size_t reserved = window_budget_reserve(&budget, &block_size, &window_size);
+    ASSERT_EQ(block_size, 1024);
+    ASSERT_EQ(window_size, 16);
+    ASSERT_EQ(reserved, window_budget_cost(1024, 16));
+    ASSERT_EQ(window_budget_collect_clamps(&budget), 0);
+    window_budget_release(&budget, reserved);
+    ASSERT_EQ(budget.reserved_bytes, 0);
+}
+
+TEST(window_budget, window_is_shrunk_to_the_headroom) {
+    struct window_budget budget;
+    window_budget_init(&budget, window_budget_cost(1024, 10));
+    uint16_t block_size = 1024;
+    uint16_t window_size = 64;
+    size_t first = window_budget_reserve(&budget, &block_size, &window_size);
+    ASSERT_EQ(block_size, 1024);
+    ASSERT_EQ(window_size, 10);
+    block_size = 1024;
+    window_size = 4;
+    size_t second = window_budget_reserve(&budget, &block_size, &window_size);
+    ASSERT_EQ(block_size, 512);
+    ASSERT_EQ(window_size, 1);
+    ASSERT_EQ(window_budget_collect_clamps(&budget), 2);
+    window_budget_release(&budget, first);
+    window_budget_release(&budget, second);
+    ASSERT_EQ(budget.reserved_bytes, 0);
+}
+
+TEST(window_budget, block_size_is_shrunk_when_a_single_block_does_not_fit) {
+    struct window_budget budget;
+    window_budget_init(&budget, 10'000);
+    uint16_t block_size = 65464;
+    uint16_t window_size = 16;
+    size_t reserved = window_budget_reserve(&budget, &block_size, &window_size);
+    ASSERT_EQ(window_size, 1);
+    ASSERT_TRUE(block_size > 512);
+    ASSERT_TRUE(block_size < 65464);
+    ASSERT_TRUE(reserved <= 10'000);
+    window_budget_release(&budget, reserved);
+}